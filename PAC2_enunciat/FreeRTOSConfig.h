@@ -48,6 +48,8 @@
 #define configMINIMAL_STACK_SIZE				( ( uint16_t ) 100 )
 #define configMAX_TASK_NAME_LEN					( 12 )
 #define configTOTAL_HEAP_SIZE					( ( size_t ) ( 48 * 1024 ) )
+/* The OSI layer builds its semaphores and mutexes in pools, see osi_pool.h */
+#define configSUPPORT_STATIC_ALLOCATION			1
 
 /* Constants that build features in or out. */
 #define configUSE_MUTEXES						1
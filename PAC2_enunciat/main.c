@@ -37,6 +37,7 @@
 /* Standard includes */
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 
 
@@ -48,10 +49,19 @@
 
 
 /* MSP432, Wi-Fi and UART includes */
+#include "driverlib.h"
 #include "msp432_launchpad_board.h"
+#include "msp432_launchpad_timestamp.h"
+#include "msp432_launchpad_log.h"
 #include "cc3100_boosterpack.h"
 #include "cli_uart.h"
 
+/* PING PONG includes */
+#include "pingpong_frame.h"
+#include "pingpong_histogram.h"
+#include "pingpong_stream.h"
+#include "ping_log.h"
+
 
 /*----------------------------------------------------------------------------*/
 
@@ -59,34 +69,247 @@
 #define MAIN_TASK_PRIORITY          ( tskIDLE_PRIORITY + 3 )
 #define SND_TASK_PRIORITY           ( tskIDLE_PRIORITY + 2 )
 #define RCV_TASK_PRIORITY           ( tskIDLE_PRIORITY + 1 )
+#define REACTOR_TASK_PRIORITY       ( tskIDLE_PRIORITY + 2 )
 #define BLINK_TASK_PRIORITY         ( tskIDLE_PRIORITY + 1 )
+#define STATS_TASK_PRIORITY         ( tskIDLE_PRIORITY + 1 )
+#define LOG_TASK_PRIORITY           ( tskIDLE_PRIORITY + 1 )
+#define SHELL_TASK_PRIORITY         ( tskIDLE_PRIORITY + 1 )
 
 #define MAIN_STACK_SIZE             ( 1024 )
 #define SND_STACK_SIZE              ( 1024 )
 #define RCV_STACK_SIZE              ( 1024 )
+#define REACTOR_STACK_SIZE          ( 1024 )
 #define BLINK_STACK_SIZE            ( 128 )
+#define STATS_STACK_SIZE            ( 512 )
+#define LOG_STACK_SIZE              ( 256 )
+#define SHELL_STACK_SIZE            ( 512 )
 
 #define SERVER_ADDRESS              ( "192.168.2.101")
 #define SERVER_PORT                 ( 5005 )
 #define BUFFER_SIZE                 ( 16 )
 #define PING_NUMBER                 ( 10  )
 
+/* Parallel TCP connections, more than one are multiplexed by ReactorTask */
+#define PING_CONNECTIONS            ( 1 )
+
+/* PINGs over TCP connections or as UDP datagrams */
+#define PING_TRANSPORT_TCP          ( 0 )
+#define PING_TRANSPORT_UDP          ( 1 )
+#define PING_TRANSPORT              ( PING_TRANSPORT_TCP )
+
+/* UDP PINGs are sent at a fixed rate instead of being clocked by the PONGs, */
+/* in whole ticks and at least one                                           */
+#define PING_INTERVAL_MS            ( 100 )
+
+/* PING/PONG encoding: padded "PING %d" text or length-prefixed binary frames */
+#define PING_FRAMING_TEXT           ( 0 )
+#define PING_FRAMING_BINARY         ( 1 )
+#define PING_FRAMING                ( PING_FRAMING_TEXT )
+
+/* Payload bytes carried by each binary PING, echoed back in its PONG */
+#define PING_PAYLOAD_SIZE           ( 0 )
+#define PING_PAYLOAD_MAX            ( 64 )
+
+/* PINGs that may be outstanding at once, 1 = stop-and-wait */
+#define PING_WINDOW                 ( 1 )
+#define PING_WINDOW_MAX             ( 8 )
+
+/* Receive buffer, holds several coalesced PONGs */
+#define PONG_BUFFER_SIZE            ( 64 + PING_PAYLOAD_MAX )
+
+#define PING_FRAME_SIZE             ( PINGPONG_FRAME_HEADER_SIZE + PING_PAYLOAD_MAX )
+
+/* Hot path messages: 1 = deferred binary records (decode with host/log_decode), 0 = text */
+#define PING_LOG_DEFERRED           ( 1 )
+
+/* LogTask drains the binary log this often when it is empty */
+#define LOG_INTERVAL_MS             ( 10 )
+
+/* Driver command round trips timed by the cmd shell command by default */
+#define CMD_BENCH_COUNT             ( 100 )
+#define CMD_BENCH_MAX               ( 10000 )
+
+/* Receiving tasks sleep in sl_Select, waking up at least this often */
+#define RCV_TIMEOUT_MS              ( 1000 )
+
+/* Button S1 dumps the RTT histogram on demand */
+#define DUMP_BUTTON_PORT            ( GPIO_PORT_P1 )
+#define DUMP_BUTTON_PIN             ( GPIO_PIN1 )
+
+#if (PING_PAYLOAD_SIZE > PING_PAYLOAD_MAX)
+#error "PING_PAYLOAD_MAX sizes the buffers, it must hold PING_PAYLOAD_SIZE"
+#endif
+
+#if (PING_TRANSPORT == PING_TRANSPORT_UDP)
+#if (PING_FRAMING != PING_FRAMING_BINARY)
+#error "UDP PINGs carry their sequence number and timestamp in binary frames"
+#endif
+#if (PING_CONNECTIONS > 1)
+#error "UDP PINGs use a single socket"
+#endif
+#endif
+
+#if (PING_LOG_DEFERRED)
+#define LOG0(id)                    MSP432_LAUNCHPAD_LOG0(id)
+#define LOG1(id, a)                 MSP432_LAUNCHPAD_LOG1(id, a)
+#define LOG2(id, a, b)              MSP432_LAUNCHPAD_LOG2(id, a, b)
+#else
+#define LOG0(id)                    LogText(id, 0, 0)
+#define LOG1(id, a)                 LogText(id, (uint32_t) (a), 0)
+#define LOG2(id, a, b)              LogText(id, (uint32_t) (a), (uint32_t) (b))
+#endif
+
+/*----------------------------------------------------------------------------*/
+
+/* Outstanding PINGs, indexed by sequence number modulo PING_WINDOW_MAX */
+typedef struct {
+    volatile uint32_t seq;
+    volatile uint32_t sent;
+    volatile bool pending;
+} ping_slot_t;
+
+/* Echo server of a connection */
+typedef struct {
+    const char *address;
+    uint16_t port;
+} ping_server_t;
+
+/* State of one connection to an echo server */
+typedef struct {
+    int16_t socket_id;
+    SlSockAddrIn_t address;
+    ping_slot_t slots[PING_WINDOW_MAX];
+
+    /* PINGs sent, PONGs received and the difference, used by ReactorTask */
+    uint32_t sent;
+    uint32_t received;
+    uint32_t in_flight;
+
+    /* The server closed the connection or its socket failed, no more PINGs */
+    bool closed;
+
+    /* Ticks at which the first PING was sent and the last PONG received */
+    TickType_t start;
+    TickType_t end;
+
+    /* Receive buffer, keeps the start of an incomplete PONG */
+    uint8_t rxBuffer[PONG_BUFFER_SIZE];
+    uint16_t rxLength;
+
+    /* Round trip times in microseconds, measured with the CPU cycle counter */
+    pingpong_histogram_t rtt;
+} ping_connection_t;
+
+/* Shell command, the argument is an empty string if none was given */
+typedef struct {
+    const char *name;
+    const char *help;
+    void (*handler)(const char *argument);
+} shell_command_t;
+
 /*----------------------------------------------------------------------------*/
 
 static void BlinkTask(void *pvParameters);
 static void MainTask(void *pvParameters);
+#if (PING_TRANSPORT == PING_TRANSPORT_UDP)
+static void UDPSendTask(void *pvParameters);
+static void UDPReceiveTask(void *pvParameters);
+#elif (PING_CONNECTIONS > 1)
+static void ReactorTask(void *pvParameters);
+#else
 static void SNDTask(void *pvParameters);
 static void RCVTask(void *pvParameters);
+#endif
+static uint32_t PingWindow(void);
+static uint32_t PingPayload(void);
+static bool PingReady(ping_connection_t *connection);
+static void PingSend(ping_connection_t *connection);
+static bool PongMatch(ping_connection_t *connection, uint32_t pong_seq, uint32_t now);
+static uint16_t PongParse(ping_connection_t *connection, uint8_t *buffer, uint16_t length);
+static uint32_t PongConsume(ping_connection_t *connection, uint16_t length);
+static void StatsTask(void *pvParameters);
+static void StatsThroughput(const char *label, uint32_t pongs, TickType_t start, TickType_t end);
+static void StatsSummary(void);
+static void StatsDump(void);
+#if (PING_LOG_DEFERRED)
+static void LogTask(void *pvParameters);
+#else
+static void LogText(uint8_t id, uint32_t a, uint32_t b);
+#endif
+static void ShellTask(void *pvParameters);
+static void ShellNotify(void);
+static void ShellExecute(char *line);
+static bool ShellValue(const char *argument, uint32_t min, uint32_t max, uint32_t *value);
+static void ShellHelp(const char *argument);
+static void ShellWindow(const char *argument);
+static void ShellPayload(const char *argument);
+static void ShellRate(const char *argument);
+static void ShellStats(const char *argument);
+static void ShellSpi(const char *argument);
+static void ShellSpiDirection(const char *label, const spi_direction_stats_t *stats);
+#if (SL_RX_AGGR)
+static void ShellAggr(const char *argument);
+#endif
+static void ShellCmd(const char *argument);
+static void ShellPool(const char *argument);
+#if (SPI_TRACE)
+static void ShellTrace(const char *argument);
+#endif
+#if (SL_CMD_TRACE)
+static void ShellCmdTrace(const char *argument);
+#endif
 
 /*----------------------------------------------------------------------------*/
 
 // Declaracion de un mutex
 SemaphoreHandle_t mutSOCKET;
+SemaphoreHandle_t mutSTATS;
 SemaphoreHandle_t semaphoreEND;
 SemaphoreHandle_t semaphoreRCV;
+SemaphoreHandle_t semaphoreDUMP;
 QueueHandle_t q;
 
-int16_t socket_id = -1;
+/* PINGs in flight per connection, can be changed at runtime (1..PING_WINDOW_MAX) */
+volatile uint32_t ping_window = PING_WINDOW;
+
+/* Payload of binary PINGs, can be changed at runtime (0..PING_PAYLOAD_MAX) */
+volatile uint32_t ping_payload = PING_PAYLOAD_SIZE;
+
+/* Interval between UDP PINGs, can be changed at runtime */
+volatile uint32_t ping_interval_ms = PING_INTERVAL_MS;
+
+/* Commands typed on the console, run by ShellTask */
+static const shell_command_t shell_commands[] = {
+    { "help",    "[name] list the commands",            ShellHelp },
+    { "window",  "[n] PINGs in flight per connection",  ShellWindow },
+    { "payload", "[n] payload bytes of binary PINGs",   ShellPayload },
+    { "rate",    "[n] UDP PINGs per second",            ShellRate },
+    { "stats",   "dump the RTT histogram and counters", ShellStats },
+    { "spi",     "[n] SPI counters, DMA above n bytes", ShellSpi },
+#if (SL_RX_AGGR)
+    { "aggr",    "[on|off] NWP RX aggregation",         ShellAggr },
+#endif
+    { "cmd",     "[n] time n driver commands",          ShellCmd },
+    { "pool",    "OSI object pools, use and peak",      ShellPool },
+#if (SPI_TRACE)
+    { "trace",   "[on|off|dump] SPI trace for replay",  ShellTrace },
+#endif
+#if (SL_CMD_TRACE)
+    { "cmdtrace", "[dump|clear] driver command times",  ShellCmdTrace },
+#endif
+};
+
+static TaskHandle_t shellTask = NULL;
+
+/* Server of each connection, empty entries use SERVER_ADDRESS and SERVER_PORT */
+static const ping_server_t ping_servers[PING_CONNECTIONS] = {
+    { SERVER_ADDRESS, SERVER_PORT },
+};
+
+static ping_connection_t connections[PING_CONNECTIONS];
+
+/* Loss, duplicates, reordering and jitter of the UDP PONGs */
+static pingpong_stream_t udp_stream;
 
 static void BlinkTask(void *pvParameters) {
     while(true)
@@ -109,6 +332,9 @@ static void MainTask(void *pvParameters) {
     int16_t retVal = -1;
     SlSockAddrIn_t Addr;
     int ip_address;
+    char address[20];
+    uint16_t port;
+    uint8_t i;
     char message[50];
 
     // Intenta coger el mutex, bloqueandose si no esta disponible
@@ -122,37 +348,61 @@ static void MainTask(void *pvParameters) {
         while(1);
     }
 
-    /* Set socket address */
-    retVal = stringToAddress(SERVER_ADDRESS, &ip_address);
+    for (i = 0; i < PING_CONNECTIONS; i++) {
+
+    /* Set socket address, stringToAddress writes into the string */
+    if (ping_servers[i].address != NULL) {
+        strncpy(address, ping_servers[i].address, sizeof(address) - 1);
+        port = ping_servers[i].port;
+    } else {
+        strncpy(address, SERVER_ADDRESS, sizeof(address) - 1);
+        port = SERVER_PORT;
+    }
+    address[sizeof(address) - 1] = '\0';
+
+    retVal = stringToAddress(address, &ip_address);
     if (!retVal) {
         CLI_Write(" Malformed IP address. \n\r");
     }
     Addr.sin_family = AF_INET;
     Addr.sin_addr.s_addr = sl_Htonl( (uint32_t) ip_address);
-    Addr.sin_port = sl_Htons((uint16_t) SERVER_PORT);
+    Addr.sin_port = sl_Htons(port);
+    connections[i].address = Addr;
 
-    /* Create TCP socket */
-    while (socket_id < 0){
+    /* Create socket */
+    while (connections[i].socket_id < 0){
 
-        socket_id =  wifi_tcp_client_open(&Addr);
+#if (PING_TRANSPORT == PING_TRANSPORT_UDP)
+        connections[i].socket_id =  wifi_udp_client_open(&Addr);
+#else
+        connections[i].socket_id =  wifi_tcp_client_open(&Addr);
+#endif
 
-        if (socket_id < 0) {
+        if (connections[i].socket_id < 0) {
             led_red_on();
-            CLI_Write(" Failed to create TCP socket. \n\r");
+            CLI_Write(" Failed to create socket. \n\r");
         }
+    }
+    }
+
         /* Libera el mutex */
         xSemaphoreGive( mutSOCKET );
-    }
         vTaskDelay(pdMS_TO_TICKS(1000));
     }
 
     // Intenta coger el mutex, bloqueandose si no esta disponible
     xSemaphoreTake( semaphoreEND, portMAX_DELAY );{
 
-    retVal = wifi_client_close(socket_id);
+    for (i = 0; i < PING_CONNECTIONS; i++) {
+    /* Already closed if the server went away */
+    if (connections[i].socket_id < 0) {
+        continue;
+    }
+    retVal = wifi_client_close(connections[i].socket_id);
     if (retVal <0){
         led_red_on();
-        CLI_Write(" Failed to close TCP socket. \n\r");
+        CLI_Write(" Failed to close socket. \n\r");
+    }
     }
     CLI_Write ("PING PONG finished!");
 
@@ -160,45 +410,392 @@ static void MainTask(void *pvParameters) {
 
 }
 
-static void SNDTask(void *pvParameters) {
+static uint32_t PingWindow(void)
+{
+    uint32_t window;
 
+    /* Window size may have been changed at runtime */
+    window = ping_window;
+    if (window < 1) {
+        window = 1;
+    } else if (window > PING_WINDOW_MAX) {
+        window = PING_WINDOW_MAX;
+    }
+
+    return window;
+}
+
+static uint32_t PingPayload(void)
+{
+    uint32_t payload;
+
+    /* Payload size may have been changed at runtime */
+    payload = ping_payload;
+    if (payload > PING_PAYLOAD_MAX) {
+        payload = PING_PAYLOAD_MAX;
+    }
+
+    return payload;
+}
+
+static bool PingReady(ping_connection_t *connection)
+{
+    /* More PINGs to send, and the slot of the next one is not waiting for its PONG */
+    return connection->sent < PING_NUMBER &&
+           !connection->slots[connection->sent % PING_WINDOW_MAX].pending;
+}
+
+static void PingSend(ping_connection_t *connection)
+{
     int16_t retVal = -1;
 
+#if (PING_FRAMING == PING_FRAMING_BINARY)
+    /* Payload is not touched by the encoder, it stays zeroed */
+    static uint8_t txBuffer[PING_FRAME_SIZE];
+
+    uint16_t txLength;
+
+    pingpong_frame_t frame;
+#else
     uint8_t txBuffer[BUFFER_SIZE];
+#endif
 
-    uint32_t ping_counter = 0;
+    ping_slot_t *slot;
 
-    BaseType_t status;
+    /* Turn green LED on */
+    led_green_on();
 
-    char message[50];
+    slot = &connection->slots[connection->sent % PING_WINDOW_MAX];
+    slot->seq = connection->sent;
+    slot->sent = msp432_launchpad_timestamp_get();
+    slot->pending = true;
+
+    /* Send TCP packet*/
+#if (PING_FRAMING == PING_FRAMING_BINARY)
+    frame.type = PINGPONG_FRAME_PING;
+    frame.length = PingPayload();
+    frame.seq = connection->sent;
+    frame.timestamp = slot->sent;
+    frame.payload = NULL;
+    txLength = pingpong_frame_encode(&frame, txBuffer, sizeof(txBuffer));
+    retVal =  wifi_tcp_client_send(connection->socket_id, txBuffer, txLength);
+#else
+    memset(txBuffer, 0, BUFFER_SIZE);
+    sprintf((char*) txBuffer, "PING %u", connection->sent);
+    retVal =  wifi_tcp_client_send(connection->socket_id, txBuffer, BUFFER_SIZE);
+#endif
+    if (retVal <0){
+        led_red_on();
+        LOG2(PING_LOG_SEND_FAILED, connection->sent, retVal);
+    }
+    LOG1(PING_LOG_SENT, connection->sent);
+
+    connection->sent++;
+}
+
+#if (PING_TRANSPORT == PING_TRANSPORT_UDP)
+
+static void UDPSendTask(void *pvParameters) {
+
+    int16_t retVal = -1;
+
+    ping_connection_t *connection = &connections[0];
+
+    uint8_t txBuffer[PING_FRAME_SIZE];
+
+    uint16_t txLength;
+
+    pingpong_frame_t frame;
+
+    TickType_t wake;
+
+    TickType_t interval;
 
     // Intenta coger el mutex, bloqueandose si no esta disponible
     xSemaphoreTake( mutSOCKET, portMAX_DELAY );
     {
 
-    for(;;)
+    /* Payload is not touched by the encoder, it stays zeroed */
+    memset(txBuffer, 0, sizeof(txBuffer));
+
+    connection->start = xTaskGetTickCount();
+    wake = connection->start;
+
+    while (connection->sent < PING_NUMBER)
     {
 
     /* Turn green LED on */
     led_green_on();
 
-    /* Send TCP packet*/
-    sprintf(message, "PING %d", ping_counter);
-    strcpy((char*) txBuffer, message);
-    retVal =  wifi_tcp_client_send(socket_id, txBuffer, BUFFER_SIZE);
+    /* Every datagram carries its own sequence number and timestamp */
+    frame.type = PINGPONG_FRAME_PING;
+    frame.length = PingPayload();
+    frame.seq = connection->sent;
+    frame.timestamp = msp432_launchpad_timestamp_get();
+    frame.payload = NULL;
+    txLength = pingpong_frame_encode(&frame, txBuffer, sizeof(txBuffer));
+
+    /* Send UDP packet */
+    retVal = wifi_udp_client_send(connection->socket_id, &connection->address, txBuffer, txLength);
     if (retVal <0){
         led_red_on();
-        CLI_Write(" Failed to send data through TCP socket. \n\r");
+        LOG2(PING_LOG_SEND_FAILED, connection->sent, retVal);
     }
-    sprintf(message, "Sent PING %d \n\r", ping_counter);
-    CLI_Write((unsigned char*) message);
+    LOG1(PING_LOG_SENT, connection->sent);
+
+    connection->sent++;
+
+    /*Allow to receive */
+    if (connection->sent == 1) {
+        xSemaphoreGive( semaphoreRCV );
+    }
+
+    /* Fixed rate, whatever happens to the PONGs. At least a tick, */
+    /* vTaskDelayUntil asserts on 0                                 */
+    interval = pdMS_TO_TICKS(ping_interval_ms);
+    if (interval == 0) {
+        interval = 1;
+    }
+    vTaskDelayUntil(&wake, interval);
+    }
+
+    /* Nothing else to send */
+    vTaskSuspend(NULL);
+    }
+}
+
+static void UDPReceiveTask(void *pvParameters) {
+
+    int16_t retVal = -1;
+
+    ping_connection_t *connection = &connections[0];
+
+    SlSockAddrIn_t from;
+
+    SlSocklen_t fromLength;
+
+    pingpong_frame_t frame;
+
+    uint32_t now, rtt;
+
+    int32_t ready;
+
+    /* Take semaphore to recive if sender has granted it*/
+    xSemaphoreTake( semaphoreRCV, portMAX_DELAY );{
+
+    for(;;){
+
+    /* Sleep until the NWP signals a datagram */
+    ready = wifi_select_receive(&connection->socket_id, 1, RCV_TIMEOUT_MS);
+    if (ready < 0) {
+        LOG1(PING_LOG_WAIT_FAILED, ready);
+        continue;
+    }
+
+    /* Once everything is sent, a silent timeout means the rest is lost */
+    if (ready == 0) {
+        if (connection->sent >= PING_NUMBER) {
+            break;
+        }
+        continue;
+    }
+
+    fromLength = sizeof(from);
+    retVal = wifi_udp_client_receive(connection->socket_id, &from, &fromLength,
+                                     connection->rxBuffer, PONG_BUFFER_SIZE);
+    if (retVal < 1) {
+        continue;
+    }
+    now = msp432_launchpad_timestamp_get();
+
+    /* A datagram holds exactly one frame */
+    if (pingpong_frame_decode(&frame, connection->rxBuffer, retVal) != retVal ||
+        frame.type != PINGPONG_FRAME_PONG) {
+        LOG0(PING_LOG_MALFORMED);
+        continue;
+    }
+
+    /* The PONG echoes the timestamp of its PING, no need to remember it */
+    rtt = msp432_launchpad_timestamp_to_us(now - frame.timestamp);
+    if (pingpong_stream_record(&udp_stream, frame.seq, rtt) == PINGPONG_STREAM_DUPLICATE) {
+        continue;
+    }
+
+    pingpong_histogram_record(&connection->rtt, rtt);
+    LOG2(PING_LOG_PONG, frame.seq, rtt);
+    connection->received++;
+    connection->end = xTaskGetTickCount();
+
+    if (connection->received >= PING_NUMBER) {
+        break;
+    }
+    }
+
+    StatsSummary();
+    StatsDump();
+
+    /* Release the sempahore to close the socket */
+    xSemaphoreGive( semaphoreEND );
+
+    /* Nothing else to receive */
+    vTaskSuspend(NULL);
+    }
+}
+
+#elif (PING_CONNECTIONS > 1)
+
+static void ReactorTask(void *pvParameters) {
+
+    int16_t retVal = -1;
+
+    /* Sockets still waiting for PONGs, and their connection */
+    int16_t socket_ids[PING_CONNECTIONS];
+    uint8_t active[PING_CONNECTIONS];
+    uint8_t count;
+
+    ping_connection_t *connection;
+
+    uint32_t window;
+
+    uint32_t pongs;
+
+    int32_t ready;
+
+    uint8_t i;
+
+    // Intenta coger el mutex, bloqueandose si no esta disponible
+    xSemaphoreTake( mutSOCKET, portMAX_DELAY );
+    {
+
+    for (i = 0; i < PING_CONNECTIONS; i++) {
+        connections[i].start = xTaskGetTickCount();
+    }
+
+    for(;;)
+    {
+
+    window = PingWindow();
+
+    /* Fill the window of every connection that has not finished yet */
+    count = 0;
+    for (i = 0; i < PING_CONNECTIONS; i++) {
+        connection = &connections[i];
+        if (connection->received >= PING_NUMBER || connection->closed) {
+            continue;
+        }
+
+        while (connection->in_flight < window && PingReady(connection)) {
+            PingSend(connection);
+            connection->in_flight++;
+        }
+
+        socket_ids[count] = connection->socket_id;
+        active[count] = i;
+        count++;
+    }
+
+    if (count == 0) {
+        break;
+    }
+
+    /* Sleep in a single sl_Select until any of the connections has data */
+    ready = wifi_select_receive(socket_ids, count, RCV_TIMEOUT_MS);
+    if (ready < 0) {
+        LOG1(PING_LOG_WAIT_FAILED, ready);
+        continue;
+    }
+
+    for (i = 0; i < count; i++) {
+        if (!(ready & (1 << i))) {
+            continue;
+        }
+
+        connection = &connections[active[i]];
+        retVal = wifi_tcp_client_receive(connection->socket_id,
+                                         &connection->rxBuffer[connection->rxLength],
+                                         PONG_BUFFER_SIZE - 1 - connection->rxLength);
+        if (retVal == SL_EAGAIN) {
+            continue;
+        }
+
+        /* Closed by the server, or failed and closed by the wrapper: it would */
+        /* stay readable and keep sl_Select from ever sleeping                  */
+        if (retVal < 1) {
+            LOG2(PING_LOG_CLOSED, active[i], retVal);
+            if (retVal == 0) {
+                wifi_client_close(connection->socket_id);
+            }
+            connection->socket_id = -1;
+            connection->closed = true;
+            connection->end = xTaskGetTickCount();
+            continue;
+        }
+
+        pongs = PongConsume(connection, retVal);
+        connection->in_flight -= (pongs < connection->in_flight) ? pongs : connection->in_flight;
+
+        if (pongs > 0 && connection->received >= PING_NUMBER) {
+            connection->end = xTaskGetTickCount();
+        }
+    }
+
+    }
+
+    StatsSummary();
+    StatsDump();
+
+    /* Release the sempahore to close connections */
+    xSemaphoreGive( semaphoreEND );
+
+    /* Nothing else to do */
+    vTaskSuspend(NULL);
+    }
+}
+
+#else
+
+static void SNDTask(void *pvParameters) {
+
+    ping_connection_t *connection = &connections[0];
+
+    uint32_t pong_seq;
+
+    uint32_t in_flight = 0;
+
+    uint32_t window;
+
+    BaseType_t status;
+
+    // Intenta coger el mutex, bloqueandose si no esta disponible
+    xSemaphoreTake( mutSOCKET, portMAX_DELAY );
+    {
+
+    connection->start = xTaskGetTickCount();
+
+    for(;;)
+    {
+
+    window = PingWindow();
+
+    /* Fill the window, unless the slot of the next PING is still waiting for its PONG */
+    while (in_flight < window && PingReady(connection))
+    {
+
+    PingSend(connection);
 
     /*Allow to receive */
-    xSemaphoreGiveFromISR( semaphoreRCV, pdFALSE );
+    if (connection->sent == 1) {
+        xSemaphoreGiveFromISR( semaphoreRCV, pdFALSE );
+    }
 
-    /* Block until PONG has been received in order to keep sending */
-    status = xQueueReceive( q, &ping_counter, portMAX_DELAY );
+    in_flight++;
+    }
 
+    /* Block until a PONG has been received in order to keep sending */
+    status = xQueueReceive( q, &pong_seq, portMAX_DELAY );
+    if (status == pdPASS && in_flight > 0) {
+        in_flight--;
+    }
 
     }
     }
@@ -208,49 +805,715 @@ static void RCVTask(void *pvParameters) {
 
     int16_t retVal = -1;
 
-    uint8_t rxBuffer[BUFFER_SIZE];
+    ping_connection_t *connection = &connections[0];
 
-    uint32_t ping_counter=0;
+    uint32_t pongs;
 
     BaseType_t status;
 
     /* Take semaphore to recive if sender has granted it*/
     xSemaphoreTake( semaphoreRCV, portMAX_DELAY );{
 
-    char message[50];
-
     for(;;){
 
-    /* Receive TCP packet */
-    retVal = -1;
-    while (retVal<1){
+    /* Receive TCP packet, the task sleeps until the NWP signals data */
+    retVal = SL_EAGAIN;
+    while (retVal == SL_EAGAIN){
         //CLI_Write(" TASK2-waiting for Pong. \n\r");
-        retVal = wifi_tcp_client_receive(socket_id, rxBuffer,  BUFFER_SIZE);
+        retVal = wifi_tcp_client_receive_timeout(connection->socket_id,
+                                                 &connection->rxBuffer[connection->rxLength],
+                                                 PONG_BUFFER_SIZE - 1 - connection->rxLength,
+                                                 RCV_TIMEOUT_MS);
     }
 
-    rxBuffer[retVal] = '\0';
-    CLI_Write(rxBuffer); CLI_Write("\n\r");
+    /* Closed by the server, or failed and closed by the wrapper: it would */
+    /* stay readable and sl_Select would never sleep again                  */
+    if (retVal < 1) {
+        LOG2(PING_LOG_CLOSED, 0, retVal);
+        if (retVal == 0) {
+            wifi_client_close(connection->socket_id);
+        }
+        connection->socket_id = -1;
+        connection->closed = true;
+        pongs = 0;
+    } else {
+        pongs = PongConsume(connection, retVal);
+    }
 
-    /* Increase counter */
-    ping_counter++;
+    if (connection->received >= PING_NUMBER || connection->closed) {
 
-    if (ping_counter==PING_NUMBER) {
+        connection->end = xTaskGetTickCount();
+        StatsSummary();
+        StatsDump();
 
         /* Release the sempahore to close connection */
         xSemaphoreGiveFromISR( semaphoreEND, pdFALSE );
 
-    } else {
+        /* Nothing else to receive */
+        vTaskSuspend(NULL);
+    }
 
-        /* Return counter to Task 2 */
-        status =  xQueueSendToBack( q, &ping_counter, 0);
+    /* Return a credit to the sender for every PONG so it can keep the window full */
+    while (pongs-- > 0) {
+        status =  xQueueSendToBack( q, &connection->received, 0);
 
         if( status != pdPASS ) {
-            CLI_Write(" Failed to send data to the queue. \n\r");
+            LOG0(PING_LOG_QUEUE_FAILED);
+        }
+    }
+    }
+    }
+
+}
+
+#endif
+
+static bool PongMatch(ping_connection_t *connection, uint32_t pong_seq, uint32_t now)
+{
+    ping_slot_t *slot;
+    uint32_t rtt;
+
+    /* Match it against the outstanding PINGs, in any order */
+    slot = &connection->slots[pong_seq % PING_WINDOW_MAX];
+    if (!slot->pending || slot->seq != pong_seq) {
+        LOG1(PING_LOG_UNEXPECTED, pong_seq);
+        return false;
+    }
+    slot->pending = false;
+
+    rtt = msp432_launchpad_timestamp_to_us(now - slot->sent);
+    pingpong_histogram_record(&connection->rtt, rtt);
+    LOG2(PING_LOG_PONG, pong_seq, rtt);
+
+    /* Increase counter */
+    connection->received++;
+
+    return true;
+}
+
+#if (PING_FRAMING == PING_FRAMING_BINARY)
+
+static uint16_t PongParse(ping_connection_t *connection, uint8_t *buffer, uint16_t length)
+{
+    pingpong_frame_t frame;
+    uint32_t now;
+    int32_t used;
+    uint16_t start = 0;
+
+    now = msp432_launchpad_timestamp_get();
+
+    /* TCP may split or coalesce frames, handle every complete one */
+    while ((used = pingpong_frame_decode(&frame, &buffer[start], length - start)) > 0)
+    {
+        start += used;
+
+        if (frame.type != PINGPONG_FRAME_PONG) {
+            LOG1(PING_LOG_UNEXPECTED, frame.seq);
+            continue;
+        }
+
+        PongMatch(connection, frame.seq, now);
+    }
+
+    /* Out of sync with the server, drop everything */
+    if (used < 0) {
+        LOG0(PING_LOG_MALFORMED);
+        return length;
+    }
+
+    return start;
+}
+
+#else
+
+static uint16_t PongParse(ping_connection_t *connection, uint8_t *buffer, uint16_t length)
+{
+    char *pong, *end;
+    uint32_t pong_seq;
+    uint32_t now;
+    uint16_t i, start = 0;
+
+    now = msp432_launchpad_timestamp_get();
+
+    /* TCP may split or coalesce PONGs, handle every complete one */
+    for (i = 0; i < length; i++)
+    {
+        if (buffer[i] != '\0') {
+            continue;
+        }
+
+        pong = (char*) &buffer[start];
+        start = i + 1;
+
+        /* The server echoes the number of the PING, "PING <n>" gets "PONG <n>" */
+        if (strncmp(pong, "PONG ", 5) != 0) {
+            LOG0(PING_LOG_MALFORMED);
+            continue;
+        }
+        pong_seq = strtoul(&pong[5], &end, 10);
+        if (end == &pong[5]) {
+            LOG0(PING_LOG_MALFORMED);
+            continue;
+        }
+
+        PongMatch(connection, pong_seq, now);
+    }
+
+    return start;
+}
+
+#endif
+
+static uint32_t PongConsume(ping_connection_t *connection, uint16_t length)
+{
+    uint32_t received = connection->received;
+    uint16_t start;
+
+    connection->rxLength += length;
+
+    start = PongParse(connection, connection->rxBuffer, connection->rxLength);
+
+    /* Keep the start of an incomplete PONG for the next receive */
+    connection->rxLength -= start;
+    memmove(connection->rxBuffer, &connection->rxBuffer[start], connection->rxLength);
+    if (connection->rxLength == PONG_BUFFER_SIZE - 1) {
+        LOG0(PING_LOG_MALFORMED);
+        connection->rxLength = 0;
+    }
+
+    /* PONGs matched by this receive */
+    return connection->received - received;
+}
+
+static void StatsThroughput(const char *label, uint32_t pongs, TickType_t start, TickType_t end)
+{
+    uint32_t elapsed;
+    char message[80];
+
+    elapsed = (end - start) * portTICK_PERIOD_MS;
+    sprintf(message, "%s: %u PONGs in %u ms (%u msg/s) \n\r",
+            label, pongs, elapsed,
+            elapsed ? (pongs * 1000) / elapsed : 0);
+    CLI_Write((unsigned char*) message);
+}
+
+static void StatsSummary(void) {
+
+    char label[30];
+    TickType_t start, end;
+    uint32_t pongs = 0;
+    uint8_t i;
+
+    start = connections[0].start;
+    end = connections[0].end;
+
+    for (i = 0; i < PING_CONNECTIONS; i++) {
+#if (PING_CONNECTIONS > 1)
+        sprintf(label, "Connection %u", i);
+        StatsThroughput(label, connections[i].received,
+                        connections[i].start, connections[i].end);
+#endif
+        pongs += connections[i].received;
+        if ((int32_t) (connections[i].start - start) < 0) {
+            start = connections[i].start;
+        }
+        if ((int32_t) (connections[i].end - end) > 0) {
+            end = connections[i].end;
+        }
+    }
+
+#if (PING_TRANSPORT == PING_TRANSPORT_UDP)
+    sprintf(label, "Interval %u ms", ping_interval_ms);
+#else
+    sprintf(label, "Window %u", ping_window);
+#endif
+    StatsThroughput(label, pongs, start, end);
+}
+
+static void StatsDump(void) {
+
+    /* Too big for the stack of the tasks that call it, mutSTATS keeps the
+     * RCV tasks, the reactor and StatsTask from sharing it */
+    static pingpong_histogram_t aggregate;
+    char message[160];
+    uint8_t i;
+
+    xSemaphoreTake( mutSTATS, portMAX_DELAY );
+
+    pingpong_histogram_reset(&aggregate);
+
+    for (i = 0; i < PING_CONNECTIONS; i++) {
+#if (PING_CONNECTIONS > 1)
+        sprintf(message, "RTT %u (us): ", i);
+        CLI_Write((unsigned char*) message);
+        pingpong_histogram_format(&connections[i].rtt, message, sizeof(message));
+        CLI_Write((unsigned char*) message);
+        CLI_Write(" \n\r");
+#endif
+        pingpong_histogram_merge(&aggregate, &connections[i].rtt);
+    }
+
+    CLI_Write("RTT (us): ");
+    pingpong_histogram_format(&aggregate, message, sizeof(message));
+    CLI_Write((unsigned char*) message);
+    CLI_Write(" \n\r");
+
+#if (PING_TRANSPORT == PING_TRANSPORT_UDP)
+    CLI_Write("UDP: ");
+    pingpong_stream_format(&udp_stream, connections[0].sent, message, sizeof(message));
+    CLI_Write((unsigned char*) message);
+    CLI_Write(" (us) \n\r");
+#endif
+
+    /* Lines lost to a full console ring, the statistics above are complete */
+    if (CLI_Dropped() > 0) {
+        sprintf(message, "Console dropped %lu lines \n\r", CLI_Dropped());
+        CLI_Write((unsigned char*) message);
+    }
+    /* CC3100 interrupts the spawn task could not take, their messages wait for the next one */
+    if (osi_SpawnDropped() > 0) {
+        sprintf(message, "Spawn dropped %lu calls \n\r", osi_SpawnDropped());
+        CLI_Write((unsigned char*) message);
+    }
+#if (PING_LOG_DEFERRED)
+    if (msp432_launchpad_log_dropped() > 0) {
+        sprintf(message, "Log dropped %lu records \n\r",
+                (unsigned long) msp432_launchpad_log_dropped());
+        CLI_Write((unsigned char*) message);
+    }
+#endif
+
+    xSemaphoreGive( mutSTATS );
+}
+
+static void StatsTask(void *pvParameters) {
+
+    for(;;)
+    {
+        /* Wait until the dump button is pressed */
+        xSemaphoreTake( semaphoreDUMP, portMAX_DELAY );
+
+        StatsDump();
+    }
+}
+
+#if (PING_LOG_DEFERRED)
+
+static void LogTask(void *pvParameters) {
+
+    /* One frame at a time, at most PINGPONG_LOG_FRAME_SIZE bytes */
+    static uint8_t frame[PINGPONG_LOG_FRAME_SIZE];
+    uint16_t length;
+
+    for(;;)
+    {
+        length = msp432_launchpad_log_drain(frame);
+        if (length == 0) {
+            vTaskDelay(pdMS_TO_TICKS(LOG_INTERVAL_MS));
+            continue;
+        }
+
+        /* Never drop a frame, wait for the UART to make room instead */
+        while (CLI_WriteBytes(frame, length) == 0) {
+            vTaskDelay(1);
+        }
+    }
+}
+
+#else
+
+static void LogText(uint8_t id, uint32_t a, uint32_t b) {
+
+    static const char *formats[PING_LOG_COUNT] = PING_LOG_FORMATS;
+    char message[64];
+
+    snprintf(message, sizeof(message) - 3, formats[id], a, b);
+    strcat(message, " \n\r");
+    CLI_Write((unsigned char*) message);
+}
+
+#endif
+
+static void ShellTask(void *pvParameters) {
+
+    unsigned char line[CLI_RX_LINE_SIZE];
+
+    CLI_Write("Type help for the commands \n\r");
+
+    for(;;)
+    {
+        /* Wait until the console has a complete line */
+        ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+
+        while (CLI_ReadLine(line, sizeof(line)) >= 0) {
+            ShellExecute((char*) line);
+        }
+    }
+}
+
+static void ShellNotify(void) {
+
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    /* Called from the UART interrupt */
+    vTaskNotifyGiveFromISR( shellTask, &xHigherPriorityTaskWoken );
+
+    portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+}
+
+static void ShellExecute(char *line) {
+
+    char *name, *argument;
+    uint8_t i;
+
+    /* "name [argument]", surrounding spaces are ignored */
+    name = line;
+    while (*name == ' ') {
+        name++;
+    }
+    argument = name;
+    while (*argument != '\0' && *argument != ' ') {
+        argument++;
+    }
+    if (*argument != '\0') {
+        *argument++ = '\0';
+        while (*argument == ' ') {
+            argument++;
+        }
+    }
+
+    if (*name == '\0') {
+        return;
+    }
+
+    for (i = 0; i < sizeof(shell_commands) / sizeof(shell_commands[0]); i++) {
+        if (strcmp(name, shell_commands[i].name) == 0) {
+            shell_commands[i].handler(argument);
+            return;
+        }
+    }
+
+    CLI_Write("Unknown command, type help \n\r");
+}
+
+static bool ShellValue(const char *argument, uint32_t min, uint32_t max, uint32_t *value) {
+
+    char message[50];
+    char *end;
+    unsigned long number;
+
+    number = strtoul(argument, &end, 10);
+    while (*end == ' ') {
+        end++;
+    }
+    if (end == argument || *end != '\0' || number < min || number > max) {
+        sprintf(message, "Expected a number from %u to %u \n\r", min, max);
+        CLI_Write((unsigned char*) message);
+        return false;
+    }
+
+    *value = number;
+    return true;
+}
+
+static void ShellHelp(const char *argument) {
+
+    char message[60];
+    bool found = false;
+    uint8_t i;
+
+    /* "help" lists every command, "help <name>" only that one */
+    for (i = 0; i < sizeof(shell_commands) / sizeof(shell_commands[0]); i++) {
+        if (*argument != '\0' && strcmp(argument, shell_commands[i].name) != 0) {
+            continue;
+        }
+        sprintf(message, "%-8s %s \n\r", shell_commands[i].name, shell_commands[i].help);
+        CLI_Write((unsigned char*) message);
+        found = true;
+    }
+
+    if (!found) {
+        CLI_Write("Unknown command, type help \n\r");
+    }
+}
+
+static void ShellWindow(const char *argument) {
+
+    char message[30];
+    uint32_t value;
+
+    if (*argument != '\0' && ShellValue(argument, 1, PING_WINDOW_MAX, &value)) {
+        ping_window = value;
+    }
+
+    sprintf(message, "Window %u \n\r", PingWindow());
+    CLI_Write((unsigned char*) message);
+}
+
+static void ShellPayload(const char *argument) {
+
+    char message[30];
+    uint32_t value;
+
+#if (PING_FRAMING != PING_FRAMING_BINARY)
+    CLI_Write("Text PINGs have no payload \n\r");
+#endif
+
+    if (*argument != '\0' && ShellValue(argument, 0, PING_PAYLOAD_MAX, &value)) {
+        ping_payload = value;
+    }
+
+    sprintf(message, "Payload %u bytes \n\r", PingPayload());
+    CLI_Write((unsigned char*) message);
+}
+
+static void ShellRate(const char *argument) {
+
+    char message[40];
+    uint32_t value;
+    uint32_t ticks;
+
+#if (PING_TRANSPORT != PING_TRANSPORT_UDP)
+    CLI_Write("TCP PINGs are clocked by the PONGs \n\r");
+#endif
+
+    /* Whole ticks between PINGs, so at most a PING per tick */
+    if (*argument != '\0' && ShellValue(argument, 1, configTICK_RATE_HZ, &value)) {
+        ticks = configTICK_RATE_HZ / value;
+        ping_interval_ms = (ticks * 1000) / configTICK_RATE_HZ;
+    }
+
+    /* The rate applied, which the rounding to ticks may have lowered */
+    ticks = pdMS_TO_TICKS(ping_interval_ms);
+    if (ticks == 0) {
+        ticks = 1;
+    }
+    sprintf(message, "Interval %u ms (%u PINGs/s) \n\r",
+            (uint32_t) ((ticks * 1000) / configTICK_RATE_HZ), (uint32_t) (configTICK_RATE_HZ / ticks));
+    CLI_Write((unsigned char*) message);
+}
+
+static void ShellStats(const char *argument) {
+
+    char message[40];
+
+    sprintf(message, "Console dropped %lu input lines \n\r", CLI_LinesDropped());
+    CLI_Write((unsigned char*) message);
+
+    /* StatsTask owns the dump, as for the button */
+    xSemaphoreGive( semaphoreDUMP );
+}
+
+static void ShellSpi(const char *argument) {
+
+    /* Too big for the stack of the shell task */
+    static spi_stats_t stats;
+    char message[60];
+    uint32_t value;
+
+    if (*argument != '\0' && ShellValue(argument, 0, 4096, &value)) {
+        spi_SetDmaThreshold(value);
+    }
+
+    spi_GetStats(&stats);
+    ShellSpiDirection("TX", &stats.tx);
+    ShellSpiDirection("RX", &stats.rx);
+
+    sprintf(message, "SPI DMA above %d bytes, %lu messages split \n\r",
+            stats.dma_threshold, stats.split_messages);
+    CLI_Write((unsigned char*) message);
+}
+
+static void ShellSpiDirection(const char *label, const spi_direction_stats_t *stats) {
+
+    char message[160];
+    uint32_t cyclesPerUs;
+    uint8_t i;
+    int length;
+
+    cyclesPerUs = msp432_launchpad_timestamp_from_us(1);
+
+    sprintf(message, "SPI %s: %lu transfers (%lu DMA), %lu bytes, "
+                     "%lu us polling, %lu us DMA, max CS %lu us \n\r",
+            label, stats->transfers, stats->dma_transfers,
+            (unsigned long) stats->bytes,
+            (unsigned long) (stats->poll_cycles / cyclesPerUs),
+            (unsigned long) (stats->dma_cycles / cyclesPerUs),
+            (unsigned long) msp432_launchpad_timestamp_to_us(stats->max_cs_cycles));
+    CLI_Write((unsigned char*) message);
+
+    /* Bucket bounds are 4, 16, 64, ... bytes, the last one has none */
+    length = sprintf(message, "SPI %s sizes:", label);
+    for (i = 0; i < SPI_STATS_BUCKETS; i++) {
+        length += sprintf(&message[length], " %lu", stats->sizes[i]);
+    }
+    strcpy(&message[length], " \n\r");
+    CLI_Write((unsigned char*) message);
+}
+
+#if (SL_RX_AGGR)
+static void ShellAggr(const char *argument) {
+
+    char message[40];
+    int32_t retVal = 0;
+
+    if (strcmp(argument, "on") == 0) {
+        retVal = wifi_set_rx_aggregation(true);
+    } else if (strcmp(argument, "off") == 0) {
+        retVal = wifi_set_rx_aggregation(false);
+    }
+
+    if (retVal < 0) {
+        sprintf(message, "RX aggregation failed %ld \n\r", (long) retVal);
+        CLI_Write((unsigned char*) message);
+    }
+    sprintf(message, "RX aggregation %s \n\r", wifi_get_rx_aggregation() ? "on" : "off");
+    CLI_Write((unsigned char*) message);
+}
+#endif
+
+static void ShellCmd(const char *argument) {
+
+    /* Too big for the stack of the shell task */
+    static pingpong_histogram_t latency;
+    char message[160];
+    uint8_t mac[SL_MAC_ADDR_LEN];
+    uint8_t length;
+    uint32_t count = CMD_BENCH_COUNT;
+    uint32_t i, start;
+    int32_t retVal;
+
+    if (*argument != '\0' && !ShellValue(argument, 1, CMD_BENCH_MAX, &count)) {
+        return;
+    }
+
+    /* The cheapest command with a response, each one a full trip through _SlDrvCmdOp */
+    pingpong_histogram_reset(&latency);
+    for (i = 0; i < count; i++) {
+        length = SL_MAC_ADDR_LEN;
+        start = msp432_launchpad_timestamp_get();
+        retVal = sl_NetCfgGet(SL_MAC_ADDRESS_GET, NULL, &length, mac);
+        pingpong_histogram_record(&latency,
+                                  msp432_launchpad_timestamp_to_us(msp432_launchpad_timestamp_get() - start));
+        if (retVal < 0) {
+            sprintf(message, "Command failed %ld \n\r", (long) retVal);
+            CLI_Write((unsigned char*) message);
+            return;
+        }
+    }
+
+    CLI_Write("Command round trip (us): ");
+    pingpong_histogram_format(&latency, message, sizeof(message));
+    CLI_Write((unsigned char*) message);
+    CLI_Write(" \n\r");
+}
+
+static void ShellPool(const char *argument) {
+
+    static const char * const names[OSI_POOL_COUNT] = {
+        "sync objects", "semaphores", "driver CB", "async buffers"
+    };
+    OsiPool_t pool;
+    char message[100];
+    uint8_t i;
+
+    for (i = 0; i < OSI_POOL_COUNT; i++) {
+        /* The driver CB and async buffers only with SL_MEMORY_MGMT_DYNAMIC */
+        if (osi_PoolStats(i, &pool) != OSI_OK) {
+            continue;
+        }
+        sprintf(message, "Pool %s: %lu of %lu used, peak %lu, %lu failed, %lu bytes each \n\r",
+                names[i], (unsigned long) pool.ulUsed, (unsigned long) pool.ulBlocks,
+                (unsigned long) pool.ulPeak, (unsigned long) pool.ulFailed,
+                (unsigned long) pool.ulBlockSize);
+        CLI_Write((unsigned char*) message);
+    }
+}
+
+#if (SPI_TRACE)
+static void ShellTrace(const char *argument) {
+
+    const unsigned char *trace;
+    unsigned long length, dropped, offset, i;
+    char message[80];
+    int line;
+
+    if (strcmp(argument, "on") == 0) {
+        spi_TraceStart();
+    } else if (strcmp(argument, "off") == 0) {
+        spi_TraceStop();
+    } else if (strcmp(argument, "dump") == 0) {
+        /* Hex lines for host/sl_replay, which skips everything else */
+        spi_TraceStop();
+        trace = spi_TraceGet(&length, &dropped);
+        for (offset = 0; offset < length; offset += 32) {
+            line = sprintf(message, "trace ");
+            for (i = offset; i < length && i < offset + 32; i++) {
+                line += sprintf(&message[line], "%02x", trace[i]);
+            }
+            strcpy(&message[line], " \n\r");
+            CLI_Write((unsigned char*) message);
         }
     }
+
+    trace = spi_TraceGet(&length, &dropped);
+    sprintf(message, "SPI trace %lu bytes, %lu records dropped \n\r", length, dropped);
+    CLI_Write((unsigned char*) message);
+}
+#endif
+
+#if (SL_CMD_TRACE)
+static void ShellCmdTrace(const char *argument) {
+
+    pingpong_cmdtrace_record_t record;
+    char message[PINGPONG_CMDTRACE_LINE_SIZE + 3];
+    uint32_t sequence, end;
+
+    if (strcmp(argument, "clear") == 0) {
+        CmdTraceClear();
+    } else if (strcmp(argument, "dump") == 0) {
+        /* Hex lines for host/sl_trace, which skips everything else. Only */
+        /* the records there when the dump starts, the driver adds more   */
+        end = CmdTraceCount();
+        sequence = 0;
+        while ((int32_t) (end - sequence) > 0 && CmdTraceRead(&sequence, &record)) {
+            pingpong_cmdtrace_format(&record, message);
+            strcat(message, " \n\r");
+            CLI_Write((unsigned char*) message);
+        }
     }
+
+    sprintf(message, "Command trace %lu records \n\r", (unsigned long) CmdTraceCount());
+    CLI_Write((unsigned char*) message);
+}
+#endif
+
+void PORT1_IRQHandler(void) {
+
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    uint32_t status;
+
+    status = MAP_GPIO_getEnabledInterruptStatus(DUMP_BUTTON_PORT);
+    MAP_GPIO_clearInterruptFlag(DUMP_BUTTON_PORT, status);
+
+    if (status & DUMP_BUTTON_PIN) {
+        xSemaphoreGiveFromISR( semaphoreDUMP, &xHigherPriorityTaskWoken );
     }
 
+    portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+}
+
+/* The OSI pools need configSUPPORT_STATIC_ALLOCATION, which leaves the idle task to us */
+void vApplicationGetIdleTaskMemory(StaticTask_t **ppxIdleTaskTCBBuffer,
+                                   StackType_t **ppxIdleTaskStackBuffer,
+                                   uint32_t *pulIdleTaskStackSize) {
+
+    static StaticTask_t idleTask;
+    static StackType_t idleStack[configMINIMAL_STACK_SIZE];
+
+    *ppxIdleTaskTCBBuffer = &idleTask;
+    *ppxIdleTaskStackBuffer = idleStack;
+    *pulIdleTaskStackSize = configMINIMAL_STACK_SIZE;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -258,17 +1521,33 @@ static void RCVTask(void *pvParameters) {
 int main(int argc, char** argv){
 
     mutSOCKET = xSemaphoreCreateMutex();
+    mutSTATS = xSemaphoreCreateMutex();
     semaphoreEND = xSemaphoreCreateBinary();
     semaphoreRCV = xSemaphoreCreateBinary();
-    q = xQueueCreate(5, sizeof(int32_t));
+    semaphoreDUMP = xSemaphoreCreateBinary();
+    q = xQueueCreate(PING_WINDOW_MAX, sizeof(int32_t));
 
     // Comprueba si semaforo y mutex se han creado bien
-    if (mutSOCKET!=NULL)
+    if (mutSOCKET!=NULL && mutSTATS!=NULL)
     {
     int32_t retVal = -1;
+    uint8_t i;
     /* Initialize the board */
     board_init();
 
+    /* Start the cycle counter used to timestamp PINGs */
+    msp432_launchpad_timestamp_init();
+
+    for (i = 0; i < PING_CONNECTIONS; i++) {
+        connections[i].socket_id = -1;
+        pingpong_histogram_reset(&connections[i].rtt);
+    }
+    pingpong_stream_reset(&udp_stream);
+
+    /* The dump button and the console call FreeRTOS from their ISRs */
+    MAP_Interrupt_setPriority(INT_PORT1, 0xE0);
+    MAP_Interrupt_setPriority(INT_EUSCIA0, 0xE0);
+
     /* Set up Command Line Interface (UART) */
     CLI_Configure();
 
@@ -306,6 +1585,49 @@ int main(int argc, char** argv){
         while(1);
     }
 
+#if (PING_TRANSPORT == PING_TRANSPORT_UDP)
+    /* Create UDP send task */
+    retVal = xTaskCreate(UDPSendTask,
+                         "UDPSendTask",
+                         SND_STACK_SIZE,
+                         NULL,
+                         SND_TASK_PRIORITY,
+                         NULL );
+
+    if(retVal < 0)
+    {
+        led_red_on();
+        while(1);
+    }
+
+    /* Create UDP receive task */
+    retVal = xTaskCreate(UDPReceiveTask,
+                         "UDPReceiveTask",
+                         RCV_STACK_SIZE,
+                         NULL,
+                         RCV_TASK_PRIORITY,
+                         NULL );
+
+    if(retVal < 0)
+    {
+        led_red_on();
+        while(1);
+    }
+#elif (PING_CONNECTIONS > 1)
+    /* Create reactor task */
+    retVal = xTaskCreate(ReactorTask,
+                         "ReactorTask",
+                         REACTOR_STACK_SIZE,
+                         NULL,
+                         REACTOR_TASK_PRIORITY,
+                         NULL );
+
+    if(retVal < 0)
+    {
+        led_red_on();
+        while(1);
+    }
+#else
     /* Create send task */
     retVal = xTaskCreate(SNDTask,
                          "SNDTask",
@@ -333,6 +1655,54 @@ int main(int argc, char** argv){
         led_red_on();
         while(1);
     }
+#endif
+
+    /* Create stats task */
+    retVal = xTaskCreate(StatsTask,
+                         "StatsTask",
+                         STATS_STACK_SIZE,
+                         NULL,
+                         STATS_TASK_PRIORITY,
+                         NULL );
+
+    if(retVal < 0)
+    {
+        led_red_on();
+        while(1);
+    }
+
+#if (PING_LOG_DEFERRED)
+    /* Create log task, sends the binary log when nothing else runs */
+    retVal = xTaskCreate(LogTask,
+                         "LogTask",
+                         LOG_STACK_SIZE,
+                         NULL,
+                         LOG_TASK_PRIORITY,
+                         NULL );
+
+    if(retVal < 0)
+    {
+        led_red_on();
+        while(1);
+    }
+#endif
+
+    /* Create shell task, reconfigures the benchmark from the console */
+    retVal = xTaskCreate(ShellTask,
+                         "ShellTask",
+                         SHELL_STACK_SIZE,
+                         NULL,
+                         SHELL_TASK_PRIORITY,
+                         &shellTask );
+
+    if(retVal < 0)
+    {
+        led_red_on();
+        while(1);
+    }
+
+    /* Lines typed from now on wake the shell task up */
+    CLI_SetLineCallback(ShellNotify);
 
     /* Start the task scheduler */
     vTaskStartScheduler();
@@ -52,8 +52,11 @@ extern void SystemInit(void);
 extern unsigned long __STACK_END;
 
 /* External declarations for the interrupt handlers used by the application. */
+extern void PORT1_IRQHandler(void);
 extern void PORT2_IRQHandler(void);
 extern void EUSCIA0_IRQHandler(void);
+extern void DMA_INT1_IRQHandler(void);
+extern void T32_INT1_IRQHandler(void);
 
 /* External declarations for the FreeRTOS interrupt handlers. */
 extern void xPortSysTickHandler( void );
@@ -107,7 +110,7 @@ void (* const interruptVectors[])(void) =
     defaultISR,                             /* EUSCIB2 ISR               */
     defaultISR,                             /* EUSCIB3 ISR               */
     defaultISR,                             /* ADC14 ISR                 */
-    defaultISR,                             /* T32_INT1 ISR              */
+    T32_INT1_IRQHandler,                    /* T32_INT1 ISR              */
     defaultISR,                             /* T32_INT2 ISR              */
     defaultISR,                             /* T32_INTC ISR              */
     defaultISR,                             /* AES ISR                   */
@@ -115,9 +118,9 @@ void (* const interruptVectors[])(void) =
     defaultISR,                             /* DMA_ERR ISR               */
     defaultISR,                             /* DMA_INT3 ISR              */
     defaultISR,                             /* DMA_INT2 ISR              */
-    defaultISR,                             /* DMA_INT1 ISR              */
+    DMA_INT1_IRQHandler,                    /* DMA_INT1 ISR              */
     defaultISR,                             /* DMA_INT0 ISR              */
-	defaultISR,                             /* PORT1 ISR                 */
+	PORT1_IRQHandler,                       /* PORT1 ISR                 */
 	PORT2_IRQHandler,                       /* PORT2 ISR                 */
     defaultISR,                             /* PORT3 ISR                 */
     defaultISR,                             /* PORT4 ISR                 */
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#ifndef PING_LOG_H_
+#define PING_LOG_H_
+
+#include "pingpong_log.h"
+
+/*
+ * Messages of the PING/PONG hot path, logged as deferred binary records
+ * (see msp432_launchpad_log.h). Only the id travels, host/log_decode includes
+ * this file to turn it back into text. Arguments are 32-bit words, use %u,
+ * %d or %x. Append new messages at the end so old captures still decode.
+ */
+#define PING_LOG_MESSAGES(X) \
+    X(PING_LOG_SENT,            "Sent PING %u") \
+    X(PING_LOG_PONG,            "PONG %u, RTT %u us") \
+    X(PING_LOG_UNEXPECTED,      "Unexpected PONG %u") \
+    X(PING_LOG_MALFORMED,       "Malformed PONG, dropped") \
+    X(PING_LOG_SEND_FAILED,     "Failed to send PING %u: %d") \
+    X(PING_LOG_WAIT_FAILED,     "Failed to wait for PONGs: %d") \
+    X(PING_LOG_QUEUE_FAILED,    "Failed to send data to the queue") \
+    X(PING_LOG_CLOSED,          "Connection %u closed: %d")
+
+#define PING_LOG_ENUM(id, format)       id,
+#define PING_LOG_FORMAT(id, format)     format,
+
+enum {
+    PING_LOG_DROPPED = PINGPONG_LOG_DROPPED,
+    PING_LOG_MESSAGES(PING_LOG_ENUM)
+    PING_LOG_COUNT
+};
+
+/* Format strings indexed by id, to initialise a const char* array */
+#define PING_LOG_FORMATS { "Log dropped %u records", PING_LOG_MESSAGES(PING_LOG_FORMAT) }
+
+#endif /* PING_LOG_H_ */
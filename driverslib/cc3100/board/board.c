@@ -40,6 +40,12 @@
 #include "board.h"
 #include "driverlib.h"
 
+#include "msp432_launchpad_timestamp.h"
+
+#if (SPI_TRACE)
+#include "pingpong_trace.h"
+#endif
+
 /*----------------------------------------------------------------------------*/
 
 #define CC3100_IRQ_PORT             ( GPIO_PORT_P2 )
@@ -48,12 +54,22 @@
 #define CC3100_nHIB_PORT            ( GPIO_PORT_P4 )
 #define CC3100_nHIB_PIN             ( GPIO_PIN1 )
 
+/* Records of the command trace, 20 bytes each */
+#ifndef SL_CMD_TRACE_SIZE
+#define SL_CMD_TRACE_SIZE           ( 64 )
+#endif
+
 /*----------------------------------------------------------------------------*/
 
 P_EVENT_HANDLER pIraEventHandler = 0;
 
 unsigned char IntIsMasked;
 
+#if (SL_CMD_TRACE)
+static pingpong_cmdtrace_record_t cmdTraceRecords[SL_CMD_TRACE_SIZE];
+static pingpong_cmdtrace_t cmdTrace = { cmdTraceRecords, SL_CMD_TRACE_SIZE, 0 };
+#endif
+
 /*----------------------------------------------------------------------------*/
 
 int registerInterruptHandler(P_EVENT_HANDLER InterruptHdl, void* pValue)
@@ -68,6 +84,9 @@ int registerInterruptHandler(P_EVENT_HANDLER InterruptHdl, void* pValue)
 void CC3100_enable(void)
 {
     MAP_GPIO_setOutputHighOnPin(CC3100_nHIB_PORT, CC3100_nHIB_PIN);
+#if (SPI_TRACE)
+    spi_TraceEvent(PINGPONG_TRACE_ENABLE);
+#endif
 }
 
 /*----------------------------------------------------------------------------*/
@@ -75,6 +94,9 @@ void CC3100_enable(void)
 void CC3100_disable(void)
 {
     MAP_GPIO_setOutputLowOnPin(CC3100_nHIB_PORT, CC3100_nHIB_PIN);
+#if (SPI_TRACE)
+    spi_TraceEvent(PINGPONG_TRACE_DISABLE);
+#endif
 }
 
 /*----------------------------------------------------------------------------*/
@@ -173,6 +195,9 @@ void PORT2_IRQHandler(void)
     if (MAP_GPIO_getInterruptStatus(CC3100_IRQ_PORT, CC3100_IRQ_PIN))
     {
         MAP_GPIO_clearInterruptFlag(CC3100_IRQ_PORT, CC3100_IRQ_PIN);
+#if (SPI_TRACE)
+        spi_TraceEvent(PINGPONG_TRACE_IRQ);
+#endif
         if (pIraEventHandler)
         {
             pIraEventHandler(0);
@@ -181,3 +206,80 @@ void PORT2_IRQHandler(void)
 }
 
 /*----------------------------------------------------------------------------*/
+
+unsigned long GetTimestampUs(void)
+{
+    return msp432_launchpad_timestamp_us();
+}
+
+/*----------------------------------------------------------------------------*/
+
+#if (SL_CMD_TRACE)
+void CmdTraceAdd(uint16_t Opcode, uint32_t Start, uint32_t Written, uint32_t Response, uint32_t Woken)
+{
+    pingpong_cmdtrace_record_t record;
+    bool masked;
+
+    record.opcode = Opcode;
+    record.start = Start;
+    record.written = Written;
+    record.response = Response;
+    record.woken = Woken;
+
+    /* Every task that calls the driver adds records */
+    masked = MAP_Interrupt_disableMaster();
+    pingpong_cmdtrace_add(&cmdTrace, &record);
+    if (!masked)
+    {
+        MAP_Interrupt_enableMaster();
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+bool CmdTraceRead(uint32_t *pSequence, pingpong_cmdtrace_record_t *pRecord)
+{
+    bool found;
+    bool masked;
+
+    masked = MAP_Interrupt_disableMaster();
+    if ((int32_t) (*pSequence - pingpong_cmdtrace_first(&cmdTrace)) < 0)
+    {
+        *pSequence = pingpong_cmdtrace_first(&cmdTrace);
+    }
+    found = pingpong_cmdtrace_get(&cmdTrace, *pSequence, pRecord);
+    if (!masked)
+    {
+        MAP_Interrupt_enableMaster();
+    }
+
+    if (found)
+    {
+        (*pSequence)++;
+    }
+    return found;
+}
+
+/*----------------------------------------------------------------------------*/
+
+uint32_t CmdTraceCount(void)
+{
+    return cmdTrace.added;
+}
+
+/*----------------------------------------------------------------------------*/
+
+void CmdTraceClear(void)
+{
+    bool masked;
+
+    masked = MAP_Interrupt_disableMaster();
+    pingpong_cmdtrace_reset(&cmdTrace, cmdTraceRecords, SL_CMD_TRACE_SIZE);
+    if (!masked)
+    {
+        MAP_Interrupt_enableMaster();
+    }
+}
+#endif
+
+/*----------------------------------------------------------------------------*/
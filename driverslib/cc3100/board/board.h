@@ -41,6 +41,11 @@
 
 #include <msp432.h>
 
+/* Only the projects that build the command trace have driverslib/pingpong */
+#if (SL_CMD_TRACE)
+#include "pingpong_cmdtrace.h"
+#endif
+
 #define UART_READ_JITTER_BUFFER_SIZE       4
 #define UART_READ_JITTER_RTS_GUARD         3
 
@@ -314,4 +319,61 @@ void initAntSelGPIO(void);
 */
 void SelAntenna(int antenna);
 
+/*!
+    \brief     Microseconds since boot, for sl_GetTimestamp
+
+    \return         msp432_launchpad_timestamp_us, wraps every ~71 minutes
+
+    \warning
+*/
+unsigned long GetTimestampUs(void);
+
+#if (SL_CMD_TRACE)
+/*!
+    \brief     Adds a record to the command trace, for sl_CmdTrace
+
+    \param[in]      Opcode, Start, Written, Response, Woken : see user.h
+
+    \return         none
+
+    \note           Only with SL_CMD_TRACE. Over the oldest record when the
+                    SL_CMD_TRACE_SIZE records are taken
+
+    \warning
+*/
+void CmdTraceAdd(uint16_t Opcode, uint32_t Start, uint32_t Written, uint32_t Response, uint32_t Woken);
+
+/*!
+    \brief     Copies a record of the command trace
+
+    \param[in,out]  pSequence : sequence number of the record, moved to the
+                    oldest one left if it was overwritten and then past it
+    \param[out]     pRecord : the record
+
+    \return         false when there is no record at *pSequence
+
+    \warning
+*/
+bool CmdTraceRead(uint32_t *pSequence, pingpong_cmdtrace_record_t *pRecord);
+
+/*!
+    \brief     Records added to the command trace, the sequence number of
+               the next one
+
+    \return         number of records
+
+    \warning
+*/
+uint32_t CmdTraceCount(void);
+
+/*!
+    \brief     Empties the command trace
+
+    \return         none
+
+    \warning
+*/
+void CmdTraceClear(void);
+#endif
+
 #endif
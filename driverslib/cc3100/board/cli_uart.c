@@ -47,23 +47,44 @@
 
 #define _USE_CLI_
 
+/* 115200 baud from SMCLK = 48 MHz: 48e6/115200 = 416.67 = 16 * 26.04 */
 #define UCA0_OS   1    /* 1 = oversampling mode, 0 = low-freq mode */
-#define UCA0_BR0  17   /* Value of UCA1BR0 register */
-#define UCA0_BR1  0    /* Value of UCA1BR1 register */
-#define UCA0_BRS  0    /* Value of UCBRS field in UCA1MCTL register */
-#define UCA0_BRF  6    /* Value of UCBRF field in UCA1MCTL register */
+#define UCA0_BR0  26   /* Value of UCA0BR0 register */
+#define UCA0_BR1  0    /* Value of UCA0BR1 register */
+#define UCA0_BRS  0xD6 /* Value of UCBRS field in UCA0MCTLW register (fraction 0.67) */
+#define UCA0_BRF  0    /* Value of UCBRF field in UCA0MCTLW register */
 
+#define ASCII_BACKSPACE 0x08
+#define ASCII_NEWLINE   0x0A
 #define ASCII_ENTER     0x0D
+#define ASCII_DELETE    0x7F
 
 #ifdef _USE_CLI_
-unsigned char *g_ucUARTBuffer;
+/*
+ * RX line discipline: the interrupt edits cli_rx_line and, on enter, moves
+ * it to cli_rx_ready for CLI_ReadLine. A line arriving before the previous
+ * one was read, or longer than CLI_RX_LINE_SIZE - 1, is discarded whole.
+ */
+static unsigned char cli_rx_line[CLI_RX_LINE_SIZE];
+static unsigned short cli_rx_length = 0;
+static bool cli_rx_overflow = false;
+static unsigned char cli_rx_ready[CLI_RX_LINE_SIZE];
+static volatile unsigned short cli_rx_ready_length = 0;
+static volatile bool cli_rx_have_line = false;
+static volatile unsigned long cli_rx_dropped = 0;
+static void (*cli_rx_callback)(void) = NULL;
 
-int cli_have_cmd = 0;
+/*
+ * TX ring: writers append under a short critical section and return, the
+ * EUSCI_A0 TX interrupt sends one byte per UCTXIFG until it is empty.
+ * Indices run freely and wrap modulo 2^16, CLI_TX_BUFFER_SIZE divides that.
+ */
+static unsigned char cli_tx_buffer[CLI_TX_BUFFER_SIZE];
+static volatile unsigned short cli_tx_head = 0;
+static volatile unsigned short cli_tx_tail = 0;
+static volatile unsigned long cli_tx_dropped = 0;
 #endif
 
-#define UCBRF_0                (0x00)           /* USCI First Stage Modulation: 0 */
-#define UCBRS_3                (0x0600)         /* USCI First Stage Modulation: 3 */
-
 /*----------------------------------------------------------------------------*/
 
 void CLI_Configure(void)
@@ -76,19 +97,23 @@ void CLI_Configure(void)
     /* Use SMCLK, keep RESET */
     UCA0CTLW0 = UCSSEL__SMCLK + UCSWRST;
 
-    /* 48MHz/9600 = 5000 */
-    UCA0BR0 = 139;
-    UCA0BR1 = 19;
-
-    /* Modulation UCBRSx=3, UCBRFx=0 */
-    UCA0MCTLW = UCBRS_3 + UCBRF_0;
+    UCA0BR0 = UCA0_BR0;
+    UCA0BR1 = UCA0_BR1;
+    UCA0MCTLW = (UCA0_BRS << 8) | (UCA0_BRF << 4) | (UCA0_OS ? UCOS16 : 0);
 
     /* Initialize USCI state machine */
     UCA0CTLW0 &= ~UCSWRST;
 
-    /* Disable RX Interrupt on UART */
-    UCA0IFG &= ~ (UCRXIFG | UCRXIFG);
-    UCA0IE &= ~UCRXIE;
+    /* RX Interrupt is always on, TX is enabled when there is data */
+    UCA0IFG &= ~UCRXIFG;
+    UCA0IE &= ~UCTXIE;
+
+    cli_tx_head = 0;
+    cli_tx_tail = 0;
+    cli_rx_length = 0;
+    cli_rx_have_line = false;
+    UCA0IE |= UCRXIE;
+    Interrupt_enableInterrupt(INT_EUSCIA0);
 #endif
 }
 
@@ -96,45 +121,130 @@ void CLI_Configure(void)
 
 int CLI_Read(unsigned char *pBuff)
 {
+    int iLength;
+
     if(pBuff == NULL)
         return -1;
 #ifdef _USE_CLI_
-    cli_have_cmd = 0;
-    g_ucUARTBuffer = pBuff;
-    UCA0IE |= UCRXIE;
+    /* Sleep between characters, every one of them wakes the CPU up */
+    while ((iLength = CLI_ReadLine(pBuff, CLI_RX_LINE_SIZE)) < 0)
+    {
+        PCM_gotoLPM0();
+    }
 
-    Interrupt_enableMaster();
-    Interrupt_enableInterrupt(INT_EUSCIA0);
-    PCM_gotoLPM0();
+    return iLength;
+#else
+    return 0;
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
 
-    // __bis_SR_register(LPM0_bits + GIE);
+int CLI_ReadLine(unsigned char *pBuff, unsigned short usSize)
+{
+    unsigned short usLength;
 
-    while(cli_have_cmd == 0);
-    UCA0IE &= ~UCRXIE;
+    if (pBuff == NULL || usSize == 0)
+        return -1;
+#ifdef _USE_CLI_
+    if (!cli_rx_have_line)
+        return -1;
 
-    return strlen((const char *)pBuff);
+    /* The interrupt leaves cli_rx_ready alone until the flag is cleared */
+    usLength = cli_rx_ready_length;
+    if (usLength > usSize - 1)
+    {
+        usLength = usSize - 1;
+    }
+    memcpy(pBuff, cli_rx_ready, usLength);
+    pBuff[usLength] = 0x00;
+    cli_rx_have_line = false;
+
+    return (int)usLength;
 #else
-    return 0;
+    return -1;
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+
+void CLI_SetLineCallback(void (*pfnCallback)(void))
+{
+#ifdef _USE_CLI_
+    cli_rx_callback = pfnCallback;
 #endif
 }
 
 /*----------------------------------------------------------------------------*/
 
 int CLI_Write(unsigned char *inBuff)
+{
+    if (inBuff == NULL)
+        return -1;
+
+    return CLI_WriteBytes(inBuff, strlen((const char *)inBuff));
+}
+
+/*----------------------------------------------------------------------------*/
+
+int CLI_WriteBytes(const unsigned char *inBuff, unsigned short usLength)
 {
     if (inBuff == NULL)
         return -1;
 #ifdef _USE_CLI_
-    unsigned short ret,usLength = strlen((const char *)inBuff);
-    ret = usLength;
-    while (usLength)
+    unsigned short usCopied = 0, usChunk, usFree;
+    bool bMasked;
+#if (CLI_TX_OVERFLOW == CLI_TX_OVERFLOW_BLOCK)
+    /* Only a task can wait for the TX interrupt: from an ISR, with interrupts
+     * masked or inside a critical section (BASEPRI) it would never run */
+    bool bBlock = (__get_IPSR() == 0) && (__get_PRIMASK() == 0) && (__get_BASEPRI() == 0);
+#else
+    bool bBlock = false;
+#endif
+
+    /* A string longer than the whole ring would never fit, keep its start */
+    if (!bBlock && usLength > CLI_TX_BUFFER_SIZE)
     {
-        while (!(UCA0IFG & UCTXIFG)) ;
-        UCA0TXBUF = *inBuff;
-        usLength--;
-        inBuff++;
+        usLength = CLI_TX_BUFFER_SIZE;
     }
-    return (int)ret;
+
+    while (usCopied < usLength)
+    {
+        /* Writers may be preempted by other writers, reserve and copy atomically */
+        bMasked = Interrupt_disableMaster();
+        usFree = CLI_TX_BUFFER_SIZE - (unsigned short)(cli_tx_head - cli_tx_tail);
+
+        /* Never wait: a line that does not fit is dropped whole */
+        if (!bBlock && usFree < usLength)
+        {
+            cli_tx_dropped++;
+            if (!bMasked)
+                Interrupt_enableMaster();
+            return 0;
+        }
+
+        usChunk = usLength - usCopied;
+        if (usChunk > usFree)
+        {
+            usChunk = usFree;
+        }
+        for (; usChunk > 0; usChunk--)
+        {
+            cli_tx_buffer[cli_tx_head % CLI_TX_BUFFER_SIZE] = inBuff[usCopied++];
+            cli_tx_head++;
+        }
+        UCA0IE |= UCTXIE;
+        if (!bMasked)
+            Interrupt_enableMaster();
+
+        /* CLI_TX_OVERFLOW_BLOCK from a task: wait for the interrupt to make room */
+        if (usCopied < usLength)
+        {
+            while ((unsigned short)(cli_tx_head - cli_tx_tail) == CLI_TX_BUFFER_SIZE) ;
+        }
+    }
+
+    return (int)usCopied;
 #else
     return 0;
 #endif
@@ -142,24 +252,120 @@ int CLI_Write(unsigned char *inBuff)
 
 /*----------------------------------------------------------------------------*/
 
+unsigned long CLI_Dropped(void)
+{
+#ifdef _USE_CLI_
+    return cli_tx_dropped;
+#else
+    return 0;
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+
+unsigned long CLI_LinesDropped(void)
+{
+#ifdef _USE_CLI_
+    return cli_rx_dropped;
+#else
+    return 0;
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+
+#ifdef _USE_CLI_
+/* Echo from the interrupt: never waits, drops what does not fit */
+static void CLI_Echo(const char *pcEcho)
+{
+    while (*pcEcho != 0x00 &&
+           (unsigned short)(cli_tx_head - cli_tx_tail) < CLI_TX_BUFFER_SIZE)
+    {
+        cli_tx_buffer[cli_tx_head % CLI_TX_BUFFER_SIZE] = *pcEcho++;
+        cli_tx_head++;
+    }
+    UCA0IE |= UCTXIE;
+}
+
+static void CLI_Receive(unsigned char ucChar)
+{
+    char acEcho[2];
+
+    if (ucChar == ASCII_ENTER || ucChar == ASCII_NEWLINE)
+    {
+        /* CR LF from a terminal is a single line, empty lines are ignored */
+        if (cli_rx_length == 0 && !cli_rx_overflow)
+            return;
+
+        CLI_Echo("\n\r");
+        if (cli_rx_overflow || cli_rx_have_line)
+        {
+            cli_rx_dropped++;
+        }
+        else
+        {
+            memcpy(cli_rx_ready, cli_rx_line, cli_rx_length);
+            cli_rx_ready_length = cli_rx_length;
+            cli_rx_have_line = true;
+            if (cli_rx_callback != NULL)
+                cli_rx_callback();
+        }
+        cli_rx_length = 0;
+        cli_rx_overflow = false;
+    }
+    else if (ucChar == ASCII_BACKSPACE || ucChar == ASCII_DELETE)
+    {
+        if (cli_rx_length > 0)
+        {
+            cli_rx_length--;
+            CLI_Echo("\b \b");
+        }
+    }
+    else if (ucChar >= ' ')
+    {
+        if (cli_rx_length < CLI_RX_LINE_SIZE - 1)
+        {
+            cli_rx_line[cli_rx_length++] = ucChar;
+            acEcho[0] = (char)ucChar;
+            acEcho[1] = 0x00;
+            CLI_Echo(acEcho);
+        }
+        else
+        {
+            cli_rx_overflow = true;
+        }
+    }
+}
+#endif
+
+/*----------------------------------------------------------------------------*/
+
 void EUSCIA0_IRQHandler(void)
 {
+#ifdef _USE_CLI_
+    /* Transmit buffer empty: send the next byte, or stop until CLI_Write adds more */
+    if ((UCA0IE & UCTXIE) && (UCA0IFG & UCTXIFG))
+    {
+        if (cli_tx_head != cli_tx_tail)
+        {
+            UCA0TXBUF = cli_tx_buffer[cli_tx_tail % CLI_TX_BUFFER_SIZE];
+            cli_tx_tail++;
+        }
+        else
+        {
+            UCA0IE &= ~UCTXIE;
+        }
+    }
+#endif
+
     if (UCA0IFG & UCRXIFG)
     {
 #ifdef _USE_CLI_
+        /* Reading the buffer clears UCRXIFG */
+        CLI_Receive(UCA0RXBUF);
+#else
         UCA0IFG &= ~UCRXIFG;
-        *g_ucUARTBuffer = UCA1RXBUF;
-        if (*g_ucUARTBuffer == ASCII_ENTER)
-        {
-            cli_have_cmd = 1;
-            *g_ucUARTBuffer = 0x00;
-            Interrupt_disableSleepOnIsrExit();
-
-            // __bic_SR_register_on_exit(LPM0_bits);
-        }
-        g_ucUARTBuffer++;
 #endif
-        __no_operation();
     }
 }
 
@@ -44,6 +44,38 @@
 //          command line interface
 //****************************************************************************
 
+//****************************************************************************
+//          CLI_Write does not wait for the UART: it copies the string into
+//          a CLI_TX_BUFFER_SIZE ring drained by the EUSCI_A0 TX interrupt.
+//          When the ring is full, CLI_TX_OVERFLOW_DROP discards the whole
+//          string (see CLI_Dropped) and CLI_TX_OVERFLOW_BLOCK waits for room.
+//          Only a task can wait: called from an interrupt, with interrupts
+//          masked or inside a critical section, BLOCK drops as DROP does.
+//****************************************************************************
+
+#define CLI_TX_OVERFLOW_DROP    0
+#define CLI_TX_OVERFLOW_BLOCK   1
+
+#ifndef CLI_TX_OVERFLOW
+#define CLI_TX_OVERFLOW         CLI_TX_OVERFLOW_DROP
+#endif
+
+/* Power of two, at most 32768 */
+#ifndef CLI_TX_BUFFER_SIZE
+#define CLI_TX_BUFFER_SIZE      1024
+#endif
+
+//****************************************************************************
+//          Received characters are edited (backspace) and echoed by the
+//          EUSCI_A0 RX interrupt. A complete line waits for CLI_ReadLine,
+//          lines arriving meanwhile are dropped (see CLI_LinesDropped).
+//****************************************************************************
+
+/* Longest line including its terminating 0x00 */
+#ifndef CLI_RX_LINE_SIZE
+#define CLI_RX_LINE_SIZE        64
+#endif
+
 //*****************************************************************************
 //
 // If building with a C++ compiler, make all of the definitions in this header
@@ -65,12 +97,42 @@ extern "C" {
 
     \return     int - No of bytes read, -1 in case of error
 
-    \note
+    \note       Sleeps until a line has been entered
 
-    \warning
+    \warning    pBuff must hold CLI_RX_LINE_SIZE bytes
 */
 extern int CLI_Read(unsigned char *pBuff);
 
+/*!
+    \brief      Read a complete line, if there is one
+
+    \param[in]  pBuff - Pointer to the read buffer
+    \param[in]  usSize - Size of the buffer, the line is truncated
+                to usSize - 1 bytes and null terminated
+
+    \return     int - No of bytes read, -1 if no line is ready
+
+    \note       Never waits, see CLI_SetLineCallback
+
+    \warning
+*/
+extern int CLI_ReadLine(unsigned char *pBuff, unsigned short usSize);
+
+/*!
+    \brief      Register a function called when a line is complete
+
+    \param[in]  pfnCallback - Function to call, NULL for none
+
+    \return     none
+
+    \note       Runs in the EUSCI_A0 interrupt, it may only wake up the
+                reader (e.g. a FreeRTOS FromISR call, which needs a
+                priority below configMAX_SYSCALL_INTERRUPT_PRIORITY)
+
+    \warning
+*/
+extern void CLI_SetLineCallback(void (*pfnCallback)(void));
+
 /*!
     \brief      Configures the Application Uart
 
@@ -90,14 +152,57 @@ extern void CLI_Configure(void);
     \param[in]  inBuff - Pointer to output data, string should be null
                 terminated
 
-    \return     int - No of byte sent, -1 in case of error
+    \return     int - No of bytes queued for transmission, 0 if the
+                string was dropped, -1 in case of error
 
-    \note
+    \note       Returns as soon as the string is in the TX ring, the UART
+                sends it in the background at 115200 baud
 
     \warning
 */
 extern int CLI_Write(unsigned char *inBuff);
 
+/*!
+    \brief      Write raw bytes on Application Uart channel
+
+    \param[in]  inBuff - Pointer to output data, may contain 0x00
+    \param[in]  usLength - Number of bytes to write
+
+    \return     int - No of bytes queued for transmission, 0 if the
+                data was dropped, -1 in case of error
+
+    \note       Same TX ring and overflow policy as CLI_Write
+
+    \warning
+*/
+extern int CLI_WriteBytes(const unsigned char *inBuff, unsigned short usLength);
+
+/*!
+    \brief      Number of strings dropped because the TX ring was full
+
+    \param[in]  none
+
+    \return     unsigned long - strings dropped since reset
+
+    \note       With CLI_TX_OVERFLOW_BLOCK, only strings written outside task context
+
+    \warning
+*/
+extern unsigned long CLI_Dropped(void);
+
+/*!
+    \brief      Number of input lines dropped, too long or not read in time
+
+    \param[in]  none
+
+    \return     unsigned long - lines dropped since reset
+
+    \note
+
+    \warning
+*/
+extern unsigned long CLI_LinesDropped(void);
+
 
 //*****************************************************************************
 //
@@ -38,9 +38,23 @@
 
 #include <msp432.h>
 
+#include <string.h>
+
 #include "simplelink.h"
+#include "protocol.h"
+#include "driver.h"
 #include "spi.h"
 #include "board.h"
+#include "msp432_launchpad_timestamp.h"
+
+#if (SPI_TRACE)
+#include "pingpong_trace.h"
+#endif
+
+#ifdef SL_PLATFORM_MULTI_THREADED
+#include "FreeRTOS.h"
+#include "task.h"
+#endif
 
 /*----------------------------------------------------------------------------*/
 
@@ -70,21 +84,97 @@
 #define DMA_RX_CHANNEL              ( DMA_CH1_EUSCIB0RX0 )
 #define DMA_RX_NUMBER               ( 1 )
 
-#define DMA_BUFF_SIZE_MIN           ( 100 )
+/* Completion of the channel that ends a transfer, see DMA_INT1_IRQHandler */
+#define DMA_DONE_INT                ( DMA_INT1 )
+#define DMA_DONE_PRIORITY           ( 0xE0 )
+
+/* Notification bit the DMA interrupt sets for the waiting task */
+#define DMA_DONE_NOTIFY_BIT         ( 0x80000000 )
+
 #define DMA_MAX_TRANSACTION_SIZE    ( 1024 )
 
+/* SPI_DMA_AUTOTUNE: bytes clocked out with CS high, and the bounds of the result */
+#define DMA_CALIBRATION_SHORT       ( 32 )
+#define DMA_CALIBRATION_LONG        ( 256 )
+#define DMA_THRESHOLD_MIN           ( 16 )
+#define DMA_THRESHOLD_MAX           ( DMA_MAX_TRANSACTION_SIZE )
+
+/* Scatter-gather tasks per chain, each moves up to DMA_MAX_TRANSACTION_SIZE */
+#define DMA_TASKS_MAX               ( 8 )
+
+/* Buffers written by a SimpleLink message: sync, header, descriptors, payloads */
+#define SPI_SEGMENTS_MAX            ( SL_MSG_WRITES_MAX )
+
+#if (SPI_SEGMENTS_MAX < SL_MSG_WRITES_MAX)
+#error "SPI_SEGMENTS_MAX must hold every buffer of a message to send it in one chain"
+#endif
+
+/*----------------------------------------------------------------------------*/
+
+typedef struct {
+    unsigned char *pBuff;
+    int len;
+} spi_segment_t;
+
 /*----------------------------------------------------------------------------*/
 
 static void spi_assert_cs(void);
 static void spi_deassert_cs(void);
-static void dma_setup_write(unsigned char *pBuff, int len);
-static void dma_setup_read(unsigned char *pBuff, int len);
+static void spi_flush(void);
+static void spi_record(spi_direction_stats_t *stats, int len, bool dma, uint32_t cycles);
+#if (SPI_TRACE)
+static void spi_trace_write(uint32_t timestamp, int total);
+static void spi_trace_read(uint32_t timestamp, const unsigned char *pBuff, int len);
+#endif
+#if (SPI_DMA_AUTOTUNE)
+static void spi_calibrate(void);
+static uint32_t spi_poll_cycles(int len);
+static uint32_t spi_dma_cycles(int len);
+#endif
+static void dma_task_set(DMA_ControlTable *task, unsigned int count,
+                         void *src, uint32_t srcInc, void *dst, uint32_t dstInc);
+static void dma_start(uint32_t channel, DMA_ControlTable *tasks, unsigned int count);
+static void dma_write(void);
+static void dma_read(unsigned char *pBuff, int len);
+static void dma_wait(uint32_t channel);
 
 /*----------------------------------------------------------------------------*/
 
 #pragma DATA_ALIGN(MSP_EXP432P401RLP_DMAControlTable1, 1024)
 DMA_ControlTable MSP_EXP432P401RLP_DMAControlTable1[32];
 
+/* Scatter-gather task lists, DMA_TaskStructEntry format */
+static DMA_ControlTable dma_tx_tasks[DMA_TASKS_MAX];
+static DMA_ControlTable dma_rx_tasks[DMA_TASKS_MAX];
+
+/* Clocked out while reading */
+static const uint8_t dma_dummy = 0xFF;
+
+/* Buffers of the SimpleLink message being written, sent under a single CS */
+static spi_segment_t spi_segments[SPI_SEGMENTS_MAX];
+static uint8_t spi_segment_count = 0;
+static bool spi_gather = false;
+
+/* Polling below this size, DMA above */
+static volatile int spi_dma_threshold = SPI_DMA_THRESHOLD;
+
+static spi_stats_t spi_stats;
+
+/* Upper bounds of the histogram buckets but the last one */
+static const int spi_stats_sizes[SPI_STATS_BUCKETS - 1] = { 4, 16, 64, 256, 1024, 4096 };
+
+#if (SPI_TRACE)
+/* Written by the SPI calls and the IRQ handler, always with interrupts masked */
+static uint8_t spi_trace_buffer[SPI_TRACE_SIZE];
+static pingpong_trace_t spi_trace;
+static volatile bool spi_tracing = false;
+#endif
+
+#ifdef SL_PLATFORM_MULTI_THREADED
+/* Task sleeping in dma_wait, the SimpleLink driver lock allows a single one */
+static volatile TaskHandle_t dma_task = NULL;
+#endif
+
 /* SPI Master Configuration Parameter */
 static const eUSCI_SPI_MasterConfig spiMasterConfig = {
         EUSCI_B_SPI_CLOCKSOURCE_SMCLK,                           // SMCLK Clock Source
@@ -124,9 +214,28 @@ Fd_t spi_Open(char *ifName, unsigned long flags)
     MAP_GPIO_setOutputHighOnPin(SPI_CS_PORT, SPI_CS_PIN);
     MAP_GPIO_setAsOutputPin(SPI_CS_PORT, SPI_CS_PIN);
 
+    /* The DMA control table and channel mapping never change afterwards */
+    MAP_DMA_enableModule();
+    MAP_DMA_setControlBase(MSP_EXP432P401RLP_DMAControlTable1);
+    MAP_DMA_assignChannel(DMA_TX_CHANNEL);
+    MAP_DMA_assignChannel(DMA_RX_CHANNEL);
+
+    /* RX must keep up with TX, also while it fetches its next task */
+    MAP_DMA_enableChannelAttribute(DMA_RX_CHANNEL, UDMA_ATTR_HIGH_PRIORITY);
+
+    /* DMA completion wakes up the task that started the transfer */
+    MAP_Interrupt_setPriority(DMA_DONE_INT, DMA_DONE_PRIORITY);
+    MAP_Interrupt_enableInterrupt(DMA_DONE_INT);
+
     /* 50 ms delay */
     Delay(50);
 
+#if (SPI_DMA_AUTOTUNE)
+    /* The CC3100 is still in hibernation, with CS high nobody listens */
+    spi_calibrate();
+#endif
+    spi_ResetStats();
+
     /* Enable WLAN interrupt */
     CC3100_InterruptEnable();
 
@@ -155,70 +264,45 @@ int spi_Close(Fd_t fd)
 
 int spi_Write(Fd_t fd, unsigned char *pBuff, int len)
 {
-    int len_to_return = 0;
-    int read_size = 0;
-
-    /* Check if USCI_B0 is busy */
-    while (UCB0STATW & UCBUSY);
+    /* Inside a message, collect the buffer and send them all at its end. */
+    /* Never with the driver as it is, but a message with more buffers    */
+    /* goes out in two chains, counted so that it does not go unnoticed   */
+    if (spi_gather && spi_segment_count == SPI_SEGMENTS_MAX)
+    {
+        spi_stats.split_messages++;
+        spi_flush();
+    }
 
-    /* Assert the CS pin */
-    spi_assert_cs();
+    spi_segments[spi_segment_count].pBuff = pBuff;
+    spi_segments[spi_segment_count].len = len;
+    spi_segment_count++;
 
-    /* Use DMA if size is above minimum to minimize delay, polling otherwise */
-    if (len > DMA_BUFF_SIZE_MIN)
+    if (!spi_gather)
     {
-        /* Repeat while more bytes are pending */
-        while (len > 0)
-        {
-            if (len < DMA_MAX_TRANSACTION_SIZE)
-            {
-                dma_setup_write(&pBuff[read_size], len);
-                read_size += len;
-                len = 0;
-            }
-            else
-            {
-                dma_setup_write(&pBuff[read_size], DMA_MAX_TRANSACTION_SIZE);
-                read_size += DMA_MAX_TRANSACTION_SIZE;
-                len -= DMA_MAX_TRANSACTION_SIZE;
-            }
-        }
-
-        /* Return bytes that have been transmitted */
-        len_to_return = read_size;
+        spi_flush();
     }
-    else
-    {
-        /* Return bytes that have been transmitted */
-        len_to_return = len;
 
-        /* While there are bytes pending */
-        while (len)
-        {
-            /* Wait while USCI_B0 is not transmitting */
-            while (!(UCB0IFG & UCTXIFG));
+    /* Return bytes that have been (or will be) transmitted */
+    return len;
+}
 
-            /* Put data in the USCI_B0 transmit buffer */
-            UCB0TXBUF = *pBuff;
+/*----------------------------------------------------------------------------*/
 
-            /* Wait while USCI_B0 is not receiving */
-            while (!(UCB0IFG & UCRXIFG));
+void spi_StartWriteSequence(Fd_t fd)
+{
+    spi_gather = true;
+}
 
-            /* Read the USCI_B0 receive buffer */
-            UCB0RXBUF;
+/*----------------------------------------------------------------------------*/
 
-            /* Decrease pending bytes */
-            len --;
+void spi_EndWriteSequence(Fd_t fd)
+{
+    spi_gather = false;
 
-            /* Increase data pointer */
-            pBuff++;
-        }
+    if (spi_segment_count > 0)
+    {
+        spi_flush();
     }
-
-    /* De-assert the CS pin */
-    spi_deassert_cs();
-
-    return len_to_return;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -226,35 +310,21 @@ int spi_Write(Fd_t fd, unsigned char *pBuff, int len)
 int spi_Read(Fd_t fd, unsigned char *pBuff, int len)
 {
     uint16_t i = 0;
-    uint16_t read_size = 0;
+    uint32_t start;
+    bool dma;
 
     /* Check if USCI_B0 is busy */
     while (UCB0STATW & UCBUSY);
 
     /* Assert the CS pin */
+    start = msp432_launchpad_timestamp_get();
     spi_assert_cs();
 
     /* Use DMA if size is above minimum to minimize delay, polling otherwise */
-    if (len > DMA_BUFF_SIZE_MIN)
+    dma = (len > spi_dma_threshold);
+    if (dma)
     {
-        while (len > 0)
-        {
-            if (len < DMA_MAX_TRANSACTION_SIZE)
-            {
-                dma_setup_read(&pBuff[read_size], len);
-                read_size += len;
-                len = 0;
-            }
-            else
-            {
-                dma_setup_read(&pBuff[read_size], DMA_MAX_TRANSACTION_SIZE);
-                read_size += DMA_MAX_TRANSACTION_SIZE;
-                len -= DMA_MAX_TRANSACTION_SIZE;
-            }
-        }
-
-        /* Return bytes that have been received */
-        len = read_size;
+        dma_read(pBuff, len);
     }
     else
     {
@@ -277,12 +347,94 @@ int spi_Read(Fd_t fd, unsigned char *pBuff, int len)
 
     /* De-assert the CS pin */
     spi_deassert_cs();
+    spi_record(&spi_stats.rx, len, dma, msp432_launchpad_timestamp_get() - start);
+#if (SPI_TRACE)
+    spi_trace_read(start, pBuff, len);
+#endif
 
     return len;
 }
 
 /*----------------------------------------------------------------------------*/
 
+void spi_GetStats(spi_stats_t *stats)
+{
+    *stats = spi_stats;
+    stats->dma_threshold = spi_dma_threshold;
+}
+
+/*----------------------------------------------------------------------------*/
+
+void spi_ResetStats(void)
+{
+    memset(&spi_stats, 0, sizeof(spi_stats));
+}
+
+/*----------------------------------------------------------------------------*/
+
+void spi_SetDmaThreshold(int len)
+{
+    spi_dma_threshold = len;
+}
+
+/*----------------------------------------------------------------------------*/
+
+#if (SPI_TRACE)
+
+void spi_TraceStart(void)
+{
+    bool masked;
+
+    masked = MAP_Interrupt_disableMaster();
+    pingpong_trace_reset(&spi_trace, spi_trace_buffer, sizeof(spi_trace_buffer),
+                         msp432_launchpad_timestamp_from_us(1000000));
+    spi_tracing = true;
+    if (!masked)
+    {
+        MAP_Interrupt_enableMaster();
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+void spi_TraceStop(void)
+{
+    spi_tracing = false;
+}
+
+/*----------------------------------------------------------------------------*/
+
+void spi_TraceEvent(unsigned char kind)
+{
+    bool masked;
+
+    if (!spi_tracing)
+    {
+        return;
+    }
+
+    masked = MAP_Interrupt_disableMaster();
+    pingpong_trace_add(&spi_trace, kind, msp432_launchpad_timestamp_get(), NULL, 0);
+    if (!masked)
+    {
+        MAP_Interrupt_enableMaster();
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+const unsigned char* spi_TraceGet(unsigned long *length, unsigned long *dropped)
+{
+    *length = spi_trace.length;
+    *dropped = spi_trace.dropped;
+
+    return spi_trace_buffer;
+}
+
+#endif
+
+/*----------------------------------------------------------------------------*/
+
 static void spi_assert_cs(void)
 {
     /* Put down the CS pin to active the SPI slave */
@@ -299,53 +451,400 @@ static void spi_deassert_cs(void)
 
 /*----------------------------------------------------------------------------*/
 
-static void dma_setup_write(unsigned char *pBuff, int len) {
-    /* Configuring DMA module */
-    MAP_DMA_enableModule();
-    MAP_DMA_setControlBase(MSP_EXP432P401RLP_DMAControlTable1);
+static void spi_flush(void)
+{
+    unsigned char *pBuff;
+    int total = 0, len;
+    uint32_t start;
+    uint8_t i;
+    bool dma;
 
-    /* Assign DMA TX channel */
-    MAP_DMA_assignChannel(DMA_TX_CHANNEL);
+    for (i = 0; i < spi_segment_count; i++)
+    {
+        total += spi_segments[i].len;
+    }
 
-    /* Setup the TX transfer characteristics & buffers */
-    MAP_DMA_setChannelControl(DMA_TX_CHANNEL | UDMA_PRI_SELECT, UDMA_SIZE_8 | UDMA_SRC_INC_8 | UDMA_DST_INC_NONE | UDMA_ARB_1);
-    MAP_DMA_setChannelTransfer(DMA_TX_CHANNEL | UDMA_PRI_SELECT, UDMA_MODE_BASIC, pBuff, (void *) MAP_SPI_getTransmitBufferAddressForDMA(SPI_BASE), len);
+    /* Check if USCI_B0 is busy */
+    while (UCB0STATW & UCBUSY);
 
-    /* Enable DMA channel to start SPI transaction */
-    MAP_DMA_enableChannel(DMA_TX_NUMBER);
+    /* Assert the CS pin */
+    start = msp432_launchpad_timestamp_get();
+    spi_assert_cs();
 
-    /* Wait until SPI transaction is complete */
-    while(DMA_isChannelEnabled(DMA_TX_NUMBER))
-       ;
+    /* Use DMA if size is above minimum to minimize delay, polling otherwise */
+    dma = (total > spi_dma_threshold);
+    if (dma)
+    {
+        dma_write();
+    }
+    else
+    {
+        for (i = 0; i < spi_segment_count; i++)
+        {
+            pBuff = spi_segments[i].pBuff;
+            len = spi_segments[i].len;
+
+            /* While there are bytes pending */
+            while (len)
+            {
+                /* Wait while USCI_B0 is not transmitting */
+                while (!(UCB0IFG & UCTXIFG));
+
+                /* Put data in the USCI_B0 transmit buffer */
+                UCB0TXBUF = *pBuff;
+
+                /* Wait while USCI_B0 is not receiving */
+                while (!(UCB0IFG & UCRXIFG));
+
+                /* Read the USCI_B0 receive buffer */
+                UCB0RXBUF;
+
+                /* Decrease pending bytes */
+                len --;
+
+                /* Increase data pointer */
+                pBuff++;
+            }
+        }
+    }
+
+    /* De-assert the CS pin */
+    spi_deassert_cs();
+    spi_record(&spi_stats.tx, total, dma, msp432_launchpad_timestamp_get() - start);
+#if (SPI_TRACE)
+    spi_trace_write(start, total);
+#endif
+
+    spi_segment_count = 0;
 }
 
 /*----------------------------------------------------------------------------*/
 
-static void dma_setup_read(unsigned char *pBuff, int len)
+static void spi_record(spi_direction_stats_t *stats, int len, bool dma, uint32_t cycles)
 {
-    uint8_t dummy = 0xFF;
+    uint8_t bucket = 0;
 
-    /* Configuring DMA module */
-    MAP_DMA_enableModule();
-    MAP_DMA_setControlBase(MSP_EXP432P401RLP_DMAControlTable1);
+    while (bucket < SPI_STATS_BUCKETS - 1 && len > spi_stats_sizes[bucket])
+    {
+        bucket++;
+    }
 
-    /* Assign DMA TX and RX channels */
-    MAP_DMA_assignChannel(DMA_TX_CHANNEL);
-    MAP_DMA_assignChannel(DMA_RX_CHANNEL);
+    /* CS is held for the whole transfer, the time goes to its method */
+    stats->transfers++;
+    stats->bytes += len;
+    stats->sizes[bucket]++;
+    if (dma)
+    {
+        stats->dma_transfers++;
+        stats->dma_cycles += cycles;
+    }
+    else
+    {
+        stats->poll_cycles += cycles;
+    }
+    if (cycles > stats->max_cs_cycles)
+    {
+        stats->max_cs_cycles = cycles;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+#if (SPI_TRACE)
+
+static void spi_trace_write(uint32_t timestamp, int total)
+{
+    bool masked;
+    uint8_t i;
+
+    if (!spi_tracing)
+    {
+        return;
+    }
 
-    /* Setup the TX transfer characteristics & buffers */
-    MAP_DMA_setChannelControl(DMA_TX_CHANNEL | UDMA_PRI_SELECT, UDMA_SIZE_8 | UDMA_DST_INC_NONE | UDMA_DST_INC_NONE | UDMA_ARB_1);
-    MAP_DMA_setChannelTransfer(DMA_TX_CHANNEL | UDMA_PRI_SELECT, UDMA_MODE_BASIC, &dummy, (void *) MAP_SPI_getTransmitBufferAddressForDMA(SPI_BASE), len);
+    /* The gathered buffers make a single record, as they made a single CS */
+    masked = MAP_Interrupt_disableMaster();
+    if (pingpong_trace_begin(&spi_trace, PINGPONG_TRACE_WRITE, timestamp, total))
+    {
+        for (i = 0; i < spi_segment_count; i++)
+        {
+            pingpong_trace_append(&spi_trace, spi_segments[i].pBuff, spi_segments[i].len);
+        }
+    }
+    if (!masked)
+    {
+        MAP_Interrupt_enableMaster();
+    }
+}
 
-    /* Setup the RX transfer characteristics & buffers */
-    MAP_DMA_setChannelControl(DMA_RX_CHANNEL | UDMA_PRI_SELECT, UDMA_SIZE_8 | UDMA_SRC_INC_NONE | UDMA_DST_INC_8 | UDMA_ARB_1);
-    MAP_DMA_setChannelTransfer(DMA_RX_CHANNEL | UDMA_PRI_SELECT, UDMA_MODE_BASIC, (void *) MAP_SPI_getReceiveBufferAddressForDMA(SPI_BASE), pBuff, len);
+/*----------------------------------------------------------------------------*/
+
+static void spi_trace_read(uint32_t timestamp, const unsigned char *pBuff, int len)
+{
+    bool masked;
 
-    /* Enable DMA channels to start SPI transaction */
-    MAP_DMA_enableChannel(DMA_RX_NUMBER);
+    if (!spi_tracing)
+    {
+        return;
+    }
+
+    masked = MAP_Interrupt_disableMaster();
+    pingpong_trace_add(&spi_trace, PINGPONG_TRACE_READ, timestamp, pBuff, len);
+    if (!masked)
+    {
+        MAP_Interrupt_enableMaster();
+    }
+}
+
+#endif
+
+/*----------------------------------------------------------------------------*/
+
+#if (SPI_DMA_AUTOTUNE)
+
+static void spi_calibrate(void)
+{
+    uint32_t pollShort, pollLong, dmaShort, dmaLong;
+    uint32_t pollPerByte, dmaPerByte, dmaSetup;
+    int threshold;
+
+    /* Warm up the flash cache and the channels before measuring */
+    spi_poll_cycles(DMA_CALIBRATION_SHORT);
+    spi_dma_cycles(DMA_CALIBRATION_SHORT);
+
+    pollShort = spi_poll_cycles(DMA_CALIBRATION_SHORT);
+    pollLong = spi_poll_cycles(DMA_CALIBRATION_LONG);
+    dmaShort = spi_dma_cycles(DMA_CALIBRATION_SHORT);
+    dmaLong = spi_dma_cycles(DMA_CALIBRATION_LONG);
+
+    /* Cycles per byte in 1/256 units, the difference cancels the fixed costs */
+    pollPerByte = ((pollLong - pollShort) << 8) / (DMA_CALIBRATION_LONG - DMA_CALIBRATION_SHORT);
+    dmaPerByte = ((dmaLong - dmaShort) << 8) / (DMA_CALIBRATION_LONG - DMA_CALIBRATION_SHORT);
+    dmaSetup = dmaShort - ((dmaPerByte * DMA_CALIBRATION_SHORT) >> 8);
+
+    /* DMA wins once its setup is paid off by its per-byte advantage */
+    if (pollPerByte > dmaPerByte)
+    {
+        threshold = (dmaSetup << 8) / (pollPerByte - dmaPerByte);
+    }
+    else
+    {
+        threshold = DMA_THRESHOLD_MAX;
+    }
+
+    if (threshold < DMA_THRESHOLD_MIN)
+    {
+        threshold = DMA_THRESHOLD_MIN;
+    }
+    else if (threshold > DMA_THRESHOLD_MAX)
+    {
+        threshold = DMA_THRESHOLD_MAX;
+    }
+
+    spi_dma_threshold = threshold;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static uint32_t spi_poll_cycles(int len)
+{
+    uint32_t start;
+
+    start = msp432_launchpad_timestamp_get();
+
+    /* Same steps per byte as spi_flush and spi_Read */
+    while (len--)
+    {
+        while (!(UCB0IFG & UCTXIFG));
+        UCB0TXBUF = 0xFF;
+        while (!(UCB0IFG & UCRXIFG));
+        UCB0RXBUF;
+    }
+
+    return msp432_launchpad_timestamp_get() - start;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static uint32_t spi_dma_cycles(int len)
+{
+    void *txBuffer = (void *) MAP_SPI_getTransmitBufferAddressForDMA(SPI_BASE);
+    uint32_t start;
+
+    start = msp432_launchpad_timestamp_get();
+
+    /* Same steps as dma_write for a single task */
+    dma_task_set(&dma_tx_tasks[0], len,
+                 (void *) &dma_dummy, UDMA_SRC_INC_NONE, txBuffer, UDMA_DST_INC_NONE);
+    dma_start(DMA_TX_CHANNEL, dma_tx_tasks, 1);
+    dma_wait(DMA_TX_NUMBER);
+    while (UCB0STATW & UCBUSY);
+    UCB0RXBUF;
+
+    return msp432_launchpad_timestamp_get() - start;
+}
+
+#endif
+
+/*----------------------------------------------------------------------------*/
+
+static void dma_task_set(DMA_ControlTable *task, unsigned int count,
+                         void *src, uint32_t srcInc, void *dst, uint32_t dstInc)
+{
+    /* Same layout as DMA_TaskStructEntry, which only works for initializers */
+    task->srcEndAddr = (srcInc == UDMA_SRC_INC_NONE) ? src : (uint8_t *) src + count - 1;
+    task->dstEndAddr = (dstInc == UDMA_DST_INC_NONE) ? dst : (uint8_t *) dst + count - 1;
+    task->control = srcInc | dstInc | UDMA_SIZE_8 | UDMA_ARB_1 |
+                    ((count - 1) << 4) |
+                    UDMA_MODE_PER_SCATTER_GATHER | UDMA_MODE_ALT_SELECT;
+    task->spare = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void dma_start(uint32_t channel, DMA_ControlTable *tasks, unsigned int count)
+{
+    /* The last task stops the channel and raises its interrupt */
+    tasks[count - 1].control = (tasks[count - 1].control & ~UDMA_CHCTL_XFERMODE_M) |
+                               UDMA_MODE_BASIC;
+
+    if (count == 1)
+    {
+        /* A single task needs no list, program the primary structure directly */
+        MSP_EXP432P401RLP_DMAControlTable1[channel & 0x0F] = tasks[0];
+        MAP_DMA_disableChannelAttribute(channel, UDMA_ATTR_ALTSELECT);
+    }
+    else
+    {
+        MAP_DMA_setChannelScatterGather(channel, count, tasks, true);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void dma_write(void)
+{
+    void *txBuffer = (void *) MAP_SPI_getTransmitBufferAddressForDMA(SPI_BASE);
+    unsigned char *pBuff;
+    unsigned int count = 0, chunk;
+    int len;
+    uint8_t i;
+
+    /* One chain for the whole message, split in DMA_MAX_TRANSACTION_SIZE tasks */
+    for (i = 0; i < spi_segment_count; i++)
+    {
+        pBuff = spi_segments[i].pBuff;
+        len = spi_segments[i].len;
+
+        while (len > 0)
+        {
+            chunk = (len < DMA_MAX_TRANSACTION_SIZE) ? len : DMA_MAX_TRANSACTION_SIZE;
+            dma_task_set(&dma_tx_tasks[count++], chunk,
+                         pBuff, UDMA_SRC_INC_8, txBuffer, UDMA_DST_INC_NONE);
+            pBuff += chunk;
+            len -= chunk;
+
+            /* Task list full, send what it holds and go on with a new chain */
+            if (count == DMA_TASKS_MAX && (len > 0 || i + 1 < spi_segment_count))
+            {
+                dma_start(DMA_TX_CHANNEL, dma_tx_tasks, count);
+                dma_wait(DMA_TX_NUMBER);
+                count = 0;
+            }
+        }
+    }
+
+    if (count > 0)
+    {
+        dma_start(DMA_TX_CHANNEL, dma_tx_tasks, count);
+        dma_wait(DMA_TX_NUMBER);
+    }
+
+    /* The DMA is done once the last byte is in UCB0TXBUF, let it go out */
+    while (UCB0STATW & UCBUSY);
+
+    /* Nothing read the bytes clocked in, do not leave them to spi_Read */
+    UCB0RXBUF;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void dma_read(unsigned char *pBuff, int len)
+{
+    void *txBuffer = (void *) MAP_SPI_getTransmitBufferAddressForDMA(SPI_BASE);
+    void *rxBuffer = (void *) MAP_SPI_getReceiveBufferAddressForDMA(SPI_BASE);
+    unsigned int count, chunk;
+
+    while (len > 0)
+    {
+        /* Twin chains: RX stores every byte the dummy TX bytes clock in */
+        for (count = 0; count < DMA_TASKS_MAX && len > 0; count++)
+        {
+            chunk = (len < DMA_MAX_TRANSACTION_SIZE) ? len : DMA_MAX_TRANSACTION_SIZE;
+            dma_task_set(&dma_tx_tasks[count], chunk,
+                         (void *) &dma_dummy, UDMA_SRC_INC_NONE, txBuffer, UDMA_DST_INC_NONE);
+            dma_task_set(&dma_rx_tasks[count], chunk,
+                         rxBuffer, UDMA_SRC_INC_NONE, pBuff, UDMA_DST_INC_8);
+            pBuff += chunk;
+            len -= chunk;
+        }
+
+        dma_start(DMA_TX_CHANNEL, dma_tx_tasks, count);
+        dma_start(DMA_RX_CHANNEL, dma_rx_tasks, count);
+
+        /* Enable DMA channels to start SPI transaction, RX ends it */
+        MAP_DMA_enableChannel(DMA_RX_NUMBER);
+        dma_wait(DMA_RX_NUMBER);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void dma_wait(uint32_t channel)
+{
+#ifdef SL_PLATFORM_MULTI_THREADED
+    uint32_t notified;
+
+    /* Route the completion of the channel that ends the transfer to the task */
+    dma_task = xTaskGetCurrentTaskHandle();
+    MAP_DMA_assignInterrupt(DMA_DONE_INT, channel);
+
+    /* Start the SPI transaction */
+    MAP_DMA_enableChannel(DMA_TX_NUMBER);
+
+    /*
+     * Sleep, other tasks run until the last byte has been transferred. The
+     * channel state decides, a bit left over by an earlier transfer only
+     * costs one more turn.
+     */
+    while (MAP_DMA_isChannelEnabled(channel))
+    {
+        xTaskNotifyWait(0, DMA_DONE_NOTIFY_BIT, &notified, portMAX_DELAY);
+    }
+    dma_task = NULL;
+#else
+    /* Start the SPI transaction */
     MAP_DMA_enableChannel(DMA_TX_NUMBER);
 
     /* Wait until SPI transaction is complete */
-    while(DMA_isChannelEnabled(DMA_RX_NUMBER))
+    while(DMA_isChannelEnabled(channel))
        ;
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+
+void DMA_INT1_IRQHandler(void)
+{
+#ifdef SL_PLATFORM_MULTI_THREADED
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    /* A single channel is assigned to DMA_INT1, its flag needs no clearing */
+    if (dma_task != NULL)
+    {
+        xTaskNotifyFromISR(dma_task, DMA_DONE_NOTIFY_BIT, eSetBits, &xHigherPriorityTaskWoken);
+    }
+
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+#endif
 }
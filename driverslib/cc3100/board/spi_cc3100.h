@@ -50,6 +50,61 @@ extern "C" {
 */
 typedef unsigned int Fd_t;
 
+/*!
+    \brief   transfers above this size use DMA, polling otherwise
+
+    \note    With SPI_DMA_AUTOTUNE set to 1, spi_Open replaces it with the
+            size at which DMA becomes faster than polling, measured from
+            the per-byte and setup costs at the current clocks
+*/
+#ifndef SPI_DMA_THRESHOLD
+#define SPI_DMA_THRESHOLD           100
+#endif
+
+#ifndef SPI_DMA_AUTOTUNE
+#define SPI_DMA_AUTOTUNE            0
+#endif
+
+/*!
+    \brief   with SPI_TRACE set to 1, spi_TraceStart records every
+            transaction, IRQ and nHIB edge in a RAM buffer of
+            SPI_TRACE_SIZE bytes (see pingpong_trace.h for the format)
+*/
+#ifndef SPI_TRACE
+#define SPI_TRACE                   0
+#endif
+
+#ifndef SPI_TRACE_SIZE
+#define SPI_TRACE_SIZE              8192
+#endif
+
+/* Transfer size histogram: up to 4, 16, 64, 256, 1024, 4096 and more bytes */
+#define SPI_STATS_BUCKETS           7
+
+/*!
+    \brief   what the transport did in one direction, times in CPU cycles
+            (see msp432_launchpad_timestamp_to_us)
+*/
+typedef struct
+{
+    unsigned long transfers;
+    unsigned long dma_transfers;
+    unsigned long long bytes;
+    unsigned long long poll_cycles;
+    unsigned long long dma_cycles;
+    unsigned long max_cs_cycles;
+    unsigned long sizes[SPI_STATS_BUCKETS];
+} spi_direction_stats_t;
+
+typedef struct
+{
+    spi_direction_stats_t tx;
+    spi_direction_stats_t rx;
+    /* Messages with more buffers than spi_Write gathers, sent in two chains */
+    unsigned long split_messages;
+    int dma_threshold;
+} spi_stats_t;
+
 
 /*!
     \brief open spi communication port to be used for communicating with a
@@ -139,6 +194,126 @@ int spi_Read(Fd_t fd, unsigned char *pBuff, int len);
 */
 int spi_Write(Fd_t fd, unsigned char *pBuff, int len);
 
+/*!
+    \brief marks the start of a SimpleLink message
+
+    \param[in]      fd        -    file descriptor of an opened SPI channel
+
+    \return         none
+
+    \sa             spi_EndWriteSequence , spi_Write
+    \note           Until spi_EndWriteSequence, spi_Write only records the
+                    buffers, they must stay valid until then. They are then
+                    sent under a single CS assertion, as one DMA
+                    scatter-gather chain when large enough
+    \warning
+*/
+void spi_StartWriteSequence(Fd_t fd);
+
+/*!
+    \brief marks the end of a SimpleLink message and sends it
+
+    \param[in]      fd        -    file descriptor of an opened SPI channel
+
+    \return         none
+
+    \sa             spi_StartWriteSequence , spi_Write
+    \note
+    \warning
+*/
+void spi_EndWriteSequence(Fd_t fd);
+
+/*!
+    \brief copies the transport counters
+
+    \param[out]     stats     -    counters since spi_Open or spi_ResetStats
+
+    \return         none
+
+    \sa             spi_ResetStats
+    \note           A message gathered by spi_StartWriteSequence counts as
+                    a single TX transfer
+    \warning
+*/
+void spi_GetStats(spi_stats_t *stats);
+
+/*!
+    \brief clears the transport counters
+
+    \return         none
+
+    \sa             spi_GetStats
+    \note
+    \warning
+*/
+void spi_ResetStats(void);
+
+/*!
+    \brief sets the size above which transfers use DMA
+
+    \param[in]      len       -    threshold in bytes
+
+    \return         none
+
+    \sa             spi_GetStats
+    \note
+    \warning
+*/
+void spi_SetDmaThreshold(int len);
+
+#if (SPI_TRACE)
+/*!
+    \brief starts a new trace, dropping the one recorded so far
+
+    \return         none
+
+    \sa             spi_TraceStop , spi_TraceGet
+    \note           Recording stops by itself at the first record that does
+                    not fit in SPI_TRACE_SIZE
+    \warning
+*/
+void spi_TraceStart(void);
+
+/*!
+    \brief stops recording, the trace stays until the next spi_TraceStart
+
+    \return         none
+
+    \sa             spi_TraceStart
+    \note
+    \warning
+*/
+void spi_TraceStop(void);
+
+/*!
+    \brief records a line event while a trace is running
+
+    \param[in]      kind      -    PINGPONG_TRACE_IRQ, PINGPONG_TRACE_ENABLE
+                    or PINGPONG_TRACE_DISABLE
+
+    \return         none
+
+    \sa             spi_TraceStart
+    \note           Safe to call from an interrupt handler
+    \warning
+*/
+void spi_TraceEvent(unsigned char kind);
+
+/*!
+    \brief gives the trace recorded so far
+
+    \param[out]     length    -    bytes of trace, header included
+    \param[out]     dropped   -    records that did not fit
+
+    \return         the trace buffer
+
+    \sa             spi_TraceStart
+    \note           Stop the trace before reading it
+    \warning
+*/
+const unsigned char* spi_TraceGet(unsigned long *length, unsigned long *dropped);
+#endif
+
 #ifdef  __cplusplus
 }
 #endif // __cplusplus
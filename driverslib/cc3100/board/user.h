@@ -628,14 +628,97 @@ typedef P_EVENT_HANDLER                         SL_P_EVENT_HANDLER;
 
     \warning        
 */
-/*
 #define SL_START_WRITE_STAT
-*/
 
 #ifdef SL_START_WRITE_STAT
+#ifndef SL_IF_TYPE_UART
+#define sl_IfStartWriteSequence                     spi_StartWriteSequence
+#define sl_IfEndWriteSequence                       spi_EndWriteSequence
+#else
 #define sl_IfStartWriteSequence                      
 #define sl_IfEndWriteSequence                        
 #endif
+#endif
+
+/*!
+    \brief      Size of the receive look-ahead buffer
+
+    \note       When defined, the driver reads the sync pattern and the
+                response header of every message in one SPI transfer, and
+                the rest of the message in one more when it fits this
+                buffer, instead of one transfer per field. Undefine it to
+                get TI's original receive path back
+
+    \note       SL_RX_SPECULATIVE_LEN, the size of the first transfer,
+                defaults to the 12 bytes every message has. Larger values
+                do not build: they would clock past the end of the
+                shortest messages
+
+    \note       NWP RX aggregation (SL_RX_AGGR) needs it: the buffer is
+                where the messages of a burst are taken apart
+
+    \warning    Must hold SL_RX_SPECULATIVE_LEN bytes
+*/
+#define SL_RX_LOOKAHEAD_SIZE                        256
+
+/*!
+    \brief      NWP RX aggregation support
+
+    \note       1 builds the reader of the message bursts the NWP sends
+                with SL_SET_HOST_RX_AGGR, wifi_set_rx_aggregation and the
+                shell command "aggr". With 0 sl_NetCfgSet refuses to
+                enable aggregation and wifi_init leaves the NWP as it is
+
+    \warning    The burst layout the reader expects has only been tried
+                against host/nwp_sim, never against a CC3100. Off unless
+                built with SL_RX_AGGR=1
+*/
+#ifndef SL_RX_AGGR
+#define SL_RX_AGGR                                  0
+#endif
+
+/*!
+    \brief      Get the timer counter value (timestamp), counting up from
+                0 to SL_TIMESTAMP_MAX_VALUE
+
+    \note       Microseconds of Timer32, see msp432_launchpad_timestamp.
+                With it the driver gives up on a sync pattern that does not
+                come in SYNC_PATTERN_TIMEOUT_IN_MSEC, and sl_CmdTrace gets
+                its times
+
+    \note       belongs to \ref porting_sec
+*/
+#define sl_GetTimestamp                             GetTimestampUs
+#define SL_TIMESTAMP_TICKS_IN_10_MILLISECONDS       (10000)
+#define SL_TIMESTAMP_MAX_VALUE                      (0xFFFFFFFF)
+
+/*!
+    \brief      Latency record of a driver command
+
+    \param      Opcode      -   of the request, or of the response of an
+                                asynchronous action
+    \param      Start       -   sl_GetTimestamp when the caller entered the
+                                driver
+    \param      Written     -   when the request was written to the NWP
+    \param      Response    -   when the driver read the response
+    \param      Woken       -   when the caller got its result back
+
+    \note       A time is 0 when that step did not happen. CmdTraceAdd keeps
+                the last SL_CMD_TRACE_SIZE records for the shell command
+                "cmdtrace", see pingpong_cmdtrace.h
+
+    \note       Off unless built with SL_CMD_TRACE=1
+
+    \note       belongs to \ref porting_sec
+*/
+#ifndef SL_CMD_TRACE
+#define SL_CMD_TRACE                                0
+#endif
+
+#if (SL_CMD_TRACE)
+#define sl_CmdTrace(Opcode,Start,Written,Response,Woken) \
+                                CmdTraceAdd(Opcode,Start,Written,Response,Woken)
+#endif
 /*!
 
  Close the Doxygen group.
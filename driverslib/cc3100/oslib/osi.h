@@ -44,6 +44,7 @@ extern "C" {
 #endif
 
 #include "portable.h"
+#include "osi_pool.h"
   
 #define OSI_WAIT_FOREVER   			(0xFFFFFFFF)
 
@@ -377,6 +378,15 @@ void osi_TaskDelete(OsiTaskHandle* pTaskHandle);
 */
 OsiReturnVal_e osi_Spawn(P_OSI_SPAWN_ENTRY pEntry , void* pValue , unsigned long flags);
 
+/*!
+	\brief 	This function returns the number of osi_Spawn calls lost to a full spawn ring
+
+	\return the number of calls that returned OSI_OPERATION_FAILED since startup
+	\note
+	\warning
+*/
+unsigned long osi_SpawnDropped(void);
+
 
 /*******************************************************************************
 
@@ -484,6 +494,25 @@ void * mem_Malloc(unsigned long Size);
 */
 void mem_Free(void *pMem);
 
+// Pools of the OSI objects and of mem_Malloc, see osi_pool.h
+#define OSI_POOL_SYNC_OBJ		(0)
+#define OSI_POOL_SEMAPHORE		(1)
+#define OSI_POOL_DRIVER_CB		(2)
+#define OSI_POOL_ASYNC_BUF		(3)
+#define OSI_POOL_COUNT			(4)
+
+/*!
+    \brief				Copies the counters of a pool
+	\param	Pool		-	One of the OSI_POOL_ identifiers
+	\param	pStats		-	Filled in with the pool, its block size, capacity,
+							blocks in use, high-water mark and failed allocations
+	\return OSI_OK, or OSI_INVALID_PARAMS if the port has no such pool
+    \sa
+    \note				mem_Malloc only has pools with SL_MEMORY_MGMT_DYNAMIC
+    \warning
+*/
+OsiReturnVal_e osi_PoolStats(unsigned long Pool, OsiPool_t* pStats);
+
 
 /*!
     \brief				Set Memory
@@ -578,7 +607,7 @@ typedef struct
     void* pValue;
 }tSimpleLinkSpawnMsg;
   
-/* The queue used to send message to simple link spawn task. */
+/* Unused, osi_Spawn queues the calls in a ring of its own. */
 extern void* xSimpleLinkSpawnQueue;
 
 /* API for SL Task*/
@@ -45,17 +45,229 @@
 #include "semphr.h"
 #include "portmacro.h"
 #include <osi.h>
+#include "simplelink.h"
+#include "protocol.h"
+#include "driver.h"
 
 
 
 portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
 //Local function definition
 static void vSimpleLinkSpawnTask( void *pvParameters );
-//Queue Handler
+//Only there for osi.h, osi_Spawn uses xSpawnRing
 QueueHandle_t xSimpleLinkSpawnQueue = NULL;
 TaskHandle_t xSimpleLinkSpawnTaskHndl = NULL;
-// Queue size 
-#define slQUEUE_SIZE				( 3 )
+// Spawn ring size, a power of two
+#define slSPAWN_RING_SIZE			( 8 )
+#define slSPAWN_RING_MASK			( slSPAWN_RING_SIZE - 1 )
+// Notification bit osi_Spawn sets, spi_cc3100.c waits for DMA on 0x80000000
+// and the sync objects use 0x40000000
+#define slSPAWN_NOTIFY_BIT			( 0x00000001 )
+
+/*
+ * Spawn ring: a bounded MPSC queue between osi_Spawn, called from the
+ * CC3100 interrupt and from tasks, and the spawn task. A producer claims a
+ * position with a compare-and-swap on ulSpawnTail and never blocks or masks
+ * interrupts. ulLap tells the state of the slot for the position p being
+ * claimed, with base = p & ~slSPAWN_RING_MASK:
+ *  - base: free, the spawn task has run the call of the previous lap;
+ *  - base + 1: published, pEntry and pValue are valid;
+ *  - anything below base: still in use one lap behind, the ring is full.
+ * A producer interrupted between claiming and publishing holds back the
+ * calls behind it until it resumes and wakes the task itself.
+ * Zeroed memory is an empty ring, so osi_Spawn works before the task starts.
+ */
+typedef struct
+{
+	volatile uint32_t ulLap;
+	volatile P_OSI_SPAWN_ENTRY pEntry;
+	void* volatile pValue;
+}tSimpleLinkSpawnSlot;
+
+static tSimpleLinkSpawnSlot xSpawnRing[slSPAWN_RING_SIZE];
+static volatile uint32_t ulSpawnTail;
+static uint32_t ulSpawnHead;
+static volatile uint32_t ulSpawnDropped;
+
+/*
+ * Compare-and-swap of a word, safe between tasks and interrupts: on the
+ * Cortex-M4 an exception between LDREX and STREX makes the STREX fail, and
+ * the caller retries with a fresh value.
+ */
+static inline int osi_CompareAndSwap(volatile uint32_t* pWord, uint32_t ulOld, uint32_t ulNew)
+{
+#if defined(__TI_ARM__)
+	if((uint32_t)__ldrex((void*)pWord) != ulOld)
+	{
+		return 0;
+	}
+	return (0 == __strex(ulNew, (void*)pWord));
+#else
+	return __atomic_compare_exchange_n(pWord, &ulOld, ulNew, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+#endif
+}
+
+// Sync objects on direct-to-task notifications (1) or on binary semaphores (0).
+// The proven gain is RAM, a 16-byte pool block per sync object where a
+// semaphore takes 80. A faster _SlDrvCmdOp round trip is not: on the host
+// it is within noise, and it has not been measured on the board. To measure
+// it, compare the shell command "cmd 1000" of this build with one of
+// OSI_SYNC_NOTIFY=0
+#ifndef OSI_SYNC_NOTIFY
+#define OSI_SYNC_NOTIFY				( 1 )
+#endif
+
+#if (OSI_SYNC_NOTIFY)
+// Notification bit of the sync objects, next to the spawn and DMA bits
+#define osiSYNC_NOTIFY_BIT			( 0x40000000 )
+
+/*
+ * Sync object for a single waiter, 12 bytes instead of a queue object.
+ * ulGiven latches the signal as the binary semaphore did, and the signal
+ * wakes the task registered in xWaiter with osiSYNC_NOTIFY_BIT. The bit is
+ * only a hint: a task woken by another bit, or by a stale one left by a
+ * signal that came after it had taken ulGiven, looks at ulGiven and waits
+ * again. A second task that waits while xWaiter is taken sleeps on
+ * xShared, a binary semaphore created the first time it is needed and
+ * given by every later signal. When the pool has no semaphore left for
+ * it, the second task looks at ulGiven once a tick instead.
+ */
+typedef struct
+{
+	volatile uint32_t ulGiven;
+	TaskHandle_t volatile xWaiter;
+	SemaphoreHandle_t volatile xShared;
+}tOsiSyncObj;
+
+static int osi_SyncObjTake(tOsiSyncObj* pObj)
+{
+	while(0 != pObj->ulGiven)
+	{
+		if(osi_CompareAndSwap(&pObj->ulGiven, 1, 0))
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+#endif
+
+/*
+ * Object pools, see osi_pool.h. sl_Start creates CmdSyncObj, TxSyncObj and
+ * one sync object per action, and the global, protection and Tx locks;
+ * sl_Stop deletes them again. Taken from the heap, every sleep/wake cycle
+ * would need fresh memory that heap_1 never gets back. The pools hold that
+ * set, plus a spare lock for the GlobalLockObj that a stop leaves behind
+ * when the device needs a restart, and two semaphores for the xShared of
+ * sync objects that see a second waiter. sl_Start uses every sync object
+ * of 2 + MAX_CONCURRENT_ACTIONS, the two spare ones are for the SimpleLink
+ * spawn task (SL_PLATFORM_EXTERNAL_SPAWN undefined) and the application.
+ * The semaphores come from their pool only with configSUPPORT_STATIC_ALLOCATION,
+ * without it they are created on the heap as before.
+ */
+#ifndef OSI_POOL_SYNC_OBJS
+#define OSI_POOL_SYNC_OBJS			( 2 + MAX_CONCURRENT_ACTIONS + 2 )
+#endif
+
+#ifndef OSI_POOL_SEMAPHORES
+#if (OSI_SYNC_NOTIFY)
+#define OSI_POOL_SEMAPHORES			( 3 + 1 + 2 )
+#else
+#define OSI_POOL_SEMAPHORES			( 3 + 1 + 2 + MAX_CONCURRENT_ACTIONS )
+#endif
+#endif
+
+#if (OSI_SYNC_NOTIFY)
+OSI_POOL_STORAGE(xSyncObjStorage, sizeof(tOsiSyncObj), OSI_POOL_SYNC_OBJS);
+static OsiPool_t xSyncObjPool = OSI_POOL_INIT(xSyncObjStorage, sizeof(tOsiSyncObj), OSI_POOL_SYNC_OBJS);
+#endif
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+OSI_POOL_STORAGE(xSemaphoreStorage, sizeof(StaticSemaphore_t), OSI_POOL_SEMAPHORES);
+static OsiPool_t xSemaphorePool = OSI_POOL_INIT(xSemaphoreStorage, sizeof(StaticSemaphore_t), OSI_POOL_SEMAPHORES);
+#endif
+
+#ifdef SL_MEMORY_MGMT_DYNAMIC
+// Size classes of mem_Malloc, the only two allocations of the driver: the
+// buffer of an async event, one at a time, and the driver control block
+#ifndef OSI_POOL_ASYNC_BUFS
+#define OSI_POOL_ASYNC_BUFS			( 1 )
+#endif
+#define osiMEM_POOLS				( 2 )
+
+OSI_POOL_STORAGE(xAsyncBufStorage, SL_ASYNC_MAX_MSG_LEN, OSI_POOL_ASYNC_BUFS);
+OSI_POOL_STORAGE(xDriverCbStorage, sizeof(_SlDriverCb_t), 1);
+// In increasing block size
+static OsiPool_t xMemPools[osiMEM_POOLS] =
+{
+	OSI_POOL_INIT(xAsyncBufStorage, SL_ASYNC_MAX_MSG_LEN, OSI_POOL_ASYNC_BUFS),
+	OSI_POOL_INIT(xDriverCbStorage, sizeof(_SlDriverCb_t), 1)
+};
+#endif
+
+static OsiPool_t* const pxOsiPools[OSI_POOL_COUNT] =
+{
+#if (OSI_SYNC_NOTIFY)
+	&xSyncObjPool,
+#else
+	NULL,
+#endif
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+	&xSemaphorePool,
+#else
+	NULL,
+#endif
+#ifdef SL_MEMORY_MGMT_DYNAMIC
+	&xMemPools[1],
+	&xMemPools[0]
+#else
+	NULL,
+	NULL
+#endif
+};
+
+// The pools are shared by all the tasks, allocation and release are short
+static void* osi_PoolTake(OsiPool_t* pPool)
+{
+	void* pBlock;
+
+	taskENTER_CRITICAL();
+	pBlock = osi_PoolAlloc(pPool);
+	taskEXIT_CRITICAL();
+	return pBlock;
+}
+
+static void osi_PoolGive(OsiPool_t* pPool, void* pBlock)
+{
+	taskENTER_CRITICAL();
+	(void)osi_PoolFree(pPool, pBlock);
+	taskEXIT_CRITICAL();
+}
+
+// A mutex or an empty binary semaphore, built in place in a pool block
+static SemaphoreHandle_t osi_SemaphoreCreate(int bMutex)
+{
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+	StaticSemaphore_t* pxBuffer = (StaticSemaphore_t*)osi_PoolTake(&xSemaphorePool);
+
+	if(NULL == pxBuffer)
+	{
+		return NULL;
+	}
+	return bMutex ? xSemaphoreCreateMutexStatic(pxBuffer) : xSemaphoreCreateBinaryStatic(pxBuffer);
+#else
+	return bMutex ? xSemaphoreCreateMutex() : xSemaphoreCreateBinary();
+#endif
+}
+
+static void osi_SemaphoreDelete(SemaphoreHandle_t xSemaphore)
+{
+	//Statically allocated, vSemaphoreDelete leaves the block alone
+	vSemaphoreDelete(xSemaphore);
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+	osi_PoolGive(&xSemaphorePool, (void*)xSemaphore);
+#endif
+}
 
 
 
@@ -81,9 +293,22 @@ OsiReturnVal_e osi_SyncObjCreate(OsiSyncObj_t* pSyncObj)
     {
         return OSI_INVALID_PARAMS;
     }
+#if (OSI_SYNC_NOTIFY)
+    tOsiSyncObj *pObj = (tOsiSyncObj *)osi_PoolTake(&xSyncObjPool);
+
+    if(NULL == pObj)
+    {
+        return OSI_OPERATION_FAILED;
+    }
+    pObj->ulGiven = 0;
+    pObj->xWaiter = NULL;
+    pObj->xShared = NULL;
+    *pSyncObj = (OsiSyncObj_t)pObj;
+    return OSI_OK;
+#else
     SemaphoreHandle_t *pl_SyncObj = (SemaphoreHandle_t *)pSyncObj;
 
-    *pl_SyncObj = xSemaphoreCreateBinary();
+    *pl_SyncObj = osi_SemaphoreCreate(0);
 
     if((SemaphoreHandle_t)(*pSyncObj) != NULL)
     {
@@ -93,6 +318,7 @@ OsiReturnVal_e osi_SyncObjCreate(OsiSyncObj_t* pSyncObj)
     {
         return OSI_OPERATION_FAILED;
     }
+#endif
 }
 
 /*!
@@ -112,7 +338,17 @@ OsiReturnVal_e osi_SyncObjDelete(OsiSyncObj_t* pSyncObj)
 	{
 		return OSI_INVALID_PARAMS;
 	}
-    vSemaphoreDelete(*pSyncObj );
+#if (OSI_SYNC_NOTIFY)
+    tOsiSyncObj *pObj = (tOsiSyncObj *)*pSyncObj;
+
+    if(NULL != pObj->xShared)
+    {
+        osi_SemaphoreDelete(pObj->xShared);
+    }
+    osi_PoolGive(&xSyncObjPool, pObj);
+#else
+    osi_SemaphoreDelete((SemaphoreHandle_t)*pSyncObj );
+#endif
     return OSI_OK;
 }
 
@@ -136,12 +372,31 @@ OsiReturnVal_e osi_SyncObjSignal(OsiSyncObj_t* pSyncObj)
 		return OSI_INVALID_PARAMS;
 	}
 
+#if (OSI_SYNC_NOTIFY)
+	tOsiSyncObj *pObj = (tOsiSyncObj *)*pSyncObj;
+	TaskHandle_t xWaiter;
+	SemaphoreHandle_t xShared;
+
+	//Latched first, a waiter registered after this read finds it set
+	pObj->ulGiven = 1;
+	xWaiter = pObj->xWaiter;
+	if(NULL != xWaiter)
+	{
+		xTaskNotify( xWaiter, osiSYNC_NOTIFY_BIT, eSetBits );
+	}
+	xShared = pObj->xShared;
+	if(NULL != xShared)
+	{
+		xSemaphoreGive( xShared );
+	}
+#else
     if(pdTRUE != xSemaphoreGive( *pSyncObj ))
 	{
         //In case of Semaphore, you are expected to get this if multiple sem
         // give is called before sem take
         return OSI_OK;
 	}
+#endif
 	
     return OSI_OK;
 }
@@ -165,6 +420,26 @@ OsiReturnVal_e osi_SyncObjSignalFromISR(OsiSyncObj_t* pSyncObj)
 	{
 		return OSI_INVALID_PARAMS;
 	}
+#if (OSI_SYNC_NOTIFY)
+	tOsiSyncObj *pObj = (tOsiSyncObj *)*pSyncObj;
+	portBASE_TYPE xWoken = pdFALSE;
+	TaskHandle_t xWaiter;
+	SemaphoreHandle_t xShared;
+
+	pObj->ulGiven = 1;
+	xWaiter = pObj->xWaiter;
+	if(NULL != xWaiter)
+	{
+		xTaskNotifyFromISR( xWaiter, osiSYNC_NOTIFY_BIT, eSetBits, &xWoken );
+	}
+	xShared = pObj->xShared;
+	if(NULL != xShared)
+	{
+		xSemaphoreGiveFromISR( xShared, &xWoken );
+	}
+	portYIELD_FROM_ISR( xWoken );
+	return OSI_OK;
+#else
 	xHigherPriorityTaskWoken = pdFALSE;
 	if(pdTRUE == xSemaphoreGiveFromISR( *pSyncObj, &xHigherPriorityTaskWoken ))
 	{
@@ -180,6 +455,7 @@ OsiReturnVal_e osi_SyncObjSignalFromISR(OsiSyncObj_t* pSyncObj)
 		// give is called before sem take
 		return OSI_OK;
 	}
+#endif
 }
 
 /*!
@@ -204,6 +480,82 @@ OsiReturnVal_e osi_SyncObjWait(OsiSyncObj_t* pSyncObj , OsiTime_t Timeout)
 	{
 		return OSI_INVALID_PARAMS;
 	}
+#if (OSI_SYNC_NOTIFY)
+	tOsiSyncObj *pObj = (tOsiSyncObj *)*pSyncObj;
+	TaskHandle_t xSelf;
+	TimeOut_t xTimeOut;
+	TickType_t xTicks;
+	uint32_t ulNotified;
+	portBASE_TYPE xSecond;
+	OsiReturnVal_e Ret;
+
+	//Signalled already, often the case for a command response
+	if(osi_SyncObjTake(pObj))
+	{
+		return OSI_OK;
+	}
+	if(OSI_NO_WAIT == Timeout)
+	{
+		return OSI_OPERATION_FAILED;
+	}
+
+	xTicks = (OSI_WAIT_FOREVER == Timeout) ? portMAX_DELAY : ( TickType_t )(Timeout/portTICK_PERIOD_MS);
+	vTaskSetTimeOutState(&xTimeOut);
+	xSelf = xTaskGetCurrentTaskHandle();
+
+	taskENTER_CRITICAL();
+	if(NULL == pObj->xWaiter)
+	{
+		pObj->xWaiter = xSelf;
+	}
+	xSecond = (pObj->xWaiter != xSelf);
+	taskEXIT_CRITICAL();
+
+	//Created once with the scheduler suspended, two late waiters cannot both create it
+	if(xSecond && (NULL == pObj->xShared))
+	{
+		vTaskSuspendAll();
+		if(NULL == pObj->xShared)
+		{
+			pObj->xShared = osi_SemaphoreCreate(0);
+		}
+		xTaskResumeAll();
+	}
+
+	//Registered before ulGiven is read, so a signal is seen one way or the other
+	for(;;)
+	{
+		if(osi_SyncObjTake(pObj))
+		{
+			Ret = OSI_OK;
+			break;
+		}
+		if(pdFALSE != xTaskCheckForTimeOut(&xTimeOut, &xTicks))
+		{
+			Ret = OSI_OPERATION_FAILED;
+			break;
+		}
+		if(xSecond && (NULL != pObj->xShared))
+		{
+			xSemaphoreTake( pObj->xShared, xTicks );
+		}
+		else if(xSecond)
+		{
+			//No semaphore left for xShared, a timeout would look fatal to the driver
+			vTaskDelay( 1 );
+		}
+		else
+		{
+			xTaskNotifyWait( 0, osiSYNC_NOTIFY_BIT, &ulNotified, xTicks );
+		}
+	}
+
+	if(!xSecond)
+	{
+		pObj->xWaiter = NULL;
+	}
+	return Ret;
+#else
     if(pdTRUE == xSemaphoreTake( (SemaphoreHandle_t)*pSyncObj, ( TickType_t )(Timeout/portTICK_PERIOD_MS) ))
     {
         return OSI_OK;
@@ -212,6 +564,7 @@ OsiReturnVal_e osi_SyncObjWait(OsiSyncObj_t* pSyncObj , OsiTime_t Timeout)
     {
         return OSI_OPERATION_FAILED;
     }
+#endif
 }
 
 /*!
@@ -262,8 +615,8 @@ OsiReturnVal_e osi_LockObjCreate(OsiLockObj_t* pLockObj)
     {
             return OSI_INVALID_PARAMS;
     }
-    *pLockObj = (OsiLockObj_t)xSemaphoreCreateMutex();
-    if(pLockObj != NULL)
+    *pLockObj = (OsiLockObj_t)osi_SemaphoreCreate(1);
+    if(*pLockObj != NULL)
     {  
         return OSI_OK;
     }
@@ -334,7 +687,7 @@ void osi_TaskDelete(OsiTaskHandle* pTaskHandle)
 */
 OsiReturnVal_e osi_LockObjDelete(OsiLockObj_t* pLockObj)
 {
-    vSemaphoreDelete((SemaphoreHandle_t)*pLockObj );
+    osi_SemaphoreDelete((SemaphoreHandle_t)*pLockObj );
     return OSI_OK;
 }
 
@@ -424,22 +777,54 @@ OsiReturnVal_e osi_LockObjUnlock(OsiLockObj_t* pLockObj)
 
 OsiReturnVal_e osi_Spawn(P_OSI_SPAWN_ENTRY pEntry , void* pValue , unsigned long flags)
 {
+	portBASE_TYPE xWoken = pdFALSE;
+	tSimpleLinkSpawnSlot* pSlot;
+	uint32_t ulPos;
+	uint32_t ulDropped;
+	int32_t lDiff;
 
-	tSimpleLinkSpawnMsg Msg;
-	Msg.pEntry = pEntry;
-	Msg.pValue = pValue;
-	xHigherPriorityTaskWoken = pdFALSE;
+	(void)flags;
 
-	if(pdTRUE == xQueueSendFromISR( xSimpleLinkSpawnQueue, &Msg, &xHigherPriorityTaskWoken ))
+	//Claim the next position, another producer may take it first
+	do
 	{
-		if( xHigherPriorityTaskWoken )
+		ulPos = ulSpawnTail;
+		pSlot = &xSpawnRing[ulPos & slSPAWN_RING_MASK];
+		lDiff = (int32_t)(pSlot->ulLap - (ulPos & ~slSPAWN_RING_MASK));
+		if(lDiff < 0)
 		{
-			taskYIELD ();
+			do
+			{
+				ulDropped = ulSpawnDropped;
+			}while(!osi_CompareAndSwap(&ulSpawnDropped, ulDropped, ulDropped + 1));
+			return OSI_OPERATION_FAILED;
 		}
+	}while((lDiff > 0) || !osi_CompareAndSwap(&ulSpawnTail, ulPos, ulPos + 1));
 
-		return OSI_OK;
+	pSlot->pEntry = pEntry;
+	pSlot->pValue = pValue;
+	pSlot->ulLap = (ulPos & ~slSPAWN_RING_MASK) + 1;
+
+	//One bit wakes the spawn task for everything published so far
+	if(NULL != xSimpleLinkSpawnTaskHndl)
+	{
+		xTaskNotifyFromISR( xSimpleLinkSpawnTaskHndl, slSPAWN_NOTIFY_BIT, eSetBits, &xWoken );
+		portYIELD_FROM_ISR( xWoken );
 	}
-	return OSI_OPERATION_FAILED;
+
+	return OSI_OK;
+}
+
+/*!
+	\brief 	This function returns the number of osi_Spawn calls lost to a full spawn ring
+
+	\return the number of calls that returned OSI_OPERATION_FAILED since startup
+	\note
+	\warning
+*/
+unsigned long osi_SpawnDropped(void)
+{
+	return ulSpawnDropped;
 }
 
 
@@ -454,21 +839,35 @@ OsiReturnVal_e osi_Spawn(P_OSI_SPAWN_ENTRY pEntry , void* pValue , unsigned long
 */
 void vSimpleLinkSpawnTask(void *pvParameters)
 {
-	tSimpleLinkSpawnMsg Msg;
-	portBASE_TYPE ret=pdFAIL;
+	tSimpleLinkSpawnSlot* pSlot;
+	P_OSI_SPAWN_ENTRY pEntry;
+	void* pValue;
+	uint32_t ulNotified;
 
 	for(;;)
 	{
-		ret = xQueueReceive( xSimpleLinkSpawnQueue, &Msg, portMAX_DELAY );
-		if(ret == pdPASS)
+		//Run the calls in order up to the first one not published yet
+		pSlot = &xSpawnRing[ulSpawnHead & slSPAWN_RING_MASK];
+		while(pSlot->ulLap == (ulSpawnHead & ~slSPAWN_RING_MASK) + 1)
 		{
-				Msg.pEntry(Msg.pValue);
+			pEntry = pSlot->pEntry;
+			pValue = pSlot->pValue;
+			pSlot->ulLap = (ulSpawnHead & ~slSPAWN_RING_MASK) + slSPAWN_RING_SIZE;
+			ulSpawnHead++;
+
+			pEntry(pValue);
+
+			pSlot = &xSpawnRing[ulSpawnHead & slSPAWN_RING_MASK];
 		}
+
+		//A call that read from the CC3100 may have taken the bit in its DMA
+		//wait, the ring is checked again before sleeping so nothing is lost
+		xTaskNotifyWait( 0, slSPAWN_NOTIFY_BIT, &ulNotified, portMAX_DELAY );
 	}
 }
 
 /*!
-	\brief 	This is the API to create SL spawn task and create the SL queue
+	\brief 	This is the API to create SL spawn task, osi_Spawn calls queued before run first
 
 	\param	uxPriority		-	task priority
 
@@ -478,11 +877,6 @@ void vSimpleLinkSpawnTask(void *pvParameters)
 */
 OsiReturnVal_e VStartSimpleLinkSpawnTask(unsigned portBASE_TYPE uxPriority)
 {
-    xSimpleLinkSpawnQueue = xQueueCreate( slQUEUE_SIZE, sizeof( tSimpleLinkSpawnMsg ) );
-    if(0 == xSimpleLinkSpawnQueue)
-    {
-    	return OSI_OPERATION_FAILED;
-    }
     if(pdPASS == xTaskCreate( vSimpleLinkSpawnTask, ( portCHAR * ) "SLSPAWN",\
     					 (512/sizeof( portSTACK_TYPE )), NULL, uxPriority, &xSimpleLinkSpawnTaskHndl ))
     {
@@ -493,7 +887,7 @@ OsiReturnVal_e VStartSimpleLinkSpawnTask(unsigned portBASE_TYPE uxPriority)
 }
 
 /*!
-	\brief 	This is the API to delete SL spawn task and delete the SL queue
+	\brief 	This is the API to delete SL spawn task
 
 	\param	none
 
@@ -508,12 +902,6 @@ void VDeleteSimpleLinkSpawnTask( void )
 		vTaskDelete( xSimpleLinkSpawnTaskHndl );
 		xSimpleLinkSpawnTaskHndl = 0;
 	}
-
-	if(0 !=xSimpleLinkSpawnQueue)
-	{
-		vQueueDelete( xSimpleLinkSpawnQueue );
-		xSimpleLinkSpawnQueue = 0;
-	}
 }
 
 /*!
@@ -637,7 +1025,8 @@ OsiReturnVal_e osi_MsgQRead(OsiMsgQ_t* pMsgQ, void* pMsg , OsiTime_t Timeout)
 }
 
 /*!
-	\brief 	This function to call the memory de-allocation function of the FREERTOS
+	\brief 	This function allocates memory, from the pools for the sizes the driver
+			uses with SL_MEMORY_MGMT_DYNAMIC, from the FREERTOS heap otherwise
 
 	\param	Size	-	size of memory to alloc in bytes
 
@@ -648,12 +1037,24 @@ OsiReturnVal_e osi_MsgQRead(OsiMsgQ_t* pMsgQ, void* pMsg , OsiTime_t Timeout)
 
 void * mem_Malloc(unsigned long Size)
 {
-  
+#ifdef SL_MEMORY_MGMT_DYNAMIC
+    void *pMem;
+
+    //Sizes of the driver never fall back on the heap, it would not give them back
+    if(Size <= xMemPools[osiMEM_POOLS - 1].ulBlockSize)
+    {
+        taskENTER_CRITICAL();
+        pMem = osi_PoolAllocSize(xMemPools, osiMEM_POOLS, (size_t)Size);
+        taskEXIT_CRITICAL();
+        return pMem;
+    }
+#endif
     return ( void * ) pvPortMalloc( (size_t)Size );
 }
 
 /*!
-	\brief 	This function to call the memory de-allocation function of the FREERTOS
+	\brief 	This function frees memory from mem_Malloc, back to its pool or to the
+			FREERTOS heap
 
 	\param	pMem		-	pointer to the memory which needs to be freed
 	
@@ -663,9 +1064,43 @@ void * mem_Malloc(unsigned long Size)
 */
 void mem_Free(void *pMem)
 {
+#ifdef SL_MEMORY_MGMT_DYNAMIC
+    bool bPooled;
+
+    taskENTER_CRITICAL();
+    bPooled = osi_PoolFreeAny(xMemPools, osiMEM_POOLS, pMem);
+    taskEXIT_CRITICAL();
+    if(bPooled)
+    {
+        return;
+    }
+#endif
     vPortFree( pMem );
 }
 
+/*!
+	\brief 	This function copies the counters of an object pool
+
+	\param	Pool		-	one of the OSI_POOL_ identifiers of osi.h
+	\param	pStats		-	filled in with a copy of the pool
+
+	\return OSI_OK, or OSI_INVALID_PARAMS for a pool this build does not have
+	\note
+	\warning
+*/
+OsiReturnVal_e osi_PoolStats(unsigned long Pool, OsiPool_t* pStats)
+{
+	if((NULL == pStats) || (Pool >= OSI_POOL_COUNT) || (NULL == pxOsiPools[Pool]))
+	{
+		return OSI_INVALID_PARAMS;
+	}
+
+	taskENTER_CRITICAL();
+	*pStats = *pxOsiPools[Pool];
+	taskEXIT_CRITICAL();
+	return OSI_OK;
+}
+
 /*!
 	\brief 	This function call the memset function
 	\param	pBuf	     -	 pointer to the memory to be fill
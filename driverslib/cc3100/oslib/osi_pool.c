@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#include "osi_pool.h"
+
+/*----------------------------------------------------------------------------*/
+
+void* osi_PoolAlloc(OsiPool_t* pPool)
+{
+    void* pBlock;
+
+    if (pPool->pFree != NULL)
+    {
+        /* A released block keeps the link to the next one in its first word */
+        pBlock = pPool->pFree;
+        pPool->pFree = *(void**) pBlock;
+    }
+    else if (pPool->ulTouched < pPool->ulBlocks)
+    {
+        pBlock = (uint8_t*) pPool->pStorage + pPool->ulTouched * pPool->ulBlockSize;
+        pPool->ulTouched++;
+    }
+    else
+    {
+        pPool->ulFailed++;
+        return NULL;
+    }
+
+    pPool->ulUsed++;
+    if (pPool->ulUsed > pPool->ulPeak)
+    {
+        pPool->ulPeak = pPool->ulUsed;
+    }
+
+    return pBlock;
+}
+
+/*----------------------------------------------------------------------------*/
+
+bool osi_PoolFree(OsiPool_t* pPool, void* pBlock)
+{
+    uint32_t ulOffset;
+    void* pFree;
+
+    if (!osi_PoolOwns(pPool, pBlock))
+    {
+        return false;
+    }
+
+    /* Only blocks handed out, and at their start */
+    ulOffset = (uint32_t) ((const uint8_t*) pBlock - (const uint8_t*) pPool->pStorage);
+    if ((ulOffset % pPool->ulBlockSize) != 0 || ulOffset / pPool->ulBlockSize >= pPool->ulTouched)
+    {
+        return false;
+    }
+
+    /* Released already */
+    for (pFree = pPool->pFree; pFree != NULL; pFree = *(void**) pFree)
+    {
+        if (pFree == pBlock)
+        {
+            return false;
+        }
+    }
+
+    *(void**) pBlock = pPool->pFree;
+    pPool->pFree = pBlock;
+    pPool->ulUsed--;
+
+    return true;
+}
+
+/*----------------------------------------------------------------------------*/
+
+bool osi_PoolOwns(const OsiPool_t* pPool, const void* pBlock)
+{
+    const uint8_t* pStart = (const uint8_t*) pPool->pStorage;
+    const uint8_t* pByte = (const uint8_t*) pBlock;
+
+    return pByte >= pStart && pByte < pStart + pPool->ulBlocks * pPool->ulBlockSize;
+}
+
+/*----------------------------------------------------------------------------*/
+
+void* osi_PoolAllocSize(OsiPool_t* pPools, uint32_t ulCount, size_t Size)
+{
+    void* pBlock;
+    uint32_t i;
+
+    for (i = 0; i < ulCount; i++)
+    {
+        if (Size <= pPools[i].ulBlockSize)
+        {
+            pBlock = osi_PoolAlloc(&pPools[i]);
+            if (pBlock != NULL)
+            {
+                return pBlock;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+
+bool osi_PoolFreeAny(OsiPool_t* pPools, uint32_t ulCount, void* pBlock)
+{
+    uint32_t i;
+
+    for (i = 0; i < ulCount; i++)
+    {
+        if (osi_PoolOwns(&pPools[i], pBlock))
+        {
+            (void) osi_PoolFree(&pPools[i], pBlock);
+            return true;
+        }
+    }
+
+    return false;
+}
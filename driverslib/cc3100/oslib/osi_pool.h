@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#ifndef OSI_POOL_H_
+#define OSI_POOL_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Fixed-block pools for the objects of the OSI layer.
+ *
+ * A pool hands out blocks of a single size from storage fixed at compile
+ * time. Allocation and release are O(1): released blocks go to a list
+ * threaded through the blocks themselves, and until every block has been
+ * handed out once the next one comes from the untouched end of the storage,
+ * so a pool needs no initialisation at run time. Nothing is split or
+ * merged, a pool cannot fragment, and the RAM it takes shows in the map
+ * file. The counters tell how close the compile-time capacity is to what
+ * the application really needs.
+ *
+ * A release walks the list of released blocks, a few compares for pools of
+ * the size the OSI layer has, so that a block freed twice, or one that is
+ * not a block of the pool, is refused instead of corrupting the list.
+ *
+ * A pool does no locking, the OSI port serialises the calls.
+ *
+ * Plain C99, shared by osi_freertos.c and the host port in osi_posix.c.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Unit of the storage, which aligns every block for any object */
+typedef uint64_t OsiPoolWord_t;
+
+#define OSI_POOL_WORDS(Size)        ( ((Size) + sizeof(OsiPoolWord_t) - 1) / sizeof(OsiPoolWord_t) )
+
+/* Storage for Count blocks that hold Size bytes each */
+#define OSI_POOL_STORAGE(Name, Size, Count) \
+    static OsiPoolWord_t Name[OSI_POOL_WORDS(Size) * (Count)]
+
+/* Static initialiser of the pool over that storage */
+#define OSI_POOL_INIT(Storage, Size, Count) \
+    { (Storage), NULL, (uint32_t) (OSI_POOL_WORDS(Size) * sizeof(OsiPoolWord_t)), (Count), 0, 0, 0, 0 }
+
+typedef struct
+{
+    OsiPoolWord_t* pStorage;
+    void* pFree;
+    uint32_t ulBlockSize;
+    uint32_t ulBlocks;
+
+    /* Blocks handed out at least once, the first ulTouched of the storage */
+    uint32_t ulTouched;
+
+    uint32_t ulUsed;
+    uint32_t ulPeak;
+    /* Allocations that found the pool empty */
+    uint32_t ulFailed;
+} OsiPool_t;
+
+/* A block, or NULL if all of them are in use */
+void* osi_PoolAlloc(OsiPool_t* pPool);
+/* False, and the pool unchanged, if pBlock is not a block in use */
+bool osi_PoolFree(OsiPool_t* pPool, void* pBlock);
+
+/* Whether pBlock is one of the blocks of the pool */
+bool osi_PoolOwns(const OsiPool_t* pPool, const void* pBlock);
+
+/*
+ * Size classes: a block of at least Size bytes from the first of the Count
+ * pools, in increasing block size, that has one left. NULL if none fits.
+ */
+void* osi_PoolAllocSize(OsiPool_t* pPools, uint32_t ulCount, size_t Size);
+
+/*
+ * Returns pBlock to the pool it came from. False if it is not from any of
+ * them; a block of one that is not in use is ignored.
+ */
+bool osi_PoolFreeAny(OsiPool_t* pPools, uint32_t ulCount, void* pBlock);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OSI_POOL_H_ */
@@ -48,6 +48,14 @@
 
 #define          _SL_PENDING_RX_MSG(pDriverCB)   (RxIrqCnt != (pDriverCB)->RxDoneCnt)
 
+/*  The messages of an aggregated burst come with a single IRQ, which is    */
+/*  done with once the last of them has been read                           */
+#ifdef SL_RX_BURST
+#define          _SL_RX_BURST_PENDING()          (g_RxLookAhead.Burst)
+#else
+#define          _SL_RX_BURST_PENDING()          (FALSE)
+#endif
+
 /*  2 LSB of the N2H_SYNC_PATTERN are for sequence number 
 only in SPI interface
 support backward sync pattern */
@@ -73,6 +81,28 @@ support backward sync pattern */
 /*  Actual size of Recv/Recvfrom response data  */
 #define ACT_DATA_SIZE(_ptr)   (((_SocketAddrResponse_u *)(_ptr))->IpV4.statusOrLen)
 
+/*  With SL_RX_LOOKAHEAD_SIZE defined (user.h), _SlDrvRxHdrRead reads the  */
+/*  headers, and the rest of the message when it fits, in bulk transfers   */
+/*  into a look-ahead buffer, which then serves the reads of _SlDrvMsgRead */
+#ifdef SL_RX_LOOKAHEAD
+
+/*  First read after CNYS: sync + generic and spec headers, which every    */
+/*  message has. It must not go past the end of the shortest message, the  */
+/*  NWP has not been seen to put up with that                              */
+#ifndef SL_RX_SPECULATIVE_LEN
+#define SL_RX_SPECULATIVE_LEN   (SYNC_PATTERN_LEN + _SL_RESP_HDR_SIZE)
+#endif
+#define SL_RX_SPECULATIVE_READ  ((_u16)((SL_RX_SPECULATIVE_LEN + 3) & ~3))
+
+/*  Fails to compile when SL_RX_SPECULATIVE_READ is longer than a message  */
+/*  without payload (sizeof rules out #if)                                 */
+typedef _u8 _SlRxSpeculativeLenCheck_t[(SL_RX_SPECULATIVE_READ <= SYNC_PATTERN_LEN + _SL_RESP_HDR_SIZE) ? 1 : -1];
+
+#define NWP_RX_READ_CHECK(fd,pBuff,len) VERIFY_RET_OK(_SlDrvRxLookAheadRead((_u8 *)(pBuff),(_u16)(len)))
+#else
+#define NWP_RX_READ_CHECK(fd,pBuff,len) NWP_IF_READ_CHECK(fd,pBuff,len)
+#endif
+
 
 /* Internal function prototype declaration */
 
@@ -407,6 +437,29 @@ static const _SlSyncPattern_t g_H2NSyncPattern = H2N_SYNC_PATTERN;
 static const _SlSyncPattern_t g_H2NCnysPattern = H2N_CNYS_PATTERN;
 #endif
 
+#ifdef SL_RX_LOOKAHEAD
+/*  Bytes of the message being received read ahead of _SlDrvMsgRead.      */
+/*  The NWP presents a new message after every CNYS, which drops the rest, */
+/*  or with RX aggregation a burst of them back to back after a single IRQ */
+typedef struct
+{
+    union
+    {
+        _u8     Buf[SL_RX_LOOKAHEAD_SIZE];
+        _u32    Align;
+    } u;
+    _u16        Offset;
+    _u16        Length;
+    _u16        Left;       /* of the message, past Offset */
+#ifdef SL_RX_BURST
+    _u8         Aggregated; /* SL_SET_HOST_RX_AGGR is on */
+    _u8         Burst;      /* the next message of the burst is at Buf[0] */
+#endif
+} _SlRxLookAhead_t;
+
+static _SlRxLookAhead_t g_RxLookAhead;
+#endif
+
 
 _volatile _u8           RxIrqCnt;
 
@@ -478,9 +531,24 @@ static _SlReturnVal_t _SlDrvMsgWrite(_SlCmdCtrl_t  *pCmdCtrl,_SlCmdExt_t  *pCmdE
 static _SlReturnVal_t _SlDrvMsgReadCmdCtx(_u16 cmdOpcode);
 static _SlReturnVal_t _SlDrvClassifyRxMsg(_SlOpcode_t Opcode );
 static _SlReturnVal_t _SlDrvRxHdrRead(_u8 *pBuf, _u8 *pAlignSize);
+#ifdef SL_RX_LOOKAHEAD
+static _SlReturnVal_t _SlDrvRxLookAheadFill(_u16 Len);
+static _u16           _SlDrvRxLookAheadGet(_u8 *pBuf, _u16 Len);
+static _SlReturnVal_t _SlDrvRxLookAheadRead(_u8 *pBuf, _u16 Len);
+static void           _SlDrvRxLookAheadDrop(_u16 Len);
+#endif
+#ifdef SL_RX_BURST
+static _SlReturnVal_t _SlDrvRxBurstNext(void);
+#endif
 static void           _SlAsyncEventGenericHandler(_u8 bInCmdContext);
-static void	          _SlRemoveFromList(_u8* ListIndex, _u8 ItemIndex);
+static _u8            _SlDrvLowestBit(_u32 Bitmap);
+#ifndef SL_TINY_EXT
+static void           _SlDrvRemovePending(_u8 ObjIdx);
+#endif
 static _SlReturnVal_t _SlFindAndSetActiveObj(_SlOpcode_t  Opcode, _u8 Sd);
+#ifdef sl_CmdTrace
+static void           _SlDrvTraceResponse(_u8 ObjIdx, _SlOpcode_t Opcode);
+#endif
 static _SlReturnVal_t _SlDrvObjGlobalLockWaitForever(void);
 
 /*****************************************************************************/
@@ -512,6 +580,10 @@ _SlReturnVal_t _SlDrvDriverCBInit(void)
 
     _SlDrvMemZero(g_pCB, (_u16)sizeof(_SlDriverCb_t));
     RxIrqCnt = 0;
+#ifdef SL_RX_LOOKAHEAD
+    /* The NWP starts afresh, the host re-enables aggregation if it wants it */
+    _SlDrvMemZero(&g_RxLookAhead, (_u16)sizeof(g_RxLookAhead));
+#endif
     OSI_RET_OK_CHECK( sl_SyncObjCreate(&g_pCB->CmdSyncObj, "CmdSyncObj") );
     SL_DRV_SYNC_OBJ_CLEAR(&g_pCB->CmdSyncObj);
 
@@ -521,21 +593,16 @@ _SlReturnVal_t _SlDrvDriverCBInit(void)
     /* Init Drv object */
     _SlDrvMemZero(&g_pCB->ObjPool[0], (_u16)(MAX_CONCURRENT_ACTIONS*sizeof(_SlPoolObj_t)));
 
-    /* place all Obj in the free list*/
-    g_pCB->FreePoolIdx = 0;
-
+    /* all Obj are free, none active or pending (the bitmaps were zeroed with g_pCB) */
     for (Idx = 0 ; Idx < MAX_CONCURRENT_ACTIONS ; Idx++)
     {
-        g_pCB->ObjPool[Idx].NextIndex = Idx + 1;
+        g_pCB->FreePoolBitmap |= (_SlPoolBitmap_t)((_SlPoolBitmap_t)1 << Idx);
         g_pCB->ObjPool[Idx].AdditionalData = SL_MAX_SOCKETS;
 
         OSI_RET_OK_CHECK( sl_SyncObjCreate(&g_pCB->ObjPool[Idx].SyncObj, "SyncObj"));
         SL_DRV_SYNC_OBJ_CLEAR(&g_pCB->ObjPool[Idx].SyncObj);
     }
 
-     g_pCB->ActivePoolIdx = MAX_CONCURRENT_ACTIONS;
-     g_pCB->PendingPoolIdx = MAX_CONCURRENT_ACTIONS;
-
     /* Flow control init */
     g_pCB->FlowContCB.TxPoolCnt = FLOW_CONT_MIN;
     OSI_RET_OK_CHECK(sl_LockObjCreate(&g_pCB->FlowContCB.TxLockObj, "TxLockObj"));
@@ -578,9 +645,7 @@ _SlReturnVal_t _SlDrvDriverCBDeinit(void)
 	OSI_RET_OK_CHECK( sl_SyncObjDelete(&g_pCB->ObjPool[Idx].SyncObj) );   
     }
 
-    g_pCB->FreePoolIdx = 0;
-    g_pCB->PendingPoolIdx = MAX_CONCURRENT_ACTIONS;
-    g_pCB->ActivePoolIdx = MAX_CONCURRENT_ACTIONS;
+    g_pCB->FreePoolBitmap = 0;
 
 #ifdef SL_MEMORY_MGMT_DYNAMIC
     sl_Free(g_pCB);
@@ -624,6 +689,9 @@ _SlReturnVal_t _SlDrvCmdOp(
     _SlCmdExt_t   *pCmdExt)
 {
     _SlReturnVal_t RetVal;
+#ifdef sl_CmdTrace
+    _u32 TraceStart = sl_GetTimestamp();
+#endif
 
     SL_DRV_LOCK_GLOBAL_LOCK_FOREVER();
 
@@ -647,6 +715,13 @@ _SlReturnVal_t _SlDrvCmdOp(
 
     if(SL_OS_RET_CODE_OK == RetVal)
     {
+#ifdef sl_CmdTrace
+        /* _SlDrvMsgReadCmdCtx adds the record once it has the response */
+        g_pCB->CmdTrace.Opcode = pCmdCtrl->Opcode;
+        g_pCB->CmdTrace.Start = TraceStart;
+        g_pCB->CmdTrace.Written = sl_GetTimestamp();
+        g_pCB->CmdTrace.Response = 0;
+#endif
 
 #ifndef SL_IF_TYPE_UART    
         /* Waiting for SPI to stabilize after first command */
@@ -711,6 +786,9 @@ _SlReturnVal_t _SlDrvDataReadOp(
     pArgsData.pData = pCmdExt->pRxPayload;
     pArgsData.pArgs =  (_u8 *)pTxRxDescBuff;
     g_pCB->ObjPool[ObjIdx].pRespArgs =  (_u8 *)&pArgsData;
+#ifdef sl_CmdTrace
+    g_pCB->ObjPool[ObjIdx].Trace.Opcode = pCmdCtrl->Opcode;
+#endif
 
     SL_DRV_PROTECTION_OBJ_UNLOCK();
 
@@ -753,6 +831,11 @@ _SlReturnVal_t _SlDrvDataReadOp(
     /* send the message */
     RetVal =  _SlDrvMsgWrite(pCmdCtrl, pCmdExt, (_u8 *)pTxRxDescBuff);
 
+#ifdef sl_CmdTrace
+    /* still under the global lock, so before the response can be read */
+    g_pCB->ObjPool[ObjIdx].Trace.Written = sl_GetTimestamp();
+#endif
+
     SL_DRV_LOCK_GLOBAL_UNLOCK();
     
 
@@ -792,6 +875,10 @@ _SlReturnVal_t _SlDrvDataWriteOp(
     _SlCmdExt_t         *pCmdExt)
 {
     _SlReturnVal_t  RetVal = SL_EAGAIN; /*  initiated as SL_EAGAIN for the non blocking mode */
+#ifdef sl_CmdTrace
+    _u32 TraceStart = sl_GetTimestamp();
+    _u32 TraceWritten;
+#endif
     while( 1 )
     {
         /*  Do Flow Control check/update for DataWrite operation */
@@ -855,6 +942,15 @@ _SlReturnVal_t _SlDrvDataWriteOp(
 
     SL_DRV_LOCK_GLOBAL_UNLOCK();
 
+#ifdef sl_CmdTrace
+    /* no response, the caller has its result once the data is written */
+    if (SL_OS_RET_CODE_OK == RetVal)
+    {
+        TraceWritten = sl_GetTimestamp();
+        sl_CmdTrace(pCmdCtrl->Opcode, TraceStart, TraceWritten, 0, TraceWritten);
+    }
+#endif
+
     return RetVal;
 }
 
@@ -1022,7 +1118,7 @@ static _SlReturnVal_t _SlDrvMsgRead(void)
 			}
             if (RespPayloadLen > 0)
             {
-                NWP_IF_READ_CHECK(g_pCB->FD,
+                NWP_RX_READ_CHECK(g_pCB->FD,
                                   pAsyncBuf + _SL_RESP_HDR_SIZE,
                                   AlignedLengthRecv);
         }
@@ -1032,7 +1128,7 @@ static _SlReturnVal_t _SlDrvMsgRead(void)
 				AlignedLengthRecv = (_u16)(_SL_PROTOCOL_ALIGN_SIZE(RespPayloadLen) - SL_ASYNC_MAX_PAYLOAD_LEN);
             while (AlignedLengthRecv > 0)
             {
-                NWP_IF_READ_CHECK(g_pCB->FD,TailBuffer,4);
+                NWP_RX_READ_CHECK(g_pCB->FD,TailBuffer,4);
                 AlignedLengthRecv = AlignedLengthRecv - 4;
             }
         }
@@ -1077,7 +1173,7 @@ static _SlReturnVal_t _SlDrvMsgRead(void)
 
             /*  Read first 4 bytes of Recv/Recvfrom response to get SocketId and actual  */
             /*  response data length */
-            NWP_IF_READ_CHECK(g_pCB->FD, &uBuf.TempBuf[4], RECV_ARGS_SIZE);
+            NWP_RX_READ_CHECK(g_pCB->FD, &uBuf.TempBuf[4], RECV_ARGS_SIZE);
 
             /*  Validate Socket ID and Received Length value.  */
             VERIFY_PROTOCOL((SD(&uBuf.TempBuf[4])& BSD_SOCKET_ID_MASK) < SL_MAX_SOCKETS);
@@ -1094,7 +1190,7 @@ static _SlReturnVal_t _SlDrvMsgRead(void)
 
             if(ExpArgSize > (_u8)RECV_ARGS_SIZE)
             {
-                NWP_IF_READ_CHECK(g_pCB->FD,
+                NWP_RX_READ_CHECK(g_pCB->FD,
                     ((_SlArgsData_t *)(g_pCB->ObjPool[g_pCB->FunctionParams.AsyncExt.ActionIndex].pRespArgs))->pArgs + RECV_ARGS_SIZE,
                     ExpArgSize - RECV_ARGS_SIZE);
             }
@@ -1114,12 +1210,12 @@ static _SlReturnVal_t _SlDrvMsgRead(void)
                 AlignedLengthRecv = (_u16)(ACT_DATA_SIZE(&uBuf.TempBuf[4]) & (~3));
                 if( AlignedLengthRecv >= 4)
                 {
-                    NWP_IF_READ_CHECK(g_pCB->FD,((_SlArgsData_t *)(g_pCB->ObjPool[g_pCB->FunctionParams.AsyncExt.ActionIndex].pRespArgs))->pData,AlignedLengthRecv );                      
+                    NWP_RX_READ_CHECK(g_pCB->FD,((_SlArgsData_t *)(g_pCB->ObjPool[g_pCB->FunctionParams.AsyncExt.ActionIndex].pRespArgs))->pData,AlignedLengthRecv );                      
                 }
                 /*  copy the unaligned part, if any */
                 if( LengthToCopy > 0) 
                 {
-                    NWP_IF_READ_CHECK(g_pCB->FD,TailBuffer,4);
+                    NWP_RX_READ_CHECK(g_pCB->FD,TailBuffer,4);
                     /*  copy TailBuffer unaligned part (1/2/3 bytes) */
                     sl_Memcpy(((_SlArgsData_t *)(g_pCB->ObjPool[g_pCB->FunctionParams.AsyncExt.ActionIndex].pRespArgs))->pData + AlignedLengthRecv,TailBuffer,LengthToCopy);                    
                 }                  
@@ -1137,7 +1233,7 @@ static _SlReturnVal_t _SlDrvMsgRead(void)
         /*  When RxDescLen is not exact, using RxPayloadLen is forbidden! */
         /*  If such case cannot be avoided - parse message here to detect */
         /*  arguments/payload border. */
-        NWP_IF_READ_CHECK(g_pCB->FD,
+        NWP_RX_READ_CHECK(g_pCB->FD,
             g_pCB->FunctionParams.pTxRxDescBuff,
             _SL_PROTOCOL_ALIGN_SIZE(g_pCB->FunctionParams.pCmdCtrl->RxDescLen));
 
@@ -1173,7 +1269,7 @@ static _SlReturnVal_t _SlDrvMsgRead(void)
 
                 if( AlignedLengthRecv >= 4)
                 {
-                    NWP_IF_READ_CHECK(g_pCB->FD,
+                    NWP_RX_READ_CHECK(g_pCB->FD,
                         g_pCB->FunctionParams.pCmdExt->pRxPayload,
                         AlignedLengthRecv );
 
@@ -1181,7 +1277,7 @@ static _SlReturnVal_t _SlDrvMsgRead(void)
                 /*  copy the unaligned part, if any */
                 if( LengthToCopy > 0) 
                 {
-                    NWP_IF_READ_CHECK(g_pCB->FD,TailBuffer,4);
+                    NWP_RX_READ_CHECK(g_pCB->FD,TailBuffer,4);
                     /*  copy TailBuffer unaligned part (1/2/3 bytes) */
                     sl_Memcpy(g_pCB->FunctionParams.pCmdExt->pRxPayload + AlignedLengthRecv,
                         TailBuffer,
@@ -1195,7 +1291,7 @@ static _SlReturnVal_t _SlDrvMsgRead(void)
                     AlignedLengthRecv = (_u16)( (ActDataSize + 3 - g_pCB->FunctionParams.pCmdExt->RxPayloadLen) & (~3) );
                     while( AlignedLengthRecv > 0)
                     {
-                        NWP_IF_READ_CHECK(g_pCB->FD,TailBuffer, 4 );
+                        NWP_RX_READ_CHECK(g_pCB->FD,TailBuffer, 4 );
                         AlignedLengthRecv = AlignedLengthRecv - 4;
                     }
                 }
@@ -1210,8 +1306,16 @@ static _SlReturnVal_t _SlDrvMsgRead(void)
 
     if(AlignSize > 0)
     {
-        NWP_IF_READ_CHECK(g_pCB->FD, uBuf.TempBuf, AlignSize);
+        NWP_RX_READ_CHECK(g_pCB->FD, uBuf.TempBuf, AlignSize);
+    }
+
+#ifdef SL_RX_BURST
+    /*  With RX aggregation another message of the same burst may follow */
+    if (g_RxLookAhead.Aggregated)
+    {
+        VERIFY_RET_OK(_SlDrvRxBurstNext());
     }
+#endif
 
     _SL_DBG_CNT_INC(MsgCnt.Read);
 
@@ -1317,11 +1421,17 @@ static _SlReturnVal_t _SlDrvMsgReadCmdCtx(_u16 cmdOpcode)
                 return SL_API_ABORTED;
             }
 #endif            
-            g_pCB->RxDoneCnt++;
+            if (!_SL_RX_BURST_PENDING())
+            {
+                g_pCB->RxDoneCnt++;
+            }
 
             if (CMD_RESP_CLASS == g_pCB->FunctionParams.AsyncExt.RxMsgClass)
             {
                 g_pCB->IsCmdRespWaited = FALSE;
+#ifdef sl_CmdTrace
+                g_pCB->CmdTrace.Response = sl_GetTimestamp();
+#endif
 
                 /*  In case CmdResp has been read without  waiting on CmdSyncObj -  that */
                 /*  Sync object. That to prevent old signal to be processed. */
@@ -1369,6 +1479,12 @@ static _SlReturnVal_t _SlDrvMsgReadCmdCtx(_u16 cmdOpcode)
     /*  Temporary context. */
     /* sl_Spawn is activated, using a different context */
 
+#ifdef sl_CmdTrace
+    /* the next command may overwrite g_pCB->CmdTrace once the lock is free */
+    sl_CmdTrace(g_pCB->CmdTrace.Opcode, g_pCB->CmdTrace.Start, g_pCB->CmdTrace.Written,
+                g_pCB->CmdTrace.Response, sl_GetTimestamp());
+#endif
+
     SL_DRV_LOCK_GLOBAL_UNLOCK();
     
     if(_SL_PENDING_RX_MSG(g_pCB))
@@ -1418,43 +1534,52 @@ _SlReturnVal_t _SlDrvMsgReadSpawnCtx(void *pValue)
         return SL_RET_CODE_OK;
     }
 
+    /*  An aggregated burst is read to its end here, its later messages */
+    /*  have no IRQ, and so no spawn, of their own */
+    do
+    {
 #ifdef SL_TINY_EXT
-    VERIFY_RET_OK(_SlDrvMsgRead());
+        VERIFY_RET_OK(_SlDrvMsgRead());
 #else
-	if (_SlDrvMsgRead() != SL_OS_RET_CODE_OK)
-	{
-        SL_DRV_LOCK_GLOBAL_UNLOCK();
-		return SL_API_ABORTED;
-	}
+        if (_SlDrvMsgRead() != SL_OS_RET_CODE_OK)
+        {
+            SL_DRV_LOCK_GLOBAL_UNLOCK();
+            return SL_API_ABORTED;
+        }
 #endif
 
-    g_pCB->RxDoneCnt++;
+        if (!_SL_RX_BURST_PENDING())
+        {
+            g_pCB->RxDoneCnt++;
+        }
+
+        switch(g_pCB->FunctionParams.AsyncExt.RxMsgClass)
+        {
+        case ASYNC_EVT_CLASS:
+            /*  If got here and protected by LockObj a message is waiting  */
+            /*  to be read */
+            VERIFY_PROTOCOL(NULL != g_pCB->FunctionParams.AsyncExt.pAsyncBuf);
+
+            _SlAsyncEventGenericHandler(FALSE);        
 
-    switch(g_pCB->FunctionParams.AsyncExt.RxMsgClass)
-    {
-    case ASYNC_EVT_CLASS:
-        /*  If got here and protected by LockObj a message is waiting  */
-        /*  to be read */
-        VERIFY_PROTOCOL(NULL != g_pCB->FunctionParams.AsyncExt.pAsyncBuf);
-   
-        _SlAsyncEventGenericHandler(FALSE);        
-        
 #ifdef SL_MEMORY_MGMT_DYNAMIC
-        sl_Free(g_pCB->FunctionParams.AsyncExt.pAsyncBuf);
+            sl_Free(g_pCB->FunctionParams.AsyncExt.pAsyncBuf);
 #else
-        g_pCB->FunctionParams.AsyncExt.pAsyncBuf = NULL;
+            g_pCB->FunctionParams.AsyncExt.pAsyncBuf = NULL;
 #endif
-        break;
-    case DUMMY_MSG_CLASS:
-    case RECV_RESP_CLASS:
-        /* These types are legal in this context. Do nothing */
-        break;
-    case CMD_RESP_CLASS:
-        /* Command response is illegal in this context. */
-        /* No 'break' here: Assert! */
-    default:
-        VERIFY_PROTOCOL(0);
+            break;
+        case DUMMY_MSG_CLASS:
+        case RECV_RESP_CLASS:
+            /* These types are legal in this context. Do nothing */
+            break;
+        case CMD_RESP_CLASS:
+            /* Command response is illegal in this context. */
+            /* No 'break' here: Assert! */
+        default:
+            VERIFY_PROTOCOL(0);
+        }
     }
+    while (_SL_RX_BURST_PENDING());
 
     SL_DRV_LOCK_GLOBAL_UNLOCK();
 
@@ -1566,6 +1691,280 @@ static _SlReturnVal_t _SlDrvClassifyRxMsg(
 /* ******************************************************************************/
 /*  _SlDrvRxHdrRead  */
 /* ******************************************************************************/
+#ifdef SL_RX_LOOKAHEAD
+static _SlReturnVal_t _SlDrvRxHdrRead(_u8 *pBuf, _u8 *pAlignSize)
+{
+    _u8         *pLook = g_RxLookAhead.u.Buf;
+    _u16        Word = 0;
+    _u16        SyncIdx = 0;
+    _u16        Rest;
+    _u8         AlignSize;
+    _u8         SearchSync = TRUE;
+    _u8         TimeoutState = TIMEOUT_STATE_INIT_VAL;
+
+#if (defined (sl_GetTimestamp)) && (!defined (SL_TINY))
+    _SlTimeoutParams_t      TimeoutInfo={0};
+
+    /* a burst that does not go on with a sync pattern waits for it as well */
+    _SlDrvStartMeasureTimeout(&TimeoutInfo, SYNC_PATTERN_TIMEOUT_IN_MSEC);
+#endif
+
+#ifdef SL_RX_BURST
+    if (g_RxLookAhead.Burst)
+    {
+        /*  1-2. The next message of an aggregated burst, _SlDrvRxBurstNext */
+        /*       left its sync pattern at the start of the buffer            */
+        g_RxLookAhead.Burst = FALSE;
+    }
+    else
+#endif
+    {
+        /*  1. Write CNYS pattern to NWP, what was read ahead of the last message is stale */
+        NWP_IF_WRITE_CHECK(g_pCB->FD, (_u8 *)&g_H2NCnysPattern.Short, SYNC_PATTERN_LEN);
+        g_RxLookAhead.Offset = 0;
+        g_RxLookAhead.Length = 0;
+
+        /*  2. One transfer for the sync pattern and both headers, in the common case */
+        VERIFY_RET_OK(_SlDrvRxLookAheadFill(SL_RX_SPECULATIVE_READ));
+    }
+
+    /*  3. Scan a word at a time: word Word completes the candidates at offsets Word-3..Word */
+    while (SearchSync)
+    {
+        if (Word + SYNC_PATTERN_LEN > g_RxLookAhead.Length)
+        {
+            if (TIMEOUT_STATE_EXPIRY == TimeoutState)
+            {
+                return SL_API_ABORTED;
+            }
+#if (defined (sl_GetTimestamp)) && (!defined (SL_TINY))
+            /* give one more chance after the timeout, as the original scan does */
+            if (TIMEOUT_ONE_MORE_SHOT == TimeoutState)
+            {
+                TimeoutState = TIMEOUT_STATE_EXPIRY;
+            }
+            else if (_SlDrvIsTimeoutExpired(&TimeoutInfo))
+            {
+                TimeoutState = TIMEOUT_ONE_MORE_SHOT;
+            }
+#endif
+            /* Buffer full of noise: keep the last word, a sync may start in it */
+            if (g_RxLookAhead.Length + SYNC_PATTERN_LEN > SL_RX_LOOKAHEAD_SIZE)
+            {
+                sl_Memcpy(pLook, &pLook[g_RxLookAhead.Length - SYNC_PATTERN_LEN], SYNC_PATTERN_LEN);
+                g_RxLookAhead.Length = SYNC_PATTERN_LEN;
+                Word = SYNC_PATTERN_LEN;
+            }
+            VERIFY_RET_OK(_SlDrvRxLookAheadFill(SYNC_PATTERN_LEN));
+        }
+
+        for (SyncIdx = (Word == 0) ? 0 : Word - 3; SyncIdx <= Word; SyncIdx++)
+        {
+            if (N2H_SYNC_PATTERN_MATCH(&pLook[SyncIdx], g_pCB->TxSeqNum))
+            {
+                SearchSync = FALSE;
+                break;
+            }
+        }
+        Word += SYNC_PATTERN_LEN;
+    }
+
+    /*  4. Drop what came before the sync, so that the message is word aligned */
+    /*     in the buffer. On the wire it is still SyncIdx bytes off a word, so */
+    /*     the bytes up to the next word follow the message, as TI's path has */
+    AlignSize = (_u8)((SYNC_PATTERN_LEN - (SyncIdx & 3)) & 3);
+    if (SyncIdx > 0)
+    {
+        _SlDrvRxLookAheadDrop(SyncIdx);
+    }
+
+    /*  5. Skip doubled sync patterns */
+    for (;;)
+    {
+        if (g_RxLookAhead.Length < 2 * SYNC_PATTERN_LEN)
+        {
+            VERIFY_RET_OK(_SlDrvRxLookAheadFill((_u16)(2 * SYNC_PATTERN_LEN - g_RxLookAhead.Length)));
+        }
+        if (!N2H_SYNC_PATTERN_MATCH(&pLook[SYNC_PATTERN_LEN], g_pCB->TxSeqNum))
+        {
+            break;
+        }
+        _SL_DBG_CNT_INC(Work.DoubleSyncPattern);
+        _SlDrvRxLookAheadDrop(SYNC_PATTERN_LEN);
+    }
+    g_pCB->TxSeqNum++;
+
+    /*  6. The whole Resp Header, generic and spec parts */
+    if (g_RxLookAhead.Length < SYNC_PATTERN_LEN + _SL_RESP_HDR_SIZE)
+    {
+        VERIFY_RET_OK(_SlDrvRxLookAheadFill((_u16)(SYNC_PATTERN_LEN + _SL_RESP_HDR_SIZE - g_RxLookAhead.Length)));
+    }
+    sl_Memcpy(pBuf, &pLook[SYNC_PATTERN_LEN], _SL_RESP_HDR_SIZE);
+    g_RxLookAhead.Offset = (_u16)(SYNC_PATTERN_LEN + _SL_RESP_HDR_SIZE);
+
+    /*  7. The rest of the message and its alignment in one more transfer,   */
+    /*     unless it is too big to be worth a copy: then _SlDrvMsgRead reads */
+    /*     it where it belongs, and the alignment after it from the wire.    */
+    /*     In a burst the same transfer brings the start of the next message */
+    g_RxLookAhead.Left = AlignSize;
+    if (((_SlResponseHeader_t *)pBuf)->GenHeader.Len > _SL_RESP_SPEC_HDR_SIZE)
+    {
+        g_RxLookAhead.Left += (_u16)_SL_PROTOCOL_ALIGN_SIZE(RSP_PAYLOAD_LEN(pBuf));
+    }
+    Rest = g_RxLookAhead.Left;
+#ifdef SL_RX_BURST
+    if (g_RxLookAhead.Aggregated &&
+        (g_RxLookAhead.Offset + Rest + SL_RX_SPECULATIVE_READ <= SL_RX_LOOKAHEAD_SIZE))
+    {
+        Rest += SL_RX_SPECULATIVE_READ;
+    }
+#endif
+    if ((Rest > g_RxLookAhead.Length - g_RxLookAhead.Offset) &&
+        (g_RxLookAhead.Offset + Rest <= SL_RX_LOOKAHEAD_SIZE))
+    {
+        VERIFY_RET_OK(_SlDrvRxLookAheadFill((_u16)(g_RxLookAhead.Offset + Rest - g_RxLookAhead.Length)));
+    }
+
+    /*  8. Return number bytes needed to be read after the message for NWP Rx 4-byte alignment */
+    *pAlignSize = AlignSize;
+
+    return SL_RET_CODE_OK;
+}
+
+/* ******************************************************************************/
+/*  _SlDrvRxLookAheadFill  */
+/* ******************************************************************************/
+static _SlReturnVal_t _SlDrvRxLookAheadFill(_u16 Len)
+{
+    NWP_IF_READ_CHECK(g_pCB->FD, &g_RxLookAhead.u.Buf[g_RxLookAhead.Length], Len);
+    g_RxLookAhead.Length += Len;
+
+    return SL_RET_CODE_OK;
+}
+
+/* ******************************************************************************/
+/*  _SlDrvRxLookAheadGet  */
+/* ******************************************************************************/
+static _u16 _SlDrvRxLookAheadGet(_u8 *pBuf, _u16 Len)
+{
+    _u16 Available = (_u16)(g_RxLookAhead.Length - g_RxLookAhead.Offset);
+
+    if (Available > Len)
+    {
+        Available = Len;
+    }
+    if (Available > g_RxLookAhead.Left)
+    {
+        Available = g_RxLookAhead.Left;
+    }
+    if (Available > 0)
+    {
+        sl_Memcpy(pBuf, &g_RxLookAhead.u.Buf[g_RxLookAhead.Offset], Available);
+        g_RxLookAhead.Offset += Available;
+        g_RxLookAhead.Left -= Available;
+    }
+
+    return Available;
+}
+
+/* ******************************************************************************/
+/*  _SlDrvRxLookAheadRead  */
+/* ******************************************************************************/
+static _SlReturnVal_t _SlDrvRxLookAheadRead(_u8 *pBuf, _u16 Len)
+{
+    _u16 Copied = _SlDrvRxLookAheadGet(pBuf, Len);
+    _u16 Wire = (_u16)(Len - Copied);
+
+    /* Past the end of the message there is padding, or the next message of */
+    /* a burst: reads that go beyond it get zeros and leave the NWP alone    */
+    if (Wire > g_RxLookAhead.Left)
+    {
+        _SlDrvMemZero(&pBuf[Copied + g_RxLookAhead.Left], (_u16)(Wire - g_RxLookAhead.Left));
+        Wire = g_RxLookAhead.Left;
+    }
+    if (Wire > 0)
+    {
+        NWP_IF_READ_CHECK(g_pCB->FD, &pBuf[Copied], Wire);
+        g_RxLookAhead.Left -= Wire;
+    }
+
+    return SL_RET_CODE_OK;
+}
+
+/* ******************************************************************************/
+/*  _SlDrvRxLookAheadDrop  */
+/* ******************************************************************************/
+static void _SlDrvRxLookAheadDrop(_u16 Len)
+{
+    _u16 Idx;
+
+    /* Overlapping move down of a few bytes: noise, a doubled sync, or the */
+    /* start of the next message of a burst                                */
+    g_RxLookAhead.Length -= Len;
+    for (Idx = 0; Idx < g_RxLookAhead.Length; Idx++)
+    {
+        g_RxLookAhead.u.Buf[Idx] = g_RxLookAhead.u.Buf[Idx + Len];
+    }
+}
+
+#ifdef SL_RX_BURST
+/* ******************************************************************************/
+/*  _SlDrvRxBurstNext  */
+/* ******************************************************************************/
+static _SlReturnVal_t _SlDrvRxBurstNext(void)
+{
+    _u16 Skip;
+
+    /*  1. Skip what _SlDrvMsgRead did not want of the message */
+    Skip = (_u16)(g_RxLookAhead.Length - g_RxLookAhead.Offset);
+    if (Skip > g_RxLookAhead.Left)
+    {
+        Skip = g_RxLookAhead.Left;
+    }
+    g_RxLookAhead.Offset += Skip;
+    g_RxLookAhead.Left -= Skip;
+    while (g_RxLookAhead.Left > 0)
+    {
+        Skip = (g_RxLookAhead.Left < SL_RX_LOOKAHEAD_SIZE) ? g_RxLookAhead.Left : (_u16)SL_RX_LOOKAHEAD_SIZE;
+        g_RxLookAhead.Offset = 0;
+        g_RxLookAhead.Length = 0;
+        VERIFY_RET_OK(_SlDrvRxLookAheadFill(Skip));
+        g_RxLookAhead.Left -= Skip;
+        g_RxLookAhead.Offset = Skip;
+    }
+
+    /*  2. What was read past the message goes to the start of the buffer */
+    if (g_RxLookAhead.Offset > 0)
+    {
+        _SlDrvRxLookAheadDrop(g_RxLookAhead.Offset);
+        g_RxLookAhead.Offset = 0;
+    }
+    if (g_RxLookAhead.Length < SYNC_PATTERN_LEN)
+    {
+        VERIFY_RET_OK(_SlDrvRxLookAheadFill((_u16)(SL_RX_SPECULATIVE_READ - g_RxLookAhead.Length)));
+    }
+
+    /*  3. The burst goes on if it starts with the sync of the next message, */
+    /*     the NWP clocks out padding after the last one                    */
+    g_RxLookAhead.Burst = (N2H_SYNC_PATTERN_MATCH(g_RxLookAhead.u.Buf, g_pCB->TxSeqNum)) ? TRUE : FALSE;
+
+    return SL_RET_CODE_OK;
+}
+
+/* ******************************************************************************/
+/*  _SlDrvRxAggrSet                                                             */
+/* ******************************************************************************/
+_u8 _SlDrvRxAggrSet(_u8 Enable)
+{
+    _u8 Previous = g_RxLookAhead.Aggregated;
+
+    g_RxLookAhead.Aggregated = Enable;
+
+    return Previous;
+}
+#endif /* SL_RX_BURST */
+
+#else
 static _SlReturnVal_t _SlDrvRxHdrRead(_u8 *pBuf, _u8 *pAlignSize)
 {
      _u32       SyncCnt  = 0;
@@ -1679,6 +2078,7 @@ static _SlReturnVal_t _SlDrvRxHdrRead(_u8 *pBuf, _u8 *pAlignSize)
 
     return SL_RET_CODE_OK;
 }
+#endif
 
 /* ***************************************************************************** */
 /*  _SlDrvBasicCmd */
@@ -1720,6 +2120,10 @@ _SlReturnVal_t _SlDrvCmdSend(
 {
     _SlReturnVal_t RetVal;
     _u8            IsCmdRespWaitedOriginalVal;
+#ifdef sl_CmdTrace
+    _u32           TraceStart = sl_GetTimestamp();
+    _u32           TraceWritten;
+#endif
 
        _SlFunctionParams_t originalFuncParms;
 
@@ -1742,6 +2146,14 @@ _SlReturnVal_t _SlDrvCmdSend(
     /* restore the original command paramaters  */
     sl_Memcpy(&g_pCB->FunctionParams, &originalFuncParms, sizeof(_SlFunctionParams_t));
 
+#ifdef sl_CmdTrace
+    if (SL_OS_RET_CODE_OK == RetVal)
+    {
+        TraceWritten = sl_GetTimestamp();
+        sl_CmdTrace(pCmdCtrl->Opcode, TraceStart, TraceWritten, 0, TraceWritten);
+    }
+#endif
+
     return RetVal;
 
 
@@ -1754,26 +2166,22 @@ _SlReturnVal_t _SlDrvCmdSend(
 _u8 _SlDrvWaitForPoolObj(_u8 ActionID, _u8 SocketID)
 {
     _u8 CurrObjIndex = MAX_CONCURRENT_ACTIONS;
+    _u8 ActionBit;
+#ifndef SL_TINY_EXT
+    _SlPoolBitmap_t ObjBit;
+#endif
+#ifdef sl_CmdTrace
+    _u32 TraceStart = sl_GetTimestamp();
+#endif
 
     /* Get free object  */
     SL_DRV_PROTECTION_OBJ_LOCK_FOREVER();
     
-    if (MAX_CONCURRENT_ACTIONS > g_pCB->FreePoolIdx)
+    if (0 != g_pCB->FreePoolBitmap)
     {
-        /* save the current obj index */
-        CurrObjIndex = g_pCB->FreePoolIdx;
-        /* set the new free index */
-#ifndef SL_TINY_EXT
-        if (MAX_CONCURRENT_ACTIONS > g_pCB->ObjPool[CurrObjIndex].NextIndex)
-        {
-            g_pCB->FreePoolIdx = g_pCB->ObjPool[CurrObjIndex].NextIndex;
-        }
-        else
-#endif           
-        {
-            /* No further free actions available */
-            g_pCB->FreePoolIdx = MAX_CONCURRENT_ACTIONS;
-        }
+        /* take the lowest free obj */
+        CurrObjIndex = _SlDrvLowestBit(g_pCB->FreePoolBitmap);
+        g_pCB->FreePoolBitmap &= (_SlPoolBitmap_t)~((_SlPoolBitmap_t)1 << CurrObjIndex);
     }
     else
     {
@@ -1781,40 +2189,39 @@ _u8 _SlDrvWaitForPoolObj(_u8 ActionID, _u8 SocketID)
         return CurrObjIndex;
     }
     g_pCB->ObjPool[CurrObjIndex].ActionID = (_u8)ActionID;
+#ifdef sl_CmdTrace
+    /* the opcode is the request's if the caller sets it, else the response's */
+    g_pCB->ObjPool[CurrObjIndex].Trace.Opcode = 0;
+    g_pCB->ObjPool[CurrObjIndex].Trace.Start = TraceStart;
+    g_pCB->ObjPool[CurrObjIndex].Trace.Written = 0;
+    g_pCB->ObjPool[CurrObjIndex].Trace.Response = 0;
+#endif
     if (SL_MAX_SOCKETS > SocketID)
     {
         g_pCB->ObjPool[CurrObjIndex].AdditionalData = SocketID;
     }
-#ifndef SL_TINY_EXT
     /*In case this action is socket related, SocketID bit will be on
     In case SocketID is set to SL_MAX_SOCKETS, the socket is not relevant to the action. In that case ActionID bit will be on */
-	while ( ( (SL_MAX_SOCKETS > SocketID) && (g_pCB->ActiveActionsBitmap & (1<<SocketID)) ) || 
-            ( (g_pCB->ActiveActionsBitmap & (1<<ActionID)) && (SL_MAX_SOCKETS == SocketID) ) )
+    ActionBit = (SL_MAX_SOCKETS > SocketID) ? SocketID : ActionID;
+#ifndef SL_TINY_EXT
+    ObjBit = (_SlPoolBitmap_t)((_SlPoolBitmap_t)1 << CurrObjIndex);
+	while (g_pCB->ActiveActionsBitmap & ((_u32)1 << ActionBit))
     {
-        /* action in progress - move to pending list */
-        g_pCB->ObjPool[CurrObjIndex].NextIndex = g_pCB->PendingPoolIdx;
-        g_pCB->PendingPoolIdx = CurrObjIndex;
+        /* action in progress - pend on its bit */
+        g_pCB->PendingPoolBitmap[ActionBit] |= ObjBit;
+        g_pCB->PendingActionBitmap[ActionID - MAX_SOCKET_ENUM_IDX] |= ObjBit;
         SL_DRV_PROTECTION_OBJ_UNLOCK();
         
         /* wait for action to be free */
 	(void)_SlDrvSyncObjWaitForever(&g_pCB->ObjPool[CurrObjIndex].SyncObj);
         
-        /* set params and move to active (remove from pending list at _SlDrvReleasePoolObj) */
+        /* set params and move to active (removed from pending at _SlDrvReleasePoolObj) */
         SL_DRV_PROTECTION_OBJ_LOCK_FOREVER();
     }
 #endif
     /* mark as active. Set socket as active if action is on socket, otherwise mark action as active */
-    if (SL_MAX_SOCKETS > SocketID)
-    {
-        g_pCB->ActiveActionsBitmap |= (1<<SocketID);
-    }
-    else
-    {
-        g_pCB->ActiveActionsBitmap |= (1<<ActionID);
-    }
-    /* move to active list  */
-    g_pCB->ObjPool[CurrObjIndex].NextIndex = g_pCB->ActivePoolIdx;
-    g_pCB->ActivePoolIdx = CurrObjIndex;	
+    g_pCB->ActiveActionsBitmap |= ((_u32)1 << ActionBit);
+    g_pCB->ActiveObjIdx[ActionBit] = CurrObjIndex;
     /* unlock */
     SL_DRV_PROTECTION_OBJ_UNLOCK();
     return CurrObjIndex;
@@ -1825,42 +2232,52 @@ _u8 _SlDrvWaitForPoolObj(_u8 ActionID, _u8 SocketID)
 /* ******************************************************************************/
 void _SlDrvReleasePoolObj(_u8 ObjIdx)
 {
+    _u8 SocketID;
+    _u8 ActionID;
 #ifndef SL_TINY_EXT        
-    _u8 PendingIndex;
+    _SlPoolBitmap_t Pending;
+#endif
+#ifdef sl_CmdTrace
+    _u32 TraceWoken = sl_GetTimestamp();
+    _SlCmdTrace_t Trace;
 #endif
 
      SL_DRV_PROTECTION_OBJ_LOCK_FOREVER();
 
+    SocketID = g_pCB->ObjPool[ObjIdx].AdditionalData & BSD_SOCKET_ID_MASK;
+    ActionID = g_pCB->ObjPool[ObjIdx].ActionID;
+#ifdef sl_CmdTrace
+    Trace = g_pCB->ObjPool[ObjIdx].Trace;
+#endif
+
       /* In Tiny mode, there is only one object pool so no pending actions are available */
 #ifndef SL_TINY_EXT
-    /* go over the pending list and release other pending action if needed */
-	PendingIndex = g_pCB->PendingPoolIdx;
-        
-	while(MAX_CONCURRENT_ACTIONS > PendingIndex)
+    /* release one pending action of the same kind: one with no socket, or on the same socket */
+    Pending = g_pCB->PendingPoolBitmap[ActionID];
+    if (SL_MAX_SOCKETS > SocketID)
+    {
+        Pending |= g_pCB->PendingPoolBitmap[SocketID];
+    }
+    Pending &= g_pCB->PendingActionBitmap[ActionID - MAX_SOCKET_ENUM_IDX];
+
+	if (0 != Pending)
 	{
-		/* In case this action is socket related, SocketID is in use, otherwise will be set to SL_MAX_SOCKETS */
-		if ( (g_pCB->ObjPool[PendingIndex].ActionID == g_pCB->ObjPool[ObjIdx].ActionID) && 
-			( (SL_MAX_SOCKETS == (g_pCB->ObjPool[PendingIndex].AdditionalData & BSD_SOCKET_ID_MASK)) || 
-			((SL_MAX_SOCKETS > (g_pCB->ObjPool[ObjIdx].AdditionalData & BSD_SOCKET_ID_MASK)) && ( (g_pCB->ObjPool[PendingIndex].AdditionalData & BSD_SOCKET_ID_MASK) == (g_pCB->ObjPool[ObjIdx].AdditionalData & BSD_SOCKET_ID_MASK) ))) )
-		{
-			/* remove from pending list */
-			_SlRemoveFromList(&g_pCB->PendingPoolIdx, PendingIndex);
-			 SL_DRV_SYNC_OBJ_SIGNAL(&g_pCB->ObjPool[PendingIndex].SyncObj);
-			 break;
-		}
-		PendingIndex = g_pCB->ObjPool[PendingIndex].NextIndex;
+		_u8 PendingIndex = _SlDrvLowestBit(Pending);
+
+		_SlDrvRemovePending(PendingIndex);
+		SL_DRV_SYNC_OBJ_SIGNAL(&g_pCB->ObjPool[PendingIndex].SyncObj);
 	}
 #endif
 
-		if (SL_MAX_SOCKETS > (g_pCB->ObjPool[ObjIdx].AdditionalData & BSD_SOCKET_ID_MASK))
+		if (SL_MAX_SOCKETS > SocketID)
 		{
 		/* unset socketID  */
-			g_pCB->ActiveActionsBitmap &= ~(1<<(g_pCB->ObjPool[ObjIdx].AdditionalData & BSD_SOCKET_ID_MASK));
+			g_pCB->ActiveActionsBitmap &= ~((_u32)1 << SocketID);
 		}
 		else
 		{
 		/* unset actionID  */
-			g_pCB->ActiveActionsBitmap &= ~(1<<g_pCB->ObjPool[ObjIdx].ActionID);
+			g_pCB->ActiveActionsBitmap &= ~((_u32)1 << ActionID);
 		}	
 
     /* delete old data */
@@ -1868,53 +2285,51 @@ void _SlDrvReleasePoolObj(_u8 ObjIdx)
     g_pCB->ObjPool[ObjIdx].ActionID = 0;
     g_pCB->ObjPool[ObjIdx].AdditionalData = SL_MAX_SOCKETS;
 
-    /* remove from active list */
-    _SlRemoveFromList(&g_pCB->ActivePoolIdx, ObjIdx);
-    /* move to free list */
-    g_pCB->ObjPool[ObjIdx].NextIndex = g_pCB->FreePoolIdx;
-    g_pCB->FreePoolIdx = ObjIdx;
+    /* move to free */
+    g_pCB->FreePoolBitmap |= (_SlPoolBitmap_t)((_SlPoolBitmap_t)1 << ObjIdx);
     SL_DRV_PROTECTION_OBJ_UNLOCK();
+
+#ifdef sl_CmdTrace
+    /* nothing to tell of an action that neither sent a request nor got a response */
+    if (0 != Trace.Opcode)
+    {
+        sl_CmdTrace(Trace.Opcode, Trace.Start, Trace.Written, Trace.Response, TraceWoken);
+    }
+#endif
 }
 
 
 /* ******************************************************************************/
-/* _SlRemoveFromList  */
+/* _SlDrvLowestBit  */
 /* ******************************************************************************/
-static void _SlRemoveFromList(_u8 *ListIndex, _u8 ItemIndex)
+static _u8 _SlDrvLowestBit(_u32 Bitmap)
 {
-#ifndef SL_TINY_EXT  
-	_u8 Idx;
-#endif        
-        
-    if (MAX_CONCURRENT_ACTIONS == g_pCB->ObjPool[*ListIndex].NextIndex)
+    /* de Bruijn sequence: the lowest set bit, isolated, selects a unique 5-bit index */
+    static const _u8 BitPosition[32] =
     {
-        *ListIndex = MAX_CONCURRENT_ACTIONS;
-    }
-    /* As MAX_CONCURRENT_ACTIONS is equal to 1 in Tiny mode */
+        0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+        31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+    };
+
+    return BitPosition[(_u32)((Bitmap & (0 - Bitmap)) * 0x077CB531UL) >> 27];
+}
+
+
 #ifndef SL_TINY_EXT
-	/* need to remove the first item in the list and therefore update the global which holds this index */
-	else if (*ListIndex == ItemIndex)
-	{
-		*ListIndex = g_pCB->ObjPool[ItemIndex].NextIndex;
-	}
-	else
-	{
-              Idx = *ListIndex;
-      
-              while(MAX_CONCURRENT_ACTIONS > Idx)
-              {
-                  /* remove from list */
-                  if (g_pCB->ObjPool[Idx].NextIndex == ItemIndex)
-                  {
-                          g_pCB->ObjPool[Idx].NextIndex = g_pCB->ObjPool[ItemIndex].NextIndex;
-                          break;
-                  }
-
-                  Idx = g_pCB->ObjPool[Idx].NextIndex;
-              }
-	}
-#endif    
+/* ******************************************************************************/
+/* _SlDrvRemovePending  */
+/* ******************************************************************************/
+static void _SlDrvRemovePending(_u8 ObjIdx)
+{
+    _SlPoolBitmap_t ObjMask = (_SlPoolBitmap_t)~((_SlPoolBitmap_t)1 << ObjIdx);
+    _u8 SocketID = g_pCB->ObjPool[ObjIdx].AdditionalData & BSD_SOCKET_ID_MASK;
+    _u8 ActionID = g_pCB->ObjPool[ObjIdx].ActionID;
+
+    /* it pends on its socket bit, or on its action bit if it has no socket */
+    g_pCB->PendingPoolBitmap[(SL_MAX_SOCKETS > SocketID) ? SocketID : ActionID] &= ObjMask;
+    g_pCB->PendingActionBitmap[ActionID - MAX_SOCKET_ENUM_IDX] &= ObjMask;
 }
+#endif
 
 
 /* ******************************************************************************/
@@ -1923,21 +2338,13 @@ static void _SlRemoveFromList(_u8 *ListIndex, _u8 ItemIndex)
 static _SlReturnVal_t _SlFindAndSetActiveObj(_SlOpcode_t  Opcode, _u8 Sd)
 {
     _u8 ActiveIndex;
+    _u32 Actions;
+    _SlOpcode_t ObjOpcode;
 
-    ActiveIndex = g_pCB->ActivePoolIdx;
-    /* go over the active list if exist to find obj waiting for this Async event */
-#ifndef SL_TINY_EXT    
-		while (MAX_CONCURRENT_ACTIONS > ActiveIndex)
-#else
-        /* Only one Active action is availabe in tiny mode, so we can replace the loop with if condition */
-        if (MAX_CONCURRENT_ACTIONS > ActiveIndex)
-#endif
+    /* a socket has one active action at most, its bit tells which entry */
+    if ((SL_MAX_SOCKETS > Sd) && (g_pCB->ActiveActionsBitmap & ((_u32)1 << Sd)))
     {
-        /* unset the Ipv4\IPv6 bit in the opcode if family bit was set  */
-        if (g_pCB->ObjPool[ActiveIndex].AdditionalData & SL_NETAPP_FAMILY_MASK)
-        {
-            Opcode &= ~SL_OPCODE_IPV6;
-        }
+        ActiveIndex = g_pCB->ActiveObjIdx[Sd];
 
         if ((g_pCB->ObjPool[ActiveIndex].ActionID == RECV_ID) && (Sd == g_pCB->ObjPool[ActiveIndex].AdditionalData) && 
 						( (SL_OPCODE_SOCKET_RECVASYNCRESPONSE == Opcode) || (SL_OPCODE_SOCKET_RECVFROMASYNCRESPONSE == Opcode)
@@ -1949,18 +2356,48 @@ static _SlReturnVal_t _SlFindAndSetActiveObj(_SlOpcode_t  Opcode, _u8 Sd)
                )
         {
             g_pCB->FunctionParams.AsyncExt.ActionIndex = ActiveIndex;
+#ifdef sl_CmdTrace
+            _SlDrvTraceResponse(ActiveIndex, Opcode);
+#endif
+            return SL_RET_CODE_OK;
+        }
+        if ((g_pCB->ObjPool[ActiveIndex].ActionID != RECV_ID) &&
+            (_SlActionLookupTable[ g_pCB->ObjPool[ActiveIndex].ActionID - MAX_SOCKET_ENUM_IDX].ActionAsyncOpcode == Opcode))
+        {
+            /* set handler */
+            g_pCB->FunctionParams.AsyncExt.AsyncEvtHandler = _SlActionLookupTable[ g_pCB->ObjPool[ActiveIndex].ActionID - MAX_SOCKET_ENUM_IDX].AsyncEventHandler;
+            g_pCB->FunctionParams.AsyncExt.ActionIndex = ActiveIndex;
+#ifdef sl_CmdTrace
+            _SlDrvTraceResponse(ActiveIndex, Opcode);
+#endif
             return SL_RET_CODE_OK;
         }
-        /* In case this action is socket related, SocketID is in use, otherwise will be set to SL_MAX_SOCKETS */
-        if ( (_SlActionLookupTable[ g_pCB->ObjPool[ActiveIndex].ActionID - MAX_SOCKET_ENUM_IDX].ActionAsyncOpcode == Opcode) && 
-            ( ((Sd == (g_pCB->ObjPool[ActiveIndex].AdditionalData & BSD_SOCKET_ID_MASK) ) && (SL_MAX_SOCKETS > Sd)) || (SL_MAX_SOCKETS == (g_pCB->ObjPool[ActiveIndex].AdditionalData & BSD_SOCKET_ID_MASK)) ) )
+    }
+
+    /* otherwise an active action with no socket, whatever Sd is: one entry per action bit */
+    Actions = g_pCB->ActiveActionsBitmap & ~(((_u32)1 << MAX_SOCKET_ENUM_IDX) - 1);
+    while (0 != Actions)
+    {
+        ActiveIndex = g_pCB->ActiveObjIdx[_SlDrvLowestBit(Actions)];
+        Actions &= Actions - 1;
+
+        /* unset the Ipv4\IPv6 bit in the opcode if family bit was set  */
+        ObjOpcode = Opcode;
+        if (g_pCB->ObjPool[ActiveIndex].AdditionalData & SL_NETAPP_FAMILY_MASK)
+        {
+            ObjOpcode &= ~SL_OPCODE_IPV6;
+        }
+
+        if (_SlActionLookupTable[ g_pCB->ObjPool[ActiveIndex].ActionID - MAX_SOCKET_ENUM_IDX].ActionAsyncOpcode == ObjOpcode)
         {
             /* set handler */
             g_pCB->FunctionParams.AsyncExt.AsyncEvtHandler = _SlActionLookupTable[ g_pCB->ObjPool[ActiveIndex].ActionID - MAX_SOCKET_ENUM_IDX].AsyncEventHandler;
             g_pCB->FunctionParams.AsyncExt.ActionIndex = ActiveIndex;
+#ifdef sl_CmdTrace
+            _SlDrvTraceResponse(ActiveIndex, Opcode);
+#endif
             return SL_RET_CODE_OK;
         }
-        ActiveIndex = g_pCB->ObjPool[ActiveIndex].NextIndex;
     }
 
     return SL_RET_CODE_SELF_ERROR;
@@ -1968,6 +2405,23 @@ static _SlReturnVal_t _SlFindAndSetActiveObj(_SlOpcode_t  Opcode, _u8 Sd)
 }
 
 
+#ifdef sl_CmdTrace
+/* ******************************************************************************/
+/*  _SlDrvTraceResponse                                                        */
+/* ******************************************************************************/
+static void _SlDrvTraceResponse(_u8 ObjIdx, _SlOpcode_t Opcode)
+{
+    g_pCB->ObjPool[ObjIdx].Trace.Response = sl_GetTimestamp();
+
+    /* an action whose request was a plain command is known by its response */
+    if (0 == g_pCB->ObjPool[ObjIdx].Trace.Opcode)
+    {
+        g_pCB->ObjPool[ObjIdx].Trace.Opcode = Opcode;
+    }
+}
+#endif
+
+
 #if defined(sl_HttpServerCallback) || defined(EXT_LIB_REGISTERED_HTTP_SERVER_EVENTS)
 void _SlDrvDispatchHttpServerEvents(SlHttpServerEvent_t *slHttpServerEvent, SlHttpServerResponse_t *slHttpServerResponse)
 {
@@ -55,6 +55,24 @@
 #ifndef SYNC_PATTERN_TIMEOUT_IN_MSEC
 #define SYNC_PATTERN_TIMEOUT_IN_MSEC   (50) /* the sync patttern timeout in milliseconds units */
 #endif
+
+/* Most sl_IfWrite calls _SlDrvMsgWrite makes between sl_IfStartWriteSequence */
+/* and sl_IfEndWriteSequence: sync pattern, header, descriptors, RX payload   */
+/* sent as TX (sendRxPayload) and TX payload                                  */
+#define SL_MSG_WRITES_MAX              (5)
+
+/* Receive path with a look-ahead buffer, see driver.c. Needed to take the */
+/* message bursts of NWP RX aggregation (SL_SET_HOST_RX_AGGR) apart        */
+#if defined(SL_RX_LOOKAHEAD_SIZE) && !defined(SL_IF_TYPE_UART)
+#define SL_RX_LOOKAHEAD
+#endif
+
+/* Taking those bursts apart, only with SL_RX_AGGR (user.h) */
+#if (SL_RX_AGGR) && defined(SL_RX_LOOKAHEAD)
+#define SL_RX_BURST
+#elif (SL_RX_AGGR)
+#error "SL_RX_AGGR needs SL_RX_LOOKAHEAD_SIZE and the SPI interface"
+#endif
 /*****************************************************************************/
 /* Macro declarations                                                        */
 /*****************************************************************************/
@@ -125,6 +143,20 @@ typedef struct
 	_i32  Total10MSecUnits;
 } _SlTimeoutParams_t;
 
+#ifdef sl_CmdTrace
+#ifndef sl_GetTimestamp
+#error "sl_CmdTrace takes its times from sl_GetTimestamp"
+#endif
+/* A command on its way through the driver, see sl_CmdTrace in user.h */
+typedef struct
+{
+    _u16  Opcode;
+    _u32  Start;
+    _u32  Written;
+    _u32  Response;
+} _SlCmdTrace_t;
+#endif
+
 typedef struct
 {
 	_u8 *pAsyncMsgBuff;
@@ -161,10 +193,21 @@ typedef struct _SlPoolObj_t
 	 _u8                *pRespArgs;
 	_u8			      ActionID; 
 	_u8			      AdditionalData; /* use for socketID and one bit which indicate supprt IPV6 or not (1=support, 0 otherwise) */
-    _u8				  NextIndex;  
+#ifdef sl_CmdTrace
+    _SlCmdTrace_t         Trace;
+#endif
 
 } _SlPoolObj_t;
 
+/* One bit per ObjPool entry */
+#if (MAX_CONCURRENT_ACTIONS > 32)
+#error "MAX_CONCURRENT_ACTIONS must fit the _SlPoolBitmap_t bitmaps"
+#elif (MAX_CONCURRENT_ACTIONS > 16)
+typedef _u32 _SlPoolBitmap_t;
+#else
+typedef _u16 _SlPoolBitmap_t;
+#endif
+
 
 typedef enum
 {
@@ -192,7 +235,9 @@ typedef enum
 	PING_ID,
 #endif	
     START_STOP_ID,
-	RECV_ID
+	RECV_ID,
+    /* Bits of ActiveActionsBitmap: one per socket, then one per action */
+    MAX_ACTION_BITS
 }_SlActionID_e;
 
 typedef struct _SlActionLookup_t
@@ -246,14 +291,21 @@ typedef struct
     P_INIT_CALLBACK                  pInitCallback;
 
     _SlPoolObj_t                    ObjPool[MAX_CONCURRENT_ACTIONS];
-	_u8					    FreePoolIdx;
-	_u8					    PendingPoolIdx;
-	_u8					    ActivePoolIdx;
+    _SlPoolBitmap_t                 FreePoolBitmap;
 	_u32					ActiveActionsBitmap;
+    /* Per ActiveActionsBitmap bit: the entry holding it, valid while the bit is set, */
+    /* and the entries pending on it. Pending entries also by action, as it is matched on release */
+    _u8                             ActiveObjIdx[MAX_ACTION_BITS];
+    _SlPoolBitmap_t                 PendingPoolBitmap[MAX_ACTION_BITS];
+    _SlPoolBitmap_t                 PendingActionBitmap[MAX_ACTION_BITS - MAX_SOCKET_ENUM_IDX];
 	_SlLockObj_t                    ProtectionLockObj;
 
     _SlSyncObj_t                     CmdSyncObj;  
     _u8                     IsCmdRespWaited;
+#ifdef sl_CmdTrace
+    /* the command _SlDrvCmdOp waits for, under the global lock */
+    _SlCmdTrace_t           CmdTrace;
+#endif
     _SlFlowContCB_t          FlowContCB;
     _u8                     TxSeqNum;
     _u8                     RxDoneCnt;
@@ -289,6 +341,9 @@ extern _SlReturnVal_t _sl_HandleAsync_InitComplete(void *pVoidBuf);
 extern _SlReturnVal_t _sl_HandleAsync_Connect(void *pVoidBuf);
 extern _SlReturnVal_t _SlDrvGlobalObjUnLock(void);
 extern _SlReturnVal_t _SlDrvMsgReadSpawnCtx(void *pValue);
+#ifdef SL_RX_BURST
+extern _u8 _SlDrvRxAggrSet(_u8 Enable);
+#endif
 
 
 #ifndef SL_TINY_EXT
@@ -65,11 +65,31 @@ _i32 sl_NetCfgSet(const _u8 ConfigId ,const _u8 ConfigOpt,const _u8 ConfigLen,co
 {
     _SlNetCfgMsgSet_u         Msg;
     _SlCmdExt_t               CmdExt;
+    _SlReturnVal_t            RetVal;
+    _u8                       RxAggr = (SL_SET_HOST_RX_AGGR == ConfigId) && (ConfigLen > 0) && (0 != *pValues);
+#ifdef SL_RX_BURST
+    _u8                       RxAggrBefore = FALSE;
+#endif
 
     /* verify no erorr handling in progress. if in progress than
     ignore the API execution and return immediately with an error */
     VERIFY_NO_ERROR_HANDLING_IN_PROGRESS();
 
+#ifdef SL_RX_BURST
+    /* Bursts may come from the moment the NWP has the command until it has */
+    /* answered it: take them apart from before enabling to after disabling */
+    if (SL_SET_HOST_RX_AGGR == ConfigId)
+    {
+        RxAggrBefore = _SlDrvRxAggrSet(TRUE);
+    }
+#else
+    /* Bursts are only taken apart when built with SL_RX_AGGR, see user.h */
+    if (RxAggr)
+    {
+        return SL_RET_CODE_INVALID_INPUT;
+    }
+#endif
+
     _SlDrvResetCmdExt(&CmdExt);
     CmdExt.TxPayloadLen = (ConfigLen+3) & (~3);
     CmdExt.pTxPayload = (_u8 *)pValues;
@@ -79,7 +99,17 @@ _i32 sl_NetCfgSet(const _u8 ConfigId ,const _u8 ConfigOpt,const _u8 ConfigLen,co
     Msg.Cmd.ConfigLen   = ConfigLen;
     Msg.Cmd.ConfigOpt   = ConfigOpt;
 
-    VERIFY_RET_OK(_SlDrvCmdOp((_SlCmdCtrl_t *)&_SlNetCfgSetCmdCtrl, &Msg, &CmdExt));
+    RetVal = _SlDrvCmdOp((_SlCmdCtrl_t *)&_SlNetCfgSetCmdCtrl, &Msg, &CmdExt);
+
+#ifdef SL_RX_BURST
+    /* On any failure, the command's or the NWP's, the mode stays as it was */
+    if (SL_SET_HOST_RX_AGGR == ConfigId)
+    {
+        (void)_SlDrvRxAggrSet(((SL_OS_RET_CODE_OK == RetVal) && (0 == Msg.Rsp.status)) ? RxAggr : RxAggrBefore);
+    }
+#endif
+
+    VERIFY_RET_OK(RetVal);
 
     return (_i16)Msg.Rsp.status;
 }
@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "pingpong_cmdtrace.h"
+
+/*----------------------------------------------------------------------------*/
+
+#define CMDTRACE_PREFIX_LENGTH  ( sizeof(PINGPONG_CMDTRACE_PREFIX) - 1 )
+
+/*----------------------------------------------------------------------------*/
+
+static const char cmdtrace_hex[] = "0123456789abcdef";
+
+/*----------------------------------------------------------------------------*/
+
+static void cmdtrace_put(uint8_t* buffer, uint32_t value);
+static uint32_t cmdtrace_get(const uint8_t* buffer);
+static int cmdtrace_nibble(char c);
+
+/*----------------------------------------------------------------------------*/
+
+void pingpong_cmdtrace_reset(pingpong_cmdtrace_t* trace, pingpong_cmdtrace_record_t* records, uint32_t size)
+{
+    trace->records = records;
+    trace->size = size;
+    trace->added = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
+void pingpong_cmdtrace_add(pingpong_cmdtrace_t* trace, const pingpong_cmdtrace_record_t* record)
+{
+    if (trace->size == 0)
+    {
+        return;
+    }
+
+    trace->records[trace->added % trace->size] = *record;
+    trace->added++;
+}
+
+/*----------------------------------------------------------------------------*/
+
+uint32_t pingpong_cmdtrace_first(const pingpong_cmdtrace_t* trace)
+{
+    return (trace->added > trace->size) ? trace->added - trace->size : 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
+bool pingpong_cmdtrace_get(const pingpong_cmdtrace_t* trace, uint32_t sequence,
+                           pingpong_cmdtrace_record_t* record)
+{
+    /* Unsigned, so that a sequence number behind the oldest one is out of range too */
+    if (trace->added - sequence - 1 >= trace->size)
+    {
+        return false;
+    }
+
+    *record = trace->records[sequence % trace->size];
+
+    return true;
+}
+
+/*----------------------------------------------------------------------------*/
+
+void pingpong_cmdtrace_format(const pingpong_cmdtrace_record_t* record, char* line)
+{
+    uint8_t data[PINGPONG_CMDTRACE_RECORD_SIZE];
+    uint32_t i;
+
+    data[0] = (uint8_t) record->opcode;
+    data[1] = (uint8_t) (record->opcode >> 8);
+    cmdtrace_put(&data[2], record->start);
+    cmdtrace_put(&data[6], record->written);
+    cmdtrace_put(&data[10], record->response);
+    cmdtrace_put(&data[14], record->woken);
+
+    memcpy(line, PINGPONG_CMDTRACE_PREFIX, CMDTRACE_PREFIX_LENGTH);
+    line += CMDTRACE_PREFIX_LENGTH;
+    for (i = 0; i < PINGPONG_CMDTRACE_RECORD_SIZE; i++)
+    {
+        *line++ = cmdtrace_hex[data[i] >> 4];
+        *line++ = cmdtrace_hex[data[i] & 0x0F];
+    }
+    *line = '\0';
+}
+
+/*----------------------------------------------------------------------------*/
+
+bool pingpong_cmdtrace_parse(const char* line, pingpong_cmdtrace_record_t* record)
+{
+    uint8_t data[PINGPONG_CMDTRACE_RECORD_SIZE];
+    int high, low;
+    uint32_t i;
+
+    if (strncmp(line, PINGPONG_CMDTRACE_PREFIX, CMDTRACE_PREFIX_LENGTH) != 0)
+    {
+        return false;
+    }
+    line += CMDTRACE_PREFIX_LENGTH;
+
+    for (i = 0; i < PINGPONG_CMDTRACE_RECORD_SIZE; i++)
+    {
+        high = cmdtrace_nibble(line[2 * i]);
+        low = (high < 0) ? -1 : cmdtrace_nibble(line[2 * i + 1]);
+        if (low < 0)
+        {
+            return false;
+        }
+        data[i] = (uint8_t) ((high << 4) | low);
+    }
+
+    record->opcode = (uint16_t) (data[0] | (data[1] << 8));
+    record->start = cmdtrace_get(&data[2]);
+    record->written = cmdtrace_get(&data[6]);
+    record->response = cmdtrace_get(&data[10]);
+    record->woken = cmdtrace_get(&data[14]);
+
+    return true;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void cmdtrace_put(uint8_t* buffer, uint32_t value)
+{
+    buffer[0] = (uint8_t) value;
+    buffer[1] = (uint8_t) (value >> 8);
+    buffer[2] = (uint8_t) (value >> 16);
+    buffer[3] = (uint8_t) (value >> 24);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static uint32_t cmdtrace_get(const uint8_t* buffer)
+{
+    return (uint32_t) buffer[0] | ((uint32_t) buffer[1] << 8) |
+           ((uint32_t) buffer[2] << 16) | ((uint32_t) buffer[3] << 24);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static int cmdtrace_nibble(char c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#ifndef PINGPONG_CMDTRACE_H_
+#define PINGPONG_CMDTRACE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Latency records of the SimpleLink driver commands (sl_CmdTrace in user.h).
+ *
+ * One record per command, data operation or asynchronous action, with the
+ * times it went through the driver, in microseconds of sl_GetTimestamp:
+ *
+ *   start     the caller entered the driver
+ *   written   the last byte of the request went to the NWP
+ *   response  the driver read the response of the NWP
+ *   woken     the caller got its result back
+ *
+ * A time is 0 when that step did not happen: a send has no response, and an
+ * asynchronous action does not know the request that started it.
+ *
+ * The ring keeps the last records added, every record has a sequence number
+ * so that a reader can tell which ones it lost while dumping. On the console
+ * each record is a "cmdtrace" line with its 18 bytes in hex, little endian:
+ * the opcode and then the four times.
+ *
+ * Plain C99, shared by the MSP432 firmware and the host-side tools.
+ */
+
+#define PINGPONG_CMDTRACE_RECORD_SIZE   ( 18 )
+#define PINGPONG_CMDTRACE_PREFIX        "cmdtrace "
+
+/* The prefix, the record in hex and the terminator */
+#define PINGPONG_CMDTRACE_LINE_SIZE     ( sizeof(PINGPONG_CMDTRACE_PREFIX) + 2 * PINGPONG_CMDTRACE_RECORD_SIZE )
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint16_t opcode;
+    uint32_t start;
+    uint32_t written;
+    uint32_t response;
+    uint32_t woken;
+} pingpong_cmdtrace_record_t;
+
+typedef struct {
+    pingpong_cmdtrace_record_t* records;
+    uint32_t size;
+
+    /* Records added since the reset, the sequence number of the next one */
+    uint32_t added;
+} pingpong_cmdtrace_t;
+
+/* Starts an empty ring over size records */
+void pingpong_cmdtrace_reset(pingpong_cmdtrace_t* trace, pingpong_cmdtrace_record_t* records, uint32_t size);
+
+/* Adds a record, over the oldest one when the ring is full */
+void pingpong_cmdtrace_add(pingpong_cmdtrace_t* trace, const pingpong_cmdtrace_record_t* record);
+
+/* Sequence number of the oldest record still in the ring */
+uint32_t pingpong_cmdtrace_first(const pingpong_cmdtrace_t* trace);
+
+/* Copies record number sequence, false if it was overwritten or is not there yet */
+bool pingpong_cmdtrace_get(const pingpong_cmdtrace_t* trace, uint32_t sequence,
+                           pingpong_cmdtrace_record_t* record);
+
+/* Writes the console line of a record, without end of line, PINGPONG_CMDTRACE_LINE_SIZE bytes */
+void pingpong_cmdtrace_format(const pingpong_cmdtrace_record_t* record, char* line);
+
+/* Decodes a console line, false if it is not one */
+bool pingpong_cmdtrace_parse(const char* line, pingpong_cmdtrace_record_t* record);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PINGPONG_CMDTRACE_H_ */
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "pingpong_frame.h"
+
+/*----------------------------------------------------------------------------*/
+
+static void frame_put_u16(uint8_t* buffer, uint16_t value);
+static void frame_put_u32(uint8_t* buffer, uint32_t value);
+static uint16_t frame_get_u16(const uint8_t* buffer);
+static uint32_t frame_get_u32(const uint8_t* buffer);
+
+/*----------------------------------------------------------------------------*/
+
+uint16_t pingpong_frame_encode(const pingpong_frame_t* frame, uint8_t* buffer, uint32_t size)
+{
+    uint32_t total = PINGPONG_FRAME_HEADER_SIZE + frame->length;
+
+    if (frame->length > PINGPONG_FRAME_MAX_PAYLOAD || total > size)
+    {
+        return 0;
+    }
+
+    buffer[0] = PINGPONG_FRAME_VERSION;
+    buffer[1] = frame->type;
+    frame_put_u16(&buffer[2], frame->length);
+    frame_put_u32(&buffer[4], frame->seq);
+    frame_put_u32(&buffer[8], frame->timestamp);
+
+    if (frame->payload != NULL && frame->length > 0)
+    {
+        memcpy(&buffer[PINGPONG_FRAME_HEADER_SIZE], frame->payload, frame->length);
+    }
+
+    return (uint16_t) total;
+}
+
+/*----------------------------------------------------------------------------*/
+
+int32_t pingpong_frame_decode(pingpong_frame_t* frame, const uint8_t* buffer, uint32_t length)
+{
+    uint16_t payload;
+
+    if (length < 1)
+    {
+        return 0;
+    }
+
+    /* Reject garbage as soon as the first byte is in */
+    if (buffer[0] != PINGPONG_FRAME_VERSION)
+    {
+        return -1;
+    }
+
+    if (length < PINGPONG_FRAME_HEADER_SIZE)
+    {
+        return 0;
+    }
+
+    payload = frame_get_u16(&buffer[2]);
+    if ((buffer[1] != PINGPONG_FRAME_PING && buffer[1] != PINGPONG_FRAME_PONG) ||
+        payload > PINGPONG_FRAME_MAX_PAYLOAD)
+    {
+        return -1;
+    }
+
+    if (length < (uint32_t) PINGPONG_FRAME_HEADER_SIZE + payload)
+    {
+        return 0;
+    }
+
+    frame->type = buffer[1];
+    frame->length = payload;
+    frame->seq = frame_get_u32(&buffer[4]);
+    frame->timestamp = frame_get_u32(&buffer[8]);
+    frame->payload = &buffer[PINGPONG_FRAME_HEADER_SIZE];
+
+    return PINGPONG_FRAME_HEADER_SIZE + payload;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void frame_put_u16(uint8_t* buffer, uint16_t value)
+{
+    buffer[0] = (uint8_t) value;
+    buffer[1] = (uint8_t) (value >> 8);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void frame_put_u32(uint8_t* buffer, uint32_t value)
+{
+    buffer[0] = (uint8_t) value;
+    buffer[1] = (uint8_t) (value >> 8);
+    buffer[2] = (uint8_t) (value >> 16);
+    buffer[3] = (uint8_t) (value >> 24);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static uint16_t frame_get_u16(const uint8_t* buffer)
+{
+    return (uint16_t) (buffer[0] | (buffer[1] << 8));
+}
+
+/*----------------------------------------------------------------------------*/
+
+static uint32_t frame_get_u32(const uint8_t* buffer)
+{
+    return (uint32_t) buffer[0] | ((uint32_t) buffer[1] << 8) |
+           ((uint32_t) buffer[2] << 16) | ((uint32_t) buffer[3] << 24);
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#ifndef PINGPONG_FRAME_H_
+#define PINGPONG_FRAME_H_
+
+#include <stdint.h>
+
+/*
+ * Length-prefixed binary PING/PONG frame, all fields little endian:
+ *
+ *   offset  size  field
+ *   0       1     version (PINGPONG_FRAME_VERSION)
+ *   1       1     type (PINGPONG_FRAME_PING or PINGPONG_FRAME_PONG)
+ *   2       2     payload length in bytes
+ *   4       4     sequence number
+ *   8       4     send timestamp, in the sender's clock units
+ *   12      n     payload
+ *
+ * The version byte never collides with the first byte of a text "PING %d"
+ * message, so a server can tell both protocols apart from the first byte.
+ * A PONG echoes the sequence number, timestamp and payload of its PING.
+ *
+ * Encoding and decoding never allocate and work directly on the caller's
+ * buffers; the code is shared by the MSP432 firmware and the host tools.
+ */
+
+#define PINGPONG_FRAME_VERSION          ( 1 )
+#define PINGPONG_FRAME_HEADER_SIZE      ( 12 )
+#define PINGPONG_FRAME_MAX_PAYLOAD      ( 1024 )
+
+#define PINGPONG_FRAME_PING             ( 1 )
+#define PINGPONG_FRAME_PONG             ( 2 )
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint8_t type;
+    uint16_t length;
+    uint32_t seq;
+    uint32_t timestamp;
+    const uint8_t* payload;
+} pingpong_frame_t;
+
+/*
+ * Writes the frame to buffer and returns its size, or 0 if it does not fit.
+ * With a NULL payload only the header is written, so the payload can be
+ * filled in place after PINGPONG_FRAME_HEADER_SIZE bytes.
+ */
+uint16_t pingpong_frame_encode(const pingpong_frame_t* frame, uint8_t* buffer, uint32_t size);
+
+/*
+ * Decodes the frame at the start of buffer. Returns the number of bytes it
+ * takes, 0 if more bytes are needed (TCP split it) or -1 if it is malformed.
+ * The payload pointer refers to the caller's buffer. Any bytes left after a
+ * complete frame belong to the next one (TCP coalesced them).
+ */
+int32_t pingpong_frame_decode(pingpong_frame_t* frame, const uint8_t* buffer, uint32_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PINGPONG_FRAME_H_ */
@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pingpong_histogram.h"
+
+/*----------------------------------------------------------------------------*/
+
+#define SUB_BUCKETS             ( 1u << PINGPONG_HISTOGRAM_SUB_BITS )
+#define HALF_SUB_BUCKETS        ( 1u << (PINGPONG_HISTOGRAM_SUB_BITS - 1) )
+#define MAX_VALUE               ( (1u << PINGPONG_HISTOGRAM_MAX_BITS) - 1 )
+
+/*----------------------------------------------------------------------------*/
+
+static uint32_t histogram_msb(uint32_t value);
+static uint32_t histogram_index(uint32_t value);
+static uint32_t histogram_highest_value(uint32_t index);
+
+/*----------------------------------------------------------------------------*/
+
+void pingpong_histogram_reset(pingpong_histogram_t* histogram)
+{
+    memset(histogram, 0, sizeof(pingpong_histogram_t));
+    histogram->min = UINT32_MAX;
+}
+
+/*----------------------------------------------------------------------------*/
+
+void pingpong_histogram_record(pingpong_histogram_t* histogram, uint32_t value)
+{
+    histogram->counts[histogram_index(value)]++;
+    histogram->total++;
+    histogram->sum += value;
+
+    if (value < histogram->min)
+    {
+        histogram->min = value;
+    }
+    if (value > histogram->max)
+    {
+        histogram->max = value;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+void pingpong_histogram_merge(pingpong_histogram_t* histogram, const pingpong_histogram_t* other)
+{
+    uint32_t i;
+
+    for (i = 0; i < PINGPONG_HISTOGRAM_BUCKETS; i++)
+    {
+        histogram->counts[i] += other->counts[i];
+    }
+    histogram->total += other->total;
+    histogram->sum += other->sum;
+
+    if (other->min < histogram->min)
+    {
+        histogram->min = other->min;
+    }
+    if (other->max > histogram->max)
+    {
+        histogram->max = other->max;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+uint32_t pingpong_histogram_percentile(const pingpong_histogram_t* histogram, uint32_t percentile)
+{
+    uint64_t target;
+    uint64_t count = 0;
+    uint32_t value;
+    uint32_t i;
+
+    if (histogram->total == 0)
+    {
+        return 0;
+    }
+
+    /* Rank of the requested percentile, rounded up and at least one */
+    if (percentile > 10000)
+    {
+        percentile = 10000;
+    }
+    target = ((uint64_t) histogram->total * percentile + 9999) / 10000;
+    if (target == 0)
+    {
+        target = 1;
+    }
+
+    for (i = 0; i < PINGPONG_HISTOGRAM_BUCKETS; i++)
+    {
+        count += histogram->counts[i];
+        if (count >= target)
+        {
+            break;
+        }
+    }
+
+    /* Report the bucket's highest equivalent value, never above the real maximum */
+    value = histogram_highest_value(i);
+    if (value > histogram->max)
+    {
+        value = histogram->max;
+    }
+    if (value < histogram->min)
+    {
+        value = histogram->min;
+    }
+
+    return value;
+}
+
+/*----------------------------------------------------------------------------*/
+
+uint32_t pingpong_histogram_mean(const pingpong_histogram_t* histogram)
+{
+    if (histogram->total == 0)
+    {
+        return 0;
+    }
+
+    return (uint32_t) (histogram->sum / histogram->total);
+}
+
+/*----------------------------------------------------------------------------*/
+
+uint32_t pingpong_histogram_bucket_value(uint32_t index)
+{
+    return histogram_highest_value(index);
+}
+
+/*----------------------------------------------------------------------------*/
+
+int pingpong_histogram_format(const pingpong_histogram_t* histogram, char* buffer, size_t length)
+{
+    return snprintf(buffer, length,
+                    "n=%lu min=%lu p50=%lu p90=%lu p99=%lu p99.9=%lu max=%lu",
+                    (unsigned long) histogram->total,
+                    (unsigned long) (histogram->total ? histogram->min : 0),
+                    (unsigned long) pingpong_histogram_percentile(histogram, 5000),
+                    (unsigned long) pingpong_histogram_percentile(histogram, 9000),
+                    (unsigned long) pingpong_histogram_percentile(histogram, 9900),
+                    (unsigned long) pingpong_histogram_percentile(histogram, 9990),
+                    (unsigned long) histogram->max);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static uint32_t histogram_msb(uint32_t value)
+{
+    uint32_t msb = 0;
+
+    if (value >= (1u << 16)) { value >>= 16; msb += 16; }
+    if (value >= (1u << 8))  { value >>= 8;  msb += 8;  }
+    if (value >= (1u << 4))  { value >>= 4;  msb += 4;  }
+    if (value >= (1u << 2))  { value >>= 2;  msb += 2;  }
+    if (value >= (1u << 1))  { msb += 1; }
+
+    return msb;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static uint32_t histogram_index(uint32_t value)
+{
+    uint32_t msb, shift;
+
+    if (value < SUB_BUCKETS)
+    {
+        return value;
+    }
+    if (value > MAX_VALUE)
+    {
+        value = MAX_VALUE;
+    }
+
+    /* Power of two selects the bucket, the next bits the linear sub-bucket */
+    msb = histogram_msb(value);
+    shift = msb - PINGPONG_HISTOGRAM_SUB_BITS + 1;
+
+    return SUB_BUCKETS + (msb - PINGPONG_HISTOGRAM_SUB_BITS) * HALF_SUB_BUCKETS +
+           ((value >> shift) - HALF_SUB_BUCKETS);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static uint32_t histogram_highest_value(uint32_t index)
+{
+    uint32_t bucket, sub, shift;
+
+    if (index < SUB_BUCKETS)
+    {
+        return index;
+    }
+
+    bucket = (index - SUB_BUCKETS) / HALF_SUB_BUCKETS;
+    sub = (index - SUB_BUCKETS) % HALF_SUB_BUCKETS + HALF_SUB_BUCKETS;
+    shift = bucket + 1;
+
+    return (sub << shift) + ((1u << shift) - 1);
+}
+
+/*----------------------------------------------------------------------------*/
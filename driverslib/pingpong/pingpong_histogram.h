@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#ifndef PINGPONG_HISTOGRAM_H_
+#define PINGPONG_HISTOGRAM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Fixed-memory, log-bucketed latency histogram (HdrHistogram-like).
+ *
+ * Values below 2^SUB_BITS are counted exactly. Above that, every power of two
+ * is split into 2^(SUB_BITS-1) linear sub-buckets, so the relative error of a
+ * reported value is below 1/2^(SUB_BITS-1). Values that do not fit in
+ * MAX_BITS are clamped to the last bucket (the exact maximum is kept apart).
+ *
+ * The code is plain C99 without any platform dependency, so it is shared by
+ * the MSP432 firmware and the host-side tools.
+ */
+
+#ifndef PINGPONG_HISTOGRAM_SUB_BITS
+#define PINGPONG_HISTOGRAM_SUB_BITS     ( 4 )
+#endif
+
+#ifndef PINGPONG_HISTOGRAM_MAX_BITS
+#define PINGPONG_HISTOGRAM_MAX_BITS     ( 24 )
+#endif
+
+#define PINGPONG_HISTOGRAM_BUCKETS      ( (1 << PINGPONG_HISTOGRAM_SUB_BITS) + \
+                                          (PINGPONG_HISTOGRAM_MAX_BITS - PINGPONG_HISTOGRAM_SUB_BITS) * \
+                                          (1 << (PINGPONG_HISTOGRAM_SUB_BITS - 1)) )
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t counts[PINGPONG_HISTOGRAM_BUCKETS];
+    uint32_t total;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+} pingpong_histogram_t;
+
+void pingpong_histogram_reset(pingpong_histogram_t* histogram);
+void pingpong_histogram_record(pingpong_histogram_t* histogram, uint32_t value);
+void pingpong_histogram_merge(pingpong_histogram_t* histogram, const pingpong_histogram_t* other);
+
+/* Percentile given in hundredths of a percent, e.g. 9990 for p99.9 */
+uint32_t pingpong_histogram_percentile(const pingpong_histogram_t* histogram, uint32_t percentile);
+uint32_t pingpong_histogram_mean(const pingpong_histogram_t* histogram);
+
+/* Highest value counted by counts[index], to walk the buckets in order */
+uint32_t pingpong_histogram_bucket_value(uint32_t index);
+
+/* One line summary: "n=... min=... p50=... p90=... p99=... p99.9=... max=..." */
+int pingpong_histogram_format(const pingpong_histogram_t* histogram, char* buffer, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PINGPONG_HISTOGRAM_H_ */
@@ -0,0 +1,256 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "pingpong_log.h"
+
+/*----------------------------------------------------------------------------*/
+
+/* A 32-bit value never takes more than 5 varint bytes */
+#define VARINT_MAX              ( 5 )
+#define RECORD_MAX              ( (2 + PINGPONG_LOG_MAX_ARGS) * VARINT_MAX )
+
+/* Small differences of either sign map to small varints: 0, -1, 1, -2 -> 0, 1, 2, 3 */
+#define LOG_ZIGZAG(d)           ( ((d) << 1) ^ (uint32_t) -(int32_t) ((d) >> 31) )
+#define LOG_UNZIGZAG(z)         ( ((z) >> 1) ^ (uint32_t) -(int32_t) ((z) & 1) )
+
+/*----------------------------------------------------------------------------*/
+
+static uint16_t log_varint_put(uint8_t* buffer, uint32_t value);
+static int log_varint_get(const uint8_t* buffer, uint16_t length, uint16_t* offset, uint32_t* value);
+
+/*----------------------------------------------------------------------------*/
+
+void pingpong_log_batch_reset(pingpong_log_batch_t* batch)
+{
+    batch->length = 0;
+    batch->count = 0;
+    batch->timestamp = 0;
+    memset(batch->args, 0, sizeof(batch->args));
+}
+
+/*----------------------------------------------------------------------------*/
+
+bool pingpong_log_batch_add(pingpong_log_batch_t* batch, const pingpong_log_record_t* record)
+{
+    uint8_t encoded[RECORD_MAX];
+    uint16_t length;
+    uint8_t i;
+
+    /* The first record carries the whole timestamp, the others the difference */
+    length = log_varint_put(encoded, ((uint32_t) record->id << 2) | record->argc);
+    length += log_varint_put(&encoded[length],
+                             batch->count ? record->timestamp - batch->timestamp : record->timestamp);
+    for (i = 0; i < record->argc; i++)
+    {
+        length += log_varint_put(&encoded[length], LOG_ZIGZAG(record->args[i] - batch->args[i]));
+    }
+
+    if (batch->length + length > PINGPONG_LOG_BATCH_SIZE)
+    {
+        return false;
+    }
+
+    memcpy(&batch->data[batch->length], encoded, length);
+    batch->length += length;
+    batch->count++;
+    batch->timestamp = record->timestamp;
+    for (i = 0; i < record->argc; i++)
+    {
+        batch->args[i] = record->args[i];
+    }
+
+    return true;
+}
+
+/*----------------------------------------------------------------------------*/
+
+uint16_t pingpong_log_frame(const pingpong_log_batch_t* batch, uint8_t* frame)
+{
+    uint16_t i, code, length;
+
+    /* COBS: every zero becomes the distance to the next one */
+    frame[0] = 0;
+    code = 1;
+    length = 2;
+    for (i = 0; i < batch->length; i++)
+    {
+        if (batch->data[i] == 0)
+        {
+            frame[code] = (uint8_t) (length - code);
+            code = length++;
+        }
+        else
+        {
+            frame[length++] = batch->data[i];
+        }
+    }
+    frame[code] = (uint8_t) (length - code);
+    frame[length++] = 0;
+
+    return length;
+}
+
+/*----------------------------------------------------------------------------*/
+
+bool pingpong_log_unframe(pingpong_log_batch_t* batch, const uint8_t* data, uint16_t length)
+{
+    uint16_t i = 0, j;
+    uint8_t code;
+
+    pingpong_log_batch_reset(batch);
+
+    while (i < length)
+    {
+        code = data[i++];
+        if (code == 0 || i + code - 1 > length)
+        {
+            return false;
+        }
+        for (j = 1; j < code; j++)
+        {
+            if (batch->length >= PINGPONG_LOG_BATCH_SIZE)
+            {
+                return false;
+            }
+            batch->data[batch->length++] = data[i++];
+        }
+
+        /* A block shorter than 255 stands for a zero, except the last one */
+        if (code < 0xFF && i < length)
+        {
+            if (batch->length >= PINGPONG_LOG_BATCH_SIZE)
+            {
+                return false;
+            }
+            batch->data[batch->length++] = 0;
+        }
+    }
+
+    return batch->length > 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
+void pingpong_log_cursor_reset(pingpong_log_cursor_t* cursor)
+{
+    memset(cursor, 0, sizeof(pingpong_log_cursor_t));
+}
+
+/*----------------------------------------------------------------------------*/
+
+int pingpong_log_next(const pingpong_log_batch_t* batch, pingpong_log_cursor_t* cursor,
+                      pingpong_log_record_t* record)
+{
+    uint32_t header, delta;
+    uint8_t i;
+
+    if (cursor->offset >= batch->length)
+    {
+        return 0;
+    }
+
+    if (log_varint_get(batch->data, batch->length, &cursor->offset, &header) < 0 ||
+        log_varint_get(batch->data, batch->length, &cursor->offset, &delta) < 0)
+    {
+        return -1;
+    }
+
+    record->id = (uint16_t) (header >> 2);
+    record->argc = (uint8_t) (header & 0x03);
+    if (record->argc > PINGPONG_LOG_MAX_ARGS)
+    {
+        return -1;
+    }
+
+    /* The first record of a batch starts from 0, so delta is the absolute time */
+    cursor->timestamp += delta;
+    record->timestamp = cursor->timestamp;
+
+    for (i = 0; i < record->argc; i++)
+    {
+        if (log_varint_get(batch->data, batch->length, &cursor->offset, &delta) < 0)
+        {
+            return -1;
+        }
+        cursor->args[i] += LOG_UNZIGZAG(delta);
+        record->args[i] = cursor->args[i];
+    }
+
+    return 1;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static uint16_t log_varint_put(uint8_t* buffer, uint32_t value)
+{
+    uint16_t length = 0;
+
+    /* Seven bits per byte, low bits first, the top bit says more follow */
+    while (value >= 0x80)
+    {
+        buffer[length++] = (uint8_t) (value | 0x80);
+        value >>= 7;
+    }
+    buffer[length++] = (uint8_t) value;
+
+    return length;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static int log_varint_get(const uint8_t* buffer, uint16_t length, uint16_t* offset, uint32_t* value)
+{
+    uint8_t shift = 0;
+    uint8_t byte;
+
+    *value = 0;
+    do
+    {
+        if (*offset >= length || shift >= 7 * VARINT_MAX)
+        {
+            return -1;
+        }
+        byte = buffer[(*offset)++];
+        *value |= (uint32_t) (byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
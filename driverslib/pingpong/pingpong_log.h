@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#ifndef PINGPONG_LOG_H_
+#define PINGPONG_LOG_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Wire format of the deferred binary log.
+ *
+ * A log record is a message id, a microsecond timestamp and up to
+ * PINGPONG_LOG_MAX_ARGS raw 32-bit arguments; the format string behind the
+ * id never leaves the build, the host decoder has the same table. Records
+ * are packed into batches with unsigned LEB128 varints:
+ *
+ *   varint  (id << 2) | argc
+ *   varint  timestamp, absolute for the first record of a batch, then the
+ *           difference to the previous record
+ *   varint  each argument, zigzag encoded difference to the last value of
+ *           the same argument position in the batch (0 at the start)
+ *
+ * Sequence numbers and similar counters thus take a single byte.
+ *
+ * A batch is COBS encoded and sent between two 0x00 bytes. Text never
+ * contains 0x00, so batches can share the UART with plain CLI_Write output
+ * and the decoder resynchronises at the next zero after any corruption.
+ *
+ * Plain C99, shared by the MSP432 firmware and the host-side tools.
+ */
+
+#define PINGPONG_LOG_MAX_ARGS           ( 3 )
+
+/* Largest batch, so that COBS needs a single overhead byte */
+#define PINGPONG_LOG_BATCH_SIZE         ( 254 )
+
+/* Largest frame on the wire: delimiters, COBS overhead and the batch */
+#define PINGPONG_LOG_FRAME_SIZE         ( PINGPONG_LOG_BATCH_SIZE + 3 )
+
+/* Reserved id, argument 0 is the number of records lost since the last one */
+#define PINGPONG_LOG_DROPPED            ( 0 )
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint16_t id;
+    uint8_t argc;
+    uint32_t timestamp;
+    uint32_t args[PINGPONG_LOG_MAX_ARGS];
+} pingpong_log_record_t;
+
+typedef struct {
+    uint8_t data[PINGPONG_LOG_BATCH_SIZE];
+    uint16_t length;
+    uint16_t count;
+    uint32_t timestamp;
+    uint32_t args[PINGPONG_LOG_MAX_ARGS];
+} pingpong_log_batch_t;
+
+/* Decoding position in a batch, and the values the next record is relative to */
+typedef struct {
+    uint16_t offset;
+    uint32_t timestamp;
+    uint32_t args[PINGPONG_LOG_MAX_ARGS];
+} pingpong_log_cursor_t;
+
+void pingpong_log_batch_reset(pingpong_log_batch_t* batch);
+
+/* Appends the record, false (and nothing written) if the batch is full */
+bool pingpong_log_batch_add(pingpong_log_batch_t* batch, const pingpong_log_record_t* record);
+
+/* COBS encodes the batch into frame, which takes PINGPONG_LOG_FRAME_SIZE bytes. Returns its size */
+uint16_t pingpong_log_frame(const pingpong_log_batch_t* batch, uint8_t* frame);
+
+/*
+ * Decodes the COBS bytes found between two 0x00 delimiters into batch.
+ * Returns false if they are not a valid batch.
+ */
+bool pingpong_log_unframe(pingpong_log_batch_t* batch, const uint8_t* data, uint16_t length);
+
+/*
+ * Decodes the next record of the batch at the cursor, which must be reset
+ * for every batch. Returns 1 for a record, 0 at the end of the batch and -1
+ * if it is malformed.
+ */
+void pingpong_log_cursor_reset(pingpong_log_cursor_t* cursor);
+int pingpong_log_next(const pingpong_log_batch_t* batch, pingpong_log_cursor_t* cursor,
+                      pingpong_log_record_t* record);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PINGPONG_LOG_H_ */
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pingpong_stream.h"
+
+/*----------------------------------------------------------------------------*/
+
+#define SEEN_WORD(seq)          ( ((seq) % PINGPONG_STREAM_WINDOW) / 32 )
+#define SEEN_BIT(seq)           ( 1u << ((seq) % 32) )
+
+/*----------------------------------------------------------------------------*/
+
+static void stream_jitter(pingpong_stream_t* stream, uint32_t transit);
+
+/*----------------------------------------------------------------------------*/
+
+void pingpong_stream_reset(pingpong_stream_t* stream)
+{
+    memset(stream, 0, sizeof(pingpong_stream_t));
+}
+
+/*----------------------------------------------------------------------------*/
+
+int pingpong_stream_record(pingpong_stream_t* stream, uint32_t seq, uint32_t transit)
+{
+    uint32_t distance, next;
+
+    /* First datagram, nothing to compare with */
+    if (stream->received == 0)
+    {
+        stream->highest = seq;
+        stream->seen[SEEN_WORD(seq)] |= SEEN_BIT(seq);
+        stream->received = 1;
+        stream->transit = transit;
+        return PINGPONG_STREAM_IN_ORDER;
+    }
+
+    /* Ahead of the highest one, forget the positions the window slides over */
+    if ((int32_t) (seq - stream->highest) > 0)
+    {
+        if (seq - stream->highest >= PINGPONG_STREAM_WINDOW)
+        {
+            memset(stream->seen, 0, sizeof(stream->seen));
+        }
+        else
+        {
+            for (next = stream->highest + 1; next != seq; next++)
+            {
+                stream->seen[SEEN_WORD(next)] &= ~SEEN_BIT(next);
+            }
+        }
+
+        stream->highest = seq;
+        stream->seen[SEEN_WORD(seq)] |= SEEN_BIT(seq);
+        stream->received++;
+        stream_jitter(stream, transit);
+        return PINGPONG_STREAM_IN_ORDER;
+    }
+
+    distance = stream->highest - seq;
+    if (distance < PINGPONG_STREAM_WINDOW)
+    {
+        if (stream->seen[SEEN_WORD(seq)] & SEEN_BIT(seq))
+        {
+            stream->duplicates++;
+            return PINGPONG_STREAM_DUPLICATE;
+        }
+        stream->seen[SEEN_WORD(seq)] |= SEEN_BIT(seq);
+    }
+
+    stream->received++;
+    stream->reordered++;
+    if (distance > stream->reorder_max)
+    {
+        stream->reorder_max = distance;
+    }
+    stream_jitter(stream, transit);
+
+    return PINGPONG_STREAM_REORDERED;
+}
+
+/*----------------------------------------------------------------------------*/
+
+uint32_t pingpong_stream_lost(const pingpong_stream_t* stream, uint32_t sent)
+{
+    return (stream->received < sent) ? sent - stream->received : 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
+uint32_t pingpong_stream_loss(const pingpong_stream_t* stream, uint32_t sent)
+{
+    if (sent == 0)
+    {
+        return 0;
+    }
+
+    return (uint32_t) (((uint64_t) pingpong_stream_lost(stream, sent) * 10000) / sent);
+}
+
+/*----------------------------------------------------------------------------*/
+
+uint32_t pingpong_stream_jitter(const pingpong_stream_t* stream)
+{
+    /* Kept scaled by 16 as in RFC 3550 appendix A.8 */
+    return stream->jitter >> 4;
+}
+
+/*----------------------------------------------------------------------------*/
+
+int pingpong_stream_format(const pingpong_stream_t* stream, uint32_t sent, char* buffer, size_t length)
+{
+    uint32_t loss = pingpong_stream_loss(stream, sent);
+
+    return snprintf(buffer, length,
+                    "sent=%lu received=%lu lost=%lu (%lu.%02lu%%) dup=%lu reordered=%lu max_distance=%lu jitter=%lu",
+                    (unsigned long) sent,
+                    (unsigned long) stream->received,
+                    (unsigned long) pingpong_stream_lost(stream, sent),
+                    (unsigned long) (loss / 100),
+                    (unsigned long) (loss % 100),
+                    (unsigned long) stream->duplicates,
+                    (unsigned long) stream->reordered,
+                    (unsigned long) stream->reorder_max,
+                    (unsigned long) pingpong_stream_jitter(stream));
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void stream_jitter(pingpong_stream_t* stream, uint32_t transit)
+{
+    int32_t d;
+
+    /* J += (|D| - J) / 16, with J scaled by 16 to keep the fraction */
+    d = (int32_t) (transit - stream->transit);
+    if (d < 0)
+    {
+        d = -d;
+    }
+    stream->jitter += (uint32_t) d - ((stream->jitter + 8) >> 4);
+    stream->transit = transit;
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef PINGPONG_STREAM_H_
+#define PINGPONG_STREAM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Delivery statistics of a sequenced datagram stream (UDP PING/PONG).
+ *
+ * Every datagram is recorded with its sequence number and its transit time.
+ * Sequence numbers seen in the last PINGPONG_STREAM_WINDOW positions below the
+ * highest one are remembered in a bitmap, which tells duplicates from late
+ * arrivals. A late arrival counts as reordered, and its distance to the
+ * highest sequence number is the reordering distance. Anything older than the
+ * window is counted as reordered without the duplicate check.
+ *
+ * Jitter follows RFC 3550 (section 6.4.1): the mean deviation of the
+ * difference in transit time of consecutive arrivals, smoothed with a gain of
+ * 1/16. Transit times may carry any constant offset (e.g. unsynchronised
+ * clocks), only their differences are used. For a round trip stream the RTT
+ * is the transit time.
+ *
+ * Plain C99, shared by the MSP432 firmware and the host-side tools.
+ */
+
+#ifndef PINGPONG_STREAM_WINDOW
+#define PINGPONG_STREAM_WINDOW          ( 64 )
+#endif
+
+/* Result of pingpong_stream_record */
+#define PINGPONG_STREAM_IN_ORDER        ( 0 )
+#define PINGPONG_STREAM_REORDERED       ( 1 )
+#define PINGPONG_STREAM_DUPLICATE       ( 2 )
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t seen[PINGPONG_STREAM_WINDOW / 32];
+    uint32_t highest;
+    uint32_t received;
+    uint32_t duplicates;
+    uint32_t reordered;
+    uint32_t reorder_max;
+    uint32_t transit;
+    uint32_t jitter;
+} pingpong_stream_t;
+
+void pingpong_stream_reset(pingpong_stream_t* stream);
+int pingpong_stream_record(pingpong_stream_t* stream, uint32_t seq, uint32_t transit);
+
+/* Datagrams out of sent that were never received, as a count and in hundredths of a percent */
+uint32_t pingpong_stream_lost(const pingpong_stream_t* stream, uint32_t sent);
+uint32_t pingpong_stream_loss(const pingpong_stream_t* stream, uint32_t sent);
+
+/* Jitter in the units of the transit times */
+uint32_t pingpong_stream_jitter(const pingpong_stream_t* stream);
+
+/* One line summary: "sent=... received=... lost=... (x.xx%) dup=... reordered=... max_distance=... jitter=..." */
+int pingpong_stream_format(const pingpong_stream_t* stream, uint32_t sent, char* buffer, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PINGPONG_STREAM_H_ */
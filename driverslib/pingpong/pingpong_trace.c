@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "pingpong_trace.h"
+
+/*----------------------------------------------------------------------------*/
+
+/* A 32-bit value never takes more than 5 varint bytes */
+#define VARINT_MAX              ( 5 )
+
+#define TRACE_KIND_BITS         ( 3 )
+#define TRACE_KIND_MASK         ( (1 << TRACE_KIND_BITS) - 1 )
+
+/*----------------------------------------------------------------------------*/
+
+static const uint8_t trace_magic[4] = { 'S', 'L', 'T', 'R' };
+
+/*----------------------------------------------------------------------------*/
+
+static uint32_t trace_varint_put(uint8_t* buffer, uint32_t value);
+static int trace_varint_get(const uint8_t* buffer, uint32_t length, uint32_t* offset, uint32_t* value);
+
+/*----------------------------------------------------------------------------*/
+
+void pingpong_trace_reset(pingpong_trace_t* trace, uint8_t* buffer, uint32_t size, uint32_t clock_hz)
+{
+    trace->buffer = buffer;
+    trace->size = size;
+    trace->timestamp = 0;
+    trace->records = 0;
+    trace->dropped = 0;
+    trace->pending = 0;
+    trace->length = 0;
+
+    if (size < PINGPONG_TRACE_HEADER_SIZE)
+    {
+        trace->size = 0;
+        return;
+    }
+
+    memcpy(buffer, trace_magic, sizeof(trace_magic));
+    buffer[4] = PINGPONG_TRACE_VERSION;
+    buffer[5] = 0;
+    buffer[6] = 0;
+    buffer[7] = 0;
+    buffer[8] = (uint8_t) clock_hz;
+    buffer[9] = (uint8_t) (clock_hz >> 8);
+    buffer[10] = (uint8_t) (clock_hz >> 16);
+    buffer[11] = (uint8_t) (clock_hz >> 24);
+    trace->length = PINGPONG_TRACE_HEADER_SIZE;
+}
+
+/*----------------------------------------------------------------------------*/
+
+void pingpong_trace_rewind(pingpong_trace_t* trace)
+{
+    /* The timestamp stays, the next record is relative to the last one saved */
+    trace->length = 0;
+    trace->dropped = 0;
+    trace->pending = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
+bool pingpong_trace_begin(pingpong_trace_t* trace, uint8_t kind, uint32_t timestamp, uint32_t length)
+{
+    uint8_t encoded[2 * VARINT_MAX];
+    uint32_t size;
+
+    trace->pending = 0;
+
+    /* Once a record is missing the rest would lie about what happened */
+    if (trace->dropped > 0)
+    {
+        trace->dropped++;
+        return false;
+    }
+
+    size = trace_varint_put(encoded, (length << TRACE_KIND_BITS) | (kind & TRACE_KIND_MASK));
+    size += trace_varint_put(&encoded[size], timestamp - trace->timestamp);
+    if (trace->length + size + length > trace->size)
+    {
+        trace->dropped++;
+        return false;
+    }
+
+    memcpy(&trace->buffer[trace->length], encoded, size);
+    trace->length += size;
+    trace->timestamp = timestamp;
+    trace->records++;
+    trace->pending = length;
+
+    return true;
+}
+
+/*----------------------------------------------------------------------------*/
+
+void pingpong_trace_append(pingpong_trace_t* trace, const uint8_t* data, uint32_t length)
+{
+    if (length > trace->pending)
+    {
+        length = trace->pending;
+    }
+    if (length == 0)
+    {
+        return;
+    }
+
+    memcpy(&trace->buffer[trace->length], data, length);
+    trace->length += length;
+    trace->pending -= length;
+}
+
+/*----------------------------------------------------------------------------*/
+
+bool pingpong_trace_add(pingpong_trace_t* trace, uint8_t kind, uint32_t timestamp,
+                        const uint8_t* data, uint32_t length)
+{
+    if (!pingpong_trace_begin(trace, kind, timestamp, length))
+    {
+        return false;
+    }
+
+    pingpong_trace_append(trace, data, length);
+
+    return true;
+}
+
+/*----------------------------------------------------------------------------*/
+
+bool pingpong_trace_open(pingpong_trace_cursor_t* cursor, const uint8_t* data, uint32_t length)
+{
+    if (length < PINGPONG_TRACE_HEADER_SIZE ||
+        memcmp(data, trace_magic, sizeof(trace_magic)) != 0 ||
+        data[4] != PINGPONG_TRACE_VERSION)
+    {
+        return false;
+    }
+
+    cursor->offset = PINGPONG_TRACE_HEADER_SIZE;
+    cursor->timestamp = 0;
+    cursor->clock_hz = (uint32_t) data[8] | ((uint32_t) data[9] << 8) |
+                       ((uint32_t) data[10] << 16) | ((uint32_t) data[11] << 24);
+
+    return true;
+}
+
+/*----------------------------------------------------------------------------*/
+
+int pingpong_trace_next(const uint8_t* data, uint32_t length, pingpong_trace_cursor_t* cursor,
+                        pingpong_trace_record_t* record)
+{
+    uint32_t header, delta;
+
+    if (cursor->offset >= length)
+    {
+        return 0;
+    }
+
+    if (trace_varint_get(data, length, &cursor->offset, &header) < 0 ||
+        trace_varint_get(data, length, &cursor->offset, &delta) < 0)
+    {
+        return -1;
+    }
+
+    record->kind = (uint8_t) (header & TRACE_KIND_MASK);
+    record->length = header >> TRACE_KIND_BITS;
+    if (record->length > length - cursor->offset)
+    {
+        return -1;
+    }
+
+    cursor->timestamp += delta;
+    record->timestamp = cursor->timestamp;
+    record->data = &data[cursor->offset];
+    cursor->offset += record->length;
+
+    return 1;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static uint32_t trace_varint_put(uint8_t* buffer, uint32_t value)
+{
+    uint32_t length = 0;
+
+    /* Seven bits per byte, low bits first, the top bit says more follow */
+    while (value >= 0x80)
+    {
+        buffer[length++] = (uint8_t) (value | 0x80);
+        value >>= 7;
+    }
+    buffer[length++] = (uint8_t) value;
+
+    return length;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static int trace_varint_get(const uint8_t* buffer, uint32_t length, uint32_t* offset, uint32_t* value)
+{
+    uint8_t shift = 0;
+    uint8_t byte;
+
+    *value = 0;
+    do
+    {
+        if (*offset >= length || shift >= 7 * VARINT_MAX)
+        {
+            return -1;
+        }
+        byte = buffer[(*offset)++];
+        *value |= (uint32_t) (byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
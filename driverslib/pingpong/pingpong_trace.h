@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#ifndef PINGPONG_TRACE_H_
+#define PINGPONG_TRACE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Wire format of the CC3100 SPI traces.
+ *
+ * Every SPI transaction between the SimpleLink driver and the NWP, and every
+ * IRQ and nHIB edge, in the order they happened. A trace is a header and the
+ * records that follow it:
+ *
+ *   header  "SLTR", the format version, three zero bytes and the rate of
+ *           the timestamp clock in Hz, 32-bit little endian
+ *   varint  (length << 3) | kind
+ *   varint  timestamp, difference to the previous record (the first one is
+ *           relative to 0) in ticks of that clock, modulo 2^32
+ *   bytes   the length bytes of the transaction: MOSI for a write, MISO
+ *           for a read, none for the line events
+ *
+ * A writer that runs out of room stops at the first record that does not
+ * fit, so a trace is always a prefix of what happened.
+ *
+ * Plain C99, shared by the MSP432 firmware and the host-side tools.
+ */
+
+#define PINGPONG_TRACE_VERSION          ( 1 )
+#define PINGPONG_TRACE_HEADER_SIZE      ( 12 )
+
+#define PINGPONG_TRACE_WRITE            ( 1 )
+#define PINGPONG_TRACE_READ             ( 2 )
+#define PINGPONG_TRACE_IRQ              ( 3 )
+#define PINGPONG_TRACE_ENABLE           ( 4 )
+#define PINGPONG_TRACE_DISABLE          ( 5 )
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint8_t* buffer;
+    uint32_t size;
+    uint32_t length;
+    uint32_t timestamp;
+    uint32_t records;
+    uint32_t dropped;
+
+    /* Bytes still expected by pingpong_trace_append for the record begun */
+    uint32_t pending;
+} pingpong_trace_t;
+
+typedef struct {
+    uint8_t kind;
+    uint32_t timestamp;
+    uint32_t length;
+    const uint8_t* data;
+} pingpong_trace_record_t;
+
+/* Decoding position in a trace, and the time the next record is relative to */
+typedef struct {
+    uint32_t offset;
+    uint32_t timestamp;
+    uint32_t clock_hz;
+} pingpong_trace_cursor_t;
+
+/* Starts an empty trace in buffer, with its header */
+void pingpong_trace_reset(pingpong_trace_t* trace, uint8_t* buffer, uint32_t size, uint32_t clock_hz);
+
+/*
+ * Forgets what the buffer holds, header included, once the caller has saved
+ * it somewhere. The records that follow continue the same trace.
+ */
+void pingpong_trace_rewind(pingpong_trace_t* trace);
+
+/*
+ * Opens a record of length bytes, which pingpong_trace_append then fills in.
+ * Returns false (and the appends are ignored) if it does not fit.
+ */
+bool pingpong_trace_begin(pingpong_trace_t* trace, uint8_t kind, uint32_t timestamp, uint32_t length);
+void pingpong_trace_append(pingpong_trace_t* trace, const uint8_t* data, uint32_t length);
+
+/* pingpong_trace_begin and pingpong_trace_append of a single buffer */
+bool pingpong_trace_add(pingpong_trace_t* trace, uint8_t kind, uint32_t timestamp,
+                        const uint8_t* data, uint32_t length);
+
+/* Checks the header and places the cursor on the first record. False if it is not a trace */
+bool pingpong_trace_open(pingpong_trace_cursor_t* cursor, const uint8_t* data, uint32_t length);
+
+/*
+ * Decodes the record at the cursor, its data points into the trace. Returns
+ * 1 for a record, 0 at the end of the trace and -1 if it is malformed or cut.
+ */
+int pingpong_trace_next(const uint8_t* data, uint32_t length, pingpong_trace_cursor_t* cursor,
+                        pingpong_trace_record_t* record);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PINGPONG_TRACE_H_ */
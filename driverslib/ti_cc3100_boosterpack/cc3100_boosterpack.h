@@ -50,11 +50,17 @@ int32_t wifi_restore(void);
 int32_t wifi_sleep(void);
 void wifi_wakeup(void);
 
+/* NWP RX aggregation, applied now when connected and by every wifi_init and wifi_wakeup */
+int32_t wifi_set_rx_aggregation(bool enable);
+bool wifi_get_rx_aggregation(void);
+
 bool stringToAddress(char* string, int* address);
 
 int16_t wifi_tcp_client_open(SlSockAddrIn_t* socket_address);
 int16_t wifi_tcp_client_send(int16_t socket_id, uint8_t* buffer, uint16_t length);
 int16_t wifi_tcp_client_receive(int16_t socket_id, uint8_t* buffer, uint16_t length);
+int16_t wifi_tcp_client_receive_timeout(int16_t socket_id, uint8_t* buffer, uint16_t length, uint32_t timeout_ms);
+int32_t wifi_select_receive(const int16_t* socket_ids, uint8_t count, uint32_t timeout_ms);
 
 int16_t wifi_udp_client_open(SlSockAddrIn_t* socket_address);
 int16_t wifi_udp_client_send(int16_t socket_id, SlSockAddrIn_t* socket_address, uint8_t* buffer, uint16_t length);
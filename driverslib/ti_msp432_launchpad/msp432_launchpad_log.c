@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#include "msp432_launchpad_log.h"
+#include "msp432_launchpad_timestamp.h"
+
+/* Not every project has driverslib/pingpong on its include path */
+#include "../pingpong/pingpong_log.h"
+
+#include "driverlib.h"
+
+#define LOG_MASK                ( MSP432_LAUNCHPAD_LOG_WORDS - 1 )
+
+// Written by the call sites (head) and by the drain (tail) only
+static uint32_t logRing[MSP432_LAUNCHPAD_LOG_WORDS];
+static volatile uint32_t logHead = 0;
+static volatile uint32_t logTail = 0;
+static volatile uint32_t logDropped = 0;
+
+// Drain side: dropped records already reported, and the clock of the last record
+static uint32_t logReported = 0;
+static uint32_t logCycles = 0;
+static uint32_t logUs = 0;
+
+static pingpong_log_batch_t logBatch;
+
+void msp432_launchpad_log_write(uint32_t header, uint32_t arg0, uint32_t arg1, uint32_t arg2)
+{
+    uint32_t timestamp, head, words;
+    bool masked;
+
+    timestamp = msp432_launchpad_timestamp_get();
+    words = 2 + (header >> 16);
+
+    // Only the copy is atomic, a handful of stores
+    masked = Interrupt_disableMaster();
+
+    head = logHead;
+    if (MSP432_LAUNCHPAD_LOG_WORDS - (head - logTail) < words)
+    {
+        logDropped++;
+    }
+    else
+    {
+        logRing[head & LOG_MASK] = header;
+        logRing[(head + 1) & LOG_MASK] = timestamp;
+        if (words > 2)
+        {
+            logRing[(head + 2) & LOG_MASK] = arg0;
+        }
+        if (words > 3)
+        {
+            logRing[(head + 3) & LOG_MASK] = arg1;
+        }
+        if (words > 4)
+        {
+            logRing[(head + 4) & LOG_MASK] = arg2;
+        }
+        logHead = head + words;
+    }
+
+    if (!masked)
+    {
+        Interrupt_enableMaster();
+    }
+}
+
+uint16_t msp432_launchpad_log_drain(uint8_t* frame)
+{
+    pingpong_log_record_t record;
+    uint32_t tail, head, header, cycles, us;
+    uint8_t i;
+
+    pingpong_log_batch_reset(&logBatch);
+
+    // Losses first, stamped with the time of the last record sent
+    if (logDropped != logReported)
+    {
+        record.id = PINGPONG_LOG_DROPPED;
+        record.argc = 1;
+        record.timestamp = logUs;
+        record.args[0] = logDropped - logReported;
+        pingpong_log_batch_add(&logBatch, &record);
+        logReported += record.args[0];
+    }
+
+    tail = logTail;
+    head = logHead;
+    while (tail != head)
+    {
+        header = logRing[tail & LOG_MASK];
+        record.id = (uint16_t) header;
+        record.argc = (uint8_t) (header >> 16);
+        for (i = 0; i < record.argc; i++)
+        {
+            record.args[i] = logRing[(tail + 2 + i) & LOG_MASK];
+        }
+
+        // Cycles to microseconds, carrying the remainder to the next record
+        cycles = logRing[(tail + 1) & LOG_MASK] - logCycles;
+        if ((int32_t) cycles < 0)
+        {
+            // Stamped just before an idle resync below, call it the same time
+            cycles = 0;
+        }
+        us = msp432_launchpad_timestamp_to_us(cycles);
+        record.timestamp = logUs + us;
+
+        if (!pingpong_log_batch_add(&logBatch, &record))
+        {
+            break;
+        }
+        logCycles += msp432_launchpad_timestamp_from_us(us);
+        logUs += us;
+        tail += 2 + record.argc;
+    }
+    logTail = tail;
+
+    if (logBatch.count == 0)
+    {
+        // Idle: keep the clock close so the cycle difference never wraps
+        cycles = msp432_launchpad_timestamp_get() - logCycles;
+        us = msp432_launchpad_timestamp_to_us(cycles);
+        logCycles += msp432_launchpad_timestamp_from_us(us);
+        logUs += us;
+        return 0;
+    }
+
+    return pingpong_log_frame(&logBatch, frame);
+}
+
+uint32_t msp432_launchpad_log_dropped(void)
+{
+    return logDropped;
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#ifndef MSP432_LAUNCHPAD_LOG_H_
+#define MSP432_LAUNCHPAD_LOG_H_
+
+#include <stdint.h>
+
+/*
+ * Deferred binary log. A call site stores a message id, the cycle counter
+ * and its raw arguments in a RAM ring and returns; nothing is formatted on
+ * the MCU. A low priority task drains the ring into pingpong_log frames and
+ * sends them with CLI_WriteBytes, host/log_decode turns them back into text.
+ *
+ * Writers (tasks or ISRs) mask interrupts only while they copy their few
+ * words, the drain reads without any lock. A full ring drops the record and
+ * the drain reports how many were lost.
+ */
+
+/* Ring size in 32-bit words, power of two. A record takes 2 to 5 words */
+#ifndef MSP432_LAUNCHPAD_LOG_WORDS
+#define MSP432_LAUNCHPAD_LOG_WORDS      ( 512 )
+#endif
+
+#define MSP432_LAUNCHPAD_LOG0(id)           msp432_launchpad_log_write((id), 0, 0, 0)
+#define MSP432_LAUNCHPAD_LOG1(id, a)        msp432_launchpad_log_write((id) | (1u << 16), \
+                                                (uint32_t) (a), 0, 0)
+#define MSP432_LAUNCHPAD_LOG2(id, a, b)     msp432_launchpad_log_write((id) | (2u << 16), \
+                                                (uint32_t) (a), (uint32_t) (b), 0)
+#define MSP432_LAUNCHPAD_LOG3(id, a, b, c)  msp432_launchpad_log_write((id) | (3u << 16), \
+                                                (uint32_t) (a), (uint32_t) (b), (uint32_t) (c))
+
+/* header is the message id in the low 16 bits and the argument count above */
+void msp432_launchpad_log_write(uint32_t header, uint32_t arg0, uint32_t arg1, uint32_t arg2);
+
+/*
+ * Moves as many records as fit into one frame of PINGPONG_LOG_FRAME_SIZE
+ * bytes. Returns the frame size, 0 if there was nothing to send.
+ */
+uint16_t msp432_launchpad_log_drain(uint8_t* frame);
+
+/* Records lost to a full ring since reset */
+uint32_t msp432_launchpad_log_dropped(void);
+
+#endif /* MSP432_LAUNCHPAD_LOG_H_ */
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#include "msp432_launchpad_timestamp.h"
+
+#include "driverlib.h"
+
+static uint32_t cyclesPerUs = 1;
+
+/* Timer32 reloads from cyclesPerSecond - 1, its interrupt counts the seconds */
+static uint32_t cyclesPerSecond = 1000000;
+static volatile uint32_t timestampSeconds = 0;
+
+void msp432_launchpad_timestamp_init(void)
+{
+    // Enable the trace unit and start the DWT cycle counter
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    // The counter runs at MCLK, read it after the clock system is set up
+    cyclesPerUs = MAP_CS_getMCLK() / 1000000;
+    if (cyclesPerUs == 0)
+    {
+        cyclesPerUs = 1;
+    }
+
+    // Timer32 module 0 in periodic mode at MCLK, one interrupt per second
+    cyclesPerSecond = cyclesPerUs * 1000000;
+    timestampSeconds = 0;
+    MAP_Timer32_initModule(TIMER32_0_BASE, TIMER32_PRESCALER_1, TIMER32_32BIT, TIMER32_PERIODIC_MODE);
+    MAP_Timer32_setCount(TIMER32_0_BASE, cyclesPerSecond - 1);
+    MAP_Timer32_clearInterruptFlag(TIMER32_0_BASE);
+    MAP_Timer32_enableInterrupt(TIMER32_0_BASE);
+    MAP_Interrupt_enableInterrupt(TIMER32_0_INTERRUPT);
+    MAP_Timer32_startTimer(TIMER32_0_BASE, false);
+}
+
+uint32_t msp432_launchpad_timestamp_get(void)
+{
+    return DWT->CYCCNT;
+}
+
+uint32_t msp432_launchpad_timestamp_to_us(uint32_t cycles)
+{
+    // Intervals must be computed as (end - start) before converting
+    return cycles / cyclesPerUs;
+}
+
+uint32_t msp432_launchpad_timestamp_from_us(uint32_t us)
+{
+    return us * cyclesPerUs;
+}
+
+uint32_t msp432_launchpad_timestamp_us(void)
+{
+    uint32_t seconds, pending, count;
+
+    // Read again if the second changed in between. A reload whose interrupt
+    // is not served yet (interrupts masked) is still pending, count it here
+    do
+    {
+        seconds = timestampSeconds;
+        pending = MAP_Timer32_getInterruptStatus(TIMER32_0_BASE);
+        count = MAP_Timer32_getValue(TIMER32_0_BASE);
+    } while (seconds != timestampSeconds ||
+             pending != MAP_Timer32_getInterruptStatus(TIMER32_0_BASE));
+
+    if (pending)
+    {
+        seconds++;
+    }
+
+    // Timer32 counts down, and the product wraps as the microseconds would
+    return seconds * 1000000 + (cyclesPerSecond - 1 - count) / cyclesPerUs;
+}
+
+void T32_INT1_IRQHandler(void)
+{
+    MAP_Timer32_clearInterruptFlag(TIMER32_0_BASE);
+    timestampSeconds++;
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#ifndef MSP432_LAUNCHPAD_TIMESTAMP_H_
+#define MSP432_LAUNCHPAD_TIMESTAMP_H_
+
+#include <stdint.h>
+
+/* Free-running CPU cycle counter (DWT CYCCNT), wraps every ~89 s at 48 MHz */
+void msp432_launchpad_timestamp_init(void);
+uint32_t msp432_launchpad_timestamp_get(void);
+uint32_t msp432_launchpad_timestamp_to_us(uint32_t cycles);
+uint32_t msp432_launchpad_timestamp_from_us(uint32_t us);
+
+/*
+ * Microseconds since msp432_launchpad_timestamp_init, wraps every ~71 min.
+ * Timer32 counts MCLK cycles within each second and its interrupt counts
+ * the seconds, so that the value is exact microseconds on all 32 bits.
+ */
+uint32_t msp432_launchpad_timestamp_us(void);
+
+#endif /* MSP432_LAUNCHPAD_TIMESTAMP_H_ */
@@ -1,24 +1,87 @@
 import socket
+import struct
+import sys
+import threading
 
-TCP_IP = '192.168.2.101'
-TCP_PORT = 5005
+# The board's network by default, 127.0.0.1 to serve host/ping_load
+TCP_IP = sys.argv[1] if len(sys.argv) > 1 else '192.168.2.101'
+TCP_PORT = int(sys.argv[2]) if len(sys.argv) > 2 else 5005
 BUFFER_SIZE = 256  # Normally 1024, but we want fast response
+PING_SIZE = 16  # Every PING is padded to 16 bytes by the client
 
+# Binary frames, see driverslib/pingpong/pingpong_frame.h
+FRAME_VERSION = 1
+FRAME_HEADER = struct.Struct('<BBHII')  # version, type, length, seq, timestamp
+FRAME_PING = 1
+FRAME_PONG = 2
 
-s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
-s.bind((TCP_IP, TCP_PORT))
-s.listen(1)
 
-while True:
+def text_pongs(pending, counter):
+    # Answer every complete 16-byte "PING <n>" with "PONG <n>", so that the
+    # client can match its PINGs; the per-connection counter if n is not all
+    # digits. host/echo_compare.sh checks that echo_server answers the same
+    pongs = []
+    while len(pending) >= PING_SIZE:
+        ping = pending[:PING_SIZE]
+        pending = pending[PING_SIZE:]
+        print "received data:", ping
+        text = ping.split("\0")[0]
+        seq = counter
+        if text.startswith("PING ") and text[5:].isdigit():
+            seq = int(text[5:])
+        pongs.append("PONG "+ str(seq) + "\0")
+        counter = counter + 1
+    return pongs, pending, counter
+
+
+def binary_pongs(pending, counter):
+    # Echo every complete frame back as a PONG with the same seq/timestamp/payload
+    pongs = []
+    while len(pending) >= FRAME_HEADER.size:
+        version, kind, length, seq, timestamp = FRAME_HEADER.unpack(pending[:FRAME_HEADER.size])
+        if version != FRAME_VERSION or kind != FRAME_PING:
+            raise ValueError("malformed frame")
+        if len(pending) < FRAME_HEADER.size + length:
+            break
+        payload = pending[FRAME_HEADER.size:FRAME_HEADER.size + length]
+        pending = pending[FRAME_HEADER.size + length:]
+        print "received frame:", seq
+        pongs.append(FRAME_HEADER.pack(FRAME_VERSION, FRAME_PONG, length, seq, timestamp) + payload)
+        counter = counter + 1
+    return pongs, pending, counter
+
+
+def serve(conn, addr):
     counter = 0
-    conn, addr = s.accept()
     print 'Connection address:', addr
+    pending = ""
+    handler = None
     while True:
         data = conn.recv(BUFFER_SIZE)
         if not data: break
-        print "received data:", data
-        echo_message = "PONG "+ str(counter) + "\0"
-        conn.send(echo_message )  # echo message
-        print "echoed message: ", echo_message
-        counter = counter + 1
+        # A pipelined client may have several PINGs in one segment
+        pending = pending + data
+        # Text PINGs start with 'P', binary frames with the version byte
+        if handler is None:
+            handler = binary_pongs if ord(pending[0]) == FRAME_VERSION else text_pongs
+        try:
+            pongs, pending, counter = handler(pending, counter)
+        except ValueError:
+            print "malformed frame, closing"
+            break
+        for echo_message in pongs:
+            conn.send(echo_message )  # echo message
+            print "echoed message: ", repr(echo_message)
     conn.close()
+
+
+s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+s.bind((TCP_IP, TCP_PORT))
+s.listen(8)
+
+# The client may open several connections at once, serve each in its own thread
+while True:
+    conn, addr = s.accept()
+    t = threading.Thread(target=serve, args=(conn, addr))
+    t.daemon = True
+    t.start()
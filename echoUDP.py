@@ -0,0 +1,56 @@
+import random
+import socket
+import struct
+
+UDP_IP = '192.168.2.101'
+UDP_PORT = 5005
+BUFFER_SIZE = 2048  # Header plus the largest payload
+
+# Binary frames, see driverslib/pingpong/pingpong_frame.h
+FRAME_VERSION = 1
+FRAME_HEADER = struct.Struct('<BBHII')  # version, type, length, seq, timestamp
+FRAME_PING = 1
+FRAME_PONG = 2
+
+# Impairments to exercise the client statistics, 0.0 = plain echo
+LOSS = 0.0  # Probability of dropping a PING
+DUPLICATE = 0.0  # Probability of answering a PING twice
+REORDER = 0.0  # Probability of holding a PONG back until the next one
+
+
+def pong(data):
+    # Echo the frame back as a PONG with the same seq/timestamp/payload
+    if len(data) < FRAME_HEADER.size:
+        raise ValueError("short frame")
+    version, kind, length, seq, timestamp = FRAME_HEADER.unpack(data[:FRAME_HEADER.size])
+    if version != FRAME_VERSION or kind != FRAME_PING or len(data) != FRAME_HEADER.size + length:
+        raise ValueError("malformed frame")
+    print "received frame:", seq
+    return FRAME_HEADER.pack(FRAME_VERSION, FRAME_PONG, length, seq, timestamp) + data[FRAME_HEADER.size:]
+
+
+s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+s.bind((UDP_IP, UDP_PORT))
+
+held = None
+while True:
+    data, addr = s.recvfrom(BUFFER_SIZE)
+    try:
+        echo_message = pong(data)
+    except ValueError:
+        print "malformed frame from", addr
+        continue
+    if random.random() < LOSS:
+        print "dropped"
+        continue
+    pongs = [echo_message]
+    if random.random() < DUPLICATE:
+        pongs.append(echo_message)
+    if held is not None:
+        pongs.append(held)
+        held = None
+    elif random.random() < REORDER:
+        held = pongs.pop(0)
+    for message in pongs:
+        s.sendto(message, addr)  # echo message
+        print "echoed message: ", repr(message)
@@ -0,0 +1,28 @@
+#!/bin/sh
+# Side-by-side benchmark of the epoll and io_uring engines of echo_server.
+#
+# Usage: ./bench_engines.sh [seconds] [window]
+# Runs echo_bench against each engine at 1, 100 and 10000 connections, on
+# loopback, with one server worker so both engines get the same core budget.
+# 10000 connections need a file descriptor limit above 10000 for both ends.
+
+set -e
+
+cd "$(dirname "$0")"
+make -s
+
+DURATION=${1:-5}
+WINDOW=${2:-1}
+PORT=5015
+
+for engine in epoll uring; do
+    ./echo_server -p $PORT -e $engine -t 1 -i 0 &
+    server=$!
+    sleep 0.5
+    for connections in 1 100 10000; do
+        printf '%-6s ' $engine
+        ./echo_bench -p $PORT -c $connections -d "$DURATION" -w "$WINDOW"
+    done
+    kill -INT $server
+    wait $server || true
+done
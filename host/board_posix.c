@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "board.h"
+#include "cli_uart.h"
+#include "msp432_launchpad_board.h"
+#include "task.h"
+
+/*
+ * The board services cc3100_boosterpack.c calls (CLI, LEDs, vTaskDelay)
+ * for the host build of the SimpleLink driver, printing to stdout instead
+ * of the UART. Shared by the links to nwp_sim and to a recorded trace.
+ * Also the driver's timestamp and, with SL_CMD_TRACE, its command trace,
+ * bigger than the board's so that a whole sl_ping -c run fits.
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#ifndef SL_CMD_TRACE_SIZE
+#define SL_CMD_TRACE_SIZE           ( 4096 )
+#endif
+
+/*----------------------------------------------------------------------------*/
+
+#if (SL_CMD_TRACE)
+static pingpong_cmdtrace_record_t cmdTraceRecords[SL_CMD_TRACE_SIZE];
+static pingpong_cmdtrace_t cmdTrace = { cmdTraceRecords, SL_CMD_TRACE_SIZE, 0 };
+static pthread_mutex_t cmdTraceMutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/*----------------------------------------------------------------------------*/
+
+void CLI_Configure(void)
+{
+}
+
+/*----------------------------------------------------------------------------*/
+
+int CLI_Write(unsigned char *inBuff)
+{
+    if (inBuff == NULL)
+    {
+        return -1;
+    }
+
+    fputs((const char*) inBuff, stdout);
+    fflush(stdout);
+
+    return (int) strlen((const char*) inBuff);
+}
+
+/*----------------------------------------------------------------------------*/
+
+void led_red_on(void)
+{
+    fputs("board: red LED on\n", stderr);
+}
+
+/*----------------------------------------------------------------------------*/
+
+void vTaskDelay( const TickType_t xTicksToDelay )
+{
+    struct timespec delay;
+
+    delay.tv_sec = xTicksToDelay / configTICK_RATE_HZ;
+    delay.tv_nsec = (long) (xTicksToDelay % configTICK_RATE_HZ) * (1000000000L / configTICK_RATE_HZ);
+    while (nanosleep(&delay, &delay) < 0 && errno == EINTR)
+    {
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+unsigned int GetTimestampUs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned int) ((uint64_t) now.tv_sec * 1000000u + (uint64_t) now.tv_nsec / 1000u);
+}
+
+/*----------------------------------------------------------------------------*/
+
+#if (SL_CMD_TRACE)
+void CmdTraceAdd(uint16_t Opcode, uint32_t Start, uint32_t Written, uint32_t Response, uint32_t Woken)
+{
+    pingpong_cmdtrace_record_t record;
+
+    record.opcode = Opcode;
+    record.start = Start;
+    record.written = Written;
+    record.response = Response;
+    record.woken = Woken;
+
+    pthread_mutex_lock(&cmdTraceMutex);
+    pingpong_cmdtrace_add(&cmdTrace, &record);
+    pthread_mutex_unlock(&cmdTraceMutex);
+}
+
+/*----------------------------------------------------------------------------*/
+
+bool CmdTraceRead(uint32_t *pSequence, pingpong_cmdtrace_record_t *pRecord)
+{
+    bool found;
+
+    pthread_mutex_lock(&cmdTraceMutex);
+    if ((int32_t) (*pSequence - pingpong_cmdtrace_first(&cmdTrace)) < 0)
+    {
+        *pSequence = pingpong_cmdtrace_first(&cmdTrace);
+    }
+    found = pingpong_cmdtrace_get(&cmdTrace, *pSequence, pRecord);
+    pthread_mutex_unlock(&cmdTraceMutex);
+
+    if (found)
+    {
+        (*pSequence)++;
+    }
+    return found;
+}
+
+/*----------------------------------------------------------------------------*/
+
+uint32_t CmdTraceCount(void)
+{
+    uint32_t added;
+
+    pthread_mutex_lock(&cmdTraceMutex);
+    added = cmdTrace.added;
+    pthread_mutex_unlock(&cmdTraceMutex);
+
+    return added;
+}
+
+/*----------------------------------------------------------------------------*/
+
+void CmdTraceClear(void)
+{
+    pthread_mutex_lock(&cmdTraceMutex);
+    pingpong_cmdtrace_reset(&cmdTrace, cmdTraceRecords, SL_CMD_TRACE_SIZE);
+    pthread_mutex_unlock(&cmdTraceMutex);
+}
+
+/*----------------------------------------------------------------------------*/
+#endif
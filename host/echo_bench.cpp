@@ -0,0 +1,393 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "pingpong_frame.h"
+#include "pingpong_histogram.h"
+
+/*
+ * Closed-loop throughput benchmark for echo_server.
+ *
+ * Opens N connections from a single epoll loop and keeps a fixed window of
+ * binary PINGs in flight on each one: every PONG that comes back is replaced
+ * by a new PING. At the end it prints the PONG rate and the RTT histogram in
+ * microseconds. bench_engines.sh runs it against both server engines.
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#define BENCH_ADDRESS           ( "127.0.0.1" )
+#define BENCH_PORT              ( 5005 )
+#define BENCH_CONNECTIONS       ( 1 )
+#define BENCH_DURATION_S        ( 5 )
+#define BENCH_WINDOW            ( 1 )
+#define BENCH_WINDOW_MAX        ( 64 )
+#define BENCH_READ_SIZE         ( 64 * 1024 )
+#define BENCH_EVENTS            ( 1024 )
+#define BENCH_WAIT_MS           ( 100 )
+
+/*----------------------------------------------------------------------------*/
+
+struct bench_connection_t
+{
+    int fd = -1;
+    uint32_t seq = 0;
+    unsigned in_flight = 0;
+
+    /* Bytes of a PONG split across reads */
+    std::vector<uint8_t> pending;
+};
+
+/*----------------------------------------------------------------------------*/
+
+static volatile sig_atomic_t stop = 0;
+
+/*----------------------------------------------------------------------------*/
+
+static void usage(const char* name);
+static void on_signal(int signal);
+static uint32_t now_us(void);
+static int connect_open(const struct sockaddr_in& addr);
+static bool bench_send(bench_connection_t& connection, unsigned window);
+static int bench_read(bench_connection_t& connection, uint8_t* buffer, pingpong_histogram_t& rtt);
+
+/*----------------------------------------------------------------------------*/
+
+int main(int argc, char** argv)
+{
+    const char* address = BENCH_ADDRESS;
+    uint16_t port = BENCH_PORT;
+    unsigned count = BENCH_CONNECTIONS;
+    unsigned duration = BENCH_DURATION_S;
+    unsigned window = BENCH_WINDOW;
+    std::vector<bench_connection_t> connections;
+    std::vector<uint8_t> buffer(BENCH_READ_SIZE);
+    struct epoll_event events[BENCH_EVENTS];
+    struct epoll_event event;
+    struct sockaddr_in addr;
+    struct rlimit limit;
+    pingpong_histogram_t rtt;
+    uint64_t pongs = 0;
+    char line[160];
+    int epoll_fd, option, ready, i, status;
+    unsigned n, failed = 0;
+
+    while ((option = getopt(argc, argv, "a:p:c:d:w:h")) != -1)
+    {
+        switch (option)
+        {
+        case 'a':
+            address = optarg;
+            break;
+        case 'p':
+            port = (uint16_t) atoi(optarg);
+            break;
+        case 'c':
+            count = (unsigned) atoi(optarg);
+            break;
+        case 'd':
+            duration = (unsigned) atoi(optarg);
+            break;
+        case 'w':
+            window = (unsigned) atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return (option == 'h') ? 0 : 1;
+        }
+    }
+    if (count == 0 || window == 0 || window > BENCH_WINDOW_MAX)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, address, &addr.sin_addr) != 1)
+    {
+        fprintf(stderr, "malformed address %s\n", address);
+        return 1;
+    }
+
+    /* One descriptor per connection, take everything we are allowed to */
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    signal(SIGPIPE, SIG_IGN);
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0)
+    {
+        perror("epoll_create1");
+        return 1;
+    }
+
+    /* Connect everything first so the measurement does not include the handshakes */
+    connections.resize(count);
+    for (n = 0; n < count; n++)
+    {
+        connections[n].fd = connect_open(addr);
+        if (connections[n].fd < 0)
+        {
+            fprintf(stderr, "connected %u of %u\n", n, count);
+            count = n;
+            connections.resize(count);
+            break;
+        }
+        event.events = EPOLLIN;
+        event.data.u32 = n;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, connections[n].fd, &event);
+    }
+    if (count == 0)
+    {
+        close(epoll_fd);
+        return 1;
+    }
+
+    pingpong_histogram_reset(&rtt);
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto end = start + std::chrono::seconds(duration);
+
+    for (n = 0; n < count; n++)
+    {
+        bench_send(connections[n], window);
+    }
+
+    while (!stop && std::chrono::steady_clock::now() < end)
+    {
+        ready = epoll_wait(epoll_fd, events, BENCH_EVENTS, BENCH_WAIT_MS);
+        for (i = 0; i < ready; i++)
+        {
+            bench_connection_t& connection = connections[events[i].data.u32];
+
+            status = bench_read(connection, buffer.data(), rtt);
+            if (status < 0 || !bench_send(connection, window))
+            {
+                /* The server dropped us, the other connections carry on */
+                epoll_ctl(epoll_fd, EPOLL_CTL_DEL, connection.fd, NULL);
+                close(connection.fd);
+                connection.fd = -1;
+                failed++;
+                continue;
+            }
+            pongs += (uint64_t) status;
+        }
+    }
+
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (n = 0; n < count; n++)
+    {
+        if (connections[n].fd >= 0)
+        {
+            close(connections[n].fd);
+        }
+    }
+    close(epoll_fd);
+
+    pingpong_histogram_format(&rtt, line, sizeof(line));
+    printf("connections=%u window=%u pongs=%llu pongs/s=%.0f failed=%u\n",
+           count, window, (unsigned long long) pongs, pongs / elapsed, failed);
+    printf("rtt us: %s\n", line);
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void usage(const char* name)
+{
+    fprintf(stderr,
+            "usage: %s [-a address] [-p port] [-c connections] [-d seconds] [-w window]\n"
+            "  -a  server address (default %s)\n"
+            "  -p  TCP port (default %u)\n"
+            "  -c  concurrent connections (default %u)\n"
+            "  -d  duration in seconds (default %u)\n"
+            "  -w  PINGs in flight per connection, 1 to %u (default %u)\n",
+            name, BENCH_ADDRESS, BENCH_PORT, BENCH_CONNECTIONS, BENCH_DURATION_S,
+            BENCH_WINDOW_MAX, BENCH_WINDOW);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void on_signal(int signal)
+{
+    (void) signal;
+    stop = 1;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static uint32_t now_us(void)
+{
+    /* Wraps every ~71 minutes, RTTs are computed modulo 2^32 */
+    return (uint32_t) std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*----------------------------------------------------------------------------*/
+
+static int connect_open(const struct sockaddr_in& addr)
+{
+    int fd, one = 1;
+
+    /* Blocking connect keeps the listen backlog from overflowing with 10k peers */
+    fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        perror("socket");
+        return -1;
+    }
+    if (connect(fd, (const struct sockaddr*) &addr, sizeof(addr)) < 0)
+    {
+        perror("connect");
+        close(fd);
+        return -1;
+    }
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    return fd;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static bool bench_send(bench_connection_t& connection, unsigned window)
+{
+    uint8_t frames[BENCH_WINDOW_MAX * PINGPONG_FRAME_HEADER_SIZE];
+    pingpong_frame_t frame;
+    uint32_t length = 0;
+    ssize_t sent;
+
+    /* Top the window up with a single write */
+    frame.type = PINGPONG_FRAME_PING;
+    frame.length = 0;
+    frame.payload = NULL;
+    frame.timestamp = now_us();
+    while (connection.in_flight < window)
+    {
+        frame.seq = connection.seq++;
+        length += pingpong_frame_encode(&frame, frames + length, sizeof(frames) - length);
+        connection.in_flight++;
+    }
+    if (length == 0)
+    {
+        return true;
+    }
+
+    /* A dozen bytes per PING never fill the socket buffer of a closed loop */
+    sent = send(connection.fd, frames, length, MSG_NOSIGNAL);
+    return (sent == (ssize_t) length);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static int bench_read(bench_connection_t& connection, uint8_t* buffer, pingpong_histogram_t& rtt)
+{
+    pingpong_frame_t frame;
+    const uint8_t* data;
+    uint32_t length, now;
+    int32_t used;
+    ssize_t received;
+    int pongs = 0;
+
+    received = recv(connection.fd, buffer, BENCH_READ_SIZE, MSG_DONTWAIT);
+    if (received == 0 || (received < 0 && errno != EAGAIN && errno != EINTR))
+    {
+        return -1;
+    }
+    if (received < 0)
+    {
+        return 0;
+    }
+
+    /* Glue the leftover of the previous read in front, if any */
+    if (!connection.pending.empty())
+    {
+        connection.pending.insert(connection.pending.end(), buffer, buffer + received);
+        data = connection.pending.data();
+        length = (uint32_t) connection.pending.size();
+    }
+    else
+    {
+        data = buffer;
+        length = (uint32_t) received;
+    }
+
+    now = now_us();
+    while ((used = pingpong_frame_decode(&frame, data, length)) > 0)
+    {
+        if (frame.type != PINGPONG_FRAME_PONG || connection.in_flight == 0)
+        {
+            return -1;
+        }
+        pingpong_histogram_record(&rtt, now - frame.timestamp);
+        connection.in_flight--;
+        data += used;
+        length -= (uint32_t) used;
+        pongs++;
+    }
+    if (used < 0)
+    {
+        return -1;
+    }
+
+    std::vector<uint8_t> rest(data, data + length);
+    connection.pending.swap(rest);
+
+    return pongs;
+}
@@ -0,0 +1,72 @@
+#!/bin/sh
+# Checks that echo_server answers exactly like echoTCP.py, the reference.
+#
+# Usage: ./echo_compare.sh
+# Sends the same PINGs to both servers, on loopback: numbered and malformed
+# text PINGs on one connection and binary frames on another, cut in odd
+# segments. The replies of each connection must be byte for byte the same.
+# echoTCP.py needs Python 2, set PYTHON if it is not python2.
+
+set -e
+
+cd "$(dirname "$0")"
+
+PYTHON=${PYTHON:-python2}
+PORT=5025
+
+if ! $PYTHON -c 'import sys; sys.exit(sys.version_info[0] != 2)' 2>/dev/null; then
+    echo "echo_compare: no Python 2 as $PYTHON, skipped"
+    exit 0
+fi
+
+REPLIES=$(mktemp -d)
+servers=
+trap 'kill $servers 2>/dev/null; wait; rm -rf "$REPLIES"' EXIT
+
+$PYTHON ../echoTCP.py 127.0.0.1 $PORT >/dev/null 2>&1 &
+servers="$servers $!"
+./echo_server -a 127.0.0.1 -p $((PORT + 1)) -t 1 -i 0 >/dev/null 2>&1 &
+servers="$servers $!"
+sleep 0.5
+
+# The client runs on the same Python as echoTCP.py, one file of replies per server
+cat > "$REPLIES/client.py" <<'EOF'
+import socket
+import struct
+import sys
+
+port = int(sys.argv[1])
+out = open(sys.argv[2], 'wb')
+
+def exchange(stream):
+    conn = socket.create_connection(('127.0.0.1', port), 5)
+    for i in range(0, len(stream), 7):
+        conn.sendall(stream[i:i + 7])
+    conn.shutdown(socket.SHUT_WR)
+    while True:
+        data = conn.recv(4096)
+        if not data:
+            break
+        out.write(data)
+    conn.close()
+
+# Text PINGs padded to 16 bytes, then those without a number to echo
+text = ['PING %d' % n for n in range(200)]
+text += ['PING', 'PING ', 'PING 7x', 'PING -3', 'PING  7', 'PING 7 8', 'PONG 5',
+         'PING 4294967296', 'PING 00042', 'XYZ', 'PING 12345678901']
+exchange(b''.join(t.encode('ascii').ljust(16, b'\0') for t in text) + b'PING 9')
+
+# Binary frames of every payload size up to 64 bytes
+header = struct.Struct('<BBHII')
+exchange(b''.join(header.pack(1, 1, n, 1000 + n, 7 * n) + b'\xa5' * n for n in range(65)))
+EOF
+
+$PYTHON "$REPLIES/client.py" $PORT "$REPLIES/echoTCP"
+$PYTHON "$REPLIES/client.py" $((PORT + 1)) "$REPLIES/echo_server"
+
+if ! cmp -s "$REPLIES/echoTCP" "$REPLIES/echo_server"; then
+    echo "echo_compare: echo_server and echoTCP.py replies differ" >&2
+    cmp "$REPLIES/echoTCP" "$REPLIES/echo_server" >&2 || true
+    exit 1
+fi
+echo "echo_compare: $(wc -c < "$REPLIES/echoTCP") bytes of replies, same as echoTCP.py"
@@ -0,0 +1,318 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "echo_server.h"
+
+/*----------------------------------------------------------------------------*/
+
+struct epoll_loop_t
+{
+    int epoll_fd;
+    int listen_fd;
+    const echo_config_t& config;
+    echo_stats_t& stats;
+    std::vector<echo_connection_t> connections;
+    std::vector<uint8_t> buffer;
+};
+
+/*----------------------------------------------------------------------------*/
+
+static void loop_accept(epoll_loop_t& loop);
+static bool loop_read(epoll_loop_t& loop, echo_connection_t& connection);
+static bool loop_flush(epoll_loop_t& loop, echo_connection_t& connection);
+static void loop_close(epoll_loop_t& loop, echo_connection_t& connection);
+
+/*----------------------------------------------------------------------------*/
+
+int echo_epoll_run(int listen_fd, const echo_config_t& config, echo_stats_t& stats,
+                   const std::atomic<bool>& stop)
+{
+    epoll_loop_t loop = { -1, listen_fd, config, stats, {}, {} };
+    struct epoll_event events[ECHO_EVENTS];
+    struct epoll_event event;
+    int count, i;
+
+    loop.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop.epoll_fd < 0)
+    {
+        perror("epoll_create1");
+        return -1;
+    }
+
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN | EPOLLET;
+    event.data.fd = listen_fd;
+    if (epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, listen_fd, &event) < 0)
+    {
+        perror("epoll_ctl");
+        close(loop.epoll_fd);
+        return -1;
+    }
+
+    loop.buffer.resize(ECHO_READ_SIZE);
+
+    while (!stop.load(std::memory_order_relaxed))
+    {
+        count = epoll_wait(loop.epoll_fd, events, ECHO_EVENTS, ECHO_WAIT_MS);
+        if (count < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            perror("epoll_wait");
+            break;
+        }
+
+        for (i = 0; i < count; i++)
+        {
+            if (events[i].data.fd == listen_fd)
+            {
+                loop_accept(loop);
+                continue;
+            }
+
+            echo_connection_t& connection = loop.connections[events[i].data.fd];
+            if (connection.fd < 0)
+            {
+                continue;
+            }
+
+            /* Edge triggered: every handler drains its side until EAGAIN */
+            if ((events[i].events & EPOLLOUT) && !loop_flush(loop, connection))
+            {
+                loop_close(loop, connection);
+                continue;
+            }
+            if ((events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP)) ||
+                (connection.read_blocked && connection.out.empty()))
+            {
+                if (!loop_read(loop, connection))
+                {
+                    loop_close(loop, connection);
+                }
+            }
+        }
+    }
+
+    for (echo_connection_t& connection : loop.connections)
+    {
+        if (connection.fd >= 0)
+        {
+            loop_close(loop, connection);
+        }
+    }
+    close(loop.epoll_fd);
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void loop_accept(epoll_loop_t& loop)
+{
+    struct epoll_event event;
+    int fd, one = 1;
+
+    for (;;)
+    {
+        fd = accept4(loop.listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+            {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                /* Out of descriptors, the next connection edge retries */
+                perror("accept4");
+            }
+            return;
+        }
+
+        /* PONGs are tiny and latency matters more than segment count */
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        if ((size_t) fd >= loop.connections.size())
+        {
+            loop.connections.resize(std::max<size_t>(fd + 1, loop.connections.size() * 2));
+        }
+
+        echo_connection_t& connection = loop.connections[fd];
+        connection.fd = fd;
+        connection.read_blocked = false;
+        connection.out_offset = 0;
+        connection.out.clear();
+        echo_session_reset(connection.session);
+
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.fd = fd;
+        if (epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0)
+        {
+            perror("epoll_ctl");
+            connection.fd = -1;
+            close(fd);
+            continue;
+        }
+
+        echo_stats_add(loop.stats.accepted, 1);
+        if (loop.config.verbose)
+        {
+            fprintf(stderr, "connection %d opened\n", fd);
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+static bool loop_read(epoll_loop_t& loop, echo_connection_t& connection)
+{
+    ssize_t length;
+    int pongs;
+
+    connection.read_blocked = false;
+
+    for (;;)
+    {
+        /* The peer does not read its PONGs, stop reading its PINGs */
+        if (connection.out.size() - connection.out_offset >= ECHO_OUT_LIMIT)
+        {
+            connection.read_blocked = true;
+            return true;
+        }
+
+        length = recv(connection.fd, loop.buffer.data(), loop.buffer.size(), 0);
+        if (length > 0)
+        {
+            echo_stats_add(loop.stats.bytes_in, length);
+
+            pongs = echo_session_feed(connection.session, loop.buffer.data(), length, connection.out);
+            if (pongs < 0)
+            {
+                return false;
+            }
+            echo_stats_add(loop.stats.pings, pongs);
+
+            /* One send answers every PING of this read */
+            if (!loop_flush(loop, connection))
+            {
+                return false;
+            }
+            continue;
+        }
+
+        if (length == 0)
+        {
+            return false;
+        }
+        if (errno == EINTR)
+        {
+            continue;
+        }
+
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+static bool loop_flush(epoll_loop_t& loop, echo_connection_t& connection)
+{
+    ssize_t length;
+
+    while (connection.out_offset < connection.out.size())
+    {
+        length = send(connection.fd, connection.out.data() + connection.out_offset,
+                      connection.out.size() - connection.out_offset, MSG_NOSIGNAL);
+        if (length > 0)
+        {
+            echo_stats_add(loop.stats.bytes_out, length);
+            connection.out_offset += length;
+            continue;
+        }
+
+        if (length < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        /* Socket buffer full, EPOLLOUT resumes */
+        return length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+
+    connection.out.clear();
+    connection.out_offset = 0;
+
+    return true;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void loop_close(epoll_loop_t& loop, echo_connection_t& connection)
+{
+    if (loop.config.verbose)
+    {
+        fprintf(stderr, "connection %d closed after %u PINGs\n",
+                connection.fd, connection.session.counter);
+    }
+
+    /* Closing the descriptor also removes it from the epoll set */
+    close(connection.fd);
+    connection.fd = -1;
+
+    /* Do not let one slow peer pin a large buffer forever */
+    connection.out.clear();
+    if (connection.out.capacity() > ECHO_READ_SIZE)
+    {
+        connection.out.shrink_to_fit();
+    }
+
+    echo_stats_add(loop.stats.closed, 1);
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,351 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "echo_server.h"
+
+/*----------------------------------------------------------------------------*/
+
+#define SERVER_ADDRESS          ( "0.0.0.0" )
+#define SERVER_PORT             ( 5005 )
+#define REPORT_INTERVAL_S       ( 1 )
+
+/*----------------------------------------------------------------------------*/
+
+static std::atomic<bool> stop(false);
+
+/*----------------------------------------------------------------------------*/
+
+static void usage(const char* name);
+static void on_signal(int signal);
+static void raise_file_limit(void);
+static int listen_open(const char* address, uint16_t port);
+static void worker(unsigned index, int listen_fd, const echo_config_t& config,
+                   echo_stats_t& stats, bool pin);
+static void report(const echo_stats_t* stats, unsigned workers, unsigned interval, bool verbose);
+
+/*----------------------------------------------------------------------------*/
+
+int main(int argc, char** argv)
+{
+    const char* address = SERVER_ADDRESS;
+    uint16_t port = SERVER_PORT;
+    unsigned interval = REPORT_INTERVAL_S;
+    unsigned workers = std::thread::hardware_concurrency();
+    bool pin = false;
+    echo_config_t config;
+    std::vector<int> listen_fds;
+    std::vector<std::thread> threads;
+    unsigned i;
+    int listen_fd, option;
+
+    while ((option = getopt(argc, argv, "a:p:e:i:t:cvh")) != -1)
+    {
+        switch (option)
+        {
+        case 'a':
+            address = optarg;
+            break;
+        case 'p':
+            port = (uint16_t) atoi(optarg);
+            break;
+        case 'i':
+            interval = (unsigned) atoi(optarg);
+            break;
+        case 'e':
+            if (strcmp(optarg, "epoll") != 0 && strcmp(optarg, "uring") != 0)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            config.uring = (strcmp(optarg, "uring") == 0);
+            break;
+        case 't':
+            workers = (unsigned) atoi(optarg);
+            break;
+        case 'c':
+            pin = true;
+            break;
+        case 'v':
+            config.verbose = true;
+            break;
+        default:
+            usage(argv[0]);
+            return (option == 'h') ? 0 : 1;
+        }
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    signal(SIGPIPE, SIG_IGN);
+
+    raise_file_limit();
+
+    if (config.uring && !echo_uring_supported())
+    {
+        fprintf(stderr, "io_uring is not available on this kernel, falling back to epoll\n");
+        config.uring = false;
+    }
+
+    if (workers == 0)
+    {
+        workers = 1;
+    }
+
+    /* One listener per worker, all bound before any of them starts accepting */
+    for (i = 0; i < workers; i++)
+    {
+        listen_fd = listen_open(address, port);
+        if (listen_fd < 0)
+        {
+            break;
+        }
+        listen_fds.push_back(listen_fd);
+    }
+    if (listen_fds.size() != workers)
+    {
+        for (int fd : listen_fds)
+        {
+            close(fd);
+        }
+        return 1;
+    }
+    fprintf(stderr, "listening on %s:%u with %u %s workers\n", address, port, workers,
+            config.uring ? "io_uring" : "epoll");
+
+    std::unique_ptr<echo_stats_t[]> stats(new echo_stats_t[workers]);
+
+    for (i = 0; i < workers; i++)
+    {
+        threads.emplace_back(worker, i, listen_fds[i], std::cref(config), std::ref(stats[i]), pin);
+    }
+
+    /* Printing is the reporter's job, the event loops never block on it */
+    if (interval > 0)
+    {
+        report(stats.get(), workers, interval, config.verbose);
+    }
+
+    for (i = 0; i < workers; i++)
+    {
+        threads[i].join();
+        close(listen_fds[i]);
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void usage(const char* name)
+{
+    fprintf(stderr,
+            "usage: %s [-a address] [-p port] [-e engine] [-t workers] [-c] [-i seconds] [-v]\n"
+            "  -a  address to listen on (default %s)\n"
+            "  -p  TCP port (default %u)\n"
+            "  -e  I/O engine, epoll or uring (default epoll, uring falls back to it)\n"
+            "  -t  worker threads (default one per core)\n"
+            "  -c  pin worker i to core i\n"
+            "  -i  stats interval in seconds, 0 = off (default %u)\n"
+            "  -v  log every connection and the stats of every worker\n",
+            name, SERVER_ADDRESS, SERVER_PORT, REPORT_INTERVAL_S);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void on_signal(int signal)
+{
+    (void) signal;
+    stop.store(true);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void raise_file_limit(void)
+{
+    struct rlimit limit;
+
+    /* One descriptor per connection, take everything we are allowed to */
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+static int listen_open(const char* address, uint16_t port)
+{
+    struct sockaddr_in addr;
+    int fd, one = 1;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, address, &addr.sin_addr) != 1)
+    {
+        fprintf(stderr, "malformed address %s\n", address);
+        return -1;
+    }
+
+    fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        perror("socket");
+        return -1;
+    }
+
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    /* Every worker binds the same port, the kernel balances connections among them */
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0)
+    {
+        perror("SO_REUSEPORT");
+        close(fd);
+        return -1;
+    }
+
+    if (bind(fd, (struct sockaddr*) &addr, sizeof(addr)) < 0 ||
+        listen(fd, SOMAXCONN) < 0)
+    {
+        perror("bind");
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void worker(unsigned index, int listen_fd, const echo_config_t& config,
+                   echo_stats_t& stats, bool pin)
+{
+    cpu_set_t cpus;
+    int status;
+
+    if (pin)
+    {
+        CPU_ZERO(&cpus);
+        CPU_SET(index % std::thread::hardware_concurrency(), &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    }
+
+    /* A worker that cannot run takes the others down with it */
+    status = config.uring ? echo_uring_run(listen_fd, config, stats, stop)
+                          : echo_epoll_run(listen_fd, config, stats, stop);
+    if (status < 0)
+    {
+        stop.store(true);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void report(const echo_stats_t* stats, unsigned workers, unsigned interval, bool verbose)
+{
+    std::vector<uint64_t> last_pings(workers, 0);
+    uint64_t connections, pings, bytes_in, bytes_out, worker_connections, worker_pings;
+    uint64_t last_total = 0, last_in = 0, last_out = 0;
+    auto next = std::chrono::steady_clock::now();
+    unsigned i;
+
+    while (!stop.load())
+    {
+        next += std::chrono::seconds(interval);
+        while (!stop.load() && std::chrono::steady_clock::now() < next)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(ECHO_WAIT_MS));
+        }
+        if (stop.load())
+        {
+            break;
+        }
+
+        /* Each counter has a single writer, adding them up needs no lock */
+        connections = pings = bytes_in = bytes_out = 0;
+        for (i = 0; i < workers; i++)
+        {
+            worker_connections = stats[i].accepted.load(std::memory_order_relaxed) -
+                                 stats[i].closed.load(std::memory_order_relaxed);
+            worker_pings = stats[i].pings.load(std::memory_order_relaxed);
+
+            connections += worker_connections;
+            pings += worker_pings;
+            bytes_in += stats[i].bytes_in.load(std::memory_order_relaxed);
+            bytes_out += stats[i].bytes_out.load(std::memory_order_relaxed);
+
+            if (verbose)
+            {
+                fprintf(stderr, "  worker %u: connections=%lu pings/s=%lu\n", i,
+                        (unsigned long) worker_connections,
+                        (unsigned long) ((worker_pings - last_pings[i]) / interval));
+            }
+            last_pings[i] = worker_pings;
+        }
+
+        fprintf(stderr, "connections=%lu pings/s=%lu in=%lu B/s out=%lu B/s\n",
+                (unsigned long) connections,
+                (unsigned long) ((pings - last_total) / interval),
+                (unsigned long) ((bytes_in - last_in) / interval),
+                (unsigned long) ((bytes_out - last_out) / interval));
+
+        last_total = pings;
+        last_in = bytes_in;
+        last_out = bytes_out;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
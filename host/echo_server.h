@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef ECHO_SERVER_H_
+#define ECHO_SERVER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <vector>
+
+#include "echo_session.h"
+
+/*
+ * Native PING/PONG echo server, a drop-in replacement for echoTCP.py.
+ *
+ * Every worker thread runs its own I/O engine on its own SO_REUSEPORT
+ * listening socket, and the kernel spreads new connections among them, so
+ * workers share nothing. Connections
+ * live in a flat array indexed by file descriptor, so there is no lookup
+ * and no allocation on the hot path once a slot has been used. Nothing is
+ * logged per message: the loop only bumps counters, and a reporter thread
+ * prints them periodically.
+ */
+
+#define ECHO_READ_SIZE          ( 64 * 1024 )
+#define ECHO_EVENTS             ( 1024 )
+#define ECHO_WAIT_MS            ( 100 )
+
+/* Unsent PONGs above which a connection stops reading until the peer catches up */
+#define ECHO_OUT_LIMIT          ( 256 * 1024 )
+
+/*
+ * Counters of one event loop. Only the loop writes them, so plain relaxed
+ * stores are enough; any other thread may read them at any time. Each loop
+ * has its own cache line, the reporter adds them up.
+ */
+struct alignas(64) echo_stats_t
+{
+    std::atomic<uint64_t> accepted{0};
+    std::atomic<uint64_t> closed{0};
+    std::atomic<uint64_t> pings{0};
+    std::atomic<uint64_t> bytes_in{0};
+    std::atomic<uint64_t> bytes_out{0};
+};
+
+static inline void echo_stats_add(std::atomic<uint64_t>& counter, uint64_t value)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+struct echo_connection_t
+{
+    int fd = -1;
+
+    /* Stopped reading because too many PONGs are waiting to be sent */
+    bool read_blocked = false;
+
+    echo_session_t session;
+
+    /* PONGs not accepted by the socket yet, almost always empty */
+    std::vector<uint8_t> out;
+    size_t out_offset = 0;
+};
+
+struct echo_config_t
+{
+    /* Log every connection and disconnection */
+    bool verbose = false;
+
+    /* Run the io_uring engine instead of epoll */
+    bool uring = false;
+};
+
+/*
+ * Serves listen_fd (non-blocking, already listening) until stop is set.
+ * Returns 0, or -1 if the engine could not be set up.
+ */
+int echo_epoll_run(int listen_fd, const echo_config_t& config, echo_stats_t& stats,
+                   const std::atomic<bool>& stop);
+
+/* Same contract, on io_uring. Only run it when echo_uring_supported() says so */
+bool echo_uring_supported(void);
+int echo_uring_run(int listen_fd, const echo_config_t& config, echo_stats_t& stats,
+                   const std::atomic<bool>& stop);
+
+#endif /* ECHO_SERVER_H_ */
@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "echo_session.h"
+#include "pingpong_frame.h"
+
+/*----------------------------------------------------------------------------*/
+
+static int session_parse(echo_session_t& session, const uint8_t* data, size_t length,
+                         size_t& used, std::vector<uint8_t>& out);
+static int session_text(echo_session_t& session, const uint8_t* data, size_t length,
+                        size_t& used, std::vector<uint8_t>& out);
+static int session_binary(echo_session_t& session, const uint8_t* data, size_t length,
+                          size_t& used, std::vector<uint8_t>& out);
+
+/*----------------------------------------------------------------------------*/
+
+void echo_session_reset(echo_session_t& session)
+{
+    session.protocol = ECHO_PROTOCOL_UNKNOWN;
+    session.counter = 0;
+
+    /* Keep the capacity, the slot is reused by the next connection */
+    session.pending.clear();
+}
+
+/*----------------------------------------------------------------------------*/
+
+int echo_session_feed(echo_session_t& session, const uint8_t* data, size_t length,
+                      std::vector<uint8_t>& out)
+{
+    size_t used = 0;
+    int pongs;
+
+    if (length == 0)
+    {
+        return 0;
+    }
+
+    /* Text PINGs start with 'P', binary frames with the version byte */
+    if (session.protocol == ECHO_PROTOCOL_UNKNOWN)
+    {
+        session.protocol = (data[0] == PINGPONG_FRAME_VERSION) ? ECHO_PROTOCOL_BINARY
+                                                                : ECHO_PROTOCOL_TEXT;
+    }
+
+    /* Common case: nothing left over, parse straight from the read buffer */
+    if (session.pending.empty())
+    {
+        pongs = session_parse(session, data, length, used, out);
+        if (pongs >= 0 && used < length)
+        {
+            session.pending.assign(data + used, data + length);
+        }
+        return pongs;
+    }
+
+    session.pending.insert(session.pending.end(), data, data + length);
+    pongs = session_parse(session, session.pending.data(), session.pending.size(), used, out);
+    session.pending.erase(session.pending.begin(), session.pending.begin() + used);
+
+    return pongs;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static int session_parse(echo_session_t& session, const uint8_t* data, size_t length,
+                         size_t& used, std::vector<uint8_t>& out)
+{
+    if (session.protocol == ECHO_PROTOCOL_BINARY)
+    {
+        return session_binary(session, data, length, used, out);
+    }
+
+    return session_text(session, data, length, used, out);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static int session_text(echo_session_t& session, const uint8_t* data, size_t length,
+                        size_t& used, std::vector<uint8_t>& out)
+{
+    char ping[ECHO_PING_SIZE + 1];
+    char pong[24];
+    char* end;
+    unsigned long seq;
+    int pongs = 0;
+    int size;
+
+    while (length - used >= ECHO_PING_SIZE)
+    {
+        /* "PING <n>" gets "PONG <n>", anything else the PINGs counted so far */
+        memcpy(ping, &data[used], ECHO_PING_SIZE);
+        ping[ECHO_PING_SIZE] = '\0';
+        used += ECHO_PING_SIZE;
+
+        seq = session.counter;
+        if (strncmp(ping, "PING ", 5) == 0)
+        {
+            seq = strtoul(&ping[5], &end, 10);
+            /* Digits only, as echoTCP.py: no sign, spaces or trailing text */
+            if (ping[5] < '0' || ping[5] > '9' || *end != '\0')
+            {
+                seq = session.counter;
+            }
+        }
+
+        size = snprintf(pong, sizeof(pong), "PONG %lu", seq);
+        out.insert(out.end(), pong, pong + size + 1);
+
+        session.counter++;
+        pongs++;
+    }
+
+    return pongs;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static int session_binary(echo_session_t& session, const uint8_t* data, size_t length,
+                          size_t& used, std::vector<uint8_t>& out)
+{
+    pingpong_frame_t frame;
+    int32_t size;
+    size_t start;
+    int pongs = 0;
+
+    while ((size = pingpong_frame_decode(&frame, data + used, length - used)) > 0)
+    {
+        if (frame.type != PINGPONG_FRAME_PING)
+        {
+            return -1;
+        }
+        used += size;
+
+        /* Same header and payload, only the type changes */
+        frame.type = PINGPONG_FRAME_PONG;
+        start = out.size();
+        out.resize(start + size);
+        pingpong_frame_encode(&frame, out.data() + start, size);
+
+        session.counter++;
+        pongs++;
+    }
+
+    return (size < 0) ? -1 : pongs;
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef ECHO_SESSION_H_
+#define ECHO_SESSION_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+/*
+ * Server side of the PING/PONG protocol, independent of any I/O engine.
+ *
+ * Behaves exactly like echoTCP.py: the first byte of a connection tells the
+ * protocol apart. Text PINGs are 16 bytes ("PING %d" padded with zeros) and
+ * are answered with "PONG <n>\0", n the number of the PING, or the count of
+ * PINGs of the connection when the PING is not "PING " and digits only.
+ * Binary frames (driverslib/pingpong/pingpong_frame.h) are echoed back as
+ * PONGs with the same sequence number, timestamp and payload.
+ *
+ * A stream may be split or coalesced anywhere; the incomplete tail of a
+ * read is kept in the session until the rest arrives.
+ */
+
+#define ECHO_PING_SIZE          ( 16 )
+
+enum echo_protocol_t : uint8_t
+{
+    ECHO_PROTOCOL_UNKNOWN,
+    ECHO_PROTOCOL_TEXT,
+    ECHO_PROTOCOL_BINARY,
+};
+
+struct echo_session_t
+{
+    echo_protocol_t protocol = ECHO_PROTOCOL_UNKNOWN;
+    uint32_t counter = 0;
+    std::vector<uint8_t> pending;
+};
+
+void echo_session_reset(echo_session_t& session);
+
+/*
+ * Appends the PONGs that answer every complete PING in data to out. Returns
+ * the number of PINGs answered, or -1 if the peer sent a malformed frame and
+ * the connection should be closed.
+ */
+int echo_session_feed(echo_session_t& session, const uint8_t* data, size_t length,
+                      std::vector<uint8_t>& out);
+
+#endif /* ECHO_SESSION_H_ */
@@ -0,0 +1,737 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <linux/io_uring.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+#include "echo_server.h"
+
+/*
+ * io_uring engine, driven through the raw system calls (no liburing).
+ *
+ * One multishot accept stays armed on the listener and one multishot recv on
+ * every connection. Received data lands in a ring of provided buffers that is
+ * refilled as soon as the PONGs of a buffer have been built. PONGs produced
+ * while a send is in flight accumulate in echo_connection_t::out; the sends of
+ * every connection are queued while completions are processed and submitted
+ * together with the next wait, one system call per loop iteration.
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#define URING_ENTRIES           ( 4096 )
+#define URING_CQ_ENTRIES        ( 4 * URING_ENTRIES )
+#define URING_BUFFERS           ( 4096 )
+#define URING_BUFFER_SIZE       ( 4096 )
+#define URING_BUFFER_GROUP      ( 0 )
+
+/* Multishot recv with provided buffer rings, the newest feature used */
+#define URING_KERNEL_MAJOR      ( 6 )
+#define URING_KERNEL_MINOR      ( 0 )
+
+/* Operation in the upper bits of user_data, descriptor in the lower ones */
+#define URING_OP_ACCEPT         ( 1ull << 32 )
+#define URING_OP_RECV           ( 2ull << 32 )
+#define URING_OP_SEND           ( 3ull << 32 )
+#define URING_OP_CANCEL         ( 4ull << 32 )
+#define URING_OP_MASK           ( 0xffull << 32 )
+
+/*----------------------------------------------------------------------------*/
+
+struct uring_connection_t
+{
+    echo_connection_t base;
+
+    /* PONGs owned by the kernel while a send is in flight */
+    std::vector<uint8_t> sending;
+
+    bool recv_armed = false;
+    bool send_armed = false;
+    bool flush_queued = false;
+    bool cancelling = false;
+    bool closing = false;
+};
+
+struct uring_loop_t
+{
+    int ring_fd;
+    int listen_fd;
+    const echo_config_t& config;
+    echo_stats_t& stats;
+
+    /* Submission queue */
+    uint8_t* sq_ring = NULL;
+    size_t sq_ring_size = 0;
+    uint32_t* sq_head = NULL;
+    uint32_t* sq_tail = NULL;
+    uint32_t sq_mask = 0;
+    uint32_t sq_entries = 0;
+    uint32_t* sq_array = NULL;
+    struct io_uring_sqe* sqes = NULL;
+    size_t sqes_size = 0;
+    uint32_t sq_local_tail = 0;
+
+    /* Completion queue, shares the mapping of the submission queue */
+    uint8_t* cq_ring = NULL;
+    size_t cq_ring_size = 0;
+    uint32_t* cq_head = NULL;
+    uint32_t* cq_tail = NULL;
+    uint32_t cq_mask = 0;
+    struct io_uring_cqe* cqes = NULL;
+
+    /* Provided buffers */
+    struct io_uring_buf_ring* buffer_ring = NULL;
+    size_t buffer_ring_size = 0;
+    uint8_t* buffers = NULL;
+    uint16_t buffer_tail = 0;
+
+    std::vector<uring_connection_t> connections = {};
+
+    /* Connections with PONGs waiting for a send */
+    std::vector<int> flush = {};
+};
+
+/*----------------------------------------------------------------------------*/
+
+static int uring_setup(uring_loop_t& loop);
+static void uring_teardown(uring_loop_t& loop);
+static struct io_uring_sqe* uring_sqe(uring_loop_t& loop);
+static int uring_enter(uring_loop_t& loop, uint32_t wait);
+static void uring_buffer_recycle(uring_loop_t& loop, uint16_t bid);
+static void uring_arm_accept(uring_loop_t& loop);
+static void uring_arm_recv(uring_loop_t& loop, uring_connection_t& connection);
+static void uring_arm_send(uring_loop_t& loop, uring_connection_t& connection);
+static void uring_cancel_recv(uring_loop_t& loop, uring_connection_t& connection);
+static void uring_on_accept(uring_loop_t& loop, const struct io_uring_cqe& cqe);
+static void uring_on_recv(uring_loop_t& loop, const struct io_uring_cqe& cqe);
+static void uring_on_send(uring_loop_t& loop, const struct io_uring_cqe& cqe);
+static void uring_close(uring_loop_t& loop, uring_connection_t& connection);
+static void uring_release(uring_loop_t& loop, uring_connection_t& connection);
+
+/*----------------------------------------------------------------------------*/
+
+bool echo_uring_supported(void)
+{
+    struct io_uring_params params;
+    struct utsname name;
+    int major = 0, minor = 0, fd;
+
+    if (uname(&name) != 0 || sscanf(name.release, "%d.%d", &major, &minor) != 2)
+    {
+        return false;
+    }
+    if (major < URING_KERNEL_MAJOR || (major == URING_KERNEL_MAJOR && minor < URING_KERNEL_MINOR))
+    {
+        return false;
+    }
+
+    /* Disabled by sysctl, seccomp or a container runtime */
+    memset(&params, 0, sizeof(params));
+    fd = (int) syscall(__NR_io_uring_setup, 2, &params);
+    if (fd < 0)
+    {
+        return false;
+    }
+    close(fd);
+
+    return (params.features & IORING_FEAT_EXT_ARG) && (params.features & IORING_FEAT_SINGLE_MMAP);
+}
+
+/*----------------------------------------------------------------------------*/
+
+int echo_uring_run(int listen_fd, const echo_config_t& config, echo_stats_t& stats,
+                   const std::atomic<bool>& stop)
+{
+    uring_loop_t loop{ -1, listen_fd, config, stats };
+    uint32_t head, tail;
+    int status = 0;
+
+    if (uring_setup(loop) < 0)
+    {
+        uring_teardown(loop);
+        return -1;
+    }
+
+    uring_arm_accept(loop);
+
+    while (!stop.load(std::memory_order_relaxed))
+    {
+        /* Queue the sends of every connection that produced PONGs */
+        for (int fd : loop.flush)
+        {
+            uring_connection_t& connection = loop.connections[fd];
+            connection.flush_queued = false;
+            if (!connection.send_armed && !connection.closing && !connection.base.out.empty())
+            {
+                uring_arm_send(loop, connection);
+            }
+        }
+        loop.flush.clear();
+
+        /* Submit everything queued and sleep until there is a completion */
+        status = uring_enter(loop, 1);
+        if (status < 0 && status != -EINTR && status != -ETIME && status != -EBUSY)
+        {
+            fprintf(stderr, "io_uring_enter: %s\n", strerror(-status));
+            break;
+        }
+        status = 0;
+
+        head = *loop.cq_head;
+        tail = __atomic_load_n(loop.cq_tail, __ATOMIC_ACQUIRE);
+        while (head != tail)
+        {
+            const struct io_uring_cqe& cqe = loop.cqes[head & loop.cq_mask];
+
+            switch (cqe.user_data & URING_OP_MASK)
+            {
+            case URING_OP_ACCEPT:
+                uring_on_accept(loop, cqe);
+                break;
+            case URING_OP_RECV:
+                uring_on_recv(loop, cqe);
+                break;
+            case URING_OP_SEND:
+                uring_on_send(loop, cqe);
+                break;
+            default:
+                break;
+            }
+
+            head++;
+        }
+        __atomic_store_n(loop.cq_head, head, __ATOMIC_RELEASE);
+
+        /* Hand the recycled buffers back to the kernel in one go */
+        __atomic_store_n(&loop.buffer_ring->tail, loop.buffer_tail, __ATOMIC_RELEASE);
+    }
+
+    for (uring_connection_t& connection : loop.connections)
+    {
+        if (connection.base.fd >= 0)
+        {
+            close(connection.base.fd);
+            echo_stats_add(stats.closed, 1);
+        }
+    }
+    uring_teardown(loop);
+
+    return status;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static int uring_setup(uring_loop_t& loop)
+{
+    struct io_uring_params params;
+    struct io_uring_buf_reg reg;
+    uint16_t bid;
+
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL |
+                   IORING_SETUP_COOP_TASKRUN | IORING_SETUP_SINGLE_ISSUER;
+    params.cq_entries = URING_CQ_ENTRIES;
+
+    loop.ring_fd = (int) syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+    if (loop.ring_fd < 0)
+    {
+        /* Older kernels reject the optional flags, the ring works without them */
+        memset(&params, 0, sizeof(params));
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = URING_CQ_ENTRIES;
+        loop.ring_fd = (int) syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+    }
+    if (loop.ring_fd < 0)
+    {
+        perror("io_uring_setup");
+        return -1;
+    }
+
+    /* One mapping for both rings (IORING_FEAT_SINGLE_MMAP) */
+    loop.sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    loop.cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (loop.cq_ring_size > loop.sq_ring_size)
+    {
+        loop.sq_ring_size = loop.cq_ring_size;
+    }
+    loop.sq_ring = (uint8_t*) mmap(NULL, loop.sq_ring_size, PROT_READ | PROT_WRITE,
+                                   MAP_SHARED | MAP_POPULATE, loop.ring_fd, IORING_OFF_SQ_RING);
+    if (loop.sq_ring == MAP_FAILED)
+    {
+        loop.sq_ring = NULL;
+        perror("mmap");
+        return -1;
+    }
+    loop.cq_ring = loop.sq_ring;
+
+    loop.sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    loop.sqes = (struct io_uring_sqe*) mmap(NULL, loop.sqes_size, PROT_READ | PROT_WRITE,
+                                            MAP_SHARED | MAP_POPULATE, loop.ring_fd, IORING_OFF_SQES);
+    if (loop.sqes == MAP_FAILED)
+    {
+        loop.sqes = NULL;
+        perror("mmap");
+        return -1;
+    }
+
+    loop.sq_head = (uint32_t*) (loop.sq_ring + params.sq_off.head);
+    loop.sq_tail = (uint32_t*) (loop.sq_ring + params.sq_off.tail);
+    loop.sq_mask = *(uint32_t*) (loop.sq_ring + params.sq_off.ring_mask);
+    loop.sq_entries = params.sq_entries;
+    loop.sq_array = (uint32_t*) (loop.sq_ring + params.sq_off.array);
+    loop.sq_local_tail = *loop.sq_tail;
+
+    loop.cq_head = (uint32_t*) (loop.cq_ring + params.cq_off.head);
+    loop.cq_tail = (uint32_t*) (loop.cq_ring + params.cq_off.tail);
+    loop.cq_mask = *(uint32_t*) (loop.cq_ring + params.cq_off.ring_mask);
+    loop.cqes = (struct io_uring_cqe*) (loop.cq_ring + params.cq_off.cqes);
+
+    /* Provided buffer ring, page aligned as the kernel requires */
+    loop.buffer_ring_size = URING_BUFFERS * sizeof(struct io_uring_buf);
+    loop.buffer_ring = (struct io_uring_buf_ring*) mmap(NULL, loop.buffer_ring_size,
+                                                        PROT_READ | PROT_WRITE,
+                                                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    loop.buffers = (uint8_t*) malloc((size_t) URING_BUFFERS * URING_BUFFER_SIZE);
+    if (loop.buffer_ring == MAP_FAILED || loop.buffers == NULL)
+    {
+        if (loop.buffer_ring == MAP_FAILED)
+        {
+            loop.buffer_ring = NULL;
+        }
+        fprintf(stderr, "out of memory for the io_uring buffers\n");
+        return -1;
+    }
+
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t) (uintptr_t) loop.buffer_ring;
+    reg.ring_entries = URING_BUFFERS;
+    reg.bgid = URING_BUFFER_GROUP;
+    if (syscall(__NR_io_uring_register, loop.ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+    {
+        perror("IORING_REGISTER_PBUF_RING");
+        return -1;
+    }
+
+    loop.buffer_tail = 0;
+    for (bid = 0; bid < URING_BUFFERS; bid++)
+    {
+        uring_buffer_recycle(loop, bid);
+    }
+    __atomic_store_n(&loop.buffer_ring->tail, loop.buffer_tail, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void uring_teardown(uring_loop_t& loop)
+{
+    if (loop.ring_fd >= 0)
+    {
+        close(loop.ring_fd);
+    }
+    if (loop.sqes != NULL)
+    {
+        munmap(loop.sqes, loop.sqes_size);
+    }
+    if (loop.sq_ring != NULL)
+    {
+        munmap(loop.sq_ring, loop.sq_ring_size);
+    }
+    if (loop.buffer_ring != NULL)
+    {
+        munmap(loop.buffer_ring, loop.buffer_ring_size);
+    }
+    free(loop.buffers);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static struct io_uring_sqe* uring_sqe(uring_loop_t& loop)
+{
+    struct io_uring_sqe* sqe;
+    uint32_t index;
+
+    /* Queue full, submit what is there without waiting */
+    if (loop.sq_local_tail - __atomic_load_n(loop.sq_head, __ATOMIC_ACQUIRE) >= loop.sq_entries)
+    {
+        uring_enter(loop, 0);
+    }
+
+    index = loop.sq_local_tail & loop.sq_mask;
+    sqe = &loop.sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    loop.sq_array[index] = index;
+    loop.sq_local_tail++;
+
+    return sqe;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static int uring_enter(uring_loop_t& loop, uint32_t wait)
+{
+    struct io_uring_getevents_arg arg;
+    struct __kernel_timespec timeout;
+    uint32_t submit;
+    long status;
+
+    submit = loop.sq_local_tail - *loop.sq_tail;
+    __atomic_store_n(loop.sq_tail, loop.sq_local_tail, __ATOMIC_RELEASE);
+
+    /* Wake up every ECHO_WAIT_MS at most to check the stop flag */
+    memset(&arg, 0, sizeof(arg));
+    timeout.tv_sec = 0;
+    timeout.tv_nsec = ECHO_WAIT_MS * 1000000L;
+    arg.ts = (uint64_t) (uintptr_t) &timeout;
+
+    status = syscall(__NR_io_uring_enter, loop.ring_fd, submit, wait,
+                     IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+
+    return (status < 0) ? -errno : (int) status;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void uring_buffer_recycle(uring_loop_t& loop, uint16_t bid)
+{
+    struct io_uring_buf* buffer;
+
+    /* Not buffer_ring->bufs: in C++ the header's flex array sits at offset 8 */
+    buffer = (struct io_uring_buf*) loop.buffer_ring + (loop.buffer_tail & (URING_BUFFERS - 1));
+    buffer->addr = (uint64_t) (uintptr_t) (loop.buffers + (size_t) bid * URING_BUFFER_SIZE);
+    buffer->len = URING_BUFFER_SIZE;
+    buffer->bid = bid;
+    loop.buffer_tail++;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void uring_arm_accept(uring_loop_t& loop)
+{
+    struct io_uring_sqe* sqe = uring_sqe(loop);
+
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = loop.listen_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    /* Blocking sockets: io_uring parks the request instead of failing with EAGAIN */
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = URING_OP_ACCEPT | (uint32_t) loop.listen_fd;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void uring_arm_recv(uring_loop_t& loop, uring_connection_t& connection)
+{
+    struct io_uring_sqe* sqe = uring_sqe(loop);
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = connection.base.fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUFFER_GROUP;
+    sqe->user_data = URING_OP_RECV | (uint32_t) connection.base.fd;
+
+    connection.recv_armed = true;
+    connection.base.read_blocked = false;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void uring_arm_send(uring_loop_t& loop, uring_connection_t& connection)
+{
+    struct io_uring_sqe* sqe;
+
+    /* The kernel owns the sending buffer until the completion arrives */
+    if (connection.base.out_offset == 0)
+    {
+        connection.sending.swap(connection.base.out);
+        connection.base.out.clear();
+    }
+
+    sqe = uring_sqe(loop);
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = connection.base.fd;
+    sqe->addr = (uint64_t) (uintptr_t) (connection.sending.data() + connection.base.out_offset);
+    sqe->len = (uint32_t) (connection.sending.size() - connection.base.out_offset);
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = URING_OP_SEND | (uint32_t) connection.base.fd;
+
+    connection.send_armed = true;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void uring_cancel_recv(uring_loop_t& loop, uring_connection_t& connection)
+{
+    struct io_uring_sqe* sqe = uring_sqe(loop);
+
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = URING_OP_RECV | (uint32_t) connection.base.fd;
+    sqe->user_data = URING_OP_CANCEL | (uint32_t) connection.base.fd;
+
+    connection.cancelling = true;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void uring_on_accept(uring_loop_t& loop, const struct io_uring_cqe& cqe)
+{
+    int fd = cqe.res, one = 1;
+
+    /* The kernel disarms a multishot accept on errors */
+    if (!(cqe.flags & IORING_CQE_F_MORE))
+    {
+        uring_arm_accept(loop);
+    }
+
+    if (fd < 0)
+    {
+        if (fd != -EAGAIN && fd != -ECONNABORTED)
+        {
+            fprintf(stderr, "accept: %s\n", strerror(-fd));
+        }
+        return;
+    }
+
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    if ((size_t) fd >= loop.connections.size())
+    {
+        loop.connections.resize(std::max<size_t>(fd + 1, loop.connections.size() * 2));
+    }
+
+    uring_connection_t& connection = loop.connections[fd];
+    connection.base.fd = fd;
+    connection.base.out_offset = 0;
+    connection.base.out.clear();
+    connection.sending.clear();
+    connection.send_armed = false;
+    connection.flush_queued = false;
+    connection.cancelling = false;
+    connection.closing = false;
+    echo_session_reset(connection.base.session);
+
+    uring_arm_recv(loop, connection);
+
+    echo_stats_add(loop.stats.accepted, 1);
+    if (loop.config.verbose)
+    {
+        fprintf(stderr, "connection %d opened\n", fd);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void uring_on_recv(uring_loop_t& loop, const struct io_uring_cqe& cqe)
+{
+    uring_connection_t& connection = loop.connections[(uint32_t) cqe.user_data];
+    uint16_t bid;
+    int pongs;
+
+    if (!(cqe.flags & IORING_CQE_F_MORE))
+    {
+        connection.recv_armed = false;
+    }
+
+    if (cqe.res > 0 && (cqe.flags & IORING_CQE_F_BUFFER))
+    {
+        bid = (uint16_t) (cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+
+        if (!connection.closing)
+        {
+            echo_stats_add(loop.stats.bytes_in, cqe.res);
+
+            /* The session copies what it keeps, the buffer goes straight back */
+            pongs = echo_session_feed(connection.base.session,
+                                      loop.buffers + (size_t) bid * URING_BUFFER_SIZE,
+                                      cqe.res, connection.base.out);
+            if (pongs < 0)
+            {
+                uring_close(loop, connection);
+            }
+            else
+            {
+                echo_stats_add(loop.stats.pings, pongs);
+            }
+        }
+        uring_buffer_recycle(loop, bid);
+
+        if (!connection.closing && !connection.base.out.empty())
+        {
+            if (!connection.flush_queued)
+            {
+                connection.flush_queued = true;
+                loop.flush.push_back(connection.base.fd);
+            }
+
+            /* The peer does not read its PONGs, stop reading its PINGs */
+            if (connection.base.out.size() >= ECHO_OUT_LIMIT && connection.recv_armed &&
+                !connection.cancelling)
+            {
+                uring_cancel_recv(loop, connection);
+            }
+        }
+    }
+    else if (cqe.res == 0 || (cqe.res < 0 && cqe.res != -ENOBUFS && cqe.res != -ECANCELED))
+    {
+        /* End of stream or socket error */
+        uring_close(loop, connection);
+    }
+
+    if (connection.recv_armed)
+    {
+        return;
+    }
+
+    if (connection.closing)
+    {
+        uring_release(loop, connection);
+    }
+    else if (connection.cancelling || connection.base.out.size() >= ECHO_OUT_LIMIT)
+    {
+        /* Re-armed once the pending PONGs are sent */
+        connection.cancelling = false;
+        connection.base.read_blocked = true;
+    }
+    else
+    {
+        /* Out of provided buffers, or the kernel ended the multishot */
+        uring_arm_recv(loop, connection);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void uring_on_send(uring_loop_t& loop, const struct io_uring_cqe& cqe)
+{
+    uring_connection_t& connection = loop.connections[(uint32_t) cqe.user_data];
+
+    connection.send_armed = false;
+
+    if (cqe.res < 0 || connection.closing)
+    {
+        uring_close(loop, connection);
+        uring_release(loop, connection);
+        return;
+    }
+
+    echo_stats_add(loop.stats.bytes_out, cqe.res);
+    connection.base.out_offset += cqe.res;
+
+    /* Short send, the rest goes out with the next submission */
+    if (connection.base.out_offset < connection.sending.size())
+    {
+        uring_arm_send(loop, connection);
+        return;
+    }
+    connection.base.out_offset = 0;
+    connection.sending.clear();
+
+    if (!connection.base.out.empty() && !connection.flush_queued)
+    {
+        connection.flush_queued = true;
+        loop.flush.push_back(connection.base.fd);
+    }
+
+    if (connection.base.read_blocked && connection.base.out.size() < ECHO_OUT_LIMIT)
+    {
+        uring_arm_recv(loop, connection);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void uring_close(uring_loop_t& loop, uring_connection_t& connection)
+{
+    (void) loop;
+
+    if (connection.closing)
+    {
+        return;
+    }
+    connection.closing = true;
+
+    /* Completes the armed recv and send, the descriptor is closed after them */
+    shutdown(connection.base.fd, SHUT_RDWR);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void uring_release(uring_loop_t& loop, uring_connection_t& connection)
+{
+    if (connection.recv_armed || connection.send_armed || connection.base.fd < 0)
+    {
+        return;
+    }
+
+    if (loop.config.verbose)
+    {
+        fprintf(stderr, "connection %d closed after %u PINGs\n",
+                connection.base.fd, connection.base.session.counter);
+    }
+
+    /* Only now may accept hand out the same descriptor again */
+    close(connection.base.fd);
+    connection.base.fd = -1;
+
+    connection.base.out.clear();
+    connection.sending.clear();
+    if (connection.base.out.capacity() > ECHO_READ_SIZE)
+    {
+        connection.base.out.shrink_to_fit();
+    }
+    if (connection.sending.capacity() > ECHO_READ_SIZE)
+    {
+        connection.sending.shrink_to_fit();
+    }
+
+    echo_stats_add(loop.stats.closed, 1);
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,566 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "board.h"
+#include "link_cc3100.h"
+#include "nwp_link.h"
+#include "pingpong_trace.h"
+
+/*
+ * SPI, nHIB and IRQ of the CC3100 for the host build of the SimpleLink
+ * driver, over the nwp_link socket to nwp_sim. A reader thread takes every
+ * frame nwp_sim sends: IRQs call the registered handler right there, as the
+ * GPIO interrupt does on the board, and READ_DATA completes the read the
+ * driver is blocked in. The driver never has two reads in flight, it only
+ * reads with its global lock held.
+ *
+ * With NWP_TRACE naming a file, every transaction and line event also goes
+ * there as a pingpong_trace.h trace, for link_replay.c to play back.
+ */
+
+/*----------------------------------------------------------------------------*/
+
+/* Trace records are written to the file whenever this much is buffered */
+#define LINK_TRACE_BUFFER       ( 65536 )
+
+/* Trace timestamps are in ns */
+#define LINK_TRACE_CLOCK_HZ     ( 1000000000u )
+
+/*----------------------------------------------------------------------------*/
+
+static int link_fd = -1;
+static pthread_t link_thread;
+
+/* Frames from different threads must not interleave */
+static pthread_mutex_t link_send_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_mutex_t link_irq_lock = PTHREAD_MUTEX_INITIALIZER;
+static P_EVENT_HANDLER link_irq_handler;
+static void* link_irq_value;
+
+/* The read in flight, completed by the reader thread */
+static pthread_mutex_t link_read_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t link_read_done = PTHREAD_COND_INITIALIZER;
+static unsigned char* link_read_buffer;
+static int link_read_length;
+static bool link_read_ready;
+static bool link_down;
+
+/* Bytes written between link_StartWriteSequence and link_EndWriteSequence */
+static unsigned char link_gather[NWP_LINK_MAX_LENGTH];
+static int link_gather_length;
+static bool link_gathering;
+
+static link_stats_t link_stats;
+
+/* IRQs come from the reader thread, the rest from the driver */
+static pthread_mutex_t link_trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static FILE* link_trace_file;
+static pingpong_trace_t link_trace;
+static uint8_t link_trace_buffer[LINK_TRACE_BUFFER];
+
+/*----------------------------------------------------------------------------*/
+
+static bool link_send(uint8_t kind, const unsigned char* data, int length);
+static void link_count_message(const unsigned char* data, int length);
+static bool link_recv_all(int fd, void* buffer, size_t length);
+static void* link_reader(void* arg);
+static void link_trace_open(void);
+static void link_trace_close(void);
+static void link_trace_add(uint8_t kind, const unsigned char* data, int length);
+
+/*----------------------------------------------------------------------------*/
+
+Fd_t link_Open(char *ifName, unsigned long flags)
+{
+    struct sockaddr_un addr;
+    const char* path = ifName;
+    int fd;
+
+    (void) flags;
+
+    if (path == NULL)
+    {
+        path = getenv(NWP_LINK_SOCKET_ENV);
+    }
+    if (path == NULL)
+    {
+        path = NWP_LINK_SOCKET;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return (Fd_t) -1;
+    }
+    if (connect(fd, (struct sockaddr*) &addr, sizeof(addr)) < 0)
+    {
+        fprintf(stderr, "link: cannot reach nwp_sim at %s: %s\n", path, strerror(errno));
+        close(fd);
+        return (Fd_t) -1;
+    }
+
+    link_fd = fd;
+    link_down = false;
+    link_gathering = false;
+    link_ResetStats();
+    link_trace_open();
+
+    if (pthread_create(&link_thread, NULL, link_reader, NULL) != 0)
+    {
+        close(fd);
+        link_fd = -1;
+        return (Fd_t) -1;
+    }
+
+    return (Fd_t) fd;
+}
+
+/*----------------------------------------------------------------------------*/
+
+int link_Close(Fd_t fd)
+{
+    (void) fd;
+
+    if (link_fd < 0)
+    {
+        return 0;
+    }
+
+    /* The reader sees the end of the stream and exits */
+    shutdown(link_fd, SHUT_RDWR);
+    pthread_join(link_thread, NULL);
+    close(link_fd);
+    link_fd = -1;
+    link_trace_close();
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
+int link_Read(Fd_t fd, unsigned char *pBuff, int len)
+{
+    bool ok;
+
+    (void) fd;
+
+    if (len <= 0)
+    {
+        return 0;
+    }
+
+    pthread_mutex_lock(&link_read_lock);
+    link_read_buffer = pBuff;
+    link_read_length = len;
+    link_read_ready = false;
+    pthread_mutex_unlock(&link_read_lock);
+
+    if (!link_send(NWP_LINK_READ, NULL, len))
+    {
+        return 0;
+    }
+
+    pthread_mutex_lock(&link_read_lock);
+    while (!link_read_ready && !link_down)
+    {
+        pthread_cond_wait(&link_read_done, &link_read_lock);
+    }
+    ok = link_read_ready;
+    link_read_buffer = NULL;
+    pthread_mutex_unlock(&link_read_lock);
+
+    if (!ok)
+    {
+        return 0;
+    }
+
+    link_stats.rx_transfers++;
+    link_stats.rx_bytes += (unsigned) len;
+    link_trace_add(PINGPONG_TRACE_READ, pBuff, len);
+
+    return len;
+}
+
+/*----------------------------------------------------------------------------*/
+
+int link_Write(Fd_t fd, unsigned char *pBuff, int len)
+{
+    int chunk, done = 0;
+
+    (void) fd;
+
+    if (!link_gathering)
+    {
+        /* Before sending, or it could come after the IRQ it causes */
+        link_trace_add(PINGPONG_TRACE_WRITE, pBuff, len);
+        if (!link_send(NWP_LINK_WRITE, pBuff, len))
+        {
+            return 0;
+        }
+        link_stats.tx_transfers++;
+        link_stats.tx_bytes += (unsigned) len;
+        link_count_message(pBuff, len);
+        return len;
+    }
+
+    /* nwp_sim takes writes as a stream, so an oversized message may be split */
+    while (done < len)
+    {
+        if (link_gather_length == NWP_LINK_MAX_LENGTH)
+        {
+            link_trace_add(PINGPONG_TRACE_WRITE, link_gather, link_gather_length);
+            if (!link_send(NWP_LINK_WRITE, link_gather, link_gather_length))
+            {
+                return 0;
+            }
+            link_gather_length = 0;
+        }
+        chunk = len - done;
+        if (chunk > NWP_LINK_MAX_LENGTH - link_gather_length)
+        {
+            chunk = NWP_LINK_MAX_LENGTH - link_gather_length;
+        }
+        memcpy(&link_gather[link_gather_length], &pBuff[done], (size_t) chunk);
+        link_gather_length += chunk;
+        done += chunk;
+    }
+    link_stats.tx_bytes += (unsigned) len;
+
+    return len;
+}
+
+/*----------------------------------------------------------------------------*/
+
+void link_StartWriteSequence(Fd_t fd)
+{
+    (void) fd;
+
+    link_gathering = true;
+    link_gather_length = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
+void link_EndWriteSequence(Fd_t fd)
+{
+    (void) fd;
+
+    link_gathering = false;
+    if (link_gather_length > 0)
+    {
+        link_trace_add(PINGPONG_TRACE_WRITE, link_gather, link_gather_length);
+        link_send(NWP_LINK_WRITE, link_gather, link_gather_length);
+        link_stats.tx_transfers++;
+    }
+    link_gather_length = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
+void link_GetStats(link_stats_t *stats)
+{
+    *stats = link_stats;
+}
+
+/*----------------------------------------------------------------------------*/
+
+void link_ResetStats(void)
+{
+    memset(&link_stats, 0, sizeof(link_stats));
+}
+
+/*----------------------------------------------------------------------------*/
+
+int registerInterruptHandler(P_EVENT_HANDLER InterruptHdl , void* pValue)
+{
+    pthread_mutex_lock(&link_irq_lock);
+    link_irq_handler = InterruptHdl;
+    link_irq_value = pValue;
+    pthread_mutex_unlock(&link_irq_lock);
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
+void CC3100_enable(void)
+{
+    link_trace_add(PINGPONG_TRACE_ENABLE, NULL, 0);
+    link_send(NWP_LINK_ENABLE, NULL, 0);
+}
+
+/*----------------------------------------------------------------------------*/
+
+void CC3100_disable(void)
+{
+    link_trace_add(PINGPONG_TRACE_DISABLE, NULL, 0);
+    link_send(NWP_LINK_DISABLE, NULL, 0);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void link_count_message(const unsigned char* data, int length)
+{
+    static const unsigned char cnys[4] = { 0x65, 0x87, 0x78, 0x56 };
+
+    /* The driver writes CNYS, on its own, before reading each message */
+    if (length == (int) sizeof(cnys) && memcmp(data, cnys, sizeof(cnys)) == 0)
+    {
+        link_stats.rx_messages++;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+static bool link_send(uint8_t kind, const unsigned char* data, int length)
+{
+    nwp_link_header_t header;
+    struct iovec iov[2];
+    struct msghdr msg;
+    size_t total;
+    ssize_t sent;
+
+    if (link_fd < 0)
+    {
+        return false;
+    }
+
+    header.kind = kind;
+    header.reserved = 0;
+    header.length = (uint16_t) length;
+
+    iov[0].iov_base = &header;
+    iov[0].iov_len = sizeof(header);
+    iov[1].iov_base = (void*) data;
+    iov[1].iov_len = (data != NULL) ? (size_t) length : 0;
+    total = iov[0].iov_len + iov[1].iov_len;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+
+    pthread_mutex_lock(&link_send_lock);
+    while (total > 0)
+    {
+        sent = sendmsg(link_fd, &msg, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (sent <= 0)
+        {
+            break;
+        }
+        total -= (size_t) sent;
+        while (msg.msg_iovlen > 0 && (size_t) sent >= msg.msg_iov->iov_len)
+        {
+            sent -= (ssize_t) msg.msg_iov->iov_len;
+            msg.msg_iov++;
+            msg.msg_iovlen--;
+        }
+        if (msg.msg_iovlen > 0)
+        {
+            msg.msg_iov->iov_base = (char*) msg.msg_iov->iov_base + sent;
+            msg.msg_iov->iov_len -= (size_t) sent;
+        }
+    }
+    pthread_mutex_unlock(&link_send_lock);
+
+    return total == 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static bool link_recv_all(int fd, void* buffer, size_t length)
+{
+    char* p = (char*) buffer;
+    ssize_t n;
+
+    while (length > 0)
+    {
+        n = recv(fd, p, length, 0);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        p += n;
+        length -= (size_t) n;
+    }
+
+    return true;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void* link_reader(void* arg)
+{
+    nwp_link_header_t header;
+    unsigned char discard[NWP_LINK_MAX_LENGTH];
+    P_EVENT_HANDLER handler;
+    void* value;
+    bool ok = true;
+
+    (void) arg;
+
+    while (ok && link_recv_all(link_fd, &header, sizeof(header)))
+    {
+        switch (header.kind)
+        {
+        case NWP_LINK_IRQ:
+            link_stats.irqs++;
+            link_trace_add(PINGPONG_TRACE_IRQ, NULL, 0);
+            pthread_mutex_lock(&link_irq_lock);
+            handler = link_irq_handler;
+            value = link_irq_value;
+            pthread_mutex_unlock(&link_irq_lock);
+            if (handler != NULL)
+            {
+                handler(value);
+            }
+            break;
+
+        case NWP_LINK_READ_DATA:
+            pthread_mutex_lock(&link_read_lock);
+            if (link_read_buffer != NULL && header.length == link_read_length)
+            {
+                ok = link_recv_all(link_fd, link_read_buffer, header.length);
+                link_read_ready = ok;
+                pthread_cond_signal(&link_read_done);
+            }
+            else
+            {
+                /* Nobody asked for these */
+                ok = link_recv_all(link_fd, discard, header.length);
+            }
+            pthread_mutex_unlock(&link_read_lock);
+            break;
+
+        default:
+            ok = (header.length <= sizeof(discard)) && link_recv_all(link_fd, discard, header.length);
+            break;
+        }
+    }
+
+    pthread_mutex_lock(&link_read_lock);
+    link_down = true;
+    pthread_cond_broadcast(&link_read_done);
+    pthread_mutex_unlock(&link_read_lock);
+
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void link_trace_open(void)
+{
+    const char* path = getenv(LINK_TRACE_ENV);
+
+    if (path == NULL || link_trace_file != NULL)
+    {
+        return;
+    }
+
+    link_trace_file = fopen(path, "wb");
+    if (link_trace_file == NULL)
+    {
+        fprintf(stderr, "link: cannot write the trace to %s: %s\n", path, strerror(errno));
+        return;
+    }
+
+    pingpong_trace_reset(&link_trace, link_trace_buffer, sizeof(link_trace_buffer), LINK_TRACE_CLOCK_HZ);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void link_trace_close(void)
+{
+    pthread_mutex_lock(&link_trace_lock);
+    if (link_trace_file != NULL)
+    {
+        fwrite(link_trace.buffer, 1, link_trace.length, link_trace_file);
+        fclose(link_trace_file);
+        link_trace_file = NULL;
+    }
+    pthread_mutex_unlock(&link_trace_lock);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void link_trace_add(uint8_t kind, const unsigned char* data, int length)
+{
+    struct timespec now;
+    uint32_t timestamp;
+
+    if (link_trace_file == NULL)
+    {
+        return;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    timestamp = (uint32_t) ((uint64_t) now.tv_sec * LINK_TRACE_CLOCK_HZ + (uint64_t) now.tv_nsec);
+
+    pthread_mutex_lock(&link_trace_lock);
+    if (!pingpong_trace_add(&link_trace, kind, timestamp, data, (uint32_t) length))
+    {
+        /* Full: save what is there and start over, the trace goes on in the file */
+        fwrite(link_trace.buffer, 1, link_trace.length, link_trace_file);
+        pingpong_trace_rewind(&link_trace);
+        pingpong_trace_add(&link_trace, kind, timestamp, data, (uint32_t) length);
+    }
+    pthread_mutex_unlock(&link_trace_lock);
+}
+
+/*----------------------------------------------------------------------------*/
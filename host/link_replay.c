@@ -0,0 +1,731 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "board.h"
+#include "link_cc3100.h"
+#include "pingpong_trace.h"
+
+/*
+ * The link_cc3100.c interface played back from a trace recorded by it (or
+ * by the board, see spi_TraceStart), so that the driver and whatever runs
+ * on top of it can be benchmarked without nwp_sim, the network or any of
+ * their timing in the way.
+ *
+ * The NWP side of the trace is replayed, the host side is executed:
+ *  - MISO: the bytes read after each CNYS make one message, the next
+ *    CNYS the driver writes gets the next message whatever the sizes of
+ *    its reads (past the end of the message they are zeros);
+ *  - IRQ: each one is tied to the number of commands (and nHIB releases)
+ *    the host had sent before it, and raised as soon as the driver has
+ *    sent as many, from the writing thread;
+ *  - MOSI: only the opcode of every command is checked against the trace,
+ *    a mismatch counts as a divergence.
+ * A driver waiting for an IRQ the trace ties to a command it never sends
+ * gets it anyway after LINK_REPLAY_IDLE_MS, also counted as a divergence.
+ *
+ * At link_Close, or when the driver wants more messages or IRQs than the
+ * trace has (the process then exits with 2), it prints the messages replayed per
+ * second and their cost in time, CPU time and TSC cycles.
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#define LINK_REPLAY_IDLE_MS     ( 200 )
+
+/* Header of the SimpleLink messages written by the host, and of CNYS */
+#define LINK_REPLAY_SYNC_LEN    ( 4 )
+#define LINK_REPLAY_HEADER_LEN  ( 8 )
+
+/*----------------------------------------------------------------------------*/
+
+typedef struct
+{
+    uint32_t offset;
+    uint32_t length;
+} replay_message_t;
+
+/*----------------------------------------------------------------------------*/
+
+static const uint8_t replay_sync[LINK_REPLAY_SYNC_LEN] = { 0x21, 0x43, 0x34, 0x12 };
+static const uint8_t replay_cnys[LINK_REPLAY_SYNC_LEN] = { 0x65, 0x87, 0x78, 0x56 };
+
+/* What the trace holds, split up by replay_load */
+static uint8_t* replay_miso;
+static replay_message_t* replay_messages;
+static uint32_t replay_message_count;
+static uint32_t* replay_irqs;
+static uint32_t replay_irq_count;
+static uint16_t* replay_opcodes;
+static uint32_t replay_opcode_count;
+static double replay_recorded_s;
+
+/* Where the driver is in it */
+static pthread_mutex_t replay_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t replay_activity = PTHREAD_COND_INITIALIZER;
+static uint32_t replay_anchors;
+static uint32_t replay_irq_next;
+static uint32_t replay_message_next;
+static const replay_message_t* replay_current;
+static uint32_t replay_current_offset;
+static uint32_t replay_commands;
+static unsigned long replay_divergences;
+static unsigned long replay_late_irqs;
+static unsigned long long replay_activity_count;
+static bool replay_open;
+static pthread_t replay_watchdog_thread;
+
+static P_EVENT_HANDLER replay_irq_handler;
+static void* replay_irq_value;
+
+/* Gathered between link_StartWriteSequence and link_EndWriteSequence */
+static uint8_t replay_gather[LINK_REPLAY_HEADER_LEN];
+static int replay_gather_length;
+static bool replay_gathering;
+
+static link_stats_t link_stats;
+
+/* Cost of the replay, from link_Open */
+static struct timespec replay_start_wall;
+static struct timespec replay_start_cpu;
+static unsigned long long replay_start_tsc;
+
+/*----------------------------------------------------------------------------*/
+
+static bool replay_load(const char* path);
+static uint8_t* replay_read_file(const char* path, uint32_t* length);
+static uint32_t replay_unhex(uint8_t* data, uint32_t length);
+static int replay_hex_digit(uint8_t c);
+static void replay_write(const uint8_t* data, int length);
+static void replay_anchor(void);
+static void replay_raise(uint32_t count);
+static void* replay_watchdog(void* arg);
+static void replay_report(void);
+static unsigned long long replay_tsc(void);
+static double replay_elapsed(const struct timespec* start, clockid_t clock);
+
+/*----------------------------------------------------------------------------*/
+
+Fd_t link_Open(char *ifName, unsigned long flags)
+{
+    const char* path = getenv(LINK_REPLAY_ENV);
+
+    (void) ifName;
+    (void) flags;
+
+    if (path == NULL)
+    {
+        fprintf(stderr, "link: %s must name the trace to replay\n", LINK_REPLAY_ENV);
+        return (Fd_t) -1;
+    }
+    if (replay_miso == NULL && !replay_load(path))
+    {
+        return (Fd_t) -1;
+    }
+
+    pthread_mutex_lock(&replay_lock);
+    replay_anchors = 0;
+    replay_irq_next = 0;
+    replay_message_next = 0;
+    replay_current = NULL;
+    replay_commands = 0;
+    replay_divergences = 0;
+    replay_late_irqs = 0;
+    replay_gathering = false;
+    replay_open = true;
+    pthread_mutex_unlock(&replay_lock);
+    link_ResetStats();
+
+    if (pthread_create(&replay_watchdog_thread, NULL, replay_watchdog, NULL) != 0)
+    {
+        replay_open = false;
+        return (Fd_t) -1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &replay_start_wall);
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &replay_start_cpu);
+    replay_start_tsc = replay_tsc();
+
+    return (Fd_t) 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
+int link_Close(Fd_t fd)
+{
+    (void) fd;
+
+    if (!replay_open)
+    {
+        return 0;
+    }
+
+    replay_report();
+
+    pthread_mutex_lock(&replay_lock);
+    replay_open = false;
+    pthread_cond_signal(&replay_activity);
+    pthread_mutex_unlock(&replay_lock);
+    pthread_join(replay_watchdog_thread, NULL);
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
+int link_Read(Fd_t fd, unsigned char *pBuff, int len)
+{
+    uint32_t available = 0;
+
+    (void) fd;
+
+    if (len <= 0)
+    {
+        return 0;
+    }
+
+    pthread_mutex_lock(&replay_lock);
+    if (replay_current != NULL)
+    {
+        available = replay_current->length - replay_current_offset;
+        if (available > (uint32_t) len)
+        {
+            available = (uint32_t) len;
+        }
+        memcpy(pBuff, &replay_miso[replay_current->offset + replay_current_offset], available);
+        replay_current_offset += available;
+    }
+    memset(&pBuff[available], 0, (size_t) len - available);
+    replay_activity_count++;
+    pthread_mutex_unlock(&replay_lock);
+
+    link_stats.rx_transfers++;
+    link_stats.rx_bytes += (unsigned) len;
+
+    return len;
+}
+
+/*----------------------------------------------------------------------------*/
+
+int link_Write(Fd_t fd, unsigned char *pBuff, int len)
+{
+    int chunk;
+
+    (void) fd;
+
+    link_stats.tx_bytes += (unsigned) len;
+
+    if (!replay_gathering)
+    {
+        link_stats.tx_transfers++;
+        replay_write(pBuff, len);
+        return len;
+    }
+
+    /* The header is all a message is checked on */
+    chunk = (int) sizeof(replay_gather) - replay_gather_length;
+    if (chunk > len)
+    {
+        chunk = len;
+    }
+    if (chunk > 0)
+    {
+        memcpy(&replay_gather[replay_gather_length], pBuff, (size_t) chunk);
+        replay_gather_length += chunk;
+    }
+
+    return len;
+}
+
+/*----------------------------------------------------------------------------*/
+
+void link_StartWriteSequence(Fd_t fd)
+{
+    (void) fd;
+
+    replay_gathering = true;
+    replay_gather_length = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
+void link_EndWriteSequence(Fd_t fd)
+{
+    (void) fd;
+
+    replay_gathering = false;
+    if (replay_gather_length > 0)
+    {
+        link_stats.tx_transfers++;
+        replay_write(replay_gather, replay_gather_length);
+    }
+    replay_gather_length = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
+void link_GetStats(link_stats_t *stats)
+{
+    *stats = link_stats;
+}
+
+/*----------------------------------------------------------------------------*/
+
+void link_ResetStats(void)
+{
+    memset(&link_stats, 0, sizeof(link_stats));
+}
+
+/*----------------------------------------------------------------------------*/
+
+int registerInterruptHandler(P_EVENT_HANDLER InterruptHdl , void* pValue)
+{
+    pthread_mutex_lock(&replay_lock);
+    replay_irq_handler = InterruptHdl;
+    replay_irq_value = pValue;
+    pthread_mutex_unlock(&replay_lock);
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
+void CC3100_enable(void)
+{
+    replay_anchor();
+}
+
+/*----------------------------------------------------------------------------*/
+
+void CC3100_disable(void)
+{
+}
+
+/*----------------------------------------------------------------------------*/
+
+static bool replay_load(const char* path)
+{
+    pingpong_trace_cursor_t cursor;
+    pingpong_trace_record_t record;
+    replay_message_t* message = NULL;
+    uint32_t length, miso = 0, anchors = 0, first = 0;
+    bool started = false;
+    uint8_t* trace;
+    int status;
+
+    trace = replay_read_file(path, &length);
+    if (trace == NULL)
+    {
+        return false;
+    }
+
+    /* A console capture of "trace dump": keep the hex of its trace lines */
+    if (!pingpong_trace_open(&cursor, trace, length))
+    {
+        length = replay_unhex(trace, length);
+        if (!pingpong_trace_open(&cursor, trace, length))
+        {
+            fprintf(stderr, "link: %s is not a trace\n", path);
+            free(trace);
+            return false;
+        }
+    }
+
+    /* Nothing in the trace is bigger than the trace, so it bounds every table */
+    replay_miso = (uint8_t*) malloc(length);
+    replay_messages = (replay_message_t*) calloc(length, sizeof(replay_message_t));
+    replay_irqs = (uint32_t*) calloc(length, sizeof(uint32_t));
+    replay_opcodes = (uint16_t*) calloc(length, sizeof(uint16_t));
+    if (replay_miso == NULL || replay_messages == NULL || replay_irqs == NULL || replay_opcodes == NULL)
+    {
+        fprintf(stderr, "link: out of memory for %s\n", path);
+        free(trace);
+        return false;
+    }
+
+    while ((status = pingpong_trace_next(trace, length, &cursor, &record)) > 0)
+    {
+        if (!started)
+        {
+            first = record.timestamp;
+            started = true;
+        }
+        replay_recorded_s = (double) (record.timestamp - first) / cursor.clock_hz;
+
+        switch (record.kind)
+        {
+        case PINGPONG_TRACE_WRITE:
+            if (record.length >= LINK_REPLAY_SYNC_LEN &&
+                memcmp(record.data, replay_cnys, LINK_REPLAY_SYNC_LEN) == 0)
+            {
+                message = &replay_messages[replay_message_count++];
+                message->offset = miso;
+                message->length = 0;
+            }
+            else if (record.length >= LINK_REPLAY_HEADER_LEN &&
+                     memcmp(record.data, replay_sync, LINK_REPLAY_SYNC_LEN) == 0)
+            {
+                replay_opcodes[replay_opcode_count++] = (uint16_t) (record.data[4] | (record.data[5] << 8));
+                anchors++;
+            }
+            break;
+
+        case PINGPONG_TRACE_READ:
+            /* Reads before the first CNYS have nothing to answer */
+            if (message != NULL)
+            {
+                memcpy(&replay_miso[miso], record.data, record.length);
+                miso += record.length;
+                message->length += record.length;
+            }
+            break;
+
+        case PINGPONG_TRACE_IRQ:
+            replay_irqs[replay_irq_count++] = anchors;
+            break;
+
+        case PINGPONG_TRACE_ENABLE:
+            anchors++;
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    free(trace);
+    if (status < 0)
+    {
+        fprintf(stderr, "link: %s is cut short, replaying what is there\n", path);
+    }
+    printf("replay trace=%s messages=%u irqs=%u commands=%u recorded_s=%.3f\n", path,
+           replay_message_count, replay_irq_count, replay_opcode_count, replay_recorded_s);
+
+    return true;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static uint8_t* replay_read_file(const char* path, uint32_t* length)
+{
+    FILE* file;
+    uint8_t* data = NULL;
+    size_t size = 0, used = 0, n;
+
+    file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        fprintf(stderr, "link: cannot read %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+
+    do
+    {
+        if (used == size)
+        {
+            size = (size == 0) ? 65536 : 2 * size;
+            data = (uint8_t*) realloc(data, size);
+            if (data == NULL)
+            {
+                fclose(file);
+                return NULL;
+            }
+        }
+        n = fread(&data[used], 1, size - used, file);
+        used += n;
+    } while (n > 0);
+
+    fclose(file);
+    *length = (uint32_t) used;
+
+    return data;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static uint32_t replay_unhex(uint8_t* data, uint32_t length)
+{
+    static const char prefix[] = "trace ";
+    uint32_t in = 0, out = 0, line;
+    int high, low;
+
+    /* In place, the binary is never longer than the text it comes from */
+    while (in < length)
+    {
+        line = in;
+        while (line < length && (data[line] == ' ' || data[line] == '\r'))
+        {
+            line++;
+        }
+
+        if (length - line > sizeof(prefix) - 1 && memcmp(&data[line], prefix, sizeof(prefix) - 1) == 0)
+        {
+            in = line + sizeof(prefix) - 1;
+            while (in + 1 < length)
+            {
+                high = replay_hex_digit(data[in]);
+                low = replay_hex_digit(data[in + 1]);
+                if (high < 0 || low < 0)
+                {
+                    break;
+                }
+                data[out++] = (uint8_t) ((high << 4) | low);
+                in += 2;
+            }
+        }
+
+        while (in < length && data[in] != '\n')
+        {
+            in++;
+        }
+        in++;
+    }
+
+    return out;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static int replay_hex_digit(uint8_t c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+
+    return -1;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void replay_write(const uint8_t* data, int length)
+{
+    uint16_t opcode;
+
+    if (length >= LINK_REPLAY_SYNC_LEN && memcmp(data, replay_cnys, LINK_REPLAY_SYNC_LEN) == 0)
+    {
+        pthread_mutex_lock(&replay_lock);
+        if (replay_message_next == replay_message_count)
+        {
+            pthread_mutex_unlock(&replay_lock);
+            fprintf(stderr, "link: the trace has no more messages\n");
+            replay_report();
+            exit(2);
+        }
+        replay_current = &replay_messages[replay_message_next++];
+        replay_current_offset = 0;
+        link_stats.rx_messages++;
+        replay_activity_count++;
+        pthread_mutex_unlock(&replay_lock);
+        return;
+    }
+
+    if (length >= LINK_REPLAY_HEADER_LEN && memcmp(data, replay_sync, LINK_REPLAY_SYNC_LEN) == 0)
+    {
+        opcode = (uint16_t) (data[4] | (data[5] << 8));
+
+        pthread_mutex_lock(&replay_lock);
+        if (replay_commands >= replay_opcode_count || replay_opcodes[replay_commands] != opcode)
+        {
+            replay_divergences++;
+        }
+        replay_commands++;
+        pthread_mutex_unlock(&replay_lock);
+
+        replay_anchor();
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void replay_anchor(void)
+{
+    uint32_t count = 0;
+
+    pthread_mutex_lock(&replay_lock);
+    replay_anchors++;
+    while (replay_irq_next + count < replay_irq_count && replay_irqs[replay_irq_next + count] <= replay_anchors)
+    {
+        count++;
+    }
+    replay_irq_next += count;
+    replay_activity_count++;
+    pthread_mutex_unlock(&replay_lock);
+
+    replay_raise(count);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void replay_raise(uint32_t count)
+{
+    P_EVENT_HANDLER handler;
+    void* value;
+
+    pthread_mutex_lock(&replay_lock);
+    handler = replay_irq_handler;
+    value = replay_irq_value;
+    pthread_mutex_unlock(&replay_lock);
+
+    /* As the reader thread of link_cc3100.c, without the lock held */
+    while (count-- > 0)
+    {
+        link_stats.irqs++;
+        if (handler != NULL)
+        {
+            handler(value);
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void* replay_watchdog(void* arg)
+{
+    unsigned long long seen = ~0ULL;
+    struct timespec deadline;
+    bool idle;
+
+    (void) arg;
+
+    pthread_mutex_lock(&replay_lock);
+    while (replay_open)
+    {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += LINK_REPLAY_IDLE_MS * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+        pthread_cond_timedwait(&replay_activity, &replay_lock, &deadline);
+
+        idle = replay_open && seen == replay_activity_count;
+        seen = replay_activity_count;
+        if (idle && replay_irq_next == replay_irq_count)
+        {
+            /* Nothing left to raise, the driver waits for what the trace does not have */
+            pthread_mutex_unlock(&replay_lock);
+            fprintf(stderr, "link: the trace has no more IRQs\n");
+            replay_report();
+            exit(2);
+        }
+        if (idle)
+        {
+            /* An IRQ is still due, the driver did not send what the trace ties it to */
+            replay_irq_next++;
+            replay_late_irqs++;
+            replay_divergences++;
+            pthread_mutex_unlock(&replay_lock);
+            replay_raise(1);
+            pthread_mutex_lock(&replay_lock);
+        }
+    }
+    pthread_mutex_unlock(&replay_lock);
+
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void replay_report(void)
+{
+    double wall, cpu;
+    unsigned long long cycles;
+    uint32_t messages;
+
+    wall = replay_elapsed(&replay_start_wall, CLOCK_MONOTONIC);
+    cpu = replay_elapsed(&replay_start_cpu, CLOCK_PROCESS_CPUTIME_ID);
+    cycles = replay_tsc() - replay_start_tsc;
+
+    pthread_mutex_lock(&replay_lock);
+    messages = replay_message_next;
+    pthread_mutex_unlock(&replay_lock);
+
+    if (messages == 0)
+    {
+        printf("replay messages=0\n");
+        return;
+    }
+
+    printf("replay messages=%u of=%u messages/s=%.0f ns/message=%.0f cpu_ns/message=%.0f "
+           "cycles/message=%.0f spi_reads/message=%.2f divergences=%lu late_irqs=%lu\n",
+           messages, replay_message_count, messages / wall, wall * 1e9 / messages,
+           cpu * 1e9 / messages, (double) cycles / messages,
+           (double) link_stats.rx_transfers / messages, replay_divergences, replay_late_irqs);
+    fflush(stdout);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static unsigned long long replay_tsc(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    /* No cycle counter to read, cycles/message stays at 0 */
+    return 0;
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+
+static double replay_elapsed(const struct timespec* start, clockid_t clock)
+{
+    struct timespec now;
+
+    clock_gettime(clock, &now);
+
+    return (double) (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*----------------------------------------------------------------------------*/
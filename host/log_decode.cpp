@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include <unistd.h>
+
+#include "pingpong_log.h"
+#include "ping_log.h"
+
+/*
+ * Decoder of the deferred binary log of the PingPong firmware.
+ *
+ * Reads the raw UART capture (a file, or stdin from the serial port set to
+ * 115200 8N1) and prints it back as text: plain CLI_Write output goes through
+ * untouched, and every pingpong_log frame between two 0x00 bytes becomes one
+ * timestamped line per record, formatted with the strings of ping_log.h.
+ *
+ * With -s it also tells how many bytes the same lines would have taken as
+ * CLI_Write text, to see what the binary log saves on the wire.
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#define DECODE_READ_SIZE        ( 4096 )
+
+/*----------------------------------------------------------------------------*/
+
+struct decode_stats_t
+{
+    uint64_t frames = 0;
+    uint64_t records = 0;
+    uint64_t errors = 0;
+    uint64_t frame_bytes = 0;
+    uint64_t text_bytes = 0;
+};
+
+/*----------------------------------------------------------------------------*/
+
+static const char* formats[PING_LOG_COUNT] = PING_LOG_FORMATS;
+
+/*----------------------------------------------------------------------------*/
+
+static void usage(const char* name);
+static void decode_frame(const std::vector<uint8_t>& data, uint64_t& clock, decode_stats_t& stats);
+
+/*----------------------------------------------------------------------------*/
+
+int main(int argc, char** argv)
+{
+    FILE* input = stdin;
+    bool summary = false;
+    std::vector<uint8_t> frame;
+    uint8_t buffer[DECODE_READ_SIZE];
+    decode_stats_t stats;
+    uint64_t clock = 0;
+    bool inside = false;
+    size_t length, i;
+    int option;
+
+    while ((option = getopt(argc, argv, "sh")) != -1)
+    {
+        switch (option)
+        {
+        case 's':
+            summary = true;
+            break;
+        default:
+            usage(argv[0]);
+            return (option == 'h') ? 0 : 1;
+        }
+    }
+    if (optind < argc)
+    {
+        input = fopen(argv[optind], "rb");
+        if (input == NULL)
+        {
+            perror(argv[optind]);
+            return 1;
+        }
+    }
+
+    /* Line buffered, so piping a live serial port shows every record at once */
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    while ((length = fread(buffer, 1, sizeof(buffer), input)) > 0)
+    {
+        for (i = 0; i < length; i++)
+        {
+            /* Text never contains 0x00: the first one opens a frame, the next one closes it */
+            if (buffer[i] == 0)
+            {
+                if (inside)
+                {
+                    decode_frame(frame, clock, stats);
+                    frame.clear();
+                }
+                inside = !inside;
+            }
+            else if (inside)
+            {
+                frame.push_back(buffer[i]);
+            }
+            else
+            {
+                putchar(buffer[i]);
+                stats.text_bytes++;
+            }
+        }
+    }
+
+    if (input != stdin)
+    {
+        fclose(input);
+    }
+
+    if (summary)
+    {
+        fprintf(stderr, "%llu frames, %llu records, %llu bad frames\n",
+                (unsigned long long) stats.frames, (unsigned long long) stats.records,
+                (unsigned long long) stats.errors);
+        fprintf(stderr, "binary log %llu bytes, as CLI_Write text %llu bytes (%.1fx)\n",
+                (unsigned long long) stats.frame_bytes, (unsigned long long) stats.text_bytes,
+                stats.frame_bytes ? (double) stats.text_bytes / stats.frame_bytes : 0.0);
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void usage(const char* name)
+{
+    fprintf(stderr,
+            "usage: %s [-s] [capture]\n"
+            "  capture  raw UART bytes (default stdin)\n"
+            "  -s       print frame counts and the size saved over text at the end\n",
+            name);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void decode_frame(const std::vector<uint8_t>& data, uint64_t& clock, decode_stats_t& stats)
+{
+    pingpong_log_batch_t batch;
+    pingpong_log_record_t record;
+    pingpong_log_cursor_t cursor;
+    uint32_t timestamp;
+    char line[256];
+    int status, length;
+
+    /* Two zeros in a row are the end of one frame and the start of the next */
+    if (data.empty())
+    {
+        return;
+    }
+
+    if (data.size() > PINGPONG_LOG_FRAME_SIZE ||
+        !pingpong_log_unframe(&batch, data.data(), (uint16_t) data.size()))
+    {
+        printf("[ bad frame of %zu bytes ]\n", data.size());
+        stats.errors++;
+        return;
+    }
+    stats.frames++;
+    stats.frame_bytes += data.size() + 2;
+
+    pingpong_log_cursor_reset(&cursor);
+    while ((status = pingpong_log_next(&batch, &cursor, &record)) > 0)
+    {
+        timestamp = record.timestamp;
+
+        /* Microseconds on 32 bits wrap every ~71 minutes, keep counting past that */
+        if (timestamp < (uint32_t) clock && (uint32_t) clock - timestamp > 0x80000000u)
+        {
+            clock += 0x100000000ull;
+        }
+        clock = (clock & ~0xFFFFFFFFull) | timestamp;
+
+        if (record.id < PING_LOG_COUNT)
+        {
+            length = snprintf(line, sizeof(line), formats[record.id],
+                              record.args[0], record.args[1], record.args[2]);
+        }
+        else
+        {
+            length = snprintf(line, sizeof(line), "unknown message %u", record.id);
+        }
+        printf("[%6llu.%06llu] %s\n", (unsigned long long) (clock / 1000000),
+               (unsigned long long) (clock % 1000000), line);
+
+        /* What CLI_Write(message) would have sent: the line plus " \n\r" */
+        stats.text_bytes += (uint64_t) length + 3;
+        stats.records++;
+    }
+    if (status < 0)
+    {
+        printf("[ malformed record ]\n");
+        stats.errors++;
+    }
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef NWP_LINK_H_
+#define NWP_LINK_H_
+
+#include <stdint.h>
+
+/*
+ * Wire format between the host build of the SimpleLink driver and nwp_sim,
+ * over a Unix stream socket. It stands for the SPI bus plus the nHIB and
+ * IRQ lines, nothing more: the SimpleLink protocol itself travels unchanged
+ * inside WRITE and READ_DATA frames.
+ *
+ * As on the board the host is the SPI master. A write is sent and forgotten,
+ * a read asks for a number of bytes and waits for exactly that many. The
+ * NWP answers reads from the message it is presenting, which changes when
+ * the host writes the CNYS pattern, and raises one IRQ per message queued,
+ * or per burst of them once the host has enabled RX aggregation.
+ */
+
+#define NWP_LINK_SOCKET         ( "/tmp/nwp_sim.sock" )
+#define NWP_LINK_SOCKET_ENV     ( "NWP_SIM_SOCKET" )
+
+/* A single SPI transaction never gets anywhere near this */
+#define NWP_LINK_MAX_LENGTH     ( 4096 )
+
+enum
+{
+    /* host -> NWP, MOSI bytes of one transaction */
+    NWP_LINK_WRITE = 1,
+    /* host -> NWP, no payload: length is the number of MISO bytes wanted */
+    NWP_LINK_READ = 2,
+    /* NWP -> host, the bytes of the pending read */
+    NWP_LINK_READ_DATA = 3,
+    /* NWP -> host, no payload: a message is waiting */
+    NWP_LINK_IRQ = 4,
+    /* host -> NWP, no payload: nHIB released / asserted */
+    NWP_LINK_ENABLE = 5,
+    NWP_LINK_DISABLE = 6,
+};
+
+typedef struct
+{
+    uint8_t kind;
+    uint8_t reserved;
+    uint16_t length;
+} nwp_link_header_t;
+
+#endif /* NWP_LINK_H_ */
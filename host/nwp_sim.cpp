@@ -0,0 +1,1332 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* Only the message layouts are wanted, not the BSD names over the real ones */
+#define SL_NO_BSD_API_NAMING
+/* simplelink.h closes one more extern "C" block than it opens, this is it */
+extern "C" {
+#include "simplelink.h"
+#include "protocol.h"
+
+#include "nwp_link.h"
+
+/*
+ * Simulated CC3100 network processor for the host build of the SimpleLink
+ * driver (link_cc3100.c).
+ *
+ * It speaks the SimpleLink SPI protocol as the driver sees it on the wire:
+ * H2N commands come in as MOSI bytes, N2H messages are queued, announced
+ * with one IRQ each and handed out on MISO after every CNYS. Once the host
+ * enables RX aggregation (SL_SET_HOST_RX_AGGR) a CNYS hands out every
+ * message queued by then, each with its own sync word, after one IRQ for
+ * all of them; the host finds the end of the burst by the padding. Sockets are
+ * bridged to real ones on this machine and the WLAN is always there, so
+ * the unmodified cc3100_boosterpack.c and PING/PONG logic run against
+ * echo_server without a board. Flow control follows the NWP: every header
+ * carries the free TX buffer count, and a DUMMY message refreshes it when
+ * the host runs low with nothing else to read.
+ *
+ * One host at a time; the counters are printed when it goes away.
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#define SIM_TX_POOL             ( 8 )
+#define SIM_TX_POOL_MAX         ( 255 )
+/* The host holds data operations back from FLOW_CONT_MIN + 1 buffers down */
+#define SIM_TX_POOL_LOW         ( 2 )
+/* The MSS, the most a single RECV hands back */
+#define SIM_RECV_MAX            ( 1460 )
+#define SIM_POLL_FDS            ( 2 + SL_MAX_SOCKETS )
+#define SIM_SELECT_FOREVER      ( 0xffff )
+#define SIM_DEFAULT_RESPONSE    ( 64 )
+/* Most bytes of messages an aggregated burst carries, more go in the next */
+#define SIM_BURST_MAX           ( 2048 )
+
+#define SIM_ALIGN(length)       ( ((length) + 3) & ~3 )
+
+/*----------------------------------------------------------------------------*/
+
+struct sim_socket_t
+{
+    int fd = -1;
+    bool stream = false;
+    bool nonblocking = false;
+    bool connecting = false;
+
+    /* A blocking RECV/RECVFROM the host is still waiting on */
+    bool recv_pending = false;
+    bool recv_from = false;
+    uint16_t recv_length = 0;
+};
+
+struct sim_select_t
+{
+    bool pending = false;
+    bool forever = false;
+    uint16_t read_fds = 0;
+    std::chrono::steady_clock::time_point deadline;
+};
+
+struct sim_stats_t
+{
+    unsigned long long commands = 0;
+    unsigned long long messages = 0;
+    unsigned long long bytes_in = 0;
+    unsigned long long bytes_out = 0;
+    unsigned long long cnys = 0;
+    unsigned long long irqs = 0;
+    unsigned long long dummies = 0;
+    unsigned long long resync = 0;
+    unsigned long long data_in = 0;
+    unsigned long long data_out = 0;
+};
+
+struct sim_device_t
+{
+    int fd = -1;
+    bool enabled = false;
+    bool connected = false;
+    bool verbose = false;
+    bool aggregate = false;
+    uint8_t seq = 0;
+    unsigned pool = SIM_TX_POOL;
+
+    /* IRQs raised that no CNYS has answered yet */
+    size_t announced = 0;
+
+    /* Free buffers as the host counts them, it decrements on data operations */
+    unsigned host_pool = 0;
+
+    /* Link frames and MOSI bytes not consumed yet */
+    std::vector<uint8_t> link_rx;
+    std::vector<uint8_t> mosi;
+
+    /* N2H messages without the sync word, and the one on MISO now */
+    std::deque<std::vector<uint8_t>> queue;
+    std::vector<uint8_t> current;
+    size_t offset = 0;
+
+    sim_socket_t sockets[SL_MAX_SOCKETS];
+    sim_select_t select;
+    sim_stats_t stats;
+};
+
+/*----------------------------------------------------------------------------*/
+
+static volatile sig_atomic_t stop = 0;
+
+/*----------------------------------------------------------------------------*/
+
+static void usage(const char* name);
+static void on_signal(int signal);
+static int listen_open(const char* path);
+static void device_reset(sim_device_t& device);
+static void device_report(const sim_device_t& device);
+static bool link_send(sim_device_t& device, uint8_t kind, const uint8_t* data, uint16_t length);
+static bool link_input(sim_device_t& device);
+static bool link_frame(sim_device_t& device, uint8_t kind, const uint8_t* data, uint16_t length);
+static void mosi_parse(sim_device_t& device);
+static void nwp_queue(sim_device_t& device, uint16_t opcode, const void* args, size_t args_length,
+                      const void* payload, size_t payload_length);
+static void nwp_present(sim_device_t& device);
+static void nwp_irq(sim_device_t& device);
+static void nwp_aggregate(sim_device_t& device, bool enable);
+static void nwp_basic(sim_device_t& device, uint16_t opcode, int16_t status);
+static void nwp_command(sim_device_t& device, uint16_t opcode, const uint8_t* data, size_t length);
+static void nwp_flow(sim_device_t& device);
+static void socket_command(sim_device_t& device, uint16_t opcode, const uint8_t* data, size_t length);
+static void socket_recv(sim_device_t& device, uint8_t index);
+static void socket_connected(sim_device_t& device, uint8_t index);
+static uint16_t select_ready(sim_device_t& device, uint16_t read_fds);
+static void select_answer(sim_device_t& device, uint16_t ready);
+
+/*----------------------------------------------------------------------------*/
+
+int main(int argc, char** argv)
+{
+    const char* path = getenv(NWP_LINK_SOCKET_ENV);
+    struct pollfd fds[SIM_POLL_FDS];
+    uint8_t indexes[SIM_POLL_FDS];
+    sim_device_t device;
+    int listen_fd, option, timeout, count, i;
+    uint16_t ready;
+
+    if (path == NULL)
+    {
+        path = NWP_LINK_SOCKET;
+    }
+
+    while ((option = getopt(argc, argv, "s:t:vh")) != -1)
+    {
+        switch (option)
+        {
+        case 's':
+            path = optarg;
+            break;
+        case 't':
+            device.pool = (unsigned) atoi(optarg);
+            break;
+        case 'v':
+            device.verbose = true;
+            break;
+        default:
+            usage(argv[0]);
+            return (option == 'h') ? 0 : 1;
+        }
+    }
+    if (device.pool <= SIM_TX_POOL_LOW || device.pool > SIM_TX_POOL_MAX)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    signal(SIGPIPE, SIG_IGN);
+
+    listen_fd = listen_open(path);
+    if (listen_fd < 0)
+    {
+        return 1;
+    }
+    fprintf(stderr, "listening on %s with %u TX buffers\n", path, device.pool);
+
+    while (!stop)
+    {
+        count = 0;
+        timeout = -1;
+
+        if (device.fd < 0)
+        {
+            fds[count].fd = listen_fd;
+            fds[count].events = POLLIN;
+            count++;
+        }
+        else
+        {
+            fds[count].fd = device.fd;
+            fds[count].events = POLLIN;
+            count++;
+
+            /* Only sockets somebody is waiting on */
+            for (i = 0; i < SL_MAX_SOCKETS; i++)
+            {
+                const sim_socket_t& socket = device.sockets[i];
+
+                if (socket.fd < 0)
+                {
+                    continue;
+                }
+                if (socket.connecting)
+                {
+                    fds[count].events = POLLOUT;
+                }
+                else if (socket.recv_pending ||
+                         (device.select.pending && (device.select.read_fds & (1 << i))))
+                {
+                    fds[count].events = POLLIN;
+                }
+                else
+                {
+                    continue;
+                }
+                fds[count].fd = socket.fd;
+                indexes[count] = (uint8_t) i;
+                count++;
+            }
+
+            if (device.select.pending && !device.select.forever)
+            {
+                const auto left = device.select.deadline - std::chrono::steady_clock::now();
+                timeout = (int) std::chrono::ceil<std::chrono::milliseconds>(left).count();
+                if (timeout < 0)
+                {
+                    timeout = 0;
+                }
+            }
+        }
+
+        if (poll(fds, (nfds_t) count, timeout) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            perror("poll");
+            break;
+        }
+
+        if (device.fd < 0)
+        {
+            if (fds[0].revents & POLLIN)
+            {
+                device.fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+                if (device.fd >= 0 && device.verbose)
+                {
+                    fprintf(stderr, "host attached\n");
+                }
+            }
+            continue;
+        }
+
+        if ((fds[0].revents & (POLLIN | POLLHUP | POLLERR)) && !link_input(device))
+        {
+            device_report(device);
+            device_reset(device);
+            device.stats = sim_stats_t();
+            close(device.fd);
+            device.fd = -1;
+            continue;
+        }
+
+        for (i = 1; i < count; i++)
+        {
+            if (fds[i].revents == 0)
+            {
+                continue;
+            }
+            if (device.sockets[indexes[i]].connecting)
+            {
+                socket_connected(device, indexes[i]);
+            }
+            else if (device.sockets[indexes[i]].recv_pending)
+            {
+                socket_recv(device, indexes[i]);
+            }
+        }
+
+        if (device.select.pending)
+        {
+            ready = select_ready(device, device.select.read_fds);
+            if (ready != 0 || (!device.select.forever &&
+                               std::chrono::steady_clock::now() >= device.select.deadline))
+            {
+                select_answer(device, ready);
+            }
+        }
+    }
+
+    if (device.fd >= 0)
+    {
+        device_report(device);
+        device_reset(device);
+        close(device.fd);
+    }
+    close(listen_fd);
+    unlink(path);
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void usage(const char* name)
+{
+    fprintf(stderr,
+            "usage: %s [-s socket] [-t buffers] [-v]\n"
+            "  -s  link socket (default $%s or %s)\n"
+            "  -t  NWP TX buffers, %u to %u (default %u)\n"
+            "  -v  log every command\n",
+            name, NWP_LINK_SOCKET_ENV, NWP_LINK_SOCKET, SIM_TX_POOL_LOW + 1, SIM_TX_POOL_MAX,
+            SIM_TX_POOL);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void on_signal(int signal)
+{
+    (void) signal;
+    stop = 1;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static int listen_open(const char* path)
+{
+    struct sockaddr_un addr;
+    int fd;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "socket path too long: %s\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        perror("socket");
+        return -1;
+    }
+
+    /* A previous run that was killed leaves the node behind */
+    unlink(path);
+    if (bind(fd, (struct sockaddr*) &addr, sizeof(addr)) < 0 || listen(fd, 1) < 0)
+    {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void device_reset(sim_device_t& device)
+{
+    int i;
+
+    /* What nHIB does: the NWP forgets everything, sockets included */
+    for (i = 0; i < SL_MAX_SOCKETS; i++)
+    {
+        if (device.sockets[i].fd >= 0)
+        {
+            close(device.sockets[i].fd);
+        }
+        device.sockets[i] = sim_socket_t();
+    }
+    device.select = sim_select_t();
+    device.queue.clear();
+    device.current.clear();
+    device.offset = 0;
+    device.mosi.clear();
+    device.seq = 0;
+    device.aggregate = false;
+    device.announced = 0;
+    device.host_pool = 0;
+    device.connected = false;
+    device.enabled = false;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void device_report(const sim_device_t& device)
+{
+    const sim_stats_t& stats = device.stats;
+    const double messages = (stats.commands > 0) ? (double) stats.commands : 1.0;
+
+    printf("commands=%llu messages=%llu cnys=%llu irqs=%llu dummies=%llu resync_bytes=%llu\n",
+           stats.commands, stats.messages, stats.cnys, stats.irqs, stats.dummies, stats.resync);
+    printf("mosi_bytes=%llu miso_bytes=%llu bytes/command=%.1f data_in=%llu data_out=%llu\n",
+           stats.bytes_in, stats.bytes_out, (stats.bytes_in + stats.bytes_out) / messages,
+           stats.data_in, stats.data_out);
+    fflush(stdout);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static bool link_send(sim_device_t& device, uint8_t kind, const uint8_t* data, uint16_t length)
+{
+    std::vector<uint8_t> frame(sizeof(nwp_link_header_t) + ((data != NULL) ? length : 0));
+    nwp_link_header_t header;
+    size_t done = 0;
+    ssize_t sent;
+
+    header.kind = kind;
+    header.reserved = 0;
+    header.length = length;
+    memcpy(frame.data(), &header, sizeof(header));
+    if (data != NULL)
+    {
+        memcpy(frame.data() + sizeof(header), data, length);
+    }
+
+    while (done < frame.size())
+    {
+        sent = send(device.fd, frame.data() + done, frame.size() - done, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (sent <= 0)
+        {
+            return false;
+        }
+        done += (size_t) sent;
+    }
+
+    return true;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static bool link_input(sim_device_t& device)
+{
+    uint8_t buffer[16 * 1024];
+    nwp_link_header_t header;
+    size_t used = 0;
+    ssize_t length;
+
+    length = recv(device.fd, buffer, sizeof(buffer), 0);
+    if (length < 0 && errno == EINTR)
+    {
+        return true;
+    }
+    if (length <= 0)
+    {
+        return false;
+    }
+    device.link_rx.insert(device.link_rx.end(), buffer, buffer + length);
+
+    while (device.link_rx.size() - used >= sizeof(header))
+    {
+        memcpy(&header, device.link_rx.data() + used, sizeof(header));
+
+        /* Only WRITE frames carry their length in bytes */
+        const size_t payload = (header.kind == NWP_LINK_WRITE) ? header.length : 0;
+        if (device.link_rx.size() - used < sizeof(header) + payload)
+        {
+            break;
+        }
+        if (!link_frame(device, header.kind, device.link_rx.data() + used + sizeof(header),
+                        header.length))
+        {
+            return false;
+        }
+        used += sizeof(header) + payload;
+    }
+    device.link_rx.erase(device.link_rx.begin(), device.link_rx.begin() + (long) used);
+
+    return true;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static bool link_frame(sim_device_t& device, uint8_t kind, const uint8_t* data, uint16_t length)
+{
+    std::vector<uint8_t> miso;
+    size_t available;
+
+    switch (kind)
+    {
+    case NWP_LINK_WRITE:
+        device.stats.bytes_in += length;
+        if (device.enabled)
+        {
+            device.mosi.insert(device.mosi.end(), data, data + length);
+            mosi_parse(device);
+        }
+        return true;
+
+    case NWP_LINK_READ:
+        /* Past the end of the message the NWP clocks out zeros */
+        device.stats.bytes_out += length;
+        miso.assign(length, 0);
+        if (device.offset < device.current.size())
+        {
+            available = std::min((size_t) length, device.current.size() - device.offset);
+            memcpy(miso.data(), device.current.data() + device.offset, available);
+            device.offset += available;
+        }
+        return link_send(device, NWP_LINK_READ_DATA, miso.data(), length);
+
+    case NWP_LINK_ENABLE:
+    {
+        InitComplete_t init;
+
+        device_reset(device);
+        device.enabled = true;
+        init.Status = INIT_STA_OK;
+        nwp_queue(device, SL_OPCODE_DEVICE_INITCOMPLETE, &init, sizeof(init), NULL, 0);
+        return true;
+    }
+
+    case NWP_LINK_DISABLE:
+        device_reset(device);
+        return true;
+
+    default:
+        /* Nothing else travels this way */
+        return true;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void mosi_parse(sim_device_t& device)
+{
+    static const uint8_t sync[4] = { 0x21, 0x43, 0x34, 0x12 };
+    static const uint8_t cnys[4] = { 0x65, 0x87, 0x78, 0x56 };
+    _SlGenericHeader_t header;
+    size_t used = 0, length;
+
+    while (device.mosi.size() - used >= sizeof(sync))
+    {
+        const uint8_t* word = device.mosi.data() + used;
+
+        if (memcmp(word, cnys, sizeof(cnys)) == 0)
+        {
+            /* The host wants the next message, or burst */
+            device.stats.cnys++;
+            nwp_present(device);
+            used += sizeof(cnys);
+            continue;
+        }
+
+        if (memcmp(word, sync, sizeof(sync)) != 0)
+        {
+            /* Dummy words the host clocks out, or garbage */
+            device.stats.resync++;
+            used++;
+            continue;
+        }
+
+        if (device.mosi.size() - used < sizeof(sync) + sizeof(header))
+        {
+            break;
+        }
+        memcpy(&header, word + sizeof(sync), sizeof(header));
+        length = SIM_ALIGN((size_t) header.Len);
+        if (device.mosi.size() - used < sizeof(sync) + sizeof(header) + length)
+        {
+            break;
+        }
+
+        device.stats.commands++;
+        if (device.verbose)
+        {
+            fprintf(stderr, "command 0x%04x length %u\n", header.Opcode, header.Len);
+        }
+        nwp_command(device, header.Opcode, word + sizeof(sync) + sizeof(header), header.Len);
+        used += sizeof(sync) + sizeof(header) + length;
+    }
+    device.mosi.erase(device.mosi.begin(), device.mosi.begin() + (long) used);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void nwp_queue(sim_device_t& device, uint16_t opcode, const void* args, size_t args_length,
+                      const void* payload, size_t payload_length)
+{
+    _SlResponseHeader_t header;
+    std::vector<uint8_t> message;
+    uint8_t nonblocking = 0;
+    int i;
+
+    for (i = 0; i < SL_MAX_SOCKETS; i++)
+    {
+        if (device.sockets[i].fd >= 0 && device.sockets[i].nonblocking)
+        {
+            nonblocking |= (uint8_t) (1 << i);
+        }
+    }
+
+    /* Len counts the rest of the header but not the alignment padding */
+    header.GenHeader.Opcode = opcode;
+    header.GenHeader.Len = (uint16_t) (_SL_RESP_SPEC_HDR_SIZE + args_length + payload_length);
+    header.TxPoolCnt = (uint8_t) device.pool;
+    header.DevStatus = 0;
+    header.SocketTXFailure = 0;
+    header.SocketNonBlocking = nonblocking;
+
+    message.resize(sizeof(header) + SIM_ALIGN(args_length + payload_length));
+    memcpy(message.data(), &header, sizeof(header));
+    if (args_length > 0)
+    {
+        memcpy(message.data() + sizeof(header), args, args_length);
+    }
+    if (payload_length > 0)
+    {
+        memcpy(message.data() + sizeof(header) + args_length, payload, payload_length);
+    }
+
+    device.queue.push_back(std::move(message));
+    device.stats.messages++;
+
+    /* An aggregated burst takes everything queued until its CNYS */
+    if (!device.aggregate || device.announced == 0)
+    {
+        nwp_irq(device);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void nwp_present(sim_device_t& device)
+{
+    _SlGenericHeader_t header;
+    size_t count = 1, bytes, i;
+
+    device.current.clear();
+    device.offset = 0;
+    if (device.announced > 0)
+    {
+        device.announced--;
+    }
+    if (device.queue.empty())
+    {
+        return;
+    }
+
+    /*
+     * Aggregated, as many messages as fit, but one left for each IRQ still
+     * to be answered: those were raised one per message before aggregation
+     * was turned on, and every CNYS of the host has to find something.
+     */
+    if (device.aggregate)
+    {
+        bytes = device.queue.front().size();
+        while (count + device.announced < device.queue.size() &&
+               bytes + sizeof(uint32_t) + device.queue[count].size() <= SIM_BURST_MAX)
+        {
+            bytes += sizeof(uint32_t) + device.queue[count].size();
+            count++;
+        }
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        /* Each message has its own sync word, which carries its sequence */
+        const uint32_t pattern = (N2H_SYNC_PATTERN & 0xFFFFFFF8u) | 0x4u | (device.seq & 0x3u);
+        const uint8_t* sync = (const uint8_t*) &pattern;
+
+        device.seq++;
+        device.current.insert(device.current.end(), sync, sync + sizeof(pattern));
+        device.current.insert(device.current.end(), device.queue.front().begin(),
+                              device.queue.front().end());
+
+        memcpy(&header, device.queue.front().data(), sizeof(header));
+        if (header.Opcode != SL_OPCODE_DEVICE_INITCOMPLETE)
+        {
+            device.host_pool = device.pool;
+        }
+        device.queue.pop_front();
+    }
+
+    /* What did not fit needs an IRQ of its own */
+    if (device.aggregate && device.announced == 0 && !device.queue.empty())
+    {
+        nwp_irq(device);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void nwp_irq(sim_device_t& device)
+{
+    device.announced++;
+    device.stats.irqs++;
+    link_send(device, NWP_LINK_IRQ, NULL, 0);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void nwp_aggregate(sim_device_t& device, bool enable)
+{
+    device.aggregate = enable;
+
+    /* Back to one message per CNYS: what a burst IRQ covered needs one each */
+    while (!enable && device.announced < device.queue.size())
+    {
+        nwp_irq(device);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void nwp_basic(sim_device_t& device, uint16_t opcode, int16_t status)
+{
+    _BasicResponse_t response;
+
+    response.status = status;
+    response.padding = 0;
+    nwp_queue(device, opcode, &response, sizeof(response), NULL, 0);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void nwp_command(sim_device_t& device, uint16_t opcode, const uint8_t* data, size_t length)
+{
+    const uint16_t response = opcode & 0x7FFF;
+
+    switch (opcode)
+    {
+    case SL_OPCODE_DEVICE_STOP_COMMAND:
+        nwp_basic(device, SL_OPCODE_DEVICE_STOP_RESPONSE, 0);
+        nwp_basic(device, SL_OPCODE_DEVICE_STOP_ASYNC_RESPONSE, 0);
+        break;
+
+    case SL_OPCODE_WLAN_WLANCONNECTCOMMAND:
+    {
+        slWlanConnectAsyncResponse_t connected;
+        SlIpV4AcquiredAsync_t acquired;
+
+        /*
+         * Association and DHCP are instant. The events go out ahead of the
+         * response so that the host sees them before sl_WlanConnect returns;
+         * cc3100_boosterpack.c spins on a non-volatile flag right after it.
+         */
+        memset(&connected, 0, sizeof(connected));
+        connected.ssid_len = (uint8_t) strlen("nwp_sim");
+        memcpy(connected.ssid_name, "nwp_sim", connected.ssid_len);
+        memset(&acquired, 0, sizeof(acquired));
+        acquired.ip = INADDR_LOOPBACK;
+        acquired.gateway = INADDR_LOOPBACK;
+        acquired.dns = INADDR_LOOPBACK;
+
+        device.connected = true;
+        nwp_queue(device, SL_OPCODE_WLAN_WLANASYNCCONNECTEDRESPONSE, &connected, sizeof(connected), NULL, 0);
+        nwp_queue(device, SL_OPCODE_NETAPP_IPACQUIRED, &acquired, sizeof(acquired), NULL, 0);
+        nwp_basic(device, response, 0);
+        break;
+    }
+
+    case SL_OPCODE_WLAN_WLANDISCONNECTCOMMAND:
+        if (device.connected)
+        {
+            slWlanConnectAsyncResponse_t disconnected;
+
+            memset(&disconnected, 0, sizeof(disconnected));
+            disconnected.reason_code = SL_WLAN_DISCONNECT_USER_INITIATED_DISCONNECTION;
+            device.connected = false;
+            nwp_queue(device, SL_OPCODE_WLAN_WLANASYNCDISCONNECTEDRESPONSE, &disconnected,
+                      sizeof(disconnected), NULL, 0);
+            nwp_basic(device, response, 0);
+        }
+        else
+        {
+            nwp_basic(device, response, -1);
+        }
+        break;
+
+    case SL_OPCODE_DEVICE_DEVICEGET:
+    case SL_OPCODE_DEVICE_NETCFG_GET_COMMAND:
+    case SL_OPCODE_WLAN_CFG_GET:
+    case SL_OPCODE_NETAPP_NETAPPGET:
+    {
+        /* All four share the {Status, Id, Option, Length} descriptor */
+        static const uint8_t mac[6] = { 0x02, 0x00, 0x00, 0x31, 0x00, 0x01 };
+        _NetCfgSetGet_t get;
+        std::vector<uint8_t> value;
+
+        if (length < sizeof(get))
+        {
+            nwp_basic(device, response, -1);
+            break;
+        }
+        memcpy(&get, data, sizeof(get));
+        value.assign(get.ConfigLen, 0);
+        if (opcode == SL_OPCODE_DEVICE_NETCFG_GET_COMMAND && get.ConfigId == SL_MAC_ADDRESS_GET)
+        {
+            memcpy(value.data(), mac, std::min(value.size(), sizeof(mac)));
+        }
+        get.Status = 0;
+        nwp_queue(device, response, &get, sizeof(get), value.data(), value.size());
+        break;
+    }
+
+    case SL_OPCODE_DEVICE_NETCFG_SET_COMMAND:
+    {
+        _NetCfgSetGet_t set;
+
+        /* Only RX aggregation changes anything here */
+        if (length > sizeof(set))
+        {
+            memcpy(&set, data, sizeof(set));
+            if (set.ConfigId == SL_SET_HOST_RX_AGGR && set.ConfigLen > 0)
+            {
+                nwp_aggregate(device, data[sizeof(set)] != 0);
+            }
+        }
+        nwp_basic(device, response, 0);
+        break;
+    }
+
+    case SL_OPCODE_NETAPP_DNSGETHOSTBYNAME:
+    {
+        _GetHostByNameCommand_t command;
+        _GetHostByNameIPv4AsyncResponse_t resolved;
+        struct addrinfo hints, *result = NULL;
+        std::string name;
+
+        memset(&resolved, 0, sizeof(resolved));
+        if (length < sizeof(command))
+        {
+            nwp_basic(device, response, -1);
+            break;
+        }
+        memcpy(&command, data, sizeof(command));
+        name.assign((const char*) data + sizeof(command),
+                    std::min((size_t) command.Len, length - sizeof(command)));
+
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        if (getaddrinfo(name.c_str(), NULL, &hints, &result) == 0 && result != NULL)
+        {
+            /* Host order, sl_NetAppDnsGetHostByName hands it over untouched */
+            resolved.ip0 = ntohl(((struct sockaddr_in*) result->ai_addr)->sin_addr.s_addr);
+            freeaddrinfo(result);
+        }
+        else
+        {
+            resolved.status = (uint16_t) -1;
+        }
+        nwp_basic(device, response, 0);
+        nwp_queue(device, SL_OPCODE_NETAPP_DNSGETHOSTBYNAMEASYNCRESPONSE, &resolved, sizeof(resolved),
+                  NULL, 0);
+        break;
+    }
+
+    default:
+        if ((opcode & SL_OPCODE_SILO_MASK) == SL_OPCODE_SILO_SOCKET)
+        {
+            socket_command(device, opcode, data, length);
+            break;
+        }
+
+        /*
+         * Every other set command takes a {status, padding} answer, and zeros
+         * are a harmless answer to the rest: the driver reads what it expects
+         * and the next CNYS drops whatever is left.
+         */
+        if (device.verbose)
+        {
+            fprintf(stderr, "  answered with zeros\n");
+        }
+        {
+            uint8_t zeros[SIM_DEFAULT_RESPONSE] = { 0 };
+
+            nwp_queue(device, response, zeros, sizeof(zeros), NULL, 0);
+        }
+        break;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void nwp_flow(sim_device_t& device)
+{
+    /* Any message refreshes the count, only send one when nothing is on the way */
+    if (device.host_pool > 0)
+    {
+        device.host_pool--;
+    }
+    if (device.host_pool <= SIM_TX_POOL_LOW && device.queue.empty())
+    {
+        _BasicResponse_t dummy;
+
+        memset(&dummy, 0, sizeof(dummy));
+        device.stats.dummies++;
+        nwp_queue(device, SL_OPCODE_DEVICE_DEVICEASYNCDUMMY, &dummy, sizeof(dummy), NULL, 0);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void socket_command(sim_device_t& device, uint16_t opcode, const uint8_t* data, size_t length)
+{
+    const uint16_t response = opcode & 0x7FFF;
+    _SocketResponse_t answer;
+    struct sockaddr_in addr;
+    uint8_t index;
+    int i;
+
+    memset(&answer, 0, sizeof(answer));
+
+    if (opcode == SL_OPCODE_SOCKET_SOCKET)
+    {
+        _SocketCommand_t command;
+
+        if (length < sizeof(command))
+        {
+            answer.statusOrLen = SL_SOC_ERROR;
+            nwp_queue(device, response, &answer, sizeof(answer), NULL, 0);
+            return;
+        }
+        memcpy(&command, data, sizeof(command));
+
+        for (i = 0; i < SL_MAX_SOCKETS && device.sockets[i].fd >= 0; i++)
+        {
+        }
+        if (i == SL_MAX_SOCKETS)
+        {
+            answer.statusOrLen = SL_ENSOCK;
+        }
+        else if (command.Domain != SL_AF_INET ||
+                 (command.Type != SL_SOCK_STREAM && command.Type != SL_SOCK_DGRAM))
+        {
+            answer.statusOrLen = SL_SOC_ERROR;
+        }
+        else
+        {
+            /* The real socket never blocks us, blocking is the host's business */
+            sim_socket_t& socket = device.sockets[i];
+
+            socket.stream = (command.Type == SL_SOCK_STREAM);
+            socket.fd = ::socket(AF_INET, (socket.stream ? SOCK_STREAM : SOCK_DGRAM) |
+                                 SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            answer.statusOrLen = (socket.fd < 0) ? (int16_t) -errno : 0;
+            answer.sd = (uint8_t) i;
+        }
+        nwp_queue(device, response, &answer, sizeof(answer), NULL, 0);
+        return;
+    }
+
+    if (opcode == SL_OPCODE_SOCKET_SELECT)
+    {
+        _SelectCommand_t command;
+        unsigned timeout_ms;
+        uint16_t ready;
+
+        memset(&command, 0, sizeof(command));
+        memcpy(&command, data, std::min(length, sizeof(command)));
+        nwp_basic(device, response, 0);
+
+        /* One select at a time, as the driver only has one SELECT_ID object */
+        device.select.pending = true;
+        device.select.read_fds = command.readFds;
+        device.select.forever = (command.tv_sec == SIM_SELECT_FOREVER &&
+                                 command.tv_usec == SIM_SELECT_FOREVER);
+        timeout_ms = (unsigned) command.tv_sec * 1000u + command.tv_usec;
+        device.select.deadline = std::chrono::steady_clock::now() +
+                                 std::chrono::milliseconds(timeout_ms);
+
+        ready = select_ready(device, command.readFds);
+        if (ready != 0 || (!device.select.forever && timeout_ms == 0))
+        {
+            select_answer(device, ready);
+        }
+        return;
+    }
+
+    /* Everything else names its socket in the byte after a 16-bit field */
+    if (length < 4 || (data[2] & BSD_SOCKET_ID_MASK) >= SL_MAX_SOCKETS ||
+        device.sockets[data[2] & BSD_SOCKET_ID_MASK].fd < 0)
+    {
+        answer.statusOrLen = SL_SOC_ERROR;
+        answer.sd = (length >= 4) ? data[2] : 0;
+        if (opcode != SL_OPCODE_SOCKET_SEND && opcode != SL_OPCODE_SOCKET_SENDTO)
+        {
+            nwp_queue(device, response, &answer, sizeof(answer), NULL, 0);
+        }
+        return;
+    }
+    index = data[2] & BSD_SOCKET_ID_MASK;
+    sim_socket_t& socket = device.sockets[index];
+    answer.sd = index;
+
+    switch (opcode)
+    {
+    case SL_OPCODE_SOCKET_CLOSE:
+        close(socket.fd);
+        socket = sim_socket_t();
+        device.select.read_fds &= (uint16_t) ~(1 << index);
+        nwp_queue(device, response, &answer, sizeof(answer), NULL, 0);
+        break;
+
+    case SL_OPCODE_SOCKET_BIND:
+    case SL_OPCODE_SOCKET_CONNECT:
+    {
+        _SocketAddrIPv4Command_t command;
+
+        memset(&command, 0, sizeof(command));
+        memcpy(&command, data, std::min(length, sizeof(command)));
+
+        /* Port and address come in network order, straight from SlSockAddrIn_t */
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = command.port;
+        addr.sin_addr.s_addr = command.address;
+
+        if (opcode == SL_OPCODE_SOCKET_BIND)
+        {
+            if (bind(socket.fd, (struct sockaddr*) &addr, sizeof(addr)) < 0)
+            {
+                answer.statusOrLen = (int16_t) -errno;
+            }
+            nwp_queue(device, response, &answer, sizeof(answer), NULL, 0);
+            break;
+        }
+
+        /* The outcome comes later as an async event, like on the NWP */
+        nwp_queue(device, response, &answer, sizeof(answer), NULL, 0);
+        if (connect(socket.fd, (struct sockaddr*) &addr, sizeof(addr)) == 0)
+        {
+            socket_connected(device, index);
+        }
+        else if (errno == EINPROGRESS)
+        {
+            socket.connecting = true;
+        }
+        else
+        {
+            answer.statusOrLen = (int16_t) -errno;
+            nwp_queue(device, SL_OPCODE_SOCKET_CONNECTASYNCRESPONSE, &answer, sizeof(answer), NULL, 0);
+        }
+        break;
+    }
+
+    case SL_OPCODE_SOCKET_SETSOCKOPT:
+    {
+        _setSockOptCommand_t command;
+
+        memcpy(&command, data, sizeof(command));
+        if (command.level == SL_SOL_SOCKET && command.optionName == SL_SO_NONBLOCKING &&
+            length >= sizeof(command) + 1)
+        {
+            socket.nonblocking = (data[sizeof(command)] != 0);
+        }
+        nwp_queue(device, response, &answer, sizeof(answer), NULL, 0);
+        break;
+    }
+
+    case SL_OPCODE_SOCKET_RECV:
+    case SL_OPCODE_SOCKET_RECVFROM:
+    {
+        _sendRecvCommand_t command;
+
+        memcpy(&command, data, sizeof(command));
+        socket.recv_pending = true;
+        socket.recv_from = (opcode == SL_OPCODE_SOCKET_RECVFROM);
+        socket.recv_length = std::min((uint16_t) SIM_RECV_MAX, command.StatusOrLen);
+        socket_recv(device, index);
+        nwp_flow(device);
+        break;
+    }
+
+    case SL_OPCODE_SOCKET_SEND:
+    case SL_OPCODE_SOCKET_SENDTO:
+    {
+        const uint8_t* payload;
+        size_t payload_length;
+        ssize_t sent;
+
+        /* No answer on success, the NWP only reports failures */
+        if (opcode == SL_OPCODE_SOCKET_SEND)
+        {
+            _sendRecvCommand_t command;
+
+            memcpy(&command, data, sizeof(command));
+            payload = data + sizeof(command);
+            payload_length = std::min((size_t) command.StatusOrLen, length - sizeof(command));
+            sent = send(socket.fd, payload, payload_length, MSG_NOSIGNAL | MSG_DONTWAIT);
+        }
+        else
+        {
+            _SocketAddrIPv4Command_t command;
+
+            memset(&command, 0, sizeof(command));
+            memcpy(&command, data, std::min(length, sizeof(command)));
+            memset(&addr, 0, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_port = command.port;
+            addr.sin_addr.s_addr = command.address;
+            payload = data + sizeof(command);
+            payload_length = (length > sizeof(command)) ?
+                std::min((size_t) (uint16_t) command.lenOrPadding, length - sizeof(command)) : 0;
+            sent = sendto(socket.fd, payload, payload_length, MSG_NOSIGNAL | MSG_DONTWAIT,
+                          (struct sockaddr*) &addr, sizeof(addr));
+        }
+        if (sent > 0)
+        {
+            device.stats.data_out += (unsigned long long) sent;
+        }
+        else if (device.verbose)
+        {
+            fprintf(stderr, "  send on socket %u failed: %s\n", index, strerror(errno));
+        }
+        nwp_flow(device);
+        break;
+    }
+
+    default:
+        if (device.verbose)
+        {
+            fprintf(stderr, "  socket command 0x%04x answered with success\n", opcode);
+        }
+        nwp_queue(device, response, &answer, sizeof(answer), NULL, 0);
+        break;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void socket_recv(sim_device_t& device, uint8_t index)
+{
+    sim_socket_t& socket = device.sockets[index];
+    uint8_t buffer[SIM_RECV_MAX];
+    struct sockaddr_in from;
+    socklen_t from_length = sizeof(from);
+    ssize_t received;
+    int16_t status;
+
+    memset(&from, 0, sizeof(from));
+    received = recvfrom(socket.fd, buffer, socket.recv_length, MSG_DONTWAIT,
+                        (struct sockaddr*) &from, &from_length);
+    if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+        /* A blocking RECV waits here; a non-blocking one must be answered now */
+        if (!socket.nonblocking)
+        {
+            return;
+        }
+        status = SL_EAGAIN;
+    }
+    else
+    {
+        status = (received < 0) ? (int16_t) -errno : (int16_t) received;
+    }
+    socket.recv_pending = false;
+    received = (status > 0) ? status : 0;
+    device.stats.data_in += (unsigned long long) received;
+
+    if (socket.recv_from)
+    {
+        _SocketAddrAsyncIPv4Response_t answer;
+
+        answer.statusOrLen = status;
+        answer.sd = index;
+        answer.family = SL_AF_INET;
+        answer.port = from.sin_port;
+        answer.paddingOrAddr = 0;
+        answer.address = from.sin_addr.s_addr;
+        nwp_queue(device, SL_OPCODE_SOCKET_RECVFROMASYNCRESPONSE, &answer, sizeof(answer), buffer,
+                  (size_t) received);
+    }
+    else
+    {
+        _SocketResponse_t answer;
+
+        answer.statusOrLen = status;
+        answer.sd = index;
+        answer.padding = 0;
+        nwp_queue(device, SL_OPCODE_SOCKET_RECVASYNCRESPONSE, &answer, sizeof(answer), buffer,
+                  (size_t) received);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void socket_connected(sim_device_t& device, uint8_t index)
+{
+    sim_socket_t& socket = device.sockets[index];
+    _SocketResponse_t answer;
+    socklen_t length = sizeof(int);
+    int error = 0;
+
+    getsockopt(socket.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+    socket.connecting = false;
+
+    answer.statusOrLen = (int16_t) -error;
+    answer.sd = index;
+    answer.padding = 0;
+    nwp_queue(device, SL_OPCODE_SOCKET_CONNECTASYNCRESPONSE, &answer, sizeof(answer), NULL, 0);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static uint16_t select_ready(sim_device_t& device, uint16_t read_fds)
+{
+    struct pollfd fds[SL_MAX_SOCKETS];
+    uint8_t indexes[SL_MAX_SOCKETS];
+    uint16_t ready = 0;
+    int count = 0, i;
+
+    for (i = 0; i < SL_MAX_SOCKETS; i++)
+    {
+        if ((read_fds & (1 << i)) && device.sockets[i].fd >= 0)
+        {
+            fds[count].fd = device.sockets[i].fd;
+            fds[count].events = POLLIN;
+            indexes[count] = (uint8_t) i;
+            count++;
+        }
+    }
+    if (count == 0 || poll(fds, (nfds_t) count, 0) <= 0)
+    {
+        return 0;
+    }
+
+    /* A closed or failed socket is readable too, the RECV tells the host why */
+    for (i = 0; i < count; i++)
+    {
+        if (fds[i].revents & (POLLIN | POLLHUP | POLLERR))
+        {
+            ready |= (uint16_t) (1 << indexes[i]);
+        }
+    }
+
+    return ready;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void select_answer(sim_device_t& device, uint16_t ready)
+{
+    _SelectAsyncResponse_t answer;
+    uint8_t count = 0;
+    int i;
+
+    for (i = 0; i < SL_MAX_SOCKETS; i++)
+    {
+        if (ready & (1 << i))
+        {
+            count++;
+        }
+    }
+
+    answer.status = count;
+    answer.readFdsCount = count;
+    answer.writeFdsCount = 0;
+    answer.readFds = ready;
+    answer.writeFds = 0;
+    device.select = sim_select_t();
+    nwp_queue(device, SL_OPCODE_SOCKET_SELECTASYNCRESPONSE, &answer, sizeof(answer), NULL, 0);
+}
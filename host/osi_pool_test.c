@@ -0,0 +1,284 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "osi_pool.h"
+
+/*
+ * Host tests of the fixed-block pools of the OSI layer, osi_pool.c:
+ *  - exhaustion: every block once, distinct and in the storage, then NULL
+ *    and the failed counter;
+ *  - double free: a block released twice, or one that is not a block of
+ *    the pool, is refused and leaves the free list and the counters as
+ *    they were;
+ *  - refill: released blocks are handed out again before the pool fails,
+ *    and a pool emptied and refilled twice over gives the same blocks;
+ *  - size classes: osi_PoolAllocSize and osi_PoolFreeAny over two pools.
+ *
+ * "make test" runs it, the exit status is the verdict.
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#define CHECK(condition)        check((condition), #condition, __FILE__, __LINE__)
+
+#define TEST_BLOCKS             ( 4 )
+/* Not a multiple of the storage word, the pool rounds it up */
+#define TEST_BLOCK_SIZE         ( 12 )
+
+/*----------------------------------------------------------------------------*/
+
+static void check(bool passed, const char* expression, const char* file, int line);
+static void pool_reset(void);
+static void test_exhaustion(void);
+static void test_double_free(void);
+static void test_refill(void);
+static void test_size_classes(void);
+
+/*----------------------------------------------------------------------------*/
+
+static uint32_t checks;
+static uint32_t failures;
+
+OSI_POOL_STORAGE(storage, TEST_BLOCK_SIZE, TEST_BLOCKS);
+static OsiPool_t pool;
+
+OSI_POOL_STORAGE(small_storage, 8, 1);
+OSI_POOL_STORAGE(large_storage, 64, 2);
+
+/*----------------------------------------------------------------------------*/
+
+int main(void)
+{
+    test_exhaustion();
+    test_double_free();
+    test_refill();
+    test_size_classes();
+
+    printf("osi_pool_test: %u checks, %u failed\n", (unsigned) checks, (unsigned) failures);
+
+    return (failures == 0) ? 0 : 1;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void check(bool passed, const char* expression, const char* file, int line)
+{
+    checks++;
+    if (!passed)
+    {
+        failures++;
+        fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+/* A fresh pool over the test storage, as the static initialiser gives it */
+static void pool_reset(void)
+{
+    OsiPool_t fresh = OSI_POOL_INIT(storage, TEST_BLOCK_SIZE, TEST_BLOCKS);
+
+    pool = fresh;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void test_exhaustion(void)
+{
+    void* blocks[TEST_BLOCKS];
+    uint32_t i, j;
+
+    pool_reset();
+    CHECK(pool.ulBlockSize == 16);
+
+    for (i = 0; i < TEST_BLOCKS; i++)
+    {
+        blocks[i] = osi_PoolAlloc(&pool);
+        CHECK(blocks[i] != NULL);
+        CHECK(osi_PoolOwns(&pool, blocks[i]));
+        for (j = 0; j < i; j++)
+        {
+            CHECK(blocks[i] != blocks[j]);
+        }
+    }
+    CHECK(pool.ulUsed == TEST_BLOCKS);
+    CHECK(pool.ulPeak == TEST_BLOCKS);
+    CHECK(pool.ulFailed == 0);
+
+    /* Empty: NULL every time, counted, nothing else changes */
+    CHECK(osi_PoolAlloc(&pool) == NULL);
+    CHECK(osi_PoolAlloc(&pool) == NULL);
+    CHECK(pool.ulFailed == 2);
+    CHECK(pool.ulUsed == TEST_BLOCKS);
+    CHECK(pool.ulPeak == TEST_BLOCKS);
+
+    /* One back, one more out, then empty again */
+    CHECK(osi_PoolFree(&pool, blocks[1]));
+    CHECK(osi_PoolAlloc(&pool) == blocks[1]);
+    CHECK(osi_PoolAlloc(&pool) == NULL);
+    CHECK(pool.ulFailed == 3);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void test_double_free(void)
+{
+    void* first;
+    void* second;
+    uint8_t outside[16];
+
+    pool_reset();
+    first = osi_PoolAlloc(&pool);
+    second = osi_PoolAlloc(&pool);
+
+    CHECK(osi_PoolFree(&pool, first));
+    CHECK(pool.ulUsed == 1);
+
+    /* At the head of the free list, then deeper in it */
+    CHECK(!osi_PoolFree(&pool, first));
+    CHECK(pool.ulUsed == 1);
+    CHECK(osi_PoolFree(&pool, second));
+    CHECK(!osi_PoolFree(&pool, first));
+    CHECK(!osi_PoolFree(&pool, second));
+    CHECK(pool.ulUsed == 0);
+
+    /* Not handed out yet, not at the start of a block, not in the pool */
+    CHECK(!osi_PoolFree(&pool, (uint8_t*) storage + 2 * pool.ulBlockSize));
+    CHECK(!osi_PoolFree(&pool, (uint8_t*) first + 4));
+    CHECK(!osi_PoolFree(&pool, outside));
+    CHECK(pool.ulUsed == 0);
+
+    /* The list is intact: both blocks once, then the untouched ones */
+    second = osi_PoolAlloc(&pool);
+    first = osi_PoolAlloc(&pool);
+    CHECK(second != first);
+    CHECK(osi_PoolAlloc(&pool) != NULL);
+    CHECK(osi_PoolAlloc(&pool) != NULL);
+    CHECK(osi_PoolAlloc(&pool) == NULL);
+    CHECK(pool.ulUsed == TEST_BLOCKS);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void test_refill(void)
+{
+    void* blocks[TEST_BLOCKS];
+    void* again[TEST_BLOCKS];
+    uint32_t round, i, j, found;
+
+    pool_reset();
+    for (i = 0; i < TEST_BLOCKS; i++)
+    {
+        blocks[i] = osi_PoolAlloc(&pool);
+    }
+
+    /* Emptied in any order and refilled, twice: the same blocks each time */
+    for (round = 0; round < 2; round++)
+    {
+        for (i = 0; i < TEST_BLOCKS; i++)
+        {
+            CHECK(osi_PoolFree(&pool, blocks[(i * 3 + round) % TEST_BLOCKS]));
+        }
+        CHECK(pool.ulUsed == 0);
+
+        for (i = 0; i < TEST_BLOCKS; i++)
+        {
+            again[i] = osi_PoolAlloc(&pool);
+        }
+        CHECK(osi_PoolAlloc(&pool) == NULL);
+
+        found = 0;
+        for (i = 0; i < TEST_BLOCKS; i++)
+        {
+            for (j = 0; j < TEST_BLOCKS; j++)
+            {
+                found += (again[i] == blocks[j]) ? 1 : 0;
+            }
+        }
+        CHECK(found == TEST_BLOCKS);
+        CHECK(pool.ulUsed == TEST_BLOCKS);
+        CHECK(pool.ulPeak == TEST_BLOCKS);
+        CHECK(pool.ulTouched == TEST_BLOCKS);
+    }
+
+    /* Last in, first out */
+    CHECK(osi_PoolFree(&pool, again[2]));
+    CHECK(osi_PoolFree(&pool, again[0]));
+    CHECK(osi_PoolAlloc(&pool) == again[0]);
+    CHECK(osi_PoolAlloc(&pool) == again[2]);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void test_size_classes(void)
+{
+    OsiPool_t pools[2] =
+    {
+        OSI_POOL_INIT(small_storage, 8, 1),
+        OSI_POOL_INIT(large_storage, 64, 2)
+    };
+    void* small;
+    void* large;
+    void* spill;
+    uint8_t outside[8];
+
+    small = osi_PoolAllocSize(pools, 2, 8);
+    CHECK(osi_PoolOwns(&pools[0], small));
+
+    /* The small class is empty, the next one that fits takes it */
+    spill = osi_PoolAllocSize(pools, 2, 4);
+    CHECK(osi_PoolOwns(&pools[1], spill));
+    large = osi_PoolAllocSize(pools, 2, 64);
+    CHECK(osi_PoolOwns(&pools[1], large));
+    CHECK(osi_PoolAllocSize(pools, 2, 4) == NULL);
+    CHECK(osi_PoolAllocSize(pools, 2, 65) == NULL);
+
+    CHECK(osi_PoolFreeAny(pools, 2, spill));
+    CHECK(pools[1].ulUsed == 1);
+    /* Still its pool's, so the caller must not hand it to the heap */
+    CHECK(osi_PoolFreeAny(pools, 2, spill));
+    CHECK(pools[1].ulUsed == 1);
+    CHECK(!osi_PoolFreeAny(pools, 2, outside));
+
+    CHECK(osi_PoolFreeAny(pools, 2, small));
+    CHECK(osi_PoolFreeAny(pools, 2, large));
+    CHECK(pools[0].ulUsed == 0);
+    CHECK(pools[1].ulUsed == 0);
+}
@@ -0,0 +1,814 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "osi.h"
+/* For the sizes of the pools; errno.h and select() have the BSD names */
+#define SL_NO_BSD_API_NAMING
+#include "simplelink.h"
+#include "protocol.h"
+#include "driver.h"
+
+/*
+ * OSI layer of the SimpleLink driver on pthreads, for the host build. Same
+ * contract as cc3100/oslib/osi_freertos.c, which it replaces:
+ *  - a sync object is a latched flag and the futex word of the thread
+ *    waiting on it, the counterpart of the board's task notifications;
+ *    with OSI_SYNC_NOTIFY=0 it is a binary semaphore, as the board's was.
+ *    A wait that times out returns OSI_OPERATION_FAILED;
+ *  - a lock object is a binary semaphore that starts given, so unlike a
+ *    pthread mutex it may be released by another thread;
+ *  - osi_Spawn queues the call for a single spawn thread, without ever
+ *    blocking, because it is called from the IRQ handler. The queue is the
+ *    lock-free ring of the board, with a futex word in place of the task
+ *    notification bit. As on the board a full ring loses the call;
+ *  - sync and lock objects, and what the driver allocates with mem_Malloc,
+ *    come from the fixed-block pools of osi_pool.h with the capacities of
+ *    osi_freertos.c, so running out of them shows here first.
+ * Timeouts are in milliseconds, measured on CLOCK_MONOTONIC.
+ */
+
+/*----------------------------------------------------------------------------*/
+
+/* osi_freertos.c has 8, the spawn thread here may be preempted for longer */
+#define OSI_SPAWN_RING_SIZE         ( 16 )
+#define OSI_SPAWN_RING_MASK         ( OSI_SPAWN_RING_SIZE - 1 )
+
+/* Sync objects on futex words (1) or on semaphores (0), as in osi_freertos.c */
+#ifndef OSI_SYNC_NOTIFY
+#define OSI_SYNC_NOTIFY             ( 1 )
+#endif
+
+/* Pool capacities of osi_freertos.c */
+#define OSI_POOL_SYNC_OBJS          ( 2 + MAX_CONCURRENT_ACTIONS + 2 )
+#if (OSI_SYNC_NOTIFY)
+#define OSI_POOL_SEMAPHORES         ( 3 + 1 + 2 )
+#else
+#define OSI_POOL_SEMAPHORES         ( 3 + 1 + 2 + MAX_CONCURRENT_ACTIONS )
+#endif
+#define OSI_POOL_ASYNC_BUFS         ( 1 )
+#define OSI_MEM_POOLS               ( 2 )
+
+/*----------------------------------------------------------------------------*/
+
+typedef struct
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool given;
+} osi_semaphore_t;
+
+/* tOsiSyncObj of osi_freertos.c, with a thread's futex word for its task */
+typedef struct
+{
+    uint32_t given;
+    uint32_t* waiter;
+    void* shared;
+} osi_sync_t;
+
+/* Lap as in osi_freertos.c: base free, base + 1 published, below base full */
+typedef struct
+{
+    uint32_t lap;
+    P_OSI_SPAWN_ENTRY pEntry;
+    void* pValue;
+} osi_spawn_slot_t;
+
+/*----------------------------------------------------------------------------*/
+
+static pthread_mutex_t spawn_lock = PTHREAD_MUTEX_INITIALIZER;
+static osi_spawn_slot_t spawn_ring[OSI_SPAWN_RING_SIZE];
+static uint32_t spawn_tail;
+static uint32_t spawn_head;
+static uint32_t spawn_dropped;
+/* 1 when there may be something to run, the spawn thread sleeps on 0 */
+static uint32_t spawn_notified;
+static bool spawn_started;
+static pthread_t spawn_thread;
+
+/* Only there for osi.h, the queue is spawn_ring */
+void* xSimpleLinkSpawnQueue = NULL;
+
+#if (OSI_SYNC_NOTIFY)
+/* Notification of the calling thread, 1 when a sync object was signalled */
+static __thread uint32_t sync_notified;
+#endif
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+#if (OSI_SYNC_NOTIFY)
+OSI_POOL_STORAGE(sync_storage, sizeof(osi_sync_t), OSI_POOL_SYNC_OBJS);
+static OsiPool_t sync_pool = OSI_POOL_INIT(sync_storage, sizeof(osi_sync_t), OSI_POOL_SYNC_OBJS);
+#endif
+OSI_POOL_STORAGE(semaphore_storage, sizeof(osi_semaphore_t), OSI_POOL_SEMAPHORES);
+static OsiPool_t semaphore_pool = OSI_POOL_INIT(semaphore_storage, sizeof(osi_semaphore_t), OSI_POOL_SEMAPHORES);
+/* Size classes of mem_Malloc, in increasing block size */
+OSI_POOL_STORAGE(async_buf_storage, SL_ASYNC_MAX_MSG_LEN, OSI_POOL_ASYNC_BUFS);
+OSI_POOL_STORAGE(driver_cb_storage, sizeof(_SlDriverCb_t), 1);
+static OsiPool_t mem_pools[OSI_MEM_POOLS] =
+{
+    OSI_POOL_INIT(async_buf_storage, SL_ASYNC_MAX_MSG_LEN, OSI_POOL_ASYNC_BUFS),
+    OSI_POOL_INIT(driver_cb_storage, sizeof(_SlDriverCb_t), 1)
+};
+static OsiPool_t* const pools[OSI_POOL_COUNT] =
+{
+#if (OSI_SYNC_NOTIFY)
+    &sync_pool,
+#else
+    NULL,
+#endif
+    &semaphore_pool,
+    &mem_pools[1],
+    &mem_pools[0]
+};
+
+/*----------------------------------------------------------------------------*/
+
+static void* osi_PoolTake(OsiPool_t* pool);
+static void osi_PoolGive(OsiPool_t* pool, void* block);
+static OsiReturnVal_e osi_SemaphoreCreate(void** pObj, bool given);
+static OsiReturnVal_e osi_SemaphoreDelete(void** pObj);
+static OsiReturnVal_e osi_SemaphoreGive(void** pObj);
+static OsiReturnVal_e osi_SemaphoreTake(void** pObj, OsiTime_t Timeout);
+static void osi_Deadline(struct timespec* deadline, OsiTime_t Timeout);
+#if (OSI_SYNC_NOTIFY)
+static bool osi_Remaining(const struct timespec* deadline, struct timespec* remaining);
+static OsiReturnVal_e osi_SyncCreate(void** pObj);
+static OsiReturnVal_e osi_SyncDelete(void** pObj);
+static OsiReturnVal_e osi_SyncSignal(void** pObj);
+static OsiReturnVal_e osi_SyncWait(void** pObj, OsiTime_t Timeout);
+#endif
+static void* vSimpleLinkSpawnTask(void* pvParameters);
+
+/*----------------------------------------------------------------------------*/
+
+#if (OSI_SYNC_NOTIFY)
+
+OsiReturnVal_e osi_SyncObjCreate(OsiSyncObj_t* pSyncObj)
+{
+    return osi_SyncCreate(pSyncObj);
+}
+
+/*----------------------------------------------------------------------------*/
+
+OsiReturnVal_e osi_SyncObjDelete(OsiSyncObj_t* pSyncObj)
+{
+    return osi_SyncDelete(pSyncObj);
+}
+
+/*----------------------------------------------------------------------------*/
+
+OsiReturnVal_e osi_SyncObjSignal(OsiSyncObj_t* pSyncObj)
+{
+    return osi_SyncSignal(pSyncObj);
+}
+
+/*----------------------------------------------------------------------------*/
+
+OsiReturnVal_e osi_SyncObjSignalFromISR(OsiSyncObj_t* pSyncObj)
+{
+    return osi_SyncSignal(pSyncObj);
+}
+
+/*----------------------------------------------------------------------------*/
+
+OsiReturnVal_e osi_SyncObjWait(OsiSyncObj_t* pSyncObj , OsiTime_t Timeout)
+{
+    return osi_SyncWait(pSyncObj, Timeout);
+}
+
+/*----------------------------------------------------------------------------*/
+
+OsiReturnVal_e osi_SyncObjClear(OsiSyncObj_t* pSyncObj)
+{
+    return osi_SyncWait(pSyncObj, OSI_NO_WAIT);
+}
+
+#else
+
+OsiReturnVal_e osi_SyncObjCreate(OsiSyncObj_t* pSyncObj)
+{
+    return osi_SemaphoreCreate(pSyncObj, false);
+}
+
+/*----------------------------------------------------------------------------*/
+
+OsiReturnVal_e osi_SyncObjDelete(OsiSyncObj_t* pSyncObj)
+{
+    return osi_SemaphoreDelete(pSyncObj);
+}
+
+/*----------------------------------------------------------------------------*/
+
+OsiReturnVal_e osi_SyncObjSignal(OsiSyncObj_t* pSyncObj)
+{
+    return osi_SemaphoreGive(pSyncObj);
+}
+
+/*----------------------------------------------------------------------------*/
+
+OsiReturnVal_e osi_SyncObjSignalFromISR(OsiSyncObj_t* pSyncObj)
+{
+    return osi_SemaphoreGive(pSyncObj);
+}
+
+/*----------------------------------------------------------------------------*/
+
+OsiReturnVal_e osi_SyncObjWait(OsiSyncObj_t* pSyncObj , OsiTime_t Timeout)
+{
+    return osi_SemaphoreTake(pSyncObj, Timeout);
+}
+
+/*----------------------------------------------------------------------------*/
+
+OsiReturnVal_e osi_SyncObjClear(OsiSyncObj_t* pSyncObj)
+{
+    return osi_SemaphoreTake(pSyncObj, OSI_NO_WAIT);
+}
+
+#endif
+
+/*----------------------------------------------------------------------------*/
+
+OsiReturnVal_e osi_LockObjCreate(OsiLockObj_t* pLockObj)
+{
+    return osi_SemaphoreCreate(pLockObj, true);
+}
+
+/*----------------------------------------------------------------------------*/
+
+OsiReturnVal_e osi_LockObjDelete(OsiLockObj_t* pLockObj)
+{
+    return osi_SemaphoreDelete(pLockObj);
+}
+
+/*----------------------------------------------------------------------------*/
+
+OsiReturnVal_e osi_LockObjLock(OsiLockObj_t* pLockObj , OsiTime_t Timeout)
+{
+    return osi_SemaphoreTake(pLockObj, Timeout);
+}
+
+/*----------------------------------------------------------------------------*/
+
+OsiReturnVal_e osi_LockObjUnlock(OsiLockObj_t* pLockObj)
+{
+    return osi_SemaphoreGive(pLockObj);
+}
+
+/*----------------------------------------------------------------------------*/
+
+OsiReturnVal_e osi_Spawn(P_OSI_SPAWN_ENTRY pEntry , void* pValue , unsigned long flags)
+{
+    osi_spawn_slot_t* slot;
+    uint32_t position;
+    int32_t difference;
+
+    (void) flags;
+
+    /* Claim the next position, another producer may take it first */
+    position = __atomic_load_n(&spawn_tail, __ATOMIC_RELAXED);
+    for (;;)
+    {
+        slot = &spawn_ring[position & OSI_SPAWN_RING_MASK];
+        difference = (int32_t) (__atomic_load_n(&slot->lap, __ATOMIC_ACQUIRE) -
+                                (position & ~OSI_SPAWN_RING_MASK));
+        if (difference < 0)
+        {
+            __atomic_fetch_add(&spawn_dropped, 1, __ATOMIC_RELAXED);
+            return OSI_OPERATION_FAILED;
+        }
+        if (difference == 0 &&
+            __atomic_compare_exchange_n(&spawn_tail, &position, position + 1, false,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        {
+            break;
+        }
+        if (difference > 0)
+        {
+            position = __atomic_load_n(&spawn_tail, __ATOMIC_RELAXED);
+        }
+    }
+
+    slot->pEntry = pEntry;
+    slot->pValue = pValue;
+    __atomic_store_n(&slot->lap, (position & ~OSI_SPAWN_RING_MASK) + 1, __ATOMIC_RELEASE);
+
+    /* Only the first call after the spawn thread went to sleep wakes it */
+    if (__atomic_exchange_n(&spawn_notified, 1, __ATOMIC_SEQ_CST) == 0)
+    {
+        syscall(SYS_futex, &spawn_notified, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+    }
+
+    return OSI_OK;
+}
+
+/*----------------------------------------------------------------------------*/
+
+unsigned long osi_SpawnDropped(void)
+{
+    return __atomic_load_n(&spawn_dropped, __ATOMIC_RELAXED);
+}
+
+/*----------------------------------------------------------------------------*/
+
+OsiReturnVal_e VStartSimpleLinkSpawnTask(unsigned portBASE_TYPE uxPriority)
+{
+    OsiReturnVal_e status = OSI_OK;
+
+    (void) uxPriority;
+
+    pthread_mutex_lock(&spawn_lock);
+    if (!spawn_started)
+    {
+        if (pthread_create(&spawn_thread, NULL, vSimpleLinkSpawnTask, NULL) == 0)
+        {
+            pthread_detach(spawn_thread);
+            spawn_started = true;
+        }
+        else
+        {
+            status = OSI_OPERATION_FAILED;
+        }
+    }
+    pthread_mutex_unlock(&spawn_lock);
+
+    return status;
+}
+
+/*----------------------------------------------------------------------------*/
+
+void osi_Sleep(unsigned int MilliSecs)
+{
+    struct timespec delay;
+
+    delay.tv_sec = MilliSecs / 1000;
+    delay.tv_nsec = (long) (MilliSecs % 1000) * 1000000L;
+    while (nanosleep(&delay, &delay) < 0 && errno == EINTR)
+    {
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+void* mem_Malloc(unsigned long Size)
+{
+    void* block;
+
+    /* The driver's sizes never fall back on malloc, as on the board */
+    if (Size <= mem_pools[OSI_MEM_POOLS - 1].ulBlockSize)
+    {
+        pthread_mutex_lock(&pool_lock);
+        block = osi_PoolAllocSize(mem_pools, OSI_MEM_POOLS, (size_t) Size);
+        pthread_mutex_unlock(&pool_lock);
+        return block;
+    }
+
+    return malloc(Size);
+}
+
+/*----------------------------------------------------------------------------*/
+
+void mem_Free(void* pMem)
+{
+    bool pooled;
+
+    pthread_mutex_lock(&pool_lock);
+    pooled = osi_PoolFreeAny(mem_pools, OSI_MEM_POOLS, pMem);
+    pthread_mutex_unlock(&pool_lock);
+
+    if (!pooled)
+    {
+        free(pMem);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+OsiReturnVal_e osi_PoolStats(unsigned long Pool, OsiPool_t* pStats)
+{
+    if (pStats == NULL || Pool >= OSI_POOL_COUNT || pools[Pool] == NULL)
+    {
+        return OSI_INVALID_PARAMS;
+    }
+
+    pthread_mutex_lock(&pool_lock);
+    *pStats = *pools[Pool];
+    pthread_mutex_unlock(&pool_lock);
+
+    return OSI_OK;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void* osi_PoolTake(OsiPool_t* pool)
+{
+    void* block;
+
+    pthread_mutex_lock(&pool_lock);
+    block = osi_PoolAlloc(pool);
+    pthread_mutex_unlock(&pool_lock);
+
+    return block;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void osi_PoolGive(OsiPool_t* pool, void* block)
+{
+    pthread_mutex_lock(&pool_lock);
+    (void) osi_PoolFree(pool, block);
+    pthread_mutex_unlock(&pool_lock);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static OsiReturnVal_e osi_SemaphoreCreate(void** pObj, bool given)
+{
+    osi_semaphore_t* semaphore;
+    pthread_condattr_t attr;
+
+    if (pObj == NULL)
+    {
+        return OSI_INVALID_PARAMS;
+    }
+
+    semaphore = (osi_semaphore_t*) osi_PoolTake(&semaphore_pool);
+    if (semaphore == NULL)
+    {
+        return OSI_MEMORY_ALLOCATION_FAILURE;
+    }
+
+    pthread_mutex_init(&semaphore->mutex, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&semaphore->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    semaphore->given = given;
+
+    *pObj = semaphore;
+
+    return OSI_OK;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static OsiReturnVal_e osi_SemaphoreDelete(void** pObj)
+{
+    osi_semaphore_t* semaphore;
+
+    if (pObj == NULL || *pObj == NULL)
+    {
+        return OSI_INVALID_PARAMS;
+    }
+
+    semaphore = (osi_semaphore_t*) *pObj;
+    pthread_cond_destroy(&semaphore->cond);
+    pthread_mutex_destroy(&semaphore->mutex);
+    osi_PoolGive(&semaphore_pool, semaphore);
+    *pObj = NULL;
+
+    return OSI_OK;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static OsiReturnVal_e osi_SemaphoreGive(void** pObj)
+{
+    osi_semaphore_t* semaphore;
+
+    if (pObj == NULL || *pObj == NULL)
+    {
+        return OSI_INVALID_PARAMS;
+    }
+
+    semaphore = (osi_semaphore_t*) *pObj;
+    pthread_mutex_lock(&semaphore->mutex);
+    semaphore->given = true;
+    pthread_cond_signal(&semaphore->cond);
+    pthread_mutex_unlock(&semaphore->mutex);
+
+    return OSI_OK;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static OsiReturnVal_e osi_SemaphoreTake(void** pObj, OsiTime_t Timeout)
+{
+    osi_semaphore_t* semaphore;
+    struct timespec deadline;
+    OsiReturnVal_e status = OSI_OK;
+
+    if (pObj == NULL || *pObj == NULL)
+    {
+        return OSI_INVALID_PARAMS;
+    }
+
+    if (Timeout != OSI_WAIT_FOREVER)
+    {
+        osi_Deadline(&deadline, Timeout);
+    }
+
+    semaphore = (osi_semaphore_t*) *pObj;
+    pthread_mutex_lock(&semaphore->mutex);
+    while (!semaphore->given)
+    {
+        if (Timeout == OSI_WAIT_FOREVER)
+        {
+            pthread_cond_wait(&semaphore->cond, &semaphore->mutex);
+        }
+        else if (Timeout == OSI_NO_WAIT ||
+                 (pthread_cond_timedwait(&semaphore->cond, &semaphore->mutex, &deadline) == ETIMEDOUT &&
+                  !semaphore->given))
+        {
+            status = OSI_OPERATION_FAILED;
+            break;
+        }
+    }
+    if (status == OSI_OK)
+    {
+        semaphore->given = false;
+    }
+    pthread_mutex_unlock(&semaphore->mutex);
+
+    return status;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void osi_Deadline(struct timespec* deadline, OsiTime_t Timeout)
+{
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec += Timeout / 1000;
+    deadline->tv_nsec += (long) (Timeout % 1000) * 1000000L;
+    if (deadline->tv_nsec >= 1000000000L)
+    {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+#if (OSI_SYNC_NOTIFY)
+
+/* False once the deadline has passed */
+static bool osi_Remaining(const struct timespec* deadline, struct timespec* remaining)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    remaining->tv_sec = deadline->tv_sec - now.tv_sec;
+    remaining->tv_nsec = deadline->tv_nsec - now.tv_nsec;
+    if (remaining->tv_nsec < 0)
+    {
+        remaining->tv_sec--;
+        remaining->tv_nsec += 1000000000L;
+    }
+
+    return remaining->tv_sec >= 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static OsiReturnVal_e osi_SyncCreate(void** pObj)
+{
+    osi_sync_t* sync;
+
+    if (pObj == NULL)
+    {
+        return OSI_INVALID_PARAMS;
+    }
+
+    sync = (osi_sync_t*) osi_PoolTake(&sync_pool);
+    if (sync == NULL)
+    {
+        return OSI_MEMORY_ALLOCATION_FAILURE;
+    }
+    memset(sync, 0, sizeof(*sync));
+
+    *pObj = sync;
+
+    return OSI_OK;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static OsiReturnVal_e osi_SyncDelete(void** pObj)
+{
+    osi_sync_t* sync;
+
+    if (pObj == NULL || *pObj == NULL)
+    {
+        return OSI_INVALID_PARAMS;
+    }
+
+    sync = (osi_sync_t*) *pObj;
+    if (sync->shared != NULL)
+    {
+        osi_SemaphoreDelete(&sync->shared);
+    }
+    osi_PoolGive(&sync_pool, sync);
+    *pObj = NULL;
+
+    return OSI_OK;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static OsiReturnVal_e osi_SyncSignal(void** pObj)
+{
+    osi_sync_t* sync;
+    uint32_t* waiter;
+    void* shared;
+
+    if (pObj == NULL || *pObj == NULL)
+    {
+        return OSI_INVALID_PARAMS;
+    }
+
+    /* Latched first, a waiter registered after the load below finds it set */
+    sync = (osi_sync_t*) *pObj;
+    __atomic_store_n(&sync->given, 1, __ATOMIC_SEQ_CST);
+
+    waiter = __atomic_load_n(&sync->waiter, __ATOMIC_SEQ_CST);
+    if (waiter != NULL && __atomic_exchange_n(waiter, 1, __ATOMIC_SEQ_CST) == 0)
+    {
+        syscall(SYS_futex, waiter, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+    }
+
+    shared = __atomic_load_n(&sync->shared, __ATOMIC_SEQ_CST);
+    if (shared != NULL)
+    {
+        osi_SemaphoreGive(&shared);
+    }
+
+    return OSI_OK;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static OsiReturnVal_e osi_SyncWait(void** pObj, OsiTime_t Timeout)
+{
+    osi_sync_t* sync;
+    uint32_t* waiter = NULL;
+    void* shared = NULL;
+    void* none = NULL;
+    struct timespec deadline, remaining;
+    bool second;
+    OsiReturnVal_e status;
+
+    if (pObj == NULL || *pObj == NULL)
+    {
+        return OSI_INVALID_PARAMS;
+    }
+
+    /* Signalled already, often the case for a command response */
+    sync = (osi_sync_t*) *pObj;
+    if (__atomic_exchange_n(&sync->given, 0, __ATOMIC_SEQ_CST) != 0)
+    {
+        return OSI_OK;
+    }
+    if (Timeout == OSI_NO_WAIT)
+    {
+        return OSI_OPERATION_FAILED;
+    }
+    if (Timeout != OSI_WAIT_FOREVER)
+    {
+        osi_Deadline(&deadline, Timeout);
+    }
+
+    /* A thread that finds another one registered sleeps on the shared semaphore, */
+    /* or looks at given once a millisecond when the pool has none left for it    */
+    second = !__atomic_compare_exchange_n(&sync->waiter, &waiter, &sync_notified, false,
+                                          __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST) &&
+             waiter != &sync_notified;
+    if (second && __atomic_load_n(&sync->shared, __ATOMIC_SEQ_CST) == NULL &&
+        osi_SemaphoreCreate(&shared, false) == OSI_OK)
+    {
+        if (!__atomic_compare_exchange_n(&sync->shared, &none, shared, false,
+                                         __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+        {
+            osi_SemaphoreDelete(&shared);
+        }
+    }
+    shared = __atomic_load_n(&sync->shared, __ATOMIC_SEQ_CST);
+
+    /* Registered before given is read, so a signal is seen one way or the other */
+    for (;;)
+    {
+        if (__atomic_exchange_n(&sync->given, 0, __ATOMIC_SEQ_CST) != 0)
+        {
+            status = OSI_OK;
+            break;
+        }
+        if (Timeout != OSI_WAIT_FOREVER && !osi_Remaining(&deadline, &remaining))
+        {
+            status = OSI_OPERATION_FAILED;
+            break;
+        }
+        if (second && shared != NULL)
+        {
+            osi_SemaphoreTake(&shared, (Timeout == OSI_WAIT_FOREVER) ? OSI_WAIT_FOREVER :
+                              (OsiTime_t) (remaining.tv_sec * 1000 + remaining.tv_nsec / 1000000L + 1));
+        }
+        else if (second)
+        {
+            osi_Sleep(1);
+        }
+        else if (__atomic_exchange_n(&sync_notified, 0, __ATOMIC_SEQ_CST) == 0)
+        {
+            syscall(SYS_futex, &sync_notified, FUTEX_WAIT_PRIVATE, 0,
+                    (Timeout == OSI_WAIT_FOREVER) ? NULL : &remaining, NULL, 0);
+        }
+    }
+
+    if (!second)
+    {
+        __atomic_store_n(&sync->waiter, NULL, __ATOMIC_SEQ_CST);
+    }
+
+    return status;
+}
+
+#endif
+
+/*----------------------------------------------------------------------------*/
+
+static void* vSimpleLinkSpawnTask(void* pvParameters)
+{
+    osi_spawn_slot_t* slot;
+    P_OSI_SPAWN_ENTRY pEntry;
+    void* pValue;
+
+    (void) pvParameters;
+
+    for (;;)
+    {
+        /* Run the calls in order up to the first one not published yet */
+        slot = &spawn_ring[spawn_head & OSI_SPAWN_RING_MASK];
+        while (__atomic_load_n(&slot->lap, __ATOMIC_ACQUIRE) == (spawn_head & ~OSI_SPAWN_RING_MASK) + 1)
+        {
+            pEntry = slot->pEntry;
+            pValue = slot->pValue;
+            __atomic_store_n(&slot->lap, (spawn_head & ~OSI_SPAWN_RING_MASK) + OSI_SPAWN_RING_SIZE,
+                             __ATOMIC_RELEASE);
+            spawn_head++;
+
+            pEntry(pValue);
+
+            slot = &spawn_ring[spawn_head & OSI_SPAWN_RING_MASK];
+        }
+
+        /* Something published since the ring was read leaves the word at 1 */
+        if (__atomic_exchange_n(&spawn_notified, 0, __ATOMIC_SEQ_CST) == 0)
+        {
+            syscall(SYS_futex, &spawn_notified, FUTEX_WAIT_PRIVATE, 0, NULL, NULL, 0);
+        }
+    }
+
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,893 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <queue>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "pingpong_histogram.h"
+
+/*
+ * Load generator that stands in for many PingPong boards at once.
+ *
+ * Every emulated client runs the TCP client of PAC2_enunciat/main.c: it
+ * connects, sends "PING <n>" padded to 16 bytes, expects "PONG <n>" back,
+ * and closes after PING_NUMBER PONGs. Then it reconnects and starts a new
+ * session, which gives the connection churn. Clients are spread over
+ * worker threads, each with its own epoll loop and timer heap.
+ *
+ * Two ways to pace the PINGs:
+ *  - closed loop (default): the next PING leaves one think time after the
+ *    previous PONG, like the board does;
+ *  - open loop (-r): PINGs arrive at a fixed total rate (Poisson) whatever
+ *    the server does. If the server falls behind, PINGs wait in the client.
+ *
+ * Latency is measured from the time a PING was due, not from the time it was
+ * finally written, so a stalled server is charged for every PING it delayed
+ * (no coordinated omission). The service time from the actual write is kept
+ * apart to show the difference. Both are written as HdrHistogram percentile
+ * distributions, in milliseconds, which the usual HdrHistogram plotters read.
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#define LOAD_ADDRESS            ( "127.0.0.1" )
+#define LOAD_PORT               ( 5005 )
+#define LOAD_CLIENTS            ( 100 )
+#define LOAD_DURATION_S         ( 10 )
+#define LOAD_RAMP_MS            ( 1000 )
+#define LOAD_REPORT_S           ( 1 )
+
+/* Same values as the board: 16 byte PINGs, 10 per connection */
+#define PING_SIZE               ( 16 )
+#define PING_NUMBER             ( 10 )
+
+/* Wait before reconnecting after an error, so a dead server is not hammered */
+#define LOAD_RETRY_US           ( 100000 )
+
+#define LOAD_READ_SIZE          ( 4096 )
+#define LOAD_EVENTS             ( 1024 )
+#define LOAD_WAIT_MS            ( 100 )
+
+/* HdrHistogram output: five reporting ticks per halving of the remaining percentiles */
+#define HDR_TICKS               ( 5 )
+#define HDR_SCALE               ( 1000.0 )
+
+/*----------------------------------------------------------------------------*/
+
+struct load_config_t
+{
+    struct sockaddr_in address;
+    unsigned clients = LOAD_CLIENTS;
+    unsigned threads = 1;
+
+    /* PINGs per session, 0 keeps the connection for the whole run */
+    unsigned pings = PING_NUMBER;
+
+    /* Mean think time in microseconds, exponentially distributed */
+    uint64_t think_us = 0;
+
+    /* Total PINGs per second over all clients, 0 = closed loop */
+    double rate = 0;
+
+    uint64_t ramp_us = LOAD_RAMP_MS * 1000ull;
+};
+
+enum load_state_t
+{
+    CLIENT_IDLE,
+    CLIENT_CONNECTING,
+    CLIENT_ACTIVE
+};
+
+struct load_client_t
+{
+    int fd = -1;
+    load_state_t state = CLIENT_IDLE;
+    uint64_t connect_start = 0;
+
+    /* PINGs sent and PONGs received in this session */
+    uint32_t sent = 0;
+    uint32_t received = 0;
+
+    /* Due times of the PINGs not written yet, and of those awaiting a PONG */
+    std::deque<uint64_t> backlog;
+    std::deque<uint64_t> due;
+    std::deque<uint64_t> written;
+
+    /* Bytes the socket did not take yet, and a PONG split across reads */
+    std::vector<uint8_t> out;
+    std::vector<uint8_t> in;
+    bool out_blocked = false;
+};
+
+enum load_timer_kind_t
+{
+    TIMER_CONNECT,
+    TIMER_ARRIVAL
+};
+
+struct load_timer_t
+{
+    uint64_t when;
+    uint32_t client;
+    load_timer_kind_t kind;
+
+    bool operator>(const load_timer_t& other) const { return when > other.when; }
+};
+
+/* Counters read live by the reporter, histograms merged once at the end */
+struct alignas(64) load_stats_t
+{
+    std::atomic<uint64_t> sessions{0};
+    std::atomic<uint64_t> pings{0};
+    std::atomic<uint64_t> pongs{0};
+    std::atomic<uint64_t> errors{0};
+
+    pingpong_histogram_t latency;
+    pingpong_histogram_t service;
+    pingpong_histogram_t connect;
+};
+
+struct load_loop_t
+{
+    const load_config_t& config;
+    load_stats_t& stats;
+    int epoll_fd;
+    std::vector<load_client_t> clients;
+    std::priority_queue<load_timer_t, std::vector<load_timer_t>, std::greater<load_timer_t>> timers;
+    std::mt19937_64 random;
+
+    /* Mean time between PINGs of one client in open loop */
+    double interval_us;
+};
+
+/*----------------------------------------------------------------------------*/
+
+static std::atomic<bool> stop(false);
+
+/*----------------------------------------------------------------------------*/
+
+static void usage(const char* name);
+static void on_signal(int signal);
+static uint64_t now_us(void);
+static void stats_add(std::atomic<uint64_t>& counter, uint64_t value);
+static void worker(const load_config_t& config, load_stats_t& stats, unsigned clients, unsigned seed);
+static uint64_t loop_exponential(load_loop_t& loop, double mean);
+static void loop_connect(load_loop_t& loop, uint32_t index, uint64_t now);
+static void loop_connected(load_loop_t& loop, uint32_t index, uint64_t now);
+static void loop_arrival(load_loop_t& loop, uint32_t index, uint64_t now);
+static void loop_send(load_loop_t& loop, load_client_t& client, uint64_t now);
+static bool loop_flush(load_loop_t& loop, load_client_t& client);
+static bool loop_read(load_loop_t& loop, uint32_t index, uint64_t now);
+static void loop_close(load_loop_t& loop, uint32_t index, uint64_t now, bool failed);
+static void hdr_write(const char* path, const pingpong_histogram_t& histogram);
+
+/*----------------------------------------------------------------------------*/
+
+int main(int argc, char** argv)
+{
+    const char* address = LOAD_ADDRESS;
+    const char* output = NULL;
+    uint16_t port = LOAD_PORT;
+    unsigned duration = LOAD_DURATION_S;
+    unsigned interval = LOAD_REPORT_S;
+    load_config_t config;
+    std::vector<std::thread> threads;
+    pingpong_histogram_t latency, service, connect;
+    uint64_t last_pongs = 0, pongs, sessions, pings, errors;
+    struct rlimit limit;
+    char line[160];
+    char path[256];
+    unsigned i, elapsed;
+    int option;
+
+    config.threads = std::thread::hardware_concurrency();
+
+    while ((option = getopt(argc, argv, "a:p:c:t:n:k:r:d:R:i:o:h")) != -1)
+    {
+        switch (option)
+        {
+        case 'a':
+            address = optarg;
+            break;
+        case 'p':
+            port = (uint16_t) atoi(optarg);
+            break;
+        case 'c':
+            config.clients = (unsigned) atoi(optarg);
+            break;
+        case 't':
+            config.threads = (unsigned) atoi(optarg);
+            break;
+        case 'n':
+            config.pings = (unsigned) atoi(optarg);
+            break;
+        case 'k':
+            config.think_us = (uint64_t) (atof(optarg) * 1000.0);
+            break;
+        case 'r':
+            config.rate = atof(optarg);
+            break;
+        case 'd':
+            duration = (unsigned) atoi(optarg);
+            break;
+        case 'R':
+            config.ramp_us = (uint64_t) atoi(optarg) * 1000ull;
+            break;
+        case 'i':
+            interval = (unsigned) atoi(optarg);
+            break;
+        case 'o':
+            output = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return (option == 'h') ? 0 : 1;
+        }
+    }
+    if (config.clients == 0 || config.rate < 0)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    if (config.threads == 0)
+    {
+        config.threads = 1;
+    }
+    if (config.threads > config.clients)
+    {
+        config.threads = config.clients;
+    }
+
+    memset(&config.address, 0, sizeof(config.address));
+    config.address.sin_family = AF_INET;
+    config.address.sin_port = htons(port);
+    if (inet_pton(AF_INET, address, &config.address.sin_addr) != 1)
+    {
+        fprintf(stderr, "malformed address %s\n", address);
+        return 1;
+    }
+
+    /* One descriptor per client, take everything we are allowed to */
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    signal(SIGPIPE, SIG_IGN);
+
+    if (config.rate > 0)
+    {
+        fprintf(stderr, "%u clients on %u threads, open loop at %.0f PINGs/s\n",
+                config.clients, config.threads, config.rate);
+    }
+    else
+    {
+        fprintf(stderr, "%u clients on %u threads, closed loop with %.1f ms think time\n",
+                config.clients, config.threads, config.think_us / 1000.0);
+    }
+
+    std::unique_ptr<load_stats_t[]> stats(new load_stats_t[config.threads]);
+
+    for (i = 0; i < config.threads; i++)
+    {
+        /* Spread the remainder so no thread has more than one extra client */
+        unsigned clients = config.clients / config.threads + (i < config.clients % config.threads);
+        threads.emplace_back(worker, std::cref(config), std::ref(stats[i]), clients, i);
+    }
+
+    /* The workers stop on their own once stop is set */
+    for (elapsed = 0; elapsed < duration && !stop.load(); elapsed++)
+    {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+
+        if (interval > 0 && (elapsed + 1) % interval == 0)
+        {
+            for (pongs = sessions = errors = 0, i = 0; i < config.threads; i++)
+            {
+                pongs += stats[i].pongs.load(std::memory_order_relaxed);
+                sessions += stats[i].sessions.load(std::memory_order_relaxed);
+                errors += stats[i].errors.load(std::memory_order_relaxed);
+            }
+            fprintf(stderr, "sessions=%llu pongs/s=%llu errors=%llu\n",
+                    (unsigned long long) sessions,
+                    (unsigned long long) ((pongs - last_pongs) / interval),
+                    (unsigned long long) errors);
+            last_pongs = pongs;
+        }
+    }
+    stop.store(true);
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    pingpong_histogram_reset(&latency);
+    pingpong_histogram_reset(&service);
+    pingpong_histogram_reset(&connect);
+    for (sessions = pings = pongs = errors = 0, i = 0; i < config.threads; i++)
+    {
+        sessions += stats[i].sessions.load();
+        pings += stats[i].pings.load();
+        pongs += stats[i].pongs.load();
+        errors += stats[i].errors.load();
+        pingpong_histogram_merge(&latency, &stats[i].latency);
+        pingpong_histogram_merge(&service, &stats[i].service);
+        pingpong_histogram_merge(&connect, &stats[i].connect);
+    }
+
+    printf("clients=%u sessions=%llu pings=%llu pongs=%llu pongs/s=%.0f errors=%llu\n",
+           config.clients, (unsigned long long) sessions, (unsigned long long) pings,
+           (unsigned long long) pongs, elapsed ? (double) pongs / elapsed : 0.0,
+           (unsigned long long) errors);
+    pingpong_histogram_format(&latency, line, sizeof(line));
+    printf("latency us: %s\n", line);
+    pingpong_histogram_format(&service, line, sizeof(line));
+    printf("service us: %s\n", line);
+    pingpong_histogram_format(&connect, line, sizeof(line));
+    printf("connect us: %s\n", line);
+
+    if (output != NULL)
+    {
+        snprintf(path, sizeof(path), "%s.latency.hgrm", output);
+        hdr_write(path, latency);
+        snprintf(path, sizeof(path), "%s.service.hgrm", output);
+        hdr_write(path, service);
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void usage(const char* name)
+{
+    fprintf(stderr,
+            "usage: %s [-a address] [-p port] [-c clients] [-t threads] [-n pings]\n"
+            "          [-k think_ms] [-r rate] [-d seconds] [-R ramp_ms] [-i seconds] [-o prefix]\n"
+            "  -a  server address (default %s)\n"
+            "  -p  TCP port (default %u)\n"
+            "  -c  emulated clients (default %u)\n"
+            "  -t  worker threads (default one per core)\n"
+            "  -n  PINGs per connection before reconnecting, 0 = never (default %u)\n"
+            "  -k  mean think time in ms between a PONG and the next PING or session (default 0)\n"
+            "  -r  open loop: total PINGs per second over all clients (default closed loop)\n"
+            "  -d  duration in seconds (default %u)\n"
+            "  -R  spread the first connections over this many ms (default %u)\n"
+            "  -i  progress interval in seconds, 0 = off (default %u)\n"
+            "  -o  write <prefix>.latency.hgrm and <prefix>.service.hgrm\n",
+            name, LOAD_ADDRESS, LOAD_PORT, LOAD_CLIENTS, PING_NUMBER, LOAD_DURATION_S,
+            LOAD_RAMP_MS, LOAD_REPORT_S);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void on_signal(int signal)
+{
+    (void) signal;
+    stop.store(true);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static uint64_t now_us(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000ull + (uint64_t) now.tv_nsec / 1000;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void stats_add(std::atomic<uint64_t>& counter, uint64_t value)
+{
+    /* Only the owning worker writes, the reporter just reads */
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void worker(const load_config_t& config, load_stats_t& stats, unsigned clients, unsigned seed)
+{
+    load_loop_t loop = { config, stats, -1, {}, {}, std::mt19937_64(now_us() + seed), 0 };
+    struct epoll_event events[LOAD_EVENTS];
+    uint64_t now, start;
+    struct timespec timeout;
+    uint64_t wait;
+    int count, i;
+    uint32_t index;
+
+    pingpong_histogram_reset(&stats.latency);
+    pingpong_histogram_reset(&stats.service);
+    pingpong_histogram_reset(&stats.connect);
+
+    loop.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop.epoll_fd < 0)
+    {
+        perror("epoll_create1");
+        return;
+    }
+
+    loop.clients.resize(clients);
+    if (config.rate > 0)
+    {
+        loop.interval_us = 1e6 * config.clients / config.rate;
+    }
+
+    /* Random start within the ramp, so the server does not see every SYN at once */
+    start = now_us();
+    for (index = 0; index < clients; index++)
+    {
+        now = start + (config.ramp_us ? loop.random() % config.ramp_us : 0);
+        loop.timers.push({ now, index, TIMER_CONNECT });
+        if (config.rate > 0)
+        {
+            loop.timers.push({ now + loop_exponential(loop, loop.interval_us), index, TIMER_ARRIVAL });
+        }
+    }
+
+    while (!stop.load(std::memory_order_relaxed))
+    {
+        /* Fire whatever is due, then sleep until the next timer */
+        now = now_us();
+        while (!loop.timers.empty() && loop.timers.top().when <= now)
+        {
+            load_timer_t timer = loop.timers.top();
+            loop.timers.pop();
+            if (timer.kind == TIMER_CONNECT)
+            {
+                loop_connect(loop, timer.client, now);
+            }
+            else
+            {
+                loop_arrival(loop, timer.client, timer.when);
+            }
+        }
+
+        /* Microsecond timeout: a PING sent late is charged to the server */
+        wait = LOAD_WAIT_MS * 1000ull;
+        if (!loop.timers.empty())
+        {
+            wait = std::min<uint64_t>(loop.timers.top().when - now, wait);
+        }
+        timeout.tv_sec = 0;
+        timeout.tv_nsec = (long) wait * 1000;
+
+        count = epoll_pwait2(loop.epoll_fd, events, LOAD_EVENTS, &timeout, NULL);
+        now = now_us();
+        for (i = 0; i < count; i++)
+        {
+            index = events[i].data.u32;
+            load_client_t& client = loop.clients[index];
+
+            if (client.state == CLIENT_CONNECTING)
+            {
+                loop_connected(loop, index, now);
+                continue;
+            }
+            if ((events[i].events & EPOLLOUT) && !loop_flush(loop, client))
+            {
+                loop_close(loop, index, now, true);
+                continue;
+            }
+            if ((events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) && client.fd >= 0)
+            {
+                loop_read(loop, index, now);
+            }
+        }
+    }
+
+    for (auto& client : loop.clients)
+    {
+        if (client.fd >= 0)
+        {
+            close(client.fd);
+        }
+    }
+    close(loop.epoll_fd);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static uint64_t loop_exponential(load_loop_t& loop, double mean)
+{
+    if (mean <= 0)
+    {
+        return 0;
+    }
+    return (uint64_t) std::exponential_distribution<double>(1.0 / mean)(loop.random);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void loop_connect(load_loop_t& loop, uint32_t index, uint64_t now)
+{
+    load_client_t& client = loop.clients[index];
+    struct epoll_event event;
+    int one = 1;
+
+    client.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (client.fd < 0)
+    {
+        loop_close(loop, index, now, true);
+        return;
+    }
+    setsockopt(client.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    client.state = CLIENT_CONNECTING;
+    client.connect_start = now;
+    if (connect(client.fd, (const struct sockaddr*) &loop.config.address,
+                sizeof(loop.config.address)) < 0 && errno != EINPROGRESS)
+    {
+        loop_close(loop, index, now, true);
+        return;
+    }
+
+    /* Writable once the handshake is done */
+    event.events = EPOLLOUT;
+    event.data.u32 = index;
+    epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, client.fd, &event);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void loop_connected(load_loop_t& loop, uint32_t index, uint64_t now)
+{
+    load_client_t& client = loop.clients[index];
+    struct epoll_event event;
+    socklen_t length = sizeof(int);
+    int error = 0;
+
+    if (getsockopt(client.fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0)
+    {
+        loop_close(loop, index, now, true);
+        return;
+    }
+
+    pingpong_histogram_record(&loop.stats.connect,
+                              (uint32_t) std::min<uint64_t>(now - client.connect_start, UINT32_MAX));
+
+    client.state = CLIENT_ACTIVE;
+    client.sent = 0;
+    client.received = 0;
+    client.in.clear();
+    client.out.clear();
+    client.out_blocked = false;
+
+    event.events = EPOLLIN;
+    event.data.u32 = index;
+    epoll_ctl(loop.epoll_fd, EPOLL_CTL_MOD, client.fd, &event);
+
+    if (loop.config.rate > 0)
+    {
+        /* PINGs that came due while reconnecting go out now */
+        loop_send(loop, client, now);
+    }
+    else
+    {
+        /* Like the board, the first PING leaves right after connecting */
+        loop_arrival(loop, index, now);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void loop_arrival(load_loop_t& loop, uint32_t index, uint64_t when)
+{
+    load_client_t& client = loop.clients[index];
+
+    /* Closed loop: the connection this PING was meant for has failed meanwhile */
+    if (loop.config.rate == 0 && client.state != CLIENT_ACTIVE)
+    {
+        return;
+    }
+
+    client.backlog.push_back(when);
+
+    /* Open loop: the next PING is due regardless of how this one goes */
+    if (loop.config.rate > 0)
+    {
+        loop.timers.push({ when + loop_exponential(loop, loop.interval_us), index, TIMER_ARRIVAL });
+    }
+
+    if (client.state == CLIENT_ACTIVE)
+    {
+        loop_send(loop, client, now_us());
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void loop_send(load_loop_t& loop, load_client_t& client, uint64_t now)
+{
+    char ping[PING_SIZE];
+    uint32_t count = 0;
+
+    /* A session never sends more than its PINGs, the rest wait for the next one */
+    while (!client.backlog.empty() &&
+           (loop.config.pings == 0 || client.sent < loop.config.pings))
+    {
+        memset(ping, 0, sizeof(ping));
+        snprintf(ping, sizeof(ping), "PING %u", client.sent);
+        client.out.insert(client.out.end(), ping, ping + sizeof(ping));
+
+        client.due.push_back(client.backlog.front());
+        client.written.push_back(now);
+        client.backlog.pop_front();
+        client.sent++;
+        count++;
+    }
+    if (count == 0)
+    {
+        return;
+    }
+
+    stats_add(loop.stats.pings, count);
+    loop_flush(loop, client);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static bool loop_flush(load_loop_t& loop, load_client_t& client)
+{
+    struct epoll_event event;
+    ssize_t sent;
+    bool blocked = false;
+
+    if (!client.out.empty())
+    {
+        sent = send(client.fd, client.out.data(), client.out.size(), MSG_NOSIGNAL);
+        if (sent < 0 && errno != EAGAIN)
+        {
+            return false;
+        }
+        if (sent > 0)
+        {
+            client.out.erase(client.out.begin(), client.out.begin() + sent);
+        }
+        blocked = !client.out.empty();
+    }
+
+    /* Only ask for EPOLLOUT while the socket is full */
+    if (blocked != client.out_blocked)
+    {
+        event.events = EPOLLIN | (blocked ? (uint32_t) EPOLLOUT : 0u);
+        event.data.u32 = (uint32_t) (&client - loop.clients.data());
+        epoll_ctl(loop.epoll_fd, EPOLL_CTL_MOD, client.fd, &event);
+        client.out_blocked = blocked;
+    }
+
+    return true;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static bool loop_read(load_loop_t& loop, uint32_t index, uint64_t now)
+{
+    load_client_t& client = loop.clients[index];
+    uint8_t buffer[LOAD_READ_SIZE];
+    const char* pong;
+    char* end;
+    unsigned long seq;
+    ssize_t received;
+    size_t start = 0, i;
+    uint32_t pongs = 0;
+
+    received = recv(client.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if (received < 0 && (errno == EAGAIN || errno == EINTR))
+    {
+        return true;
+    }
+    if (received <= 0)
+    {
+        /* The server hung up in the middle of a session */
+        loop_close(loop, index, now, true);
+        return false;
+    }
+    client.in.insert(client.in.end(), buffer, buffer + received);
+
+    /* "PONG <n>\0", TCP may split or coalesce them */
+    for (i = 0; i < client.in.size(); i++)
+    {
+        if (client.in[i] != '\0')
+        {
+            continue;
+        }
+
+        pong = (const char*) &client.in[start];
+        start = i + 1;
+
+        seq = (strncmp(pong, "PONG ", 5) == 0) ? strtoul(pong + 5, &end, 10) : 0;
+        if (strncmp(pong, "PONG ", 5) != 0 || end == pong + 5 ||
+            client.due.empty() || seq != client.received)
+        {
+            loop_close(loop, index, now, true);
+            return false;
+        }
+
+        pingpong_histogram_record(&loop.stats.latency,
+                                  (uint32_t) std::min<uint64_t>(now - client.due.front(), UINT32_MAX));
+        pingpong_histogram_record(&loop.stats.service,
+                                  (uint32_t) std::min<uint64_t>(now - client.written.front(), UINT32_MAX));
+        client.due.pop_front();
+        client.written.pop_front();
+        client.received++;
+        pongs++;
+    }
+    client.in.erase(client.in.begin(), client.in.begin() + start);
+    stats_add(loop.stats.pongs, pongs);
+
+    if (loop.config.pings != 0 && client.received >= loop.config.pings)
+    {
+        /* Session done, the board closes its socket here */
+        loop_close(loop, index, now, false);
+        return false;
+    }
+
+    if (pongs > 0 && loop.config.rate == 0)
+    {
+        loop.timers.push({ now + loop_exponential(loop, (double) loop.config.think_us),
+                           index, TIMER_ARRIVAL });
+    }
+    else if (loop.config.rate > 0)
+    {
+        loop_send(loop, client, now);
+    }
+
+    return true;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void loop_close(load_loop_t& loop, uint32_t index, uint64_t now, bool failed)
+{
+    load_client_t& client = loop.clients[index];
+    uint64_t delay;
+
+    if (client.fd >= 0)
+    {
+        /* Closing drops it from the epoll set as well */
+        close(client.fd);
+        client.fd = -1;
+    }
+    client.state = CLIENT_IDLE;
+
+    if (failed)
+    {
+        stats_add(loop.stats.errors, 1);
+
+        /* PINGs lost with the connection are sent again in the next session */
+        client.backlog.insert(client.backlog.begin(), client.due.begin(), client.due.end());
+        delay = std::max<uint64_t>(LOAD_RETRY_US, loop.config.think_us);
+    }
+    else
+    {
+        stats_add(loop.stats.sessions, 1);
+        delay = (loop.config.rate > 0) ? 0 : loop_exponential(loop, (double) loop.config.think_us);
+    }
+    client.due.clear();
+    client.written.clear();
+
+    if (loop.config.rate == 0)
+    {
+        /* Closed loop: the next session's first PING comes from loop_connected */
+        client.backlog.clear();
+    }
+
+    loop.timers.push({ now + delay, index, TIMER_CONNECT });
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void hdr_write(const char* path, const pingpong_histogram_t& histogram)
+{
+    FILE* file;
+    uint64_t count = 0;
+    double percentile = 0.0, mean, deviation = 0.0, value, half;
+    uint32_t i;
+
+    file = fopen(path, "w");
+    if (file == NULL)
+    {
+        perror(path);
+        return;
+    }
+
+    fprintf(file, "%12s %14s %10s %14s\n\n", "Value", "Percentile", "TotalCount", "1/(1-Percentile)");
+
+    mean = histogram.total ? (double) histogram.sum / histogram.total : 0.0;
+    for (i = 0; i < PINGPONG_HISTOGRAM_BUCKETS && count < histogram.total; i++)
+    {
+        if (histogram.counts[i] == 0)
+        {
+            continue;
+        }
+        count += histogram.counts[i];
+
+        /* Same clamping as pingpong_histogram_percentile */
+        value = std::min(std::max(pingpong_histogram_bucket_value(i), histogram.min), histogram.max);
+        deviation += histogram.counts[i] * (value - mean) * (value - mean);
+
+        /* Report every tick this bucket crosses, the last bucket ends at 100% */
+        while (count < histogram.total && 100.0 * count / histogram.total >= percentile)
+        {
+            fprintf(file, "%12.3f %2.12f %10llu %14.2f\n", value / HDR_SCALE, percentile / 100.0,
+                    (unsigned long long) count, 1.0 / (1.0 - percentile / 100.0));
+            half = pow(2.0, floor(log2(100.0 / (100.0 - percentile))) + 1.0);
+            percentile += 100.0 / (half * HDR_TICKS);
+        }
+        if (count == histogram.total)
+        {
+            fprintf(file, "%12.3f %2.12f %10llu %14.2f\n", value / HDR_SCALE, percentile / 100.0,
+                    (unsigned long long) count, 1.0 / (1.0 - percentile / 100.0));
+            fprintf(file, "%12.3f %2.12f %10llu\n", value / HDR_SCALE, 1.0, (unsigned long long) count);
+        }
+    }
+
+    deviation = histogram.total ? sqrt(deviation / histogram.total) : 0.0;
+    fprintf(file, "#[Mean    = %12.3f, StdDeviation   = %12.3f]\n", mean / HDR_SCALE, deviation / HDR_SCALE);
+    fprintf(file, "#[Max     = %12.3f, Total count    = %12llu]\n", histogram.max / HDR_SCALE,
+            (unsigned long long) histogram.total);
+    fprintf(file, "#[Buckets = %12d, SubBuckets     = %12d]\n",
+            PINGPONG_HISTOGRAM_MAX_BITS - PINGPONG_HISTOGRAM_SUB_BITS + 1, 1 << PINGPONG_HISTOGRAM_SUB_BITS);
+
+    fclose(file);
+}
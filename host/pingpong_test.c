@@ -0,0 +1,398 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pingpong_frame.h"
+#include "pingpong_histogram.h"
+#include "pingpong_log.h"
+#include "pingpong_stream.h"
+
+/*
+ * Host tests of the pure code the firmware shares with the host tools:
+ *  - pingpong_histogram: the bucket of every value, its error bound, the
+ *    percentiles, merge and the clamping above MAX_BITS;
+ *  - pingpong_frame: encode/decode, split and coalesced frames, garbage;
+ *  - pingpong_stream: in order, duplicate, reordered and lost datagrams,
+ *    and the RFC 3550 jitter;
+ *  - pingpong_log: varint batches through COBS and back, full batches and
+ *    corrupt frames.
+ *
+ * Built with the host's histogram parameters, the checks hold for any.
+ * "make test" runs it, the exit status is the verdict.
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#define CHECK(condition)        check((condition), #condition, __FILE__, __LINE__)
+
+#define HISTOGRAM_MAX_VALUE     ( (1u << PINGPONG_HISTOGRAM_MAX_BITS) - 1 )
+
+/*----------------------------------------------------------------------------*/
+
+static void check(bool passed, const char* expression, const char* file, int line);
+static uint32_t histogram_bucket(uint32_t value);
+static void test_histogram(void);
+static void test_frame(void);
+static void test_stream(void);
+static void test_log(void);
+
+/*----------------------------------------------------------------------------*/
+
+static uint32_t checks;
+static uint32_t failures;
+
+/* Too big for the stack with the host's parameters */
+static pingpong_histogram_t histogram;
+static pingpong_histogram_t other;
+static pingpong_histogram_t merged;
+
+/*----------------------------------------------------------------------------*/
+
+int main(void)
+{
+    test_histogram();
+    test_frame();
+    test_stream();
+    test_log();
+
+    printf("pingpong_test: %u checks, %u failed\n", (unsigned) checks, (unsigned) failures);
+
+    return (failures == 0) ? 0 : 1;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void check(bool passed, const char* expression, const char* file, int line)
+{
+    checks++;
+    if (!passed)
+    {
+        failures++;
+        fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+static uint32_t histogram_bucket(uint32_t value)
+{
+    uint32_t i;
+
+    /* The only bucket a single value leaves counted */
+    pingpong_histogram_reset(&histogram);
+    pingpong_histogram_record(&histogram, value);
+    for (i = 0; i < PINGPONG_HISTOGRAM_BUCKETS; i++)
+    {
+        if (histogram.counts[i] != 0)
+        {
+            break;
+        }
+    }
+
+    return i;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void test_histogram(void)
+{
+    uint32_t i, value, bucket, highest;
+    bool ordered = true;
+    bool bounded = true;
+    bool exact = true;
+
+    /* The buckets cover the range in order, the last one ends at the top */
+    for (i = 1; i < PINGPONG_HISTOGRAM_BUCKETS; i++)
+    {
+        ordered &= pingpong_histogram_bucket_value(i) > pingpong_histogram_bucket_value(i - 1);
+    }
+    CHECK(ordered);
+    CHECK(pingpong_histogram_bucket_value(PINGPONG_HISTOGRAM_BUCKETS - 1) == HISTOGRAM_MAX_VALUE);
+
+    /* Exact below 2^SUB_BITS, then within 1/2^(SUB_BITS-1) of the value */
+    for (value = 0; value < (1u << PINGPONG_HISTOGRAM_SUB_BITS); value++)
+    {
+        exact &= pingpong_histogram_bucket_value(histogram_bucket(value)) == value;
+    }
+    CHECK(exact);
+    for (value = 1u << PINGPONG_HISTOGRAM_SUB_BITS; value <= HISTOGRAM_MAX_VALUE && value != 0;
+         value += 1 + value / 37)
+    {
+        bucket = histogram_bucket(value);
+        highest = pingpong_histogram_bucket_value(bucket);
+        bounded &= bucket < PINGPONG_HISTOGRAM_BUCKETS &&
+                   highest >= value && pingpong_histogram_bucket_value(bucket - 1) < value &&
+                   highest - value <= value >> (PINGPONG_HISTOGRAM_SUB_BITS - 1);
+    }
+    CHECK(bounded);
+
+    /* Above MAX_BITS the value goes to the last bucket, the maximum stays exact */
+    CHECK(histogram_bucket(UINT32_MAX) == PINGPONG_HISTOGRAM_BUCKETS - 1);
+    pingpong_histogram_record(&histogram, 1);
+    CHECK(histogram.max == UINT32_MAX);
+    CHECK(pingpong_histogram_percentile(&histogram, 10000) == HISTOGRAM_MAX_VALUE);
+
+    /* Nothing recorded */
+    pingpong_histogram_reset(&histogram);
+    CHECK(pingpong_histogram_percentile(&histogram, 5000) == 0);
+    CHECK(pingpong_histogram_mean(&histogram) == 0);
+
+    /* Ranks are rounded up, reported values clamped to min and max */
+    for (value = 1; value <= 1000; value++)
+    {
+        pingpong_histogram_record(&histogram, value);
+    }
+    CHECK(histogram.total == 1000 && histogram.min == 1 && histogram.max == 1000);
+    CHECK(pingpong_histogram_mean(&histogram) == 500);
+    CHECK(pingpong_histogram_percentile(&histogram, 0) == 1);
+    CHECK(pingpong_histogram_percentile(&histogram, 10000) == 1000);
+    CHECK(pingpong_histogram_percentile(&histogram, 20000) == 1000);
+    value = pingpong_histogram_percentile(&histogram, 5000);
+    CHECK(value >= 500 && value - 500 <= 500 >> (PINGPONG_HISTOGRAM_SUB_BITS - 1));
+    value = pingpong_histogram_percentile(&histogram, 9900);
+    CHECK(value >= 990 && value - 990 <= 990 >> (PINGPONG_HISTOGRAM_SUB_BITS - 1));
+
+    /* Merging is recording both */
+    pingpong_histogram_reset(&other);
+    pingpong_histogram_reset(&merged);
+    for (value = 1; value <= 1000; value++)
+    {
+        pingpong_histogram_record(&other, value * 1000);
+        pingpong_histogram_record(&merged, value);
+        pingpong_histogram_record(&merged, value * 1000);
+    }
+    pingpong_histogram_merge(&histogram, &other);
+    CHECK(memcmp(&histogram, &merged, sizeof(histogram)) == 0);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void test_frame(void)
+{
+    static const uint8_t payload[5] = { 0x00, 0x01, 0x02, 0xFE, 0xFF };
+    uint8_t buffer[2 * (PINGPONG_FRAME_HEADER_SIZE + sizeof(payload))];
+    pingpong_frame_t frame, decoded;
+    uint16_t size;
+    uint32_t length;
+    bool split = true;
+
+    frame.type = PINGPONG_FRAME_PING;
+    frame.length = sizeof(payload);
+    frame.seq = 0x12345678;
+    frame.timestamp = 0x9ABCDEF0;
+    frame.payload = payload;
+
+    /* Does not fit */
+    CHECK(pingpong_frame_encode(&frame, buffer, PINGPONG_FRAME_HEADER_SIZE + sizeof(payload) - 1) == 0);
+
+    /* Little endian, as documented */
+    size = pingpong_frame_encode(&frame, buffer, sizeof(buffer));
+    CHECK(size == PINGPONG_FRAME_HEADER_SIZE + sizeof(payload));
+    CHECK(buffer[0] == PINGPONG_FRAME_VERSION && buffer[1] == PINGPONG_FRAME_PING);
+    CHECK(buffer[2] == sizeof(payload) && buffer[3] == 0);
+    CHECK(buffer[4] == 0x78 && buffer[7] == 0x12 && buffer[8] == 0xF0 && buffer[11] == 0x9A);
+
+    CHECK(pingpong_frame_decode(&decoded, buffer, size) == size);
+    CHECK(decoded.type == frame.type && decoded.length == frame.length);
+    CHECK(decoded.seq == frame.seq && decoded.timestamp == frame.timestamp);
+    CHECK(decoded.payload == &buffer[PINGPONG_FRAME_HEADER_SIZE]);
+    CHECK(memcmp(decoded.payload, payload, sizeof(payload)) == 0);
+
+    /* Split anywhere: more bytes are needed */
+    for (length = 0; length < size; length++)
+    {
+        split &= pingpong_frame_decode(&decoded, buffer, length) == 0;
+    }
+    CHECK(split);
+
+    /* Coalesced: the second frame starts where the first one ends */
+    frame.type = PINGPONG_FRAME_PONG;
+    frame.seq++;
+    CHECK(pingpong_frame_encode(&frame, &buffer[size], sizeof(buffer) - size) == size);
+    CHECK(pingpong_frame_decode(&decoded, buffer, sizeof(buffer)) == size);
+    CHECK(pingpong_frame_decode(&decoded, &buffer[size], sizeof(buffer) - size) == size);
+    CHECK(decoded.type == PINGPONG_FRAME_PONG && decoded.seq == 0x12345679);
+
+    /* Header only, the payload is filled in place */
+    frame.payload = NULL;
+    memset(buffer, 0xAA, sizeof(buffer));
+    CHECK(pingpong_frame_encode(&frame, buffer, sizeof(buffer)) == size);
+    CHECK(buffer[PINGPONG_FRAME_HEADER_SIZE] == 0xAA);
+
+    /* Garbage: a text PING, an unknown type, a payload too big */
+    CHECK(pingpong_frame_decode(&decoded, (const uint8_t*) "PING 1", 6) == -1);
+    buffer[1] = 3;
+    CHECK(pingpong_frame_decode(&decoded, buffer, size) == -1);
+    buffer[1] = PINGPONG_FRAME_PING;
+    buffer[2] = (uint8_t) (PINGPONG_FRAME_MAX_PAYLOAD + 1);
+    buffer[3] = (uint8_t) ((PINGPONG_FRAME_MAX_PAYLOAD + 1) >> 8);
+    CHECK(pingpong_frame_decode(&decoded, buffer, size) == -1);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void test_stream(void)
+{
+    pingpong_stream_t stream;
+    uint32_t seq;
+    char line[160];
+
+    pingpong_stream_reset(&stream);
+    for (seq = 0; seq < 10; seq++)
+    {
+        CHECK(pingpong_stream_record(&stream, seq, 100) == PINGPONG_STREAM_IN_ORDER);
+    }
+    CHECK(stream.received == 10 && stream.reordered == 0 && stream.duplicates == 0);
+    CHECK(pingpong_stream_lost(&stream, 10) == 0);
+    CHECK(pingpong_stream_jitter(&stream) == 0);
+
+    /* 10 and 11 lost, 12 arrives before them, 12 again, then 10 late */
+    CHECK(pingpong_stream_record(&stream, 12, 100) == PINGPONG_STREAM_IN_ORDER);
+    CHECK(pingpong_stream_record(&stream, 12, 100) == PINGPONG_STREAM_DUPLICATE);
+    CHECK(pingpong_stream_record(&stream, 10, 100) == PINGPONG_STREAM_REORDERED);
+    CHECK(pingpong_stream_record(&stream, 10, 100) == PINGPONG_STREAM_DUPLICATE);
+    CHECK(stream.received == 12 && stream.duplicates == 2);
+    CHECK(stream.reordered == 1 && stream.reorder_max == 2);
+    CHECK(pingpong_stream_lost(&stream, 13) == 1);
+    CHECK(pingpong_stream_loss(&stream, 13) == 769);
+    CHECK(pingpong_stream_loss(&stream, 0) == 0);
+
+    /* The window slid past it: late, but it cannot be told from a duplicate */
+    CHECK(pingpong_stream_record(&stream, 12 + PINGPONG_STREAM_WINDOW, 100) == PINGPONG_STREAM_IN_ORDER);
+    CHECK(pingpong_stream_record(&stream, 12, 100) == PINGPONG_STREAM_REORDERED);
+    CHECK(stream.reorder_max == PINGPONG_STREAM_WINDOW);
+
+    /* Sequence numbers wrap */
+    pingpong_stream_reset(&stream);
+    CHECK(pingpong_stream_record(&stream, UINT32_MAX, 100) == PINGPONG_STREAM_IN_ORDER);
+    CHECK(pingpong_stream_record(&stream, 0, 100) == PINGPONG_STREAM_IN_ORDER);
+    CHECK(pingpong_stream_record(&stream, UINT32_MAX, 100) == PINGPONG_STREAM_DUPLICATE);
+
+    /* Transit times 10 apart every time: the jitter converges to 10 */
+    pingpong_stream_reset(&stream);
+    for (seq = 0; seq < 200; seq++)
+    {
+        pingpong_stream_record(&stream, seq, 1000 + (seq & 1) * 10);
+    }
+    CHECK(pingpong_stream_jitter(&stream) >= 9 && pingpong_stream_jitter(&stream) <= 10);
+
+    pingpong_stream_format(&stream, 400, line, sizeof(line));
+    CHECK(strncmp(line, "sent=400 received=200 lost=200 (50.00%) dup=0 reordered=0", 57) == 0);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void test_log(void)
+{
+    pingpong_log_batch_t batch, decoded;
+    pingpong_log_cursor_t cursor;
+    pingpong_log_record_t record, read;
+    uint8_t frame[PINGPONG_LOG_FRAME_SIZE];
+    uint16_t size, i, added;
+    bool zeros = true;
+    bool same = true;
+
+    /* Zero arguments and timestamps, counters and values going down */
+    pingpong_log_batch_reset(&batch);
+    for (added = 0; ; added++)
+    {
+        record.id = (uint16_t) (added % 5);
+        record.argc = (uint8_t) (added % (PINGPONG_LOG_MAX_ARGS + 1));
+        record.timestamp = added * 1000u;
+        record.args[0] = added;
+        record.args[1] = UINT32_MAX - added * 3;
+        record.args[2] = 0;
+        if (!pingpong_log_batch_add(&batch, &record))
+        {
+            break;
+        }
+    }
+    CHECK(added > 10 && batch.count == added);
+    CHECK(batch.length <= PINGPONG_LOG_BATCH_SIZE);
+
+    /* COBS: zeros only as the delimiters */
+    size = pingpong_log_frame(&batch, frame);
+    CHECK(size <= PINGPONG_LOG_FRAME_SIZE && size == batch.length + 3);
+    CHECK(frame[0] == 0 && frame[size - 1] == 0);
+    for (i = 1; i < size - 1; i++)
+    {
+        zeros &= frame[i] != 0;
+    }
+    CHECK(zeros);
+
+    CHECK(pingpong_log_unframe(&decoded, &frame[1], (uint16_t) (size - 2)));
+    CHECK(decoded.length == batch.length && memcmp(decoded.data, batch.data, batch.length) == 0);
+
+    /* The records come back as they went in */
+    pingpong_log_cursor_reset(&cursor);
+    for (i = 0; i < added; i++)
+    {
+        record.id = (uint16_t) (i % 5);
+        record.argc = (uint8_t) (i % (PINGPONG_LOG_MAX_ARGS + 1));
+        record.timestamp = i * 1000u;
+        record.args[0] = i;
+        record.args[1] = UINT32_MAX - i * 3;
+        record.args[2] = 0;
+        same &= pingpong_log_next(&decoded, &cursor, &read) == 1 &&
+                read.id == record.id && read.argc == record.argc && read.timestamp == record.timestamp &&
+                memcmp(read.args, record.args, record.argc * sizeof(uint32_t)) == 0;
+    }
+    CHECK(same);
+    CHECK(pingpong_log_next(&decoded, &cursor, &read) == 0);
+
+    /* Corrupt frames: a code past the end, a zero inside, nothing at all */
+    CHECK(!pingpong_log_unframe(&decoded, (const uint8_t*) "\x03\x11", 2));
+    frame[1] = 0;
+    CHECK(!pingpong_log_unframe(&decoded, &frame[1], (uint16_t) (size - 2)));
+    CHECK(!pingpong_log_unframe(&decoded, &frame[1], 0));
+
+    /* A truncated record is malformed, not the end of the batch */
+    pingpong_log_batch_reset(&batch);
+    record.id = 1;
+    record.argc = 1;
+    record.timestamp = 1000000;
+    record.args[0] = 1000000;
+    CHECK(pingpong_log_batch_add(&batch, &record));
+    batch.length--;
+    pingpong_log_cursor_reset(&cursor);
+    CHECK(pingpong_log_next(&batch, &cursor, &read) == -1);
+}
+
+/*----------------------------------------------------------------------------*/
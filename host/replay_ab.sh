@@ -0,0 +1,68 @@
+#!/bin/sh
+# A/B comparison of two builds of the SimpleLink driver on the same trace.
+#
+# Usage: ./replay_ab.sh trace A B [runs] [-- sl_ping options]
+# A and B are sl_replay binaries, e.g. this tree's and one built from another
+# checkout. Record the trace with NWP_TRACE=trace ./sl_ping against nwp_sim
+# (or dump it from the board) and pass the sl_ping options used then. The
+# builds run alternately, runs times each (default 5); it prints the median
+# messages/s and cycles/message of each and how much B differs from A.
+# Short traces replay in milliseconds, record thousands of PINGs at least.
+
+set -e
+
+if [ $# -lt 3 ]; then
+    sed -n '4,10p' "$0" | cut -c3-
+    exit 1
+fi
+
+TRACE=$1
+A=$2
+B=$3
+shift 3
+RUNS=5
+if [ $# -gt 0 ] && [ "$1" != "--" ]; then
+    RUNS=$1
+    shift
+fi
+if [ "$1" = "--" ]; then
+    shift
+fi
+
+RESULTS=$(mktemp)
+trap 'rm -f "$RESULTS"' EXIT
+
+run=0
+while [ $run -lt "$RUNS" ]; do
+    for build in A B; do
+        if [ $build = A ]; then binary=$A; else binary=$B; fi
+        # The report is the line with messages/s, the console may prefix it with \r
+        NWP_REPLAY=$TRACE "$binary" "$@" 2>/dev/null | tr -d '\r' |
+            awk -v build=$build '/^replay messages=/ {
+                for (i = 2; i <= NF; i++) { split($i, kv, "="); value[kv[1]] = kv[2] }
+                print build, value["messages/s"], value["cycles/message"], value["divergences"]
+            }' >> "$RESULTS"
+    done
+    run=$((run + 1))
+done
+
+for build in A B; do
+    if ! grep -q "^$build " "$RESULTS"; then
+        echo "$build: no report, check the trace and the sl_ping options" >&2
+        exit 1
+    fi
+done
+
+# median build column
+median() {
+    awk -v build="$1" -v column="$2" '$1 == build { print $column }' "$RESULTS" | sort -n |
+        awk '{ v[NR] = $1 } END { print (NR % 2) ? v[(NR + 1) / 2] : (v[NR / 2] + v[NR / 2 + 1]) / 2 }'
+}
+
+awk -v ra="$(median A 2)" -v rb="$(median B 2)" -v ca="$(median A 3)" -v cb="$(median B 3)" \
+    -v da="$(median A 4)" -v db="$(median B 4)" -v runs="$RUNS" 'BEGIN {
+    printf "A messages/s=%.0f cycles/message=%.0f divergences=%d\n", ra, ca, da
+    printf "B messages/s=%.0f cycles/message=%.0f divergences=%d\n", rb, cb, db
+    printf "B vs A over %d runs: %+.1f%% messages/s, %+.1f%% cycles/message\n",
+           runs, (rb - ra) * 100 / ra, (cb - ca) * 100 / ca
+}'
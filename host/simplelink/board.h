@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _BOARD_H
+#define _BOARD_H
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pingpong_cmdtrace.h"
+
+/*
+ * The part of cc3100/board/board.h the driver uses: the IRQ line and nHIB,
+ * both carried by the link to nwp_sim (see link_cc3100.c), and the
+ * timestamp and command trace of board_posix.c.
+ */
+
+typedef void (*P_EVENT_HANDLER)(void* pValue);
+
+/*!
+    \brief register an interrupt handler for the host IRQ
+    \param[in]      InterruptHdl    -    called from the link reader thread,
+                    once per message the NWP queues
+    \param[in]      pValue          -    passed to the interrupt handler
+    \return         0
+*/
+int registerInterruptHandler(P_EVENT_HANDLER InterruptHdl , void* pValue);
+
+/*!
+    \brief          Releases the NWP from hibernate, it answers INIT_COMPLETE
+*/
+void CC3100_enable(void);
+
+/*!
+    \brief          Puts the NWP back in hibernate, it closes its sockets
+*/
+void CC3100_disable(void);
+
+/*!
+    \brief          Microseconds of CLOCK_MONOTONIC, for sl_GetTimestamp
+    \return         the driver's _u32, wraps every ~71 minutes as on the board
+*/
+unsigned int GetTimestampUs(void);
+
+/*!
+    \brief          Adds a record to the command trace, for sl_CmdTrace
+    \note           Only with SL_CMD_TRACE, see cc3100/board/board.h
+*/
+void CmdTraceAdd(uint16_t Opcode, uint32_t Start, uint32_t Written, uint32_t Response, uint32_t Woken);
+
+/*!
+    \brief          Copies the record *pSequence of the command trace
+    \return         false when there is no such record, see cc3100/board/board.h
+*/
+bool CmdTraceRead(uint32_t *pSequence, pingpong_cmdtrace_record_t *pRecord);
+
+/*!
+    \brief          Records added to the command trace
+*/
+uint32_t CmdTraceCount(void);
+
+/*!
+    \brief          Empties the command trace
+*/
+void CmdTraceClear(void);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef __LINK_CC3100_H__
+#define __LINK_CC3100_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Host counterpart of spi_cc3100.h: the same interface to the SimpleLink
+ * driver, over a Unix socket to nwp_sim (see nwp_link.h) instead of the
+ * EUSCI_B0 SPI. Every call is one frame on the socket, so a transaction
+ * here costs what a CS assertion costs on the board: one round trip for a
+ * read, one message for a gathered write.
+ *
+ * link_replay.c implements the same interface from a recorded trace.
+ */
+
+/*!
+    \brief   environment variables naming the trace file: link_cc3100.c
+             records one there, link_replay.c plays one back instead of
+             talking to nwp_sim
+*/
+#define LINK_TRACE_ENV      "NWP_TRACE"
+#define LINK_REPLAY_ENV     "NWP_REPLAY"
+
+/*!
+    \brief   type definition for the link file descriptor
+*/
+typedef unsigned int Fd_t;
+
+/*!
+    \brief   what the link did, one transfer per sl_IfRead/sl_IfWrite
+             (per message between the write sequence calls)
+*/
+typedef struct
+{
+    unsigned long tx_transfers;
+    unsigned long long tx_bytes;
+    unsigned long rx_transfers;
+    unsigned long long rx_bytes;
+    unsigned long irqs;
+    /* Messages read from the NWP, one per CNYS written: a burst with RX aggregation */
+    unsigned long rx_messages;
+} link_stats_t;
+
+/*!
+    \brief open the link to nwp_sim
+
+    Connects to the socket named by NWP_SIM_SOCKET, /tmp/nwp_sim.sock by
+    default, and starts the thread that delivers IRQs and read data.
+
+    \param[in]      ifName    -    socket path, NULL for the default
+    \param[in]      flags     -    unused
+    \return         a non-negative file descriptor, -1 if nwp_sim is not
+                    listening
+*/
+Fd_t link_Open(char *ifName, unsigned long flags);
+
+/*!
+    \brief closes the link, nwp_sim then drops its sockets
+    \return         0
+*/
+int link_Close(Fd_t fd);
+
+/*!
+    \brief reads len bytes of the message the NWP presents
+    \return         len, 0 if the link is down
+*/
+int link_Read(Fd_t fd, unsigned char *pBuff, int len);
+
+/*!
+    \brief writes len bytes to the NWP
+    \return         len, 0 if the link is down
+    \note           Between link_StartWriteSequence and
+                    link_EndWriteSequence the bytes are only gathered
+*/
+int link_Write(Fd_t fd, unsigned char *pBuff, int len);
+
+/*!
+    \brief marks the start of a SimpleLink message
+*/
+void link_StartWriteSequence(Fd_t fd);
+
+/*!
+    \brief sends the message gathered since link_StartWriteSequence as a
+           single transfer
+*/
+void link_EndWriteSequence(Fd_t fd);
+
+/*!
+    \brief copies the link counters since link_Open or link_ResetStats
+*/
+void link_GetStats(link_stats_t *stats);
+
+/*!
+    \brief clears the link counters
+*/
+void link_ResetStats(void);
+
+#ifdef  __cplusplus
+}
+#endif // __cplusplus
+
+#endif /* __LINK_CC3100_H__ */
@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef __USER_H__
+#define __USER_H__
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/*
+ * SimpleLink port for the host tools. It is cc3100/board/user.h with the
+ * same capabilities, OSI and event handler bindings; only what needs the
+ * board is replaced:
+ *  - the SPI hooks go to link_cc3100.c, which talks to nwp_sim;
+ *  - the OSI layer is osi_posix.c instead of osi_freertos.c.
+ * The directory comes first in the include path, so its board.h,
+ * FreeRTOS.h, task.h, portable.h and driverlib.h hide the target ones.
+ */
+
+/* simplelink.h defines these as long, which is 64 bits on Linux */
+#undef _u32
+#undef _i32
+#define _u32 unsigned int
+#define _i32 signed int
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "board.h"
+#include "cli_uart.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "link_cc3100.h"
+
+typedef P_EVENT_HANDLER                         SL_P_EVENT_HANDLER;
+
+/*----------------------------------------------------------------------------*/
+
+#define MAX_CONCURRENT_ACTIONS 10
+
+#define CPU_FREQ_IN_MHZ        25
+
+#define SL_INC_ARG_CHECK
+
+/* Off in the tools that use the system's socket API next to the driver's */
+#ifndef SL_NO_BSD_API_NAMING
+#define SL_INC_STD_BSD_API_NAMING
+#endif
+
+#define SL_INC_EXT_API
+
+#define SL_INC_WLAN_PKG
+#define SL_INC_SOCKET_PKG
+#define SL_INC_NET_APP_PKG
+#define SL_INC_NET_CFG_PKG
+#define SL_INC_NVMEM_PKG
+
+#define SL_INC_SOCK_SERVER_SIDE_API
+#define SL_INC_SOCK_CLIENT_SIDE_API
+#define SL_INC_SOCK_RECV_API
+#define SL_INC_SOCK_SEND_API
+
+/*----------------------------------------------------------------------------*/
+
+#define sl_DeviceEnablePreamble()
+#define sl_DeviceEnable       CC3100_enable
+#define sl_DeviceDisable      CC3100_disable
+
+#define _SlFd_t                    int32_t
+
+#define sl_IfOpen                           link_Open
+#define sl_IfClose                          link_Close
+#define sl_IfRead                           link_Read
+#define sl_IfWrite                          link_Write
+
+#define sl_IfRegIntHdlr(InterruptHdl , pValue) \
+                                registerInterruptHandler(InterruptHdl , pValue)
+#define sl_IfMaskIntHdlr()
+#define sl_IfUnMaskIntHdlr()
+
+#define SL_START_WRITE_STAT
+
+#ifdef SL_START_WRITE_STAT
+#define sl_IfStartWriteSequence                     link_StartWriteSequence
+#define sl_IfEndWriteSequence                       link_EndWriteSequence
+#endif
+
+/* Same receive path as the board, see cc3100/board/user.h */
+#define SL_RX_LOOKAHEAD_SIZE                        256
+
+/* nwp_sim sends the bursts the board build leaves out, for sl_ping -g */
+#ifndef SL_RX_AGGR
+#define SL_RX_AGGR                                  1
+#endif
+
+/* Microseconds of CLOCK_MONOTONIC, the unit and the wrap of the board's */
+#define sl_GetTimestamp                             GetTimestampUs
+#define SL_TIMESTAMP_TICKS_IN_10_MILLISECONDS       (10000)
+#define SL_TIMESTAMP_MAX_VALUE                      (0xFFFFFFFF)
+
+/* The command trace of the board, dumped by sl_ping -t for sl_trace */
+#ifndef SL_CMD_TRACE
+#define SL_CMD_TRACE                                0
+#endif
+
+#if (SL_CMD_TRACE)
+#define sl_CmdTrace(Opcode,Start,Written,Response,Woken) \
+                                CmdTraceAdd(Opcode,Start,Written,Response,Woken)
+#endif
+
+/*----------------------------------------------------------------------------*/
+
+#define SL_MEMORY_MGMT_DYNAMIC
+
+/* The pools of osi_posix.c, as the board's mem_Malloc has them */
+#ifdef SL_MEMORY_MGMT_DYNAMIC
+#define sl_Malloc(Size)                                 mem_Malloc(Size)
+#define sl_Free(pMem)                                   mem_Free(pMem)
+#endif
+
+/*----------------------------------------------------------------------------*/
+
+#define SL_PLATFORM_MULTI_THREADED
+
+#ifdef SL_PLATFORM_MULTI_THREADED
+#include "osi.h"
+
+#define SL_OS_RET_CODE_OK                       ((int)OSI_OK)
+#define SL_OS_WAIT_FOREVER                      ((OsiTime_t)OSI_WAIT_FOREVER)
+#define SL_OS_NO_WAIT                           ((OsiTime_t)OSI_NO_WAIT)
+
+#define _SlTime_t               OsiTime_t
+
+#define _SlSyncObj_t    OsiSyncObj_t
+#define sl_SyncObjCreate(pSyncObj,pName)            osi_SyncObjCreate(pSyncObj)
+#define sl_SyncObjDelete(pSyncObj)                  osi_SyncObjDelete(pSyncObj)
+#define sl_SyncObjSignal(pSyncObj)                osi_SyncObjSignal(pSyncObj)
+#define sl_SyncObjSignalFromIRQ(pSyncObj)           osi_SyncObjSignalFromISR(pSyncObj)
+#define sl_SyncObjWait(pSyncObj,Timeout)            osi_SyncObjWait(pSyncObj,Timeout)
+
+#define _SlLockObj_t        OsiLockObj_t
+#define sl_LockObjCreate(pLockObj,pName)            osi_LockObjCreate(pLockObj)
+#define sl_LockObjDelete(pLockObj)                  osi_LockObjDelete(pLockObj)
+#define sl_LockObjLock(pLockObj,Timeout)           osi_LockObjLock(pLockObj,Timeout)
+#define sl_LockObjUnlock(pLockObj)                   osi_LockObjUnlock(pLockObj)
+#endif
+
+#define SL_PLATFORM_EXTERNAL_SPAWN
+
+#ifdef SL_PLATFORM_EXTERNAL_SPAWN
+/* The driver's entries return a status that osi_Spawn drops */
+#define sl_Spawn(pEntry,pValue,flags)       osi_Spawn((P_OSI_SPAWN_ENTRY)(pEntry),pValue,flags)
+#endif
+
+/*----------------------------------------------------------------------------*/
+
+#define sl_GeneralEvtHdlr       SimpleLinkGeneralEventHandler
+#define sl_WlanEvtHdlr          SimpleLinkWlanEventHandler
+#define sl_NetAppEvtHdlr        SimpleLinkNetAppEventHandler
+#define sl_HttpServerCallback   SimpleLinkHttpServerCallback
+#define sl_SockEvtHdlr          SimpleLinkSockEventHandler
+
+#ifdef  __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __USER_H__ */
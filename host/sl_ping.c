@@ -0,0 +1,636 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+/* The system headers already have select() and FD_SET, keep the SL_ names */
+#define SL_NO_BSD_API_NAMING
+#include "simplelink.h"
+#include "cc3100_boosterpack.h"
+#include "nwp_link.h"
+#include "osi.h"
+
+#include "pingpong_cmdtrace.h"
+#include "pingpong_frame.h"
+#include "pingpong_histogram.h"
+
+/*
+ * PING/PONG client on the host build of the SimpleLink driver.
+ *
+ * The firmware's network path without the board: wifi_init, the
+ * cc3100_boosterpack.c socket wrappers and the binary PING frames, all
+ * unmodified, on top of link_cc3100.c and osi_posix.c. Point it at nwp_sim,
+ * with echo_server (or any UDP echo) behind it, and every driver change can
+ * be measured in seconds: it prints the PONG rate, the RTT histogram, the
+ * CPU time per PONG and the SPI transactions per PONG. With -k it runs
+ * that many connections at once, each on its own thread and socket, which
+ * keeps as many driver actions in flight.
+ *
+ * With -c it times driver commands instead, one sl_NetCfgGet at a time, for
+ * the cost of a round trip through _SlDrvCmdOp and the OSI sync objects.
+ * With -s it cycles wifi_sleep and wifi_wakeup, sl_Stop and sl_Start, and
+ * checks that the OSI pools end up as they started.
+ *
+ * With -t, in a build with SL_CMD_TRACE=1, it prints the driver's command
+ * trace of the run at the end, for sl_trace.
+ *
+ * With NWP_TRACE=file it also records the SPI traffic, which sl_replay (this
+ * same client on link_replay.c) plays back with NWP_REPLAY=file and the same
+ * options, to time the driver alone; its RTTs are then meaningless.
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#define SL_PING_ADDRESS         ( "127.0.0.1" )
+#define SL_PING_PORT            ( 5005 )
+#define SL_PING_COUNT           ( 1000 )
+#define SL_PING_WINDOW          ( 1 )
+#define SL_PING_WINDOW_MAX      ( 8 )
+#define SL_PING_TIMEOUT_MS      ( 1000 )
+#define SL_PING_BUFFER_SIZE     ( 512 )
+#define SL_PING_CONNECTIONS_MAX ( SL_MAX_SOCKETS )
+
+/*----------------------------------------------------------------------------*/
+
+typedef struct
+{
+    int16_t socket_id;
+    bool udp;
+    SlSockAddrIn_t address;
+    uint32_t sent;
+    uint32_t received;
+    uint32_t in_flight;
+
+    /* Bytes of a PONG split across TCP reads */
+    uint8_t pending[SL_PING_BUFFER_SIZE];
+    uint32_t pending_length;
+
+    /* The exchange of one connection, on its own thread */
+    pthread_t thread;
+    uint32_t count;
+    uint32_t window;
+    pingpong_histogram_t rtt;
+} sl_ping_t;
+
+/*----------------------------------------------------------------------------*/
+
+static void usage(const char* name);
+static uint32_t now_us(void);
+static uint64_t cpu_us(void);
+static bool ping_send(sl_ping_t* ping, uint32_t count, uint32_t window);
+/* 1 when something arrived, 0 on timeout, -1 on error */
+static int ping_receive(sl_ping_t* ping, pingpong_histogram_t* rtt);
+static void* ping_run(void* argument);
+static int command_run(uint32_t count);
+static int sleep_run(uint32_t count);
+static void trace_print(void);
+
+/*----------------------------------------------------------------------------*/
+
+int main(int argc, char** argv)
+{
+    char address[16] = SL_PING_ADDRESS;
+    uint16_t port = SL_PING_PORT;
+    uint32_t count = SL_PING_COUNT;
+    uint32_t window = SL_PING_WINDOW;
+    uint32_t connections = 1;
+    /* Too big for the stack with their histograms */
+    static sl_ping_t pings[SL_PING_CONNECTIONS_MAX];
+    static pingpong_histogram_t rtt;
+    link_stats_t link;
+    sl_ping_t ping;
+    uint32_t i, sent, received;
+    uint64_t cpu_start, cpu;
+    struct timespec start, end;
+    double elapsed;
+    char line[160];
+    int ip_address, option, status;
+    bool commands = false;
+    bool sleeps = false;
+    bool trace = false;
+
+    memset(&ping, 0, sizeof(ping));
+
+    while ((option = getopt(argc, argv, "a:p:n:w:k:ugcsth")) != -1)
+    {
+        switch (option)
+        {
+        case 'a':
+            strncpy(address, optarg, sizeof(address) - 1);
+            break;
+        case 'p':
+            port = (uint16_t) atoi(optarg);
+            break;
+        case 'n':
+            count = (uint32_t) atoi(optarg);
+            break;
+        case 'w':
+            window = (uint32_t) atoi(optarg);
+            break;
+        case 'k':
+            connections = (uint32_t) atoi(optarg);
+            break;
+        case 'u':
+            ping.udp = true;
+            break;
+        case 'g':
+            /* wifi_init applies it, unless the driver is built without it */
+            if (wifi_set_rx_aggregation(true) < 0) {
+                fprintf(stderr, "-g needs a build with SL_RX_AGGR=1\n");
+                return 1;
+            }
+            break;
+        case 'c':
+            commands = true;
+            break;
+        case 's':
+            sleeps = true;
+            break;
+        case 't':
+            trace = true;
+            break;
+        default:
+            usage(argv[0]);
+            return (option == 'h') ? 0 : 1;
+        }
+    }
+    if (count == 0 || window == 0 || window > SL_PING_WINDOW_MAX ||
+        connections == 0 || connections > SL_PING_CONNECTIONS_MAX)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    if (trace && !SL_CMD_TRACE)
+    {
+        fprintf(stderr, "-t needs a build with SL_CMD_TRACE=1\n");
+        return 1;
+    }
+
+    /* stringToAddress writes into the string, as on the board */
+    if (!stringToAddress(address, &ip_address))
+    {
+        fprintf(stderr, "malformed address %s\n", address);
+        return 1;
+    }
+    wifi_set_socket_address(&ping.address, (uint32_t) ip_address, port, true);
+
+    if (VStartSimpleLinkSpawnTask(0) != OSI_OK)
+    {
+        fprintf(stderr, "cannot start the spawn thread\n");
+        return 1;
+    }
+    if (wifi_init() < 0)
+    {
+        fprintf(stderr, "wifi_init failed, is nwp_sim running?\n");
+        return 1;
+    }
+#if (SL_CMD_TRACE)
+    /* The run, not the association */
+    CmdTraceClear();
+#endif
+    if (commands)
+    {
+        status = command_run(count);
+        if (trace)
+        {
+            trace_print();
+        }
+        sl_Stop(0);
+        return status;
+    }
+    if (sleeps)
+    {
+        status = sleep_run(count);
+        if (trace)
+        {
+            trace_print();
+        }
+        sl_Stop(0);
+        return status;
+    }
+
+    for (i = 0; i < connections; i++)
+    {
+        pings[i] = ping;
+        pings[i].count = count;
+        pings[i].window = window;
+        pings[i].socket_id = ping.udp ? wifi_udp_client_open(&ping.address) :
+                                        wifi_tcp_client_open(&ping.address);
+        if (pings[i].socket_id < 0)
+        {
+            fprintf(stderr, "cannot open the socket: %d\n", pings[i].socket_id);
+            sl_Stop(0);
+            return 1;
+        }
+    }
+
+    /* Only the exchange is measured, not the association or the handshake */
+    link_ResetStats();
+    cpu_start = cpu_us();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (i = 0; i < connections; i++)
+    {
+        if (pthread_create(&pings[i].thread, NULL, ping_run, &pings[i]) != 0)
+        {
+            fprintf(stderr, "cannot start connection %u\n", (unsigned) i);
+            return 1;
+        }
+    }
+    for (i = 0; i < connections; i++)
+    {
+        pthread_join(pings[i].thread, NULL);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    cpu = cpu_us() - cpu_start;
+    link_GetStats(&link);
+
+    pingpong_histogram_reset(&rtt);
+    sent = 0;
+    received = 0;
+    for (i = 0; i < connections; i++)
+    {
+        wifi_client_close(pings[i].socket_id);
+        pingpong_histogram_merge(&rtt, &pings[i].rtt);
+        sent += pings[i].sent;
+        received += pings[i].received;
+    }
+    if (trace)
+    {
+        trace_print();
+    }
+    sl_Stop(0);
+
+    elapsed = (double) (end.tv_sec - start.tv_sec) + (double) (end.tv_nsec - start.tv_nsec) / 1e9;
+    pingpong_histogram_format(&rtt, line, sizeof(line));
+    printf("transport=%s connections=%u window=%u rx_aggregation=%s sent=%u pongs=%u pongs/s=%.0f\n",
+           ping.udp ? "udp" : "tcp", (unsigned) connections, (unsigned) window,
+           wifi_get_rx_aggregation() ? "on" : "off",
+           (unsigned) sent, (unsigned) received, received / elapsed);
+    printf("rtt us: %s\n", line);
+    if (received > 0)
+    {
+        printf("cpu_us/pong=%.1f spi_writes/pong=%.2f spi_reads/pong=%.2f spi_bytes/pong=%.1f irqs/pong=%.2f\n",
+               (double) cpu / received,
+               (double) link.tx_transfers / received,
+               (double) link.rx_transfers / received,
+               (double) (link.tx_bytes + link.rx_bytes) / received,
+               (double) link.irqs / received);
+    }
+    if (link.rx_messages > 0)
+    {
+        printf("messages=%lu spi_reads/message=%.2f spi_rx_bytes/message=%.1f\n",
+               link.rx_messages,
+               (double) link.rx_transfers / link.rx_messages,
+               (double) link.rx_bytes / link.rx_messages);
+    }
+
+    return (received == sent) ? 0 : 1;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void usage(const char* name)
+{
+    fprintf(stderr,
+            "usage: %s [-a address] [-p port] [-n count] [-w window] [-k connections] [-u] [-g] [-c] [-s] [-t]\n"
+            "  -a  echo server address (default %s)\n"
+            "  -p  echo server port (default %u)\n"
+            "  -n  PINGs to send (default %u)\n"
+            "  -w  PINGs in flight, 1 to %u (default %u)\n"
+            "  -k  connections at once, 1 to %u, each sends -n PINGs (default 1)\n"
+            "  -u  UDP instead of TCP\n"
+            "  -g  NWP RX aggregation, messages= then counts bursts\n"
+            "  -c  time driver commands instead of PINGs, no socket is opened\n"
+            "  -s  count sleep/wake cycles instead of PINGs, then the OSI pools\n"
+            "  -t  print the driver command trace of the run, for sl_trace (SL_CMD_TRACE=1)\n"
+            "nwp_sim is found through $%s (default %s)\n",
+            name, SL_PING_ADDRESS, SL_PING_PORT, SL_PING_COUNT, SL_PING_WINDOW_MAX,
+            SL_PING_WINDOW, SL_PING_CONNECTIONS_MAX, NWP_LINK_SOCKET_ENV, NWP_LINK_SOCKET);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static uint32_t now_us(void)
+{
+    struct timespec now;
+
+    /* Wraps every ~71 minutes, RTTs are computed modulo 2^32 */
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t) ((uint64_t) now.tv_sec * 1000000u + (uint64_t) now.tv_nsec / 1000u);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static uint64_t cpu_us(void)
+{
+    struct rusage usage;
+
+    /* Every thread of the driver: caller, spawn and link reader */
+    getrusage(RUSAGE_SELF, &usage);
+    return (uint64_t) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000u +
+           (uint64_t) (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static bool ping_send(sl_ping_t* ping, uint32_t count, uint32_t window)
+{
+    uint8_t buffer[PINGPONG_FRAME_HEADER_SIZE];
+    pingpong_frame_t frame;
+    uint16_t length;
+    int16_t status;
+
+    /* One PING per call so every PONG is answered with the next PING */
+    while (ping->in_flight < window && ping->sent < count)
+    {
+        frame.type = PINGPONG_FRAME_PING;
+        frame.length = 0;
+        frame.seq = ping->sent;
+        frame.timestamp = now_us();
+        frame.payload = NULL;
+        length = pingpong_frame_encode(&frame, buffer, sizeof(buffer));
+
+        if (ping->udp)
+        {
+            status = wifi_udp_client_send(ping->socket_id, &ping->address, buffer, length);
+        }
+        else
+        {
+            status = wifi_tcp_client_send(ping->socket_id, buffer, length);
+        }
+        if (status != length)
+        {
+            fprintf(stderr, "send failed: %d\n", status);
+            return false;
+        }
+        ping->sent++;
+        ping->in_flight++;
+    }
+
+    return ping->in_flight > 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static int ping_receive(sl_ping_t* ping, pingpong_histogram_t* rtt)
+{
+    uint8_t buffer[SL_PING_BUFFER_SIZE];
+    SlSockAddrIn_t from;
+    SlSocklen_t from_length = sizeof(from);
+    pingpong_frame_t frame;
+    uint32_t used = 0;
+    int32_t ready, decoded;
+    int16_t status;
+
+    if (ping->udp)
+    {
+        ready = wifi_select_receive(&ping->socket_id, 1, SL_PING_TIMEOUT_MS);
+        if (ready <= 0)
+        {
+            return (int) ready;
+        }
+        status = wifi_udp_client_receive(ping->socket_id, &from, &from_length, buffer, sizeof(buffer));
+        if (status <= 0)
+        {
+            return (status == SL_EAGAIN) ? 0 : -1;
+        }
+        memcpy(ping->pending, buffer, (size_t) status);
+        ping->pending_length = (uint32_t) status;
+    }
+    else
+    {
+        status = wifi_tcp_client_receive_timeout(ping->socket_id,
+                                                 ping->pending + ping->pending_length,
+                                                 (uint16_t) (sizeof(ping->pending) - ping->pending_length),
+                                                 SL_PING_TIMEOUT_MS);
+        if (status == SL_EAGAIN)
+        {
+            return 0;
+        }
+        if (status <= 0)
+        {
+            return -1;
+        }
+        ping->pending_length += (uint32_t) status;
+    }
+
+    /* TCP may have coalesced PONGs or split one */
+    while (used < ping->pending_length)
+    {
+        decoded = pingpong_frame_decode(&frame, ping->pending + used, ping->pending_length - used);
+        if (decoded == 0)
+        {
+            break;
+        }
+        if (decoded < 0 || frame.type != PINGPONG_FRAME_PONG)
+        {
+            return -1;
+        }
+        pingpong_histogram_record(rtt, now_us() - frame.timestamp);
+        ping->received++;
+        ping->in_flight--;
+        used += (uint32_t) decoded;
+    }
+    if (ping->udp)
+    {
+        used = ping->pending_length;
+    }
+    memmove(ping->pending, ping->pending + used, ping->pending_length - used);
+    ping->pending_length -= used;
+
+    return 1;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void* ping_run(void* argument)
+{
+    sl_ping_t* ping = (sl_ping_t*) argument;
+    int status;
+
+    pingpong_histogram_reset(&ping->rtt);
+
+    while (ping_send(ping, ping->count, ping->window))
+    {
+        status = ping_receive(ping, &ping->rtt);
+        if (status < 0)
+        {
+            fprintf(stderr, "receive failed: %d\n", status);
+            break;
+        }
+        if (status == 0)
+        {
+            /* Whatever is still in flight is lost */
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static int command_run(uint32_t count)
+{
+    pingpong_histogram_t rtt;
+    link_stats_t link;
+    uint8_t mac[SL_MAC_ADDR_LEN];
+    uint8_t length;
+    uint64_t cpu_start, cpu;
+    struct timespec start, end;
+    double elapsed;
+    char line[160];
+    uint32_t i, sent;
+    int32_t status;
+
+    pingpong_histogram_reset(&rtt);
+    link_ResetStats();
+    cpu_start = cpu_us();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    /* As the board's cmd shell command: the cheapest command with a response */
+    for (i = 0; i < count; i++)
+    {
+        length = SL_MAC_ADDR_LEN;
+        sent = now_us();
+        status = sl_NetCfgGet(SL_MAC_ADDRESS_GET, NULL, &length, mac);
+        pingpong_histogram_record(&rtt, now_us() - sent);
+        if (status < 0)
+        {
+            fprintf(stderr, "command failed: %d\n", (int) status);
+            return 1;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    cpu = cpu_us() - cpu_start;
+    link_GetStats(&link);
+
+    elapsed = (double) (end.tv_sec - start.tv_sec) + (double) (end.tv_nsec - start.tv_nsec) / 1e9;
+    pingpong_histogram_format(&rtt, line, sizeof(line));
+    printf("command=netcfg_get commands=%u commands/s=%.0f\n", (unsigned) count, count / elapsed);
+    printf("rtt us: %s\n", line);
+    printf("cpu_us/command=%.1f spi_writes/command=%.2f spi_reads/command=%.2f irqs/command=%.2f\n",
+           (double) cpu / count,
+           (double) link.tx_transfers / count,
+           (double) link.rx_transfers / count,
+           (double) link.irqs / count);
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static int sleep_run(uint32_t count)
+{
+    static const char* const names[OSI_POOL_COUNT] = {
+        "sync_objects", "semaphores", "driver_cb", "async_buffers"
+    };
+    OsiPool_t before[OSI_POOL_COUNT], after;
+    struct timespec start, end;
+    double elapsed;
+    uint32_t i;
+    int status = 0;
+
+    for (i = 0; i < OSI_POOL_COUNT; i++)
+    {
+        osi_PoolStats(i, &before[i]);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    /* What the board does around a deep sleep, each one a sl_Stop and a sl_Start */
+    for (i = 0; i < count; i++)
+    {
+        wifi_sleep();
+        wifi_wakeup();
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    elapsed = (double) (end.tv_sec - start.tv_sec) + (double) (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("cycles=%u cycles/s=%.1f\n", (unsigned) count, count / elapsed);
+
+    /* Anything a cycle leaks stays in use, anything it cannot get fails */
+    for (i = 0; i < OSI_POOL_COUNT; i++)
+    {
+        if (osi_PoolStats(i, &after) != OSI_OK)
+        {
+            continue;
+        }
+        printf("pool=%s block_size=%u blocks=%u used=%u used_before=%u peak=%u failed=%u\n",
+               names[i], (unsigned) after.ulBlockSize, (unsigned) after.ulBlocks,
+               (unsigned) after.ulUsed, (unsigned) before[i].ulUsed,
+               (unsigned) after.ulPeak, (unsigned) after.ulFailed);
+        if (after.ulUsed != before[i].ulUsed || after.ulFailed != 0)
+        {
+            status = 1;
+        }
+    }
+
+    return status;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void trace_print(void)
+{
+#if (SL_CMD_TRACE)
+    pingpong_cmdtrace_record_t record;
+    char line[PINGPONG_CMDTRACE_LINE_SIZE];
+    uint32_t sequence = 0;
+    uint32_t printed = 0;
+    uint32_t end = CmdTraceCount();
+
+    /* The lines of the board's "cmdtrace dump" */
+    while ((int32_t) (end - sequence) > 0 && CmdTraceRead(&sequence, &record))
+    {
+        pingpong_cmdtrace_format(&record, line);
+        printf("%s\n", line);
+        printed++;
+    }
+    if (printed < end)
+    {
+        fprintf(stderr, "command trace: the first %u of %u records were overwritten\n",
+                (unsigned) (end - printed), (unsigned) end);
+    }
+#endif
+}
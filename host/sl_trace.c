@@ -0,0 +1,326 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <unistd.h>
+
+/* Only the opcodes are wanted, not the BSD names over the real ones */
+#define SL_NO_BSD_API_NAMING
+#include "simplelink.h"
+#include "protocol.h"
+
+#include "pingpong_cmdtrace.h"
+#include "pingpong_histogram.h"
+
+/*
+ * Decoder of the SimpleLink driver command trace (SL_CMD_TRACE=1).
+ *
+ * Reads console output, a capture of the board's "cmdtrace dump" or the
+ * output of sl_ping -t, skips everything that is not a cmdtrace line and
+ * prints, per opcode, where the time of its commands went:
+ *
+ *   write  start to written, the wait for the driver lock and the SPI write
+ *   nwp    written to response, what the NWP and the link took
+ *   wake   response to woken, the spawn task signalling the caller back
+ *   total  start to woken
+ *
+ * A stage is left out of a record that lacks one of its ends: sends have no
+ * response, asynchronous actions no write. With -v it also prints every
+ * record with its stages.
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#define SL_TRACE_LINE_SIZE      ( 256 )
+#define SL_TRACE_OPCODES_MAX    ( 64 )
+
+/*----------------------------------------------------------------------------*/
+
+typedef enum
+{
+    SL_TRACE_WRITE,
+    SL_TRACE_NWP,
+    SL_TRACE_WAKE,
+    SL_TRACE_TOTAL,
+    SL_TRACE_STAGES
+} sl_trace_stage_t;
+
+typedef struct
+{
+    uint16_t opcode;
+    pingpong_histogram_t stages[SL_TRACE_STAGES];
+} sl_trace_opcode_t;
+
+typedef struct
+{
+    uint16_t opcode;
+    const char* name;
+} sl_trace_name_t;
+
+/*----------------------------------------------------------------------------*/
+
+static void usage(const char* name);
+static const char* opcode_name(uint16_t opcode);
+static sl_trace_opcode_t* opcode_find(uint16_t opcode);
+/* Time between two stamps, false when either step did not happen */
+static bool stage_time(uint32_t from, uint32_t to, uint32_t* time);
+
+/*----------------------------------------------------------------------------*/
+
+static const char* const stage_names[SL_TRACE_STAGES] = { "write", "nwp", "wake", "total" };
+
+/* What the firmware and sl_ping use, the rest is printed in hex */
+static const sl_trace_name_t names[] =
+{
+    { SL_OPCODE_DEVICE_STOP_COMMAND,                "device_stop" },
+    { SL_OPCODE_DEVICE_STOP_ASYNC_RESPONSE,         "device_stop_async" },
+    { SL_OPCODE_DEVICE_DEVICEGET,                   "device_get" },
+    { SL_OPCODE_DEVICE_NETCFG_SET_COMMAND,          "netcfg_set" },
+    { SL_OPCODE_DEVICE_NETCFG_GET_COMMAND,          "netcfg_get" },
+    { SL_OPCODE_WLAN_WLANCONNECTCOMMAND,            "wlan_connect" },
+    { SL_OPCODE_WLAN_WLANDISCONNECTCOMMAND,         "wlan_disconnect" },
+    { SL_OPCODE_WLAN_POLICYSETCOMMAND,              "wlan_policy_set" },
+    { SL_OPCODE_WLAN_PROFILEDELCOMMAND,             "wlan_profile_del" },
+    { SL_OPCODE_WLAN_CFG_SET,                       "wlan_cfg_set" },
+    { SL_OPCODE_WLAN_CFG_GET,                       "wlan_cfg_get" },
+    { SL_OPCODE_NETAPP_NETAPPSET,                   "netapp_set" },
+    { SL_OPCODE_NETAPP_NETAPPGET,                   "netapp_get" },
+    { SL_OPCODE_NETAPP_DNSGETHOSTBYNAME,            "dns_gethostbyname" },
+    { SL_OPCODE_NETAPP_DNSGETHOSTBYNAMEASYNCRESPONSE, "dns_gethostbyname_async" },
+    { SL_OPCODE_SOCKET_SOCKET,                      "socket" },
+    { SL_OPCODE_SOCKET_CLOSE,                       "close" },
+    { SL_OPCODE_SOCKET_BIND,                        "bind" },
+    { SL_OPCODE_SOCKET_CONNECT,                     "connect" },
+    { SL_OPCODE_SOCKET_CONNECTASYNCRESPONSE,        "connect_async" },
+    { SL_OPCODE_SOCKET_SELECT,                      "select" },
+    { SL_OPCODE_SOCKET_SELECTASYNCRESPONSE,         "select_async" },
+    { SL_OPCODE_SOCKET_SETSOCKOPT,                  "setsockopt" },
+    { SL_OPCODE_SOCKET_GETSOCKOPT,                  "getsockopt" },
+    { SL_OPCODE_SOCKET_RECV,                        "recv" },
+    { SL_OPCODE_SOCKET_RECVFROM,                    "recvfrom" },
+    { SL_OPCODE_SOCKET_SEND,                        "send" },
+    { SL_OPCODE_SOCKET_SENDTO,                      "sendto" },
+};
+
+/* Too big for the stack with their histograms */
+static sl_trace_opcode_t opcodes[SL_TRACE_OPCODES_MAX];
+static uint32_t opcode_count;
+
+/*----------------------------------------------------------------------------*/
+
+int main(int argc, char** argv)
+{
+    char line[SL_TRACE_LINE_SIZE];
+    char summary[160];
+    pingpong_cmdtrace_record_t record;
+    sl_trace_opcode_t* entry;
+    const char* found;
+    FILE* input = stdin;
+    uint32_t times[SL_TRACE_STAGES];
+    bool valid[SL_TRACE_STAGES];
+    uint32_t i, stage, records = 0, dropped = 0;
+    int option;
+    bool verbose = false;
+
+    while ((option = getopt(argc, argv, "vh")) != -1)
+    {
+        switch (option)
+        {
+        case 'v':
+            verbose = true;
+            break;
+        default:
+            usage(argv[0]);
+            return (option == 'h') ? 0 : 1;
+        }
+    }
+    if (optind < argc)
+    {
+        input = fopen(argv[optind], "r");
+        if (input == NULL)
+        {
+            perror(argv[optind]);
+            return 1;
+        }
+    }
+
+    while (fgets(line, sizeof(line), input) != NULL)
+    {
+        /* The board ends its lines with "\n\r", the \r starts the next one */
+        found = strstr(line, PINGPONG_CMDTRACE_PREFIX);
+        if (found == NULL || !pingpong_cmdtrace_parse(found, &record))
+        {
+            continue;
+        }
+        records++;
+
+        valid[SL_TRACE_WRITE] = stage_time(record.start, record.written, &times[SL_TRACE_WRITE]);
+        valid[SL_TRACE_NWP] = stage_time(record.written, record.response, &times[SL_TRACE_NWP]);
+        valid[SL_TRACE_WAKE] = stage_time(record.response, record.woken, &times[SL_TRACE_WAKE]);
+        valid[SL_TRACE_TOTAL] = stage_time(record.start, record.woken, &times[SL_TRACE_TOTAL]);
+
+        if (verbose)
+        {
+            printf("%-24s", opcode_name(record.opcode));
+            for (stage = 0; stage < SL_TRACE_STAGES; stage++)
+            {
+                if (valid[stage])
+                {
+                    printf(" %s=%u", stage_names[stage], (unsigned) times[stage]);
+                }
+            }
+            printf("\n");
+        }
+
+        entry = opcode_find(record.opcode);
+        if (entry == NULL)
+        {
+            dropped++;
+            continue;
+        }
+        for (stage = 0; stage < SL_TRACE_STAGES; stage++)
+        {
+            if (valid[stage])
+            {
+                pingpong_histogram_record(&entry->stages[stage], times[stage]);
+            }
+        }
+    }
+    if (input != stdin)
+    {
+        fclose(input);
+    }
+
+    printf("records=%u opcodes=%u", (unsigned) records, (unsigned) opcode_count);
+    if (dropped > 0)
+    {
+        printf(" dropped=%u (more than %u opcodes)", (unsigned) dropped, SL_TRACE_OPCODES_MAX);
+    }
+    printf("\n");
+
+    for (i = 0; i < opcode_count; i++)
+    {
+        printf("%s (0x%04X)\n", opcode_name(opcodes[i].opcode), (unsigned) opcodes[i].opcode);
+        for (stage = 0; stage < SL_TRACE_STAGES; stage++)
+        {
+            if (opcodes[i].stages[stage].total == 0)
+            {
+                continue;
+            }
+            pingpong_histogram_format(&opcodes[i].stages[stage], summary, sizeof(summary));
+            printf("  %-5s us: %s\n", stage_names[stage], summary);
+        }
+    }
+
+    return (records > 0) ? 0 : 1;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void usage(const char* name)
+{
+    fprintf(stderr,
+            "usage: %s [-v] [file]\n"
+            "  -v  print every record too\n"
+            "reads the console output of \"cmdtrace dump\" or of sl_ping -t, stdin without file\n",
+            name);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static const char* opcode_name(uint16_t opcode)
+{
+    static char hex[8];
+    uint32_t i;
+
+    for (i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+    {
+        if (names[i].opcode == opcode)
+        {
+            return names[i].name;
+        }
+    }
+
+    snprintf(hex, sizeof(hex), "0x%04X", (unsigned) opcode);
+    return hex;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static sl_trace_opcode_t* opcode_find(uint16_t opcode)
+{
+    uint32_t i, stage;
+
+    for (i = 0; i < opcode_count; i++)
+    {
+        if (opcodes[i].opcode == opcode)
+        {
+            return &opcodes[i];
+        }
+    }
+    if (opcode_count == SL_TRACE_OPCODES_MAX)
+    {
+        return NULL;
+    }
+
+    opcodes[opcode_count].opcode = opcode;
+    for (stage = 0; stage < SL_TRACE_STAGES; stage++)
+    {
+        pingpong_histogram_reset(&opcodes[opcode_count].stages[stage]);
+    }
+    return &opcodes[opcode_count++];
+}
+
+/*----------------------------------------------------------------------------*/
+
+static bool stage_time(uint32_t from, uint32_t to, uint32_t* time)
+{
+    if (from == 0 || to == 0)
+    {
+        return false;
+    }
+
+    /* The stamps wrap every ~71 minutes, a stage is far shorter */
+    *time = to - from;
+    return true;
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,362 @@
+/*
+ * Copyright (C) 2017 Universitat Oberta de Catalunya - http://www.uoc.edu/
+ *
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *    Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *    Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *    Neither the name of Universitat Oberta de Catalunya nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "osi.h"
+
+#include "pingpong_histogram.h"
+
+/*
+ * Stress test of osi_Spawn, the path from the CC3100 interrupt to the spawn
+ * task that reads the NWP messages.
+ *
+ * Producer threads, standing for the IRQ handler and the tasks that call
+ * sl_Spawn after a command, hand numbered events to the spawn thread as fast
+ * as they can, or one every -i us so that the spawn thread goes to sleep
+ * between them. The spawn thread checks that every producer's events arrive
+ * once and in order, and times each one from the call to osi_Spawn to the
+ * start of its entry function. A call refused by a full queue is retried and
+ * counted, it is not lost.
+ *
+ * Two implementations run on the same load:
+ *  - queue: what osi_posix.c had before, a mutex and condition variable
+ *    around a circular buffer, the host copy of the FreeRTOS queue;
+ *  - ring: osi_posix.c itself, the lock-free ring with one futex wake.
+ */
+
+/*----------------------------------------------------------------------------*/
+
+#define SPAWN_STRESS_PRODUCERS      ( 4 )
+#define SPAWN_STRESS_PRODUCERS_MAX  ( 64 )
+#define SPAWN_STRESS_EVENTS         ( 200000 )
+#define SPAWN_STRESS_INTERVAL_US    ( 0 )
+/* Calls still not run this long after the last one are lost */
+#define SPAWN_STRESS_DRAIN_MS       ( 2000 )
+/* Same capacity as OSI_SPAWN_RING_SIZE */
+#define SPAWN_QUEUE_SIZE            ( 16 )
+
+/*----------------------------------------------------------------------------*/
+
+typedef OsiReturnVal_e (*spawn_function_t)(P_OSI_SPAWN_ENTRY pEntry, void* pValue, unsigned long flags);
+
+typedef struct
+{
+    uint32_t producer;
+    uint32_t sequence;
+    uint64_t spawned_ns;
+} spawn_event_t;
+
+typedef struct
+{
+    uint32_t index;
+    pthread_t thread;
+    spawn_event_t* events;
+    uint64_t refused;
+} spawn_producer_t;
+
+/*----------------------------------------------------------------------------*/
+
+static void usage(const char* name);
+static uint64_t now_ns(void);
+static void run(const char* name, spawn_function_t spawn);
+static void* producer_thread(void* argument);
+static void event_entry(void* pValue);
+static OsiReturnVal_e queue_spawn(P_OSI_SPAWN_ENTRY pEntry, void* pValue, unsigned long flags);
+static void* queue_thread(void* argument);
+
+/*----------------------------------------------------------------------------*/
+
+static uint32_t producers = SPAWN_STRESS_PRODUCERS;
+static uint32_t events = SPAWN_STRESS_EVENTS;
+static uint32_t interval_us = SPAWN_STRESS_INTERVAL_US;
+
+static spawn_producer_t producer[SPAWN_STRESS_PRODUCERS_MAX];
+static spawn_function_t spawn_function;
+static volatile bool go;
+
+/* Written by the spawn thread only, read once it is idle */
+static uint32_t expected[SPAWN_STRESS_PRODUCERS_MAX];
+static uint64_t reordered;
+static pingpong_histogram_t latency;
+static uint64_t dispatched;
+
+/* The previous osi_posix.c queue */
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_ready = PTHREAD_COND_INITIALIZER;
+static tSimpleLinkSpawnMsg queue[SPAWN_QUEUE_SIZE];
+static unsigned queue_head;
+static unsigned queue_count;
+
+/*----------------------------------------------------------------------------*/
+
+int main(int argc, char** argv)
+{
+    pthread_t thread;
+    uint32_t i;
+    int option;
+
+    while ((option = getopt(argc, argv, "p:n:i:h")) != -1)
+    {
+        switch (option)
+        {
+        case 'p':
+            producers = (uint32_t) atoi(optarg);
+            break;
+        case 'n':
+            events = (uint32_t) atoi(optarg);
+            break;
+        case 'i':
+            interval_us = (uint32_t) atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return (option == 'h') ? 0 : 1;
+        }
+    }
+    if (producers == 0 || producers > SPAWN_STRESS_PRODUCERS_MAX || events == 0)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    for (i = 0; i < producers; i++)
+    {
+        producer[i].index = i;
+        producer[i].events = (spawn_event_t*) calloc(events, sizeof(spawn_event_t));
+        if (producer[i].events == NULL)
+        {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+    }
+
+    if (pthread_create(&thread, NULL, queue_thread, NULL) != 0 ||
+        VStartSimpleLinkSpawnTask(0) != OSI_OK)
+    {
+        fprintf(stderr, "cannot start the spawn threads\n");
+        return 1;
+    }
+
+    run("queue", queue_spawn);
+    run("ring", osi_Spawn);
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void usage(const char* name)
+{
+    fprintf(stderr,
+            "usage: %s [-p producers] [-n events] [-i interval]\n"
+            "  -p  producer threads, 1 to %u (default %u)\n"
+            "  -n  events per producer (default %u)\n"
+            "  -i  us between the events of a producer, 0 back to back (default %u)\n",
+            name, SPAWN_STRESS_PRODUCERS_MAX, SPAWN_STRESS_PRODUCERS, SPAWN_STRESS_EVENTS,
+            SPAWN_STRESS_INTERVAL_US);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static uint64_t now_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void run(const char* name, spawn_function_t spawn)
+{
+    uint64_t start, end, total, refused, done, deadline;
+    char line[160];
+    uint32_t i;
+
+    memset(expected, 0, sizeof(expected));
+    reordered = 0;
+    pingpong_histogram_reset(&latency);
+    __atomic_store_n(&dispatched, 0, __ATOMIC_SEQ_CST);
+    spawn_function = spawn;
+    go = false;
+
+    for (i = 0; i < producers; i++)
+    {
+        producer[i].refused = 0;
+        pthread_create(&producer[i].thread, NULL, producer_thread, &producer[i]);
+    }
+    start = now_ns();
+    __atomic_store_n(&go, true, __ATOMIC_SEQ_CST);
+
+    refused = 0;
+    for (i = 0; i < producers; i++)
+    {
+        pthread_join(producer[i].thread, NULL);
+        refused += producer[i].refused;
+    }
+
+    /* Wait for the spawn thread to run what was accepted */
+    total = (uint64_t) producers * events;
+    deadline = now_ns() + SPAWN_STRESS_DRAIN_MS * 1000000ULL;
+    while ((done = __atomic_load_n(&dispatched, __ATOMIC_ACQUIRE)) < total && now_ns() < deadline)
+    {
+        usleep(100);
+    }
+    end = now_ns();
+
+    pingpong_histogram_format(&latency, line, sizeof(line));
+    printf("spawn=%s producers=%u events=%llu dispatched=%llu lost=%llu reordered=%llu refused=%llu "
+           "events/s=%.0f\n",
+           name, (unsigned) producers, (unsigned long long) total, (unsigned long long) done,
+           (unsigned long long) (total - done), (unsigned long long) reordered,
+           (unsigned long long) refused, done / ((double) (end - start) / 1e9));
+    printf("latency ns: %s\n", line);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void* producer_thread(void* argument)
+{
+    spawn_producer_t* self = (spawn_producer_t*) argument;
+    spawn_event_t* event;
+    uint32_t i;
+
+    while (!__atomic_load_n(&go, __ATOMIC_ACQUIRE))
+    {
+        sched_yield();
+    }
+
+    for (i = 0; i < events; i++)
+    {
+        event = &self->events[i];
+        event->producer = self->index;
+        event->sequence = i;
+        event->spawned_ns = now_ns();
+        while (spawn_function(event_entry, event, 0) != OSI_OK)
+        {
+            self->refused++;
+            sched_yield();
+            event->spawned_ns = now_ns();
+        }
+        if (interval_us > 0)
+        {
+            usleep(interval_us);
+        }
+    }
+
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void event_entry(void* pValue)
+{
+    spawn_event_t* event = (spawn_event_t*) pValue;
+    uint64_t elapsed = now_ns() - event->spawned_ns;
+
+    pingpong_histogram_record(&latency, (elapsed > UINT32_MAX) ? UINT32_MAX : (uint32_t) elapsed);
+
+    /* Each producer's events are numbered from 0, a gap or a repeat shows here */
+    if (event->sequence != expected[event->producer])
+    {
+        reordered++;
+    }
+    expected[event->producer] = event->sequence + 1;
+
+    __atomic_fetch_add(&dispatched, 1, __ATOMIC_RELEASE);
+}
+
+/*----------------------------------------------------------------------------*/
+
+static OsiReturnVal_e queue_spawn(P_OSI_SPAWN_ENTRY pEntry, void* pValue, unsigned long flags)
+{
+    OsiReturnVal_e status = OSI_OPERATION_FAILED;
+    tSimpleLinkSpawnMsg* Msg;
+
+    (void) flags;
+
+    pthread_mutex_lock(&queue_lock);
+    if (queue_count < SPAWN_QUEUE_SIZE)
+    {
+        Msg = &queue[(queue_head + queue_count) % SPAWN_QUEUE_SIZE];
+        Msg->pEntry = pEntry;
+        Msg->pValue = pValue;
+        queue_count++;
+        pthread_cond_signal(&queue_ready);
+        status = OSI_OK;
+    }
+    pthread_mutex_unlock(&queue_lock);
+
+    return status;
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void* queue_thread(void* argument)
+{
+    tSimpleLinkSpawnMsg Msg;
+
+    (void) argument;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&queue_lock);
+        while (queue_count == 0)
+        {
+            pthread_cond_wait(&queue_ready, &queue_lock);
+        }
+        Msg = queue[queue_head];
+        queue_head = (queue_head + 1) % SPAWN_QUEUE_SIZE;
+        queue_count--;
+        pthread_mutex_unlock(&queue_lock);
+
+        Msg.pEntry(Msg.pValue);
+    }
+
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------*/